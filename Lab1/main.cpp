@@ -16,9 +16,17 @@ ID3D11RenderTargetView* g_pRenderTargetView = nullptr;
 D3D_DRIVER_TYPE g_driverType = D3D_DRIVER_TYPE_NULL;
 D3D_FEATURE_LEVEL g_featureLevel = D3D_FEATURE_LEVEL_11_0;
 
+// Отложенное изменение размера окна
+const UINT_PTR g_SizeMoveTimerId = 1;
+bool g_InSizeMove = false;
+bool g_ResizePending = false;
+UINT g_PendingWidth = 0;
+UINT g_PendingHeight = 0;
+
 HRESULT InitDevice(HWND hWnd);
 void CleanupDevice();
 void Render();
+HRESULT ResizeSurface();
 
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 
@@ -178,12 +186,69 @@ void CleanupDevice()
 
 void Render()
 {
+    if (g_ResizePending && !g_InSizeMove && FAILED(ResizeSurface())) return;
+
+    // Пересоздание не удалось — рисовать некуда; следующий кадр повторит его
+    if (!g_pRenderTargetView) return;
+
     float clearColor[4] = { 0.0f, 0.2f, 0.4f, 1.0f };
     g_pImmediateContext->ClearRenderTargetView(g_pRenderTargetView, clearColor);
 
     g_pSwapChain->Present(0, 0);
 }
 
+// Единственная точка пересоздания ресурсов, зависящих от размера окна.
+// WM_SIZE только запоминает размер; буферы пересоздаются перед кадром,
+// не чаще раза за кадр и не во время перетаскивания рамки.
+HRESULT ResizeSurface()
+{
+    // Освобождаем существующий Render Target View (и отвязываем его от контекста)
+    g_pImmediateContext->OMSetRenderTargets(0, nullptr, nullptr);
+    if (g_pRenderTargetView)
+    {
+        g_pRenderTargetView->Release();
+        g_pRenderTargetView = nullptr;
+    }
+
+    // Изменяем размер буферов SwapChain
+    HRESULT hr = g_pSwapChain->ResizeBuffers(0, g_PendingWidth, g_PendingHeight, DXGI_FORMAT_UNKNOWN, 0);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Получаем новый back buffer и создаем Render Target View
+    ID3D11Texture2D* pBackBuffer = nullptr;
+    hr = g_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&pBackBuffer);
+    if (SUCCEEDED(hr))
+    {
+        hr = g_pd3dDevice->CreateRenderTargetView(pBackBuffer, nullptr, &g_pRenderTargetView);
+        pBackBuffer->Release();
+    }
+
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Привязываем Render Target View к контексту устройства
+    g_pImmediateContext->OMSetRenderTargets(1, &g_pRenderTargetView, nullptr);
+
+    // Обновляем Viewport
+    D3D11_VIEWPORT vp;
+    vp.Width = (FLOAT)g_PendingWidth;
+    vp.Height = (FLOAT)g_PendingHeight;
+    vp.MinDepth = 0.0f;
+    vp.MaxDepth = 1.0f;
+    vp.TopLeftX = 0;
+    vp.TopLeftY = 0;
+    g_pImmediateContext->RSSetViewports(1, &vp);
+
+    // Размер принят, только когда пересоздано всё: при ошибке пересоздание повторится в следующем кадре
+    g_ResizePending = false;
+    return S_OK;
+}
+
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
     switch (message)
@@ -191,44 +256,27 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     case WM_SIZE:
         if (g_pSwapChain && wParam != SIZE_MINIMIZED)
         {
-            if (g_pRenderTargetView)
-            {
-                g_pRenderTargetView->Release();
-                g_pRenderTargetView = nullptr;
-            }
-
-            HRESULT hr = g_pSwapChain->ResizeBuffers(0, LOWORD(lParam), HIWORD(lParam), DXGI_FORMAT_UNKNOWN, 0);
-            if (FAILED(hr))
-            {
-                return DefWindowProc(hWnd, message, wParam, lParam);
-            }
-
-            ID3D11Texture2D* pBackBuffer = nullptr;
-            hr = g_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&pBackBuffer);
-            if (SUCCEEDED(hr))
-            {
-                hr = g_pd3dDevice->CreateRenderTargetView(pBackBuffer, nullptr, &g_pRenderTargetView);
-                pBackBuffer->Release();
-            }
-
-            if (FAILED(hr))
-            {
-                return DefWindowProc(hWnd, message, wParam, lParam);
-            }
-
-            g_pImmediateContext->OMSetRenderTargets(1, &g_pRenderTargetView, nullptr);
-
-            D3D11_VIEWPORT vp;
-            vp.Width = (FLOAT)LOWORD(lParam);
-            vp.Height = (FLOAT)HIWORD(lParam);
-            vp.MinDepth = 0.0f;
-            vp.MaxDepth = 1.0f;
-            vp.TopLeftX = 0;
-            vp.TopLeftY = 0;
-            g_pImmediateContext->RSSetViewports(1, &vp);
+            g_PendingWidth = LOWORD(lParam);
+            g_PendingHeight = HIWORD(lParam);
+            g_ResizePending = g_PendingWidth > 0 && g_PendingHeight > 0;
         }
         break;
 
+    case WM_ENTERSIZEMOVE:
+        // Пока тянут рамку, основной цикл стоит — кадры рисуем по таймеру в старые буферы
+        g_InSizeMove = true;
+        SetTimer(hWnd, g_SizeMoveTimerId, USER_TIMER_MINIMUM, nullptr);
+        break;
+
+    case WM_EXITSIZEMOVE:
+        KillTimer(hWnd, g_SizeMoveTimerId);
+        g_InSizeMove = false;
+        break;
+
+    case WM_TIMER:
+        if (wParam == g_SizeMoveTimerId) Render();
+        break;
+
     case WM_DESTROY:
         PostQuitMessage(0);
         break;
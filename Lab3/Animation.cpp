@@ -0,0 +1,482 @@
+﻿#include "Animation.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+using namespace Math;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Персонажей на одну выдачу потоку: палитры и вершины соседей лежат рядом
+    const size_t CharactersPerBatch = 16;
+
+    double Milliseconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Пакеты персонажей раздаются задачам по счётчику: body(task, first, count);
+    // номер задачи — номер её буфера поз
+    template <typename Body>
+    void ForEachBatch(size_t count, unsigned threadCount, const Body& body)
+    {
+        std::atomic<size_t> next(0);
+        Jobs().RunTasks(threadCount, [&](unsigned task)
+        {
+            for (size_t first = next.fetch_add(CharactersPerBatch); first < count; first = next.fetch_add(CharactersPerBatch))
+                body(task, first, std::min(CharactersPerBatch, count - first));
+        });
+    }
+
+    Float3 Lerp(const Float3& a, const Float3& b, float t)
+    {
+        return Float3(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t);
+    }
+
+    Quaternion Conjugate(const Quaternion& q)
+    {
+        return Quaternion(-q.x, -q.y, -q.z, q.w);
+    }
+
+    Matrix MatrixFromQuaternion(const Quaternion& q)
+    {
+        const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+        return Matrix{ { VectorSet(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f),
+                         VectorSet(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f),
+                         VectorSet(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f),
+                         VectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+    }
+
+    // Обратная к MatrixFromPose: перенос назад, поворот назад, масштаб назад
+    Matrix InversePoseMatrix(const JointPose& pose)
+    {
+        return MatrixTranslation(-pose.translation.x, -pose.translation.y, -pose.translation.z) *
+            MatrixFromQuaternion(Conjugate(pose.rotation)) *
+            MatrixScaling(1.0f / pose.scale.x, 1.0f / pose.scale.y, 1.0f / pose.scale.z);
+    }
+
+    Matrix CharacterWorld(const CharacterInstance& character)
+    {
+        return MatrixScaling(character.scale, character.scale, character.scale) * MatrixRotationY(character.heading) *
+            MatrixTranslation(character.position.x, character.position.y, character.position.z);
+    }
+}
+
+Quaternion QuaternionRotationAxis(const Float3& axis, float angle)
+{
+    float s = 0.0f, c = 0.0f;
+    ScalarSinCos(&s, &c, 0.5f * angle);
+    return Quaternion(axis.x * s, axis.y * s, axis.z * s, c);
+}
+
+Quaternion QuaternionSlerp(const Quaternion& a, const Quaternion& b, float t)
+{
+    // q и -q — один поворот; берём тот, что ближе к a, иначе путь пойдёт в обход
+    float cosAngle = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    const float sign = cosAngle < 0.0f ? -1.0f : 1.0f;
+    cosAngle *= sign;
+
+    float wa = 1.0f - t, wb = t;
+    if (cosAngle < 0.9995f)
+    {
+        const float angle = std::acos(cosAngle);
+        const float inverseSin = 1.0f / std::sin(angle);
+        wa = std::sin((1.0f - t) * angle) * inverseSin;
+        wb = std::sin(t * angle) * inverseSin;
+    }
+    wb *= sign;
+
+    Quaternion result(wa * a.x + wb * b.x, wa * a.y + wb * b.y, wa * a.z + wb * b.z, wa * a.w + wb * b.w);
+    const float inverseLength = 1.0f / std::sqrt(result.x * result.x + result.y * result.y + result.z * result.z + result.w * result.w);
+    result.x *= inverseLength;
+    result.y *= inverseLength;
+    result.z *= inverseLength;
+    result.w *= inverseLength;
+    return result;
+}
+
+Matrix MatrixFromPose(const JointPose& pose)
+{
+    Matrix m = MatrixFromQuaternion(pose.rotation);
+    m.r[0] = VectorMultiply(m.r[0], VectorReplicate(pose.scale.x));
+    m.r[1] = VectorMultiply(m.r[1], VectorReplicate(pose.scale.y));
+    m.r[2] = VectorMultiply(m.r[2], VectorReplicate(pose.scale.z));
+    m.r[3] = VectorSet(pose.translation.x, pose.translation.y, pose.translation.z, 1.0f);
+    return m;
+}
+
+// Определение для ODR-использования (std::min берёт по ссылке); в C++14 без него не собирается при -O0
+const size_t Skeleton::MaxJoints;
+
+void Skeleton::ComputeInverseBind()
+{
+    // Модельная сустава — локальная * модельная родителя, обратная — в обратном порядке
+    std::vector<Matrix> inverseModel(joints.size());
+    for (size_t i = 0; i < joints.size(); ++i)
+    {
+        const Matrix inverseLocal = InversePoseMatrix(joints[i].bindPose);
+        inverseModel[i] = joints[i].parent < 0 ? inverseLocal : inverseModel[joints[i].parent] * inverseLocal;
+        StoreFloat4x4(&joints[i].inverseBind, inverseModel[i]);
+    }
+}
+
+void AnimationClip::Sample(const Skeleton& skeleton, float time, JointPose* poses) const
+{
+    float local = std::fmod(time, duration);
+    if (local < 0.0f) local += duration;
+
+    for (size_t joint = 0; joint < skeleton.joints.size(); ++joint)
+    {
+        if (joint >= tracks.size() || tracks[joint].keys.empty())
+        {
+            poses[joint] = skeleton.joints[joint].bindPose;
+            continue;
+        }
+
+        const JointTrack& track = tracks[joint];
+        const size_t next = std::upper_bound(track.times.begin(), track.times.end(), local) - track.times.begin();
+        if (next == 0 || next == track.keys.size())
+        {
+            poses[joint] = track.keys[next == 0 ? 0 : next - 1];
+            continue;
+        }
+
+        const JointPose& a = track.keys[next - 1];
+        const JointPose& b = track.keys[next];
+        const float span = track.times[next] - track.times[next - 1];
+        const float t = span > 0.0f ? (local - track.times[next - 1]) / span : 0.0f;
+        poses[joint].translation = Lerp(a.translation, b.translation, t);
+        poses[joint].rotation = QuaternionSlerp(a.rotation, b.rotation, t);
+        poses[joint].scale = Lerp(a.scale, b.scale, t);
+    }
+}
+
+void CreateProceduralCharacter(uint32_t jointCount, uint32_t ringVertices, Skeleton& skeleton, AnimationClip& clip, SkinnedMesh& mesh)
+{
+    jointCount = std::max(1u, std::min(jointCount, (uint32_t)Skeleton::MaxJoints));
+    ringVertices = std::max(3u, ringVertices);
+
+    const float height = 2.0f;
+    const float segment = height / jointCount;
+
+    skeleton.joints.assign(jointCount, Joint());
+    for (uint32_t i = 0; i < jointCount; ++i)
+    {
+        Joint& joint = skeleton.joints[i];
+        joint.name = "segment" + std::to_string(i);
+        joint.parent = (int32_t)i - 1;
+        joint.bindPose.translation = Float3(0.0f, i == 0 ? 0.0f : segment, 0.0f);
+    }
+    skeleton.ComputeInverseBind();
+
+    // Волна изгиба бежит вверх по стеблю; последний ключ совпадает с первым — клип зациклен
+    const float keyStep = 0.25f;
+    const uint32_t keyCount = 9;
+    clip.name = "sway";
+    clip.duration = keyStep * (keyCount - 1);
+    clip.tracks.assign(jointCount, JointTrack());
+    for (uint32_t i = 0; i < jointCount; ++i)
+    {
+        JointTrack& track = clip.tracks[i];
+        const float amplitude = 0.35f / std::sqrt((float)jointCount);
+        for (uint32_t key = 0; key < keyCount; ++key)
+        {
+            const float phase = TwoPi * key / (keyCount - 1) - 0.45f * i;
+            JointPose pose = skeleton.joints[i].bindPose;
+            const Quaternion bend = QuaternionRotationAxis(Float3(0.0f, 0.0f, 1.0f), amplitude * std::sin(phase));
+            const Quaternion twist = QuaternionRotationAxis(Float3(1.0f, 0.0f, 0.0f), 0.5f * amplitude * std::cos(phase));
+            pose.rotation = Quaternion(
+                bend.w * twist.x + bend.x * twist.w + bend.y * twist.z - bend.z * twist.y,
+                bend.w * twist.y - bend.x * twist.z + bend.y * twist.w + bend.z * twist.x,
+                bend.w * twist.z + bend.x * twist.y - bend.y * twist.x + bend.z * twist.w,
+                bend.w * twist.w - bend.x * twist.x - bend.y * twist.y - bend.z * twist.z);
+            if (i == 0) pose.translation.y = 0.05f * (1.0f + std::sin(2.0f * phase));
+            track.times.push_back(keyStep * key);
+            track.keys.push_back(pose);
+        }
+    }
+
+    // Трубка: два кольца на сегмент и одно сверху, плюс центры крышек
+    const uint32_t ringCount = 2 * jointCount + 1;
+    mesh.positions.clear();
+    mesh.colors.clear();
+    mesh.skin.clear();
+    mesh.indices.clear();
+    for (uint32_t ring = 0; ring < ringCount; ++ring)
+    {
+        const float f = (float)ring / 2.0f; // высота в сегментах
+        const float radius = 0.18f - 0.12f * f / jointCount;
+        const uint32_t joint = std::min((uint32_t)f, jointCount - 1);
+        const float fraction = f - joint;
+
+        // Вес соседа растёт к границе сегмента: у самой границы суставы делят вершину пополам
+        SkinWeights skin;
+        skin.joints[0] = (uint8_t)joint;
+        skin.weights[0] = 1.0f;
+        if (fraction < 0.5f && joint > 0)
+        {
+            skin.joints[1] = (uint8_t)(joint - 1);
+            skin.weights[1] = 0.5f - fraction;
+        }
+        else if (fraction > 0.5f && joint + 1 < jointCount)
+        {
+            skin.joints[1] = (uint8_t)(joint + 1);
+            skin.weights[1] = fraction - 0.5f;
+        }
+        skin.weights[0] = 1.0f - skin.weights[1];
+
+        const float shade = 0.35f + 0.65f * f / jointCount;
+        for (uint32_t i = 0; i < ringVertices; ++i)
+        {
+            float s = 0.0f, c = 0.0f;
+            ScalarSinCos(&s, &c, TwoPi * i / ringVertices);
+            mesh.positions.push_back(Float3(radius * c, f * segment, radius * s));
+            mesh.colors.push_back(Float4(0.25f * shade, (i & 1) ? 0.8f * shade : shade, 0.3f, 1.0f));
+            mesh.skin.push_back(skin);
+        }
+    }
+
+    const uint32_t bottom = (uint32_t)mesh.positions.size();
+    SkinWeights rootSkin;
+    rootSkin.weights[0] = 1.0f;
+    mesh.positions.push_back(Float3(0.0f, 0.0f, 0.0f));
+    mesh.colors.push_back(Float4(0.1f, 0.3f, 0.1f, 1.0f));
+    mesh.skin.push_back(rootSkin);
+
+    SkinWeights tipSkin;
+    tipSkin.joints[0] = (uint8_t)(jointCount - 1);
+    tipSkin.weights[0] = 1.0f;
+    mesh.positions.push_back(Float3(0.0f, height, 0.0f));
+    mesh.colors.push_back(Float4(0.9f, 0.9f, 0.4f, 1.0f));
+    mesh.skin.push_back(tipSkin);
+    const uint32_t top = bottom + 1;
+
+    // Обход по часовой стрелке снаружи, как у куба
+    for (uint32_t ring = 0; ring + 1 < ringCount; ++ring)
+    {
+        for (uint32_t i = 0; i < ringVertices; ++i)
+        {
+            const uint32_t a = ring * ringVertices + i;
+            const uint32_t b = ring * ringVertices + (i + 1) % ringVertices;
+            const uint32_t c = a + ringVertices;
+            const uint32_t d = b + ringVertices;
+            mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+        }
+    }
+    const uint32_t topRing = (ringCount - 1) * ringVertices;
+    for (uint32_t i = 0; i < ringVertices; ++i)
+    {
+        const uint32_t next = (i + 1) % ringVertices;
+        mesh.indices.insert(mesh.indices.end(), { bottom, i, next });
+        mesh.indices.insert(mesh.indices.end(), { top, topRing + next, topRing + i });
+    }
+}
+
+void ComputeSkinMatrices(const Skeleton& skeleton, const JointPose* poses, const Matrix& world, Float4x4* palette)
+{
+    // Родитель раньше потомка — модельно-мировые считаются одним проходом
+    Matrix modelWorld[Skeleton::MaxJoints];
+    const size_t jointCount = std::min(skeleton.joints.size(), Skeleton::MaxJoints);
+    for (size_t i = 0; i < jointCount; ++i)
+    {
+        const int32_t parent = skeleton.joints[i].parent;
+        modelWorld[i] = MatrixFromPose(poses[i]) * (parent < 0 ? world : modelWorld[parent]);
+        StoreFloat4x4(&palette[i], LoadFloat4x4(&skeleton.joints[i].inverseBind) * modelWorld[i]);
+    }
+}
+
+void SkinVertices(const SkinnedMesh& mesh, const Float4x4* palette, float* output)
+{
+    const size_t count = mesh.VertexCount();
+    for (size_t v = 0; v < count; ++v)
+    {
+        const Float3& p = mesh.positions[v];
+        const SkinWeights& skin = mesh.skin[v];
+        const Vector x = VectorReplicate(p.x), y = VectorReplicate(p.y), z = VectorReplicate(p.z);
+
+        // Вершина переводится каждой костью и смешивается по весам; веса по
+        // убыванию, так что на первом нуле кости кончаются
+        Vector result = VectorZero();
+        for (int i = 0; i < 4 && skin.weights[i] > 0.0f; ++i)
+        {
+            const Matrix bone = LoadFloat4x4(&palette[skin.joints[i]]);
+            Vector transformed = VectorAdd(VectorMultiply(z, bone.r[2]), bone.r[3]);
+            transformed = VectorAdd(VectorMultiply(y, bone.r[1]), transformed);
+            transformed = VectorAdd(VectorMultiply(x, bone.r[0]), transformed);
+            result = VectorAdd(VectorMultiply(VectorReplicate(skin.weights[i]), transformed), result);
+        }
+
+        // Позиция пишется четырьмя float, четвёртый тут же затирает цвет
+        float* vertex = output + v * SkinnedMesh::VertexFloats;
+        StoreFloat4(reinterpret_cast<Float4*>(vertex), result);
+        StoreFloat4(reinterpret_cast<Float4*>(vertex + 3), LoadFloat4(&mesh.colors[v]));
+    }
+}
+
+void SkinVerticesScalar(const SkinnedMesh& mesh, const Float4x4* palette, float* output)
+{
+    const size_t count = mesh.VertexCount();
+    for (size_t v = 0; v < count; ++v)
+    {
+        const Float3& p = mesh.positions[v];
+        const SkinWeights& skin = mesh.skin[v];
+        float result[3] = {};
+        for (int i = 0; i < 4; ++i)
+        {
+            if (skin.weights[i] == 0.0f) continue;
+            const Float4x4& bone = palette[skin.joints[i]];
+            for (int c = 0; c < 3; ++c)
+                result[c] += skin.weights[i] * (p.x * bone.m[0][c] + p.y * bone.m[1][c] + p.z * bone.m[2][c] + bone.m[3][c]);
+        }
+
+        float* vertex = output + v * SkinnedMesh::VertexFloats;
+        vertex[0] = result[0];
+        vertex[1] = result[1];
+        vertex[2] = result[2];
+        vertex[3] = mesh.colors[v].x;
+        vertex[4] = mesh.colors[v].y;
+        vertex[5] = mesh.colors[v].z;
+        vertex[6] = mesh.colors[v].w;
+    }
+}
+
+void CrowdAnimator::Init(const Skeleton& skeleton, const AnimationClip& clip, const SkinnedMesh& mesh)
+{
+    m_Skeleton = skeleton;
+    m_Clip = clip;
+    m_Mesh = mesh;
+    m_CharacterCount = 0;
+    m_Palette.clear();
+    m_Skinned.clear();
+    m_Stats = AnimationStats();
+    m_Stats.joints = m_Skeleton.joints.size();
+    m_Stats.vertices = m_Mesh.VertexCount();
+}
+
+void CrowdAnimator::EvaluatePoses(const std::vector<CharacterInstance>& characters, float t, unsigned threadCount)
+{
+    const Clock::time_point start = Clock::now();
+    threadCount = std::max(1u, std::min(threadCount, (unsigned)((characters.size() + CharactersPerBatch - 1) / CharactersPerBatch)));
+
+    const size_t jointCount = JointCount();
+    m_CharacterCount = characters.size();
+    m_Palette.resize(m_CharacterCount * jointCount);
+    if (m_ThreadPoses.size() < threadCount) m_ThreadPoses.resize(threadCount);
+    for (unsigned thread = 0; thread < threadCount; ++thread)
+        m_ThreadPoses[thread].resize(jointCount);
+
+    ForEachBatch(m_CharacterCount, threadCount, [&](unsigned thread, size_t first, size_t count)
+    {
+        JointPose* poses = m_ThreadPoses[thread].data();
+        for (size_t i = first; i < first + count; ++i)
+        {
+            const CharacterInstance& character = characters[i];
+            m_Clip.Sample(m_Skeleton, character.phase + t * character.speed, poses);
+            ComputeSkinMatrices(m_Skeleton, poses, CharacterWorld(character), &m_Palette[i * jointCount]);
+        }
+    });
+
+    m_Stats.characters = m_CharacterCount;
+    m_Stats.threads = threadCount;
+    m_Stats.poseMs = Milliseconds(start);
+}
+
+void CrowdAnimator::SkinOnCpu(unsigned threadCount)
+{
+    const Clock::time_point start = Clock::now();
+    threadCount = std::max(1u, std::min(threadCount, (unsigned)((m_CharacterCount + CharactersPerBatch - 1) / CharactersPerBatch)));
+
+    const size_t jointCount = JointCount();
+    const size_t characterFloats = m_Mesh.VertexCount() * SkinnedMesh::VertexFloats;
+    m_Skinned.resize(m_CharacterCount * characterFloats);
+
+    ForEachBatch(m_CharacterCount, threadCount, [&](unsigned, size_t first, size_t count)
+    {
+        for (size_t i = first; i < first + count; ++i)
+            SkinVertices(m_Mesh, &m_Palette[i * jointCount], &m_Skinned[i * characterFloats]);
+    });
+
+    m_Stats.skinMs = Milliseconds(start);
+}
+
+size_t CrowdAnimator::CapacityBytes() const
+{
+    size_t bytes = m_Palette.capacity() * sizeof(Float4x4) + m_Skinned.capacity() * sizeof(float);
+    bytes += m_Mesh.positions.capacity() * sizeof(Float3) + m_Mesh.colors.capacity() * sizeof(Float4) +
+        m_Mesh.skin.capacity() * sizeof(SkinWeights) + m_Mesh.indices.capacity() * sizeof(uint32_t);
+    for (const std::vector<JointPose>& poses : m_ThreadPoses)
+        bytes += poses.capacity() * sizeof(JointPose);
+    return bytes;
+}
+
+AnimationBenchmark BenchmarkAnimation(size_t characterCount, unsigned threadCount)
+{
+    AnimationBenchmark result;
+    threadCount = std::max(1u, threadCount);
+
+    Skeleton skeleton;
+    AnimationClip clip;
+    SkinnedMesh mesh;
+    CreateProceduralCharacter(16, 16, skeleton, clip, mesh);
+
+    // Толпа квадратом, с разными фазами и скоростями, чтобы позы не совпадали
+    std::vector<CharacterInstance> characters(characterCount);
+    const size_t side = std::max<size_t>(1, (size_t)std::ceil(std::sqrt((double)characterCount)));
+    for (size_t i = 0; i < characterCount; ++i)
+    {
+        characters[i].position = Float3(1.5f * (i % side), 0.0f, 1.5f * (i / side));
+        characters[i].heading = 0.37f * i;
+        characters[i].phase = 0.113f * i;
+        characters[i].speed = 0.8f + 0.05f * (i % 9);
+    }
+
+    CrowdAnimator crowd;
+    crowd.Init(skeleton, clip, mesh);
+
+    result.characters = characterCount;
+    result.joints = crowd.JointCount();
+    result.vertices = mesh.VertexCount();
+    result.threads = threadCount;
+    result.poseMs = result.skinMs = result.scalarSkinMs = result.simdSkinMs = INFINITY;
+
+    const size_t characterFloats = mesh.VertexCount() * SkinnedMesh::VertexFloats;
+    std::vector<float> scalar(characterCount * characterFloats), simd(characterCount * characterFloats);
+
+    const int repeats = 5;
+    for (int repeat = 0; repeat < repeats; ++repeat)
+    {
+        const float t = 0.1f * repeat;
+        crowd.EvaluatePoses(characters, t, threadCount);
+        result.poseMs = std::min(result.poseMs, crowd.Stats().poseMs);
+        crowd.SkinOnCpu(threadCount);
+        result.skinMs = std::min(result.skinMs, crowd.Stats().skinMs);
+
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < characterCount; ++i)
+            SkinVertices(mesh, &crowd.Palette()[i * result.joints], &simd[i * characterFloats]);
+        result.simdSkinMs = std::min(result.simdSkinMs, Milliseconds(start));
+
+        start = Clock::now();
+        for (size_t i = 0; i < characterCount; ++i)
+            SkinVerticesScalar(mesh, &crowd.Palette()[i * result.joints], &scalar[i * characterFloats]);
+        result.scalarSkinMs = std::min(result.scalarSkinMs, Milliseconds(start));
+    }
+
+    const std::vector<float>& skinned = crowd.SkinnedVertices();
+    for (size_t i = 0; i < scalar.size(); ++i)
+    {
+        result.maxError = std::max(result.maxError, (double)std::fabs(skinned[i] - scalar[i]));
+        result.maxError = std::max(result.maxError, (double)std::fabs(simd[i] - scalar[i]));
+    }
+
+    if (result.poseMs > 0.0) result.posesPerMs = characterCount / result.poseMs;
+    if (result.poseMs + result.skinMs > 0.0) result.charactersPerMs = characterCount / (result.poseMs + result.skinMs);
+    return result;
+}
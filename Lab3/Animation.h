@@ -0,0 +1,178 @@
+﻿#pragma once
+
+// Скелетная анимация: выборка клипа с интерполяцией кватернионов, поза скелета
+// и линейное смешивание вершин по костям (LBS). Позы персонажей толпы считаются
+// параллельно в одну палитру матриц; дальше скиннинг либо на GPU по этой
+// палитре (буфер костей, main.cpp), либо здесь, на CPU, пакетом на VectorMath
+// (SSE/NEON) — в формат вершин приложения, который рисует обычный путь и
+// программный растеризатор. D3D здесь нет.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "VectorMath.h"
+
+// Единичный кватернион поворота: (x, y, z) = ось * sin(угол / 2), w = cos(угол / 2)
+struct Quaternion
+{
+    float x = 0.0f, y = 0.0f, z = 0.0f, w = 1.0f;
+
+    Quaternion() = default;
+    Quaternion(float x_, float y_, float z_, float w_) : x(x_), y(y_), z(z_), w(w_) {}
+};
+
+Quaternion QuaternionRotationAxis(const Math::Float3& axis, float angle); // ось единичная
+
+// Сферическая интерполяция по короткой дуге; почти совпадающие — линейно с нормализацией
+Quaternion QuaternionSlerp(const Quaternion& a, const Quaternion& b, float t);
+
+// Локальное преобразование сустава относительно родителя
+struct JointPose
+{
+    Math::Float3 translation = Math::Float3(0.0f, 0.0f, 0.0f);
+    Quaternion rotation;
+    Math::Float3 scale = Math::Float3(1.0f, 1.0f, 1.0f);
+};
+
+// Масштаб, поворот, перенос — в порядке умножения строк (v * M), как мировые матрицы
+Math::Matrix MatrixFromPose(const JointPose& pose);
+
+struct Joint
+{
+    std::string name;
+    int32_t parent = -1;       // -1 — корень; родитель всегда раньше потомка
+    JointPose bindPose;        // локальная поза привязки
+    Math::Float4x4 inverseBind; // из пространства модели в пространство сустава в позе привязки
+};
+
+struct Skeleton
+{
+    static const size_t MaxJoints = 256; // номер кости в вершине — байт
+
+    std::vector<Joint> joints;
+
+    // inverseBind по bindPose всех суставов
+    void ComputeInverseBind();
+};
+
+// Ключи одного сустава; без ключей сустав стоит в позе привязки
+struct JointTrack
+{
+    std::vector<float> times; // по возрастанию, от 0 до длительности клипа
+    std::vector<JointPose> keys;
+};
+
+struct AnimationClip
+{
+    std::string name;
+    float duration = 1.0f;
+    std::vector<JointTrack> tracks; // по суставу скелета
+
+    // Локальные позы в момент time (клип зациклен): перенос и масштаб — линейно, поворот — slerp
+    void Sample(const Skeleton& skeleton, float time, JointPose* poses) const;
+};
+
+// До четырёх костей на вершину; веса по убыванию, сумма 1, лишние — нулевые
+struct SkinWeights
+{
+    uint8_t joints[4] = {};
+    float weights[4] = {};
+};
+
+struct SkinnedMesh
+{
+    static const size_t VertexFloats = 7; // выход скиннинга: xyz и rgba, как SimpleVertex
+
+    std::vector<Math::Float3> positions; // в позе привязки
+    std::vector<Math::Float4> colors;
+    std::vector<SkinWeights> skin;
+    std::vector<uint32_t> indices;
+
+    size_t VertexCount() const { return positions.size(); }
+};
+
+// Процедурный персонаж: гибкий стебель из цепочки суставов, трубка из колец
+// вершин с весами двух соседних суставов и клип покачивания с ключами через
+// четверть секунды. Для толпы и для замеров, пока нет импорта скелетных моделей
+void CreateProceduralCharacter(uint32_t jointCount, uint32_t ringVertices, Skeleton& skeleton, AnimationClip& clip, SkinnedMesh& mesh);
+
+// Персонаж в мире: общий скелет, клип и меш, свои положение и фаза
+struct CharacterInstance
+{
+    Math::Float3 position = Math::Float3(0.0f, 0.0f, 0.0f);
+    float heading = 0.0f; // поворот вокруг Y, радианы
+    float scale = 1.0f;
+    float phase = 0.0f;   // сдвиг по времени клипа, секунды
+    float speed = 1.0f;   // скорость проигрывания
+};
+
+// Палитра персонажа: inverseBind * модельная * мировая для каждого сустава,
+// построчно (v * M) — так её читают и LBS, и вершинный шейдер
+void ComputeSkinMatrices(const Skeleton& skeleton, const JointPose* poses, const Math::Matrix& world, Math::Float4x4* palette);
+
+// LBS одной копии меша: output — VertexFloats на вершину, позиция и цвет.
+// SkinVertices — пакетом на VectorMath, SkinVerticesScalar — построчно, для сверки
+void SkinVertices(const SkinnedMesh& mesh, const Math::Float4x4* palette, float* output);
+void SkinVerticesScalar(const SkinnedMesh& mesh, const Math::Float4x4* palette, float* output);
+
+struct AnimationStats
+{
+    size_t characters = 0;
+    size_t joints = 0;        // на персонажа
+    size_t vertices = 0;      // на персонажа
+    double poseMs = 0.0;      // выборка клипа и палитры, все потоки
+    double skinMs = 0.0;      // CPU-скиннинг последнего SkinOnCpu; 0 — не было
+    unsigned threads = 0;
+};
+
+// Толпа персонажей с общим скелетом, клипом и мешем
+class CrowdAnimator
+{
+public:
+    void Init(const Skeleton& skeleton, const AnimationClip& clip, const SkinnedMesh& mesh);
+
+    // Позы всех персонажей в момент t; палитры подряд, по JointCount() на персонажа
+    void EvaluatePoses(const std::vector<CharacterInstance>& characters, float t, unsigned threadCount);
+
+    // LBS по текущим палитрам; вершины персонажей подряд, VertexFloats на вершину
+    void SkinOnCpu(unsigned threadCount);
+
+    size_t JointCount() const { return m_Skeleton.joints.size(); }
+    size_t CharacterCount() const { return m_CharacterCount; }
+    const Skeleton& GetSkeleton() const { return m_Skeleton; }
+    const SkinnedMesh& Mesh() const { return m_Mesh; }
+    const std::vector<Math::Float4x4>& Palette() const { return m_Palette; }
+    const std::vector<float>& SkinnedVertices() const { return m_Skinned; }
+    const AnimationStats& Stats() const { return m_Stats; }
+    size_t CapacityBytes() const;
+
+private:
+    Skeleton m_Skeleton;
+    AnimationClip m_Clip;
+    SkinnedMesh m_Mesh;
+    size_t m_CharacterCount = 0;
+    std::vector<Math::Float4x4> m_Palette;
+    std::vector<float> m_Skinned;
+    std::vector<std::vector<JointPose>> m_ThreadPoses;
+    AnimationStats m_Stats;
+};
+
+struct AnimationBenchmark
+{
+    size_t characters = 0;
+    size_t joints = 0;
+    size_t vertices = 0;       // на персонажа
+    unsigned threads = 0;
+    double poseMs = 0.0;       // все персонажи, все потоки
+    double skinMs = 0.0;       // CPU-скиннинг пакетом, все потоки
+    double scalarSkinMs = 0.0; // построчный скиннинг в одном потоке
+    double simdSkinMs = 0.0;   // пакетный в одном потоке
+    double charactersPerMs = 0.0; // поза и скиннинг на CPU вместе
+    double posesPerMs = 0.0;      // только позы — столько персонажей тянет GPU-скиннинг со стороны CPU
+    double maxError = 0.0;        // пакетный против построчного, по координате
+};
+
+// Лучшее из нескольких повторов для каждого размера толпы
+AnimationBenchmark BenchmarkAnimation(size_t characterCount, unsigned threadCount);
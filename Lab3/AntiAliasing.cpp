@@ -0,0 +1,268 @@
+﻿#include "AntiAliasing.h"
+
+#include <d3dcompiler.h>
+
+namespace
+{
+    // Треугольник на весь экран по SV_VertexID, без вершинного буфера
+    const char* fullscreenVertexShaderCode = R"(
+struct VS_OUTPUT
+{
+    float4 Pos : SV_POSITION;
+    float2 Uv : TEXCOORD0;
+};
+
+VS_OUTPUT main(uint id : SV_VertexID)
+{
+    VS_OUTPUT output;
+    output.Uv = float2((id << 1) & 2, id & 2);
+    output.Pos = float4(output.Uv * float2(2, -2) + float2(-1, 1), 0, 1);
+    return output;
+}
+)";
+
+    const char* fxaaPixelShaderCode = R"(
+Texture2D Source : register(t0);
+SamplerState LinearClamp : register(s0);
+
+cbuffer FxaaConstants : register(b0)
+{
+    float4 RcpFrame; // 1 / ширина, 1 / высота
+};
+
+static const float EdgeThresholdMin = 0.0312;
+static const float EdgeThreshold = 0.125;
+static const float SubpixelQuality = 0.75;
+static const int SearchSteps = 12;
+static const float StepScale[SearchSteps] = { 1, 1, 1, 1, 1, 1.5, 2, 2, 2, 2, 4, 8 };
+
+float Luma(float2 uv)
+{
+    return dot(Source.SampleLevel(LinearClamp, uv, 0).rgb, float3(0.299, 0.587, 0.114));
+}
+
+float4 main(float4 pos : SV_POSITION, float2 uv : TEXCOORD0) : SV_Target
+{
+    float2 texel = RcpFrame.xy;
+    float4 center = Source.SampleLevel(LinearClamp, uv, 0);
+    float lumaM = dot(center.rgb, float3(0.299, 0.587, 0.114));
+    float lumaN = Luma(uv + float2(0, -texel.y));
+    float lumaS = Luma(uv + float2(0, texel.y));
+    float lumaW = Luma(uv + float2(-texel.x, 0));
+    float lumaE = Luma(uv + float2(texel.x, 0));
+
+    // Малый перепад яркости — не край
+    float lumaMin = min(lumaM, min(min(lumaN, lumaS), min(lumaW, lumaE)));
+    float lumaMax = max(lumaM, max(max(lumaN, lumaS), max(lumaW, lumaE)));
+    float range = lumaMax - lumaMin;
+    if (range < max(EdgeThresholdMin, lumaMax * EdgeThreshold))
+        return center;
+
+    float lumaNW = Luma(uv + float2(-texel.x, -texel.y));
+    float lumaNE = Luma(uv + float2(texel.x, -texel.y));
+    float lumaSW = Luma(uv + float2(-texel.x, texel.y));
+    float lumaSE = Luma(uv + float2(texel.x, texel.y));
+
+    // Горизонтальный край — яркость резче меняется по вертикали
+    float edgeHorizontal = abs(lumaNW + lumaSW - 2 * lumaW) + 2 * abs(lumaN + lumaS - 2 * lumaM) + abs(lumaNE + lumaSE - 2 * lumaE);
+    float edgeVertical = abs(lumaNW + lumaNE - 2 * lumaN) + 2 * abs(lumaW + lumaE - 2 * lumaM) + abs(lumaSW + lumaSE - 2 * lumaS);
+    bool horizontal = edgeHorizontal >= edgeVertical;
+
+    // Сторона края: соседний пиксель поперёк края с наибольшим перепадом
+    float luma1 = horizontal ? lumaN : lumaW;
+    float luma2 = horizontal ? lumaS : lumaE;
+    float gradient1 = luma1 - lumaM;
+    float gradient2 = luma2 - lumaM;
+    bool side1 = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+    float stepLength = horizontal ? texel.y : texel.x;
+    float lumaLocalAverage = 0.5 * ((side1 ? luma1 : luma2) + lumaM);
+    if (side1) stepLength = -stepLength;
+
+    // Поиск концов края в обе стороны вдоль него, по середине между пикселями
+    float2 edgeUv = uv;
+    if (horizontal) edgeUv.y += stepLength * 0.5;
+    else edgeUv.x += stepLength * 0.5;
+    float2 offset = horizontal ? float2(texel.x, 0) : float2(0, texel.y);
+
+    float2 uv1 = edgeUv;
+    float2 uv2 = edgeUv;
+    float lumaEnd1 = 0;
+    float lumaEnd2 = 0;
+    bool reached1 = false;
+    bool reached2 = false;
+    [unroll]
+    for (int i = 0; i < SearchSteps; ++i)
+    {
+        if (!reached1)
+        {
+            uv1 -= offset * StepScale[i];
+            lumaEnd1 = Luma(uv1) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+        }
+        if (!reached2)
+        {
+            uv2 += offset * StepScale[i];
+            lumaEnd2 = Luma(uv2) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+        }
+    }
+
+    float distance1 = horizontal ? uv.x - uv1.x : uv.y - uv1.y;
+    float distance2 = horizontal ? uv2.x - uv.x : uv2.y - uv.y;
+    bool nearer1 = distance1 < distance2;
+    float pixelOffset = 0.5 - min(distance1, distance2) / (distance1 + distance2);
+
+    // Сдвиг, только если ближний конец края меняет яркость в ту же сторону, что и центр
+    bool centerDarker = lumaM < lumaLocalAverage;
+    bool correct = ((nearer1 ? lumaEnd1 : lumaEnd2) < 0) != centerDarker;
+    float finalOffset = correct ? pixelOffset : 0;
+
+    // Субпиксельное сглаживание — по отличию центра от среднего окрестности
+    float lumaAverage = (2 * (lumaN + lumaS + lumaW + lumaE) + lumaNW + lumaNE + lumaSW + lumaSE) / 12;
+    float subpixel = saturate(abs(lumaAverage - lumaM) / range);
+    subpixel = (-2 * subpixel + 3) * subpixel * subpixel;
+    finalOffset = max(finalOffset, subpixel * subpixel * SubpixelQuality);
+
+    float2 finalUv = uv;
+    if (horizontal) finalUv.y += finalOffset * stepLength;
+    else finalUv.x += finalOffset * stepLength;
+    return float4(Source.SampleLevel(LinearClamp, finalUv, 0).rgb, center.a);
+}
+)";
+
+    struct FxaaConstants
+    {
+        float rcpFrame[4];
+    };
+}
+
+const char* AntiAliasingName(AntiAliasingMode mode)
+{
+    switch (mode)
+    {
+    case AntiAliasingMode::None: return "none";
+    case AntiAliasingMode::Msaa2x: return "MSAA 2x";
+    case AntiAliasingMode::Msaa4x: return "MSAA 4x";
+    case AntiAliasingMode::Msaa8x: return "MSAA 8x";
+    case AntiAliasingMode::Fxaa: return "FXAA";
+    default: return "unknown";
+    }
+}
+
+bool ParseAntiAliasing(const std::string& name, AntiAliasingMode& mode)
+{
+    if (name == "none") mode = AntiAliasingMode::None;
+    else if (name == "msaa2") mode = AntiAliasingMode::Msaa2x;
+    else if (name == "msaa4") mode = AntiAliasingMode::Msaa4x;
+    else if (name == "msaa8") mode = AntiAliasingMode::Msaa8x;
+    else if (name == "fxaa") mode = AntiAliasingMode::Fxaa;
+    else return false;
+    return true;
+}
+
+UINT SampleCount(AntiAliasingMode mode)
+{
+    switch (mode)
+    {
+    case AntiAliasingMode::Msaa2x: return 2;
+    case AntiAliasingMode::Msaa4x: return 4;
+    case AntiAliasingMode::Msaa8x: return 8;
+    default: return 1;
+    }
+}
+
+UINT SupportedSampleCount(ID3D11Device* pDevice, DXGI_FORMAT format, UINT requested)
+{
+    for (UINT count = requested; count > 1; count /= 2)
+    {
+        UINT colorLevels = 0, depthLevels = 0;
+        if (SUCCEEDED(pDevice->CheckMultisampleQualityLevels(format, count, &colorLevels)) && colorLevels > 0 &&
+            SUCCEEDED(pDevice->CheckMultisampleQualityLevels(DXGI_FORMAT_D24_UNORM_S8_UINT, count, &depthLevels)) && depthLevels > 0)
+        {
+            return count;
+        }
+    }
+    return 1;
+}
+
+HRESULT CreateFullscreenVertexShader(ID3D11Device* pDevice, Microsoft::WRL::ComPtr<ID3D11VertexShader>& vertexShader)
+{
+    Microsoft::WRL::ComPtr<ID3DBlob> pVSBlob;
+    HRESULT hr = D3DCompile(fullscreenVertexShaderCode, strlen(fullscreenVertexShaderCode), "fullscreenVertexShader", nullptr, nullptr, "main", "vs_5_0", 0, 0, &pVSBlob, nullptr);
+    if (FAILED(hr)) return hr;
+
+    return pDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, vertexShader.ReleaseAndGetAddressOf());
+}
+
+HRESULT FxaaPass::Init(ID3D11Device* pDevice)
+{
+    Release();
+
+    HRESULT hr = CreateFullscreenVertexShader(pDevice, m_pVertexShader);
+    if (FAILED(hr)) return hr;
+
+    Microsoft::WRL::ComPtr<ID3DBlob> pPSBlob;
+    hr = D3DCompile(fxaaPixelShaderCode, strlen(fxaaPixelShaderCode), "fxaaPixelShader", nullptr, nullptr, "main", "ps_5_0", 0, 0, &pPSBlob, nullptr);
+    if (FAILED(hr)) return hr;
+
+    hr = pDevice->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, m_pPixelShader.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    // Билинейная выборка без повтора: поиск края не должен заходить на другой край кадра
+    D3D11_SAMPLER_DESC sd = {};
+    sd.Filter = D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT;
+    sd.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+    sd.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+    sd.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+    sd.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    sd.MaxLOD = D3D11_FLOAT32_MAX;
+    hr = pDevice->CreateSamplerState(&sd, m_pSampler.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DEFAULT;
+    bd.ByteWidth = sizeof(FxaaConstants);
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    return pDevice->CreateBuffer(&bd, nullptr, m_pConstants.GetAddressOf());
+}
+
+void FxaaPass::Release()
+{
+    m_pVertexShader.Reset();
+    m_pPixelShader.Reset();
+    m_pSampler.Reset();
+    m_pConstants.Reset();
+    m_Width = m_Height = 0;
+}
+
+void FxaaPass::Apply(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSource, ID3D11RenderTargetView* pTarget, UINT width, UINT height)
+{
+    if (width != m_Width || height != m_Height)
+    {
+        FxaaConstants constants = { { 1.0f / width, 1.0f / height, 0.0f, 0.0f } };
+        pContext->UpdateSubresource(m_pConstants.Get(), 0, nullptr, &constants, 0, 0);
+        m_Width = width;
+        m_Height = height;
+    }
+
+    pContext->OMSetRenderTargets(1, &pTarget, nullptr);
+    D3D11_VIEWPORT vp = {};
+    vp.Width = (FLOAT)width;
+    vp.Height = (FLOAT)height;
+    vp.MaxDepth = 1.0f;
+    pContext->RSSetViewports(1, &vp);
+
+    pContext->IASetInputLayout(nullptr);
+    pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    pContext->VSSetShader(m_pVertexShader.Get(), nullptr, 0);
+    pContext->PSSetShader(m_pPixelShader.Get(), nullptr, 0);
+    pContext->PSSetShaderResources(0, 1, &pSource);
+    pContext->PSSetSamplers(0, 1, m_pSampler.GetAddressOf());
+    pContext->PSSetConstantBuffers(0, 1, m_pConstants.GetAddressOf());
+    pContext->Draw(3, 0);
+
+    // Источник снова станет целью рендеринга — отвязываем его от шейдера
+    ID3D11ShaderResourceView* pNull = nullptr;
+    pContext->PSSetShaderResources(0, 1, &pNull);
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <string>
+
+// Режимы сглаживания. Цепочка обмена во flip-модели не бывает многовыборочной,
+// поэтому MSAA рисуется во временную многовыборочную цель и разрешается
+// (ResolveSubresource) в back buffer. FXAA — постобработка готового кадра:
+// сцена рисуется в обычную временную цель, а проход FxaaPass пишет в back buffer.
+enum class AntiAliasingMode
+{
+    None,
+    Msaa2x,
+    Msaa4x,
+    Msaa8x,
+    Fxaa,
+    Count,
+};
+
+const char* AntiAliasingName(AntiAliasingMode mode);
+bool ParseAntiAliasing(const std::string& name, AntiAliasingMode& mode); // none, msaa2, msaa4, msaa8, fxaa
+UINT SampleCount(AntiAliasingMode mode);
+
+// Наибольшее поддерживаемое устройством число выборок не больше requested
+UINT SupportedSampleCount(ID3D11Device* pDevice, DXGI_FORMAT format, UINT requested);
+
+// Вершинный шейдер треугольника на весь экран (Draw(3), без вершинного буфера):
+// SV_POSITION и TEXCOORD0 — UV 0..1 от левого верхнего угла. Общий для проходов постобработки
+HRESULT CreateFullscreenVertexShader(ID3D11Device* pDevice, Microsoft::WRL::ComPtr<ID3D11VertexShader>& vertexShader);
+
+// FXAA: поиск края по яркости в окрестности 3x3, проход вдоль края
+// до его концов и сдвиг выборки поперёк края; плюс размытие субпиксельных деталей
+class FxaaPass
+{
+public:
+    HRESULT Init(ID3D11Device* pDevice);
+    void Release();
+    bool Ready() const { return m_pConstants.Get() != nullptr; } // Init прошёл целиком
+
+    // Читает pSource (обычная текстура размера width x height), пишет в pTarget.
+    // Меняет шейдеры, входной лейаут и привязки PS t0/s0/b0 — вызывающий восстанавливает своё
+    void Apply(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSource, ID3D11RenderTargetView* pTarget, UINT width, UINT height);
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> m_pVertexShader;
+    Microsoft::WRL::ComPtr<ID3D11PixelShader> m_pPixelShader;
+    Microsoft::WRL::ComPtr<ID3D11SamplerState> m_pSampler;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> m_pConstants;
+    UINT m_Width = 0;
+    UINT m_Height = 0;
+};
@@ -0,0 +1,196 @@
+﻿#include "BufferAllocator.h"
+
+#include <iterator>
+
+void RangeAllocator::Reset(uint64_t capacity)
+{
+    m_FreeByOffset.clear();
+    m_FreeBySize.clear();
+    m_Capacity = capacity;
+    m_FreeBytes = 0;
+    if (capacity > 0) AddFreeRange(0, capacity);
+}
+
+uint64_t RangeAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    if (size == 0) return InvalidOffset;
+
+    // Наименьший свободный диапазон, в который запрос влезает с учётом выравнивания
+    for (auto it = m_FreeBySize.lower_bound(size); it != m_FreeBySize.end(); ++it)
+    {
+        const uint64_t rangeOffset = it->second;
+        const uint64_t rangeSize = it->first;
+        const uint64_t alignedOffset = AlignUp(rangeOffset, alignment);
+        const uint64_t padding = alignedOffset - rangeOffset;
+        if (padding + size > rangeSize) continue;
+
+        RemoveFreeRange(m_FreeByOffset.find(rangeOffset));
+        if (padding > 0) AddFreeRange(rangeOffset, padding);
+        if (padding + size < rangeSize) AddFreeRange(alignedOffset + size, rangeSize - padding - size);
+        return alignedOffset;
+    }
+    return InvalidOffset;
+}
+
+void RangeAllocator::Free(uint64_t offset, uint64_t size)
+{
+    if (size == 0) return;
+
+    // Сливаем с соседями слева и справа
+    auto next = m_FreeByOffset.lower_bound(offset);
+    if (next != m_FreeByOffset.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset)
+        {
+            offset = prev->first;
+            size += prev->second;
+            RemoveFreeRange(prev);
+        }
+    }
+    if (next != m_FreeByOffset.end() && offset + size == next->first)
+    {
+        size += next->second;
+        RemoveFreeRange(next);
+    }
+
+    AddFreeRange(offset, size);
+}
+
+uint64_t RangeAllocator::LargestFreeRange() const
+{
+    return m_FreeBySize.empty() ? 0 : m_FreeBySize.rbegin()->first;
+}
+
+void RangeAllocator::AddFreeRange(uint64_t offset, uint64_t size)
+{
+    m_FreeByOffset[offset] = size;
+    m_FreeBySize.insert(std::make_pair(size, offset));
+    m_FreeBytes += size;
+}
+
+void RangeAllocator::RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator it)
+{
+    auto range = m_FreeBySize.equal_range(it->second);
+    for (auto sizeIt = range.first; sizeIt != range.second; ++sizeIt)
+    {
+        if (sizeIt->second == it->first)
+        {
+            m_FreeBySize.erase(sizeIt);
+            break;
+        }
+    }
+    m_FreeBytes -= it->second;
+    m_FreeByOffset.erase(it);
+}
+
+uint32_t BlockSuballocator::SizeClassOf(uint64_t size)
+{
+    uint32_t sizeClass = 0;
+    while (ClassSize(sizeClass) < size) ++sizeClass;
+    return sizeClass;
+}
+
+uint64_t BlockSuballocator::RoundedSize(uint64_t size)
+{
+    return size <= MaxClassSize ? ClassSize(SizeClassOf(size)) : AlignUp(size, MaxClassSize);
+}
+
+uint32_t BlockSuballocator::AddBlock(uint64_t capacity)
+{
+    Block block;
+    block.ranges.Reset(capacity);
+    m_Blocks.push_back(std::move(block));
+    return (uint32_t)m_Blocks.size() - 1;
+}
+
+void BlockSuballocator::Reset()
+{
+    m_Blocks.clear();
+    m_UsedBytes = 0;
+}
+
+Suballocation BlockSuballocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    Suballocation result;
+    if (size == 0) return result;
+
+    const bool pooled = size <= MaxClassSize;
+    const uint32_t sizeClass = SizeClassOf(size);
+    const uint64_t classSize = RoundedSize(size);
+
+    // Сначала — готовый кусок того же класса с подходящим выравниванием
+    for (uint32_t blockIndex = 0; pooled && blockIndex < m_Blocks.size(); ++blockIndex)
+    {
+        Block& block = m_Blocks[blockIndex];
+        if (sizeClass >= block.freeByClass.size()) continue;
+
+        std::vector<uint64_t>& freeList = block.freeByClass[sizeClass];
+        for (size_t i = freeList.size(); i-- > 0;)
+        {
+            if (freeList[i] % (alignment > 0 ? alignment : 1) != 0) continue;
+
+            result.block = blockIndex;
+            result.offset = freeList[i];
+            result.size = classSize;
+            freeList[i] = freeList.back();
+            freeList.pop_back();
+            m_UsedBytes += classSize;
+            return result;
+        }
+    }
+
+    // Иначе — новый диапазон из первого блока, где есть место
+    for (uint32_t blockIndex = 0; blockIndex < m_Blocks.size(); ++blockIndex)
+    {
+        uint64_t offset = m_Blocks[blockIndex].ranges.Allocate(classSize, alignment);
+        if (offset == RangeAllocator::InvalidOffset) continue;
+
+        result.block = blockIndex;
+        result.offset = offset;
+        result.size = classSize;
+        m_UsedBytes += classSize;
+        return result;
+    }
+
+    return result;
+}
+
+void BlockSuballocator::Free(const Suballocation& allocation)
+{
+    if (!allocation.IsValid() || allocation.block >= m_Blocks.size()) return;
+
+    Block& block = m_Blocks[allocation.block];
+    m_UsedBytes -= allocation.size;
+
+    if (allocation.size > MaxClassSize)
+    {
+        block.ranges.Free(allocation.offset, allocation.size);
+        return;
+    }
+
+    const uint32_t sizeClass = SizeClassOf(allocation.size);
+    if (sizeClass >= block.freeByClass.size()) block.freeByClass.resize(sizeClass + 1);
+    block.freeByClass[sizeClass].push_back(allocation.offset);
+}
+
+void BlockSuballocator::Trim()
+{
+    for (Block& block : m_Blocks)
+    {
+        for (uint32_t sizeClass = 0; sizeClass < block.freeByClass.size(); ++sizeClass)
+        {
+            for (uint64_t offset : block.freeByClass[sizeClass])
+                block.ranges.Free(offset, ClassSize(sizeClass));
+            block.freeByClass[sizeClass].clear();
+        }
+    }
+}
+
+uint64_t BlockSuballocator::CapacityBytes() const
+{
+    uint64_t capacity = 0;
+    for (const Block& block : m_Blocks)
+        capacity += block.ranges.Capacity();
+    return capacity;
+}
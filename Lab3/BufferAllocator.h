@@ -0,0 +1,236 @@
+﻿#pragma once
+
+// Учёт памяти для пулов GPU-ресурсов. Здесь нет ни одного вызова D3D:
+// только смещения, размеры и номера кадров, поэтому логику можно
+// проверять без устройства. Обёртка над D3D11 — в ResourceManager.h.
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+// Свободные диапазоны одного блока: best-fit с выравниванием и слиянием соседей при освобождении
+class RangeAllocator
+{
+public:
+    static const uint64_t InvalidOffset = ~0ull;
+
+    explicit RangeAllocator(uint64_t capacity = 0) { Reset(capacity); }
+
+    void Reset(uint64_t capacity);
+    uint64_t Allocate(uint64_t size, uint64_t alignment);
+    void Free(uint64_t offset, uint64_t size);
+
+    uint64_t Capacity() const { return m_Capacity; }
+    uint64_t FreeBytes() const { return m_FreeBytes; }
+    uint64_t LargestFreeRange() const;
+    size_t FreeRangeCount() const { return m_FreeByOffset.size(); }
+
+private:
+    void AddFreeRange(uint64_t offset, uint64_t size);
+    void RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator it);
+
+    uint64_t m_Capacity = 0;
+    uint64_t m_FreeBytes = 0;
+    std::map<uint64_t, uint64_t> m_FreeByOffset;     // смещение -> размер
+    std::multimap<uint64_t, uint64_t> m_FreeBySize;  // размер -> смещение
+};
+
+struct Suballocation
+{
+    static const uint32_t InvalidBlock = ~0u;
+
+    uint32_t block = InvalidBlock;
+    uint64_t offset = 0;
+    uint64_t size = 0; // размер с учётом класса
+
+    bool IsValid() const { return block != InvalidBlock; }
+};
+
+// Подвыделение из набора больших блоков. Мелкие запросы округляются до класса
+// размера (степень двойки от MinClassSize до MaxClassSize); освобождённые куски
+// кладутся в список своего класса и переиспользуются без поиска, Trim() возвращает
+// их в блоки. Крупные запросы выравниваются до MaxClassSize и сразу возвращаются в блок.
+class BlockSuballocator
+{
+public:
+    static const uint64_t MinClassSize = 256;
+    static const uint64_t MaxClassSize = 64 * 1024;
+
+    static uint32_t SizeClassOf(uint64_t size);
+    static uint64_t ClassSize(uint32_t sizeClass) { return MinClassSize << sizeClass; }
+    static uint64_t RoundedSize(uint64_t size);
+
+    // Возвращает номер нового блока; блоки не удаляются до Reset()
+    uint32_t AddBlock(uint64_t capacity);
+    void Reset();
+
+    // Невалидный результат означает, что места нет — вызывающий добавляет блок и повторяет
+    Suballocation Allocate(uint64_t size, uint64_t alignment);
+    void Free(const Suballocation& allocation);
+    void Trim();
+
+    size_t BlockCount() const { return m_Blocks.size(); }
+    uint64_t CapacityBytes() const;
+    uint64_t UsedBytes() const { return m_UsedBytes; }
+
+private:
+    struct Block
+    {
+        RangeAllocator ranges;
+        std::vector<std::vector<uint64_t>> freeByClass;
+    };
+
+    std::vector<Block> m_Blocks;
+    uint64_t m_UsedBytes = 0;
+};
+
+// Отложенное освобождение: ресурс, отпущенный в кадре N, можно уничтожить
+// или переиспользовать только когда GPU гарантированно закончил кадр N
+template <typename T>
+class DeferredReleaseQueue
+{
+public:
+    void Push(uint64_t frameIndex, T item)
+    {
+        m_Items.push_back(std::make_pair(frameIndex, std::move(item)));
+    }
+
+    template <typename ReleaseFn>
+    size_t Retire(uint64_t completedFrame, ReleaseFn release)
+    {
+        size_t retired = 0;
+        while (!m_Items.empty() && m_Items.front().first <= completedFrame)
+        {
+            release(m_Items.front().second);
+            m_Items.pop_front();
+            ++retired;
+        }
+        return retired;
+    }
+
+    template <typename ReleaseFn>
+    void RetireAll(ReleaseFn release)
+    {
+        Retire(~0ull, release);
+    }
+
+    size_t Size() const { return m_Items.size(); }
+
+private:
+    std::deque<std::pair<uint64_t, T>> m_Items; // номера кадров идут по возрастанию
+};
+
+// Пул временных ресурсов на кадр: Acquire отдаёт свободный ресурс с тем же ключом
+// или просит создать новый; в конце кадра всё возвращается в пул, а ресурсы,
+// не востребованные maxIdleFrames кадров подряд, удаляются
+template <typename Key, typename Resource>
+class TransientPool
+{
+public:
+    explicit TransientPool(uint64_t maxIdleFrames = 8) : m_MaxIdleFrames(maxIdleFrames) {}
+
+    Resource* Acquire(const Key& key, uint64_t frameIndex)
+    {
+        for (Entry& entry : m_Entries)
+        {
+            if (!entry.inUse && entry.key == key)
+            {
+                entry.inUse = true;
+                entry.lastUsedFrame = frameIndex;
+                return &entry.resource;
+            }
+        }
+        return nullptr;
+    }
+
+    Resource* Add(const Key& key, Resource resource, uint64_t frameIndex)
+    {
+        Entry entry;
+        entry.key = key;
+        entry.resource = std::move(resource);
+        entry.inUse = true;
+        entry.lastUsedFrame = frameIndex;
+        m_Entries.push_back(std::move(entry));
+        return &m_Entries.back().resource;
+    }
+
+    // Ресурс свободен уже в этом кадре: следующий Acquire с тем же ключом может его отдать
+    void Release(const Resource* resource)
+    {
+        for (Entry& entry : m_Entries)
+        {
+            if (&entry.resource == resource) entry.inUse = false;
+        }
+    }
+
+    // Указатели, выданные Acquire/Add, действительны только до EndFrame.
+    // onEvict(const Resource&) получает каждый удаляемый ресурс
+    template <typename EvictFn>
+    size_t EndFrame(uint64_t frameIndex, EvictFn onEvict)
+    {
+        return Remove(onEvict, [this, frameIndex](Entry& entry)
+        {
+            entry.inUse = false;
+            return frameIndex - entry.lastUsedFrame > m_MaxIdleFrames;
+        });
+    }
+
+    size_t EndFrame(uint64_t frameIndex) { return EndFrame(frameIndex, [](const Resource&) {}); }
+
+    // Удаляет все ресурсы, не занятые в текущем кадре (вытеснение по бюджету памяти)
+    template <typename EvictFn>
+    size_t Trim(EvictFn onEvict)
+    {
+        return Remove(onEvict, [](Entry& entry) { return !entry.inUse; });
+    }
+
+    template <typename EvictFn>
+    void Clear(EvictFn onEvict)
+    {
+        for (const Entry& entry : m_Entries) onEvict(entry.resource);
+        m_Entries.clear();
+    }
+
+    void Clear() { m_Entries.clear(); }
+    size_t Size() const { return m_Entries.size(); }
+
+private:
+    struct Entry
+    {
+        Key key;
+        Resource resource;
+        bool inUse = false;
+        uint64_t lastUsedFrame = 0;
+    };
+
+    template <typename EvictFn, typename Predicate>
+    size_t Remove(EvictFn& onEvict, Predicate shouldRemove)
+    {
+        size_t evicted = 0;
+        for (size_t i = 0; i < m_Entries.size();)
+        {
+            Entry& entry = m_Entries[i];
+            if (shouldRemove(entry))
+            {
+                onEvict(entry.resource);
+                m_Entries[i] = std::move(m_Entries.back());
+                m_Entries.pop_back();
+                ++evicted;
+                continue;
+            }
+            ++i;
+        }
+        return evicted;
+    }
+
+    std::deque<Entry> m_Entries; // deque: Add не двигает уже выданные ресурсы
+    uint64_t m_MaxIdleFrames;
+};
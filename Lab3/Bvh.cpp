@@ -0,0 +1,829 @@
+﻿#include "Bvh.h"
+#include "JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace Math;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const uint32_t BinCount = 16; // у маленьких узлов корзин столько, сколько примитивов
+    const float TraversalCost = 1.0f;    // цена посещения узла относительно проверки примитива
+    const float IntersectionCost = 1.0f;
+
+    // Меньше — поддерево быстрее достроить в том же потоке, чем отдавать другому
+    const uint32_t MinSubtreePrimitives = 4096;
+
+    double Milliseconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    float Component(const Float3& v, int axis)
+    {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    struct Bin
+    {
+        Aabb bounds;
+        uint32_t count = 0;
+    };
+
+    // Плоскость разбиения: центры с корзиной меньше bin идут влево
+    struct Split
+    {
+        int axis = -1;
+        uint32_t bin = 0;
+        float cost = INFINITY;
+        uint32_t bins = BinCount;
+        float offset = 0.0f;
+        float scale = 0.0f;
+
+        uint32_t BinOf(const Float3& centroid) const
+        {
+            const float position = (Component(centroid, axis) - offset) * scale;
+            return position > 0.0f ? std::min(bins - 1, (uint32_t)position) : 0u;
+        }
+    };
+
+    // Лучшее по SAH разбиение по корзинам; все три оси раскладываются за один
+    // проход по примитивам. cost — в единицах IntersectionCost
+    Split FindSplit(const uint32_t* primitives, uint32_t count, const Aabb& box, const Aabb& centroidBox,
+        const std::vector<Aabb>& primitiveBounds, const std::vector<Float3>& centroids)
+    {
+        const uint32_t binCount = std::min(BinCount, count);
+        Split splits[3];
+        bool usable[3];
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float low = Component(centroidBox.min, axis);
+            const float extent = Component(centroidBox.max, axis) - low;
+            usable[axis] = extent > 0.0f;
+            splits[axis].axis = axis;
+            splits[axis].bins = binCount;
+            splits[axis].offset = low;
+            splits[axis].scale = usable[axis] ? binCount / extent : 0.0f;
+        }
+
+        Bin bins[3][BinCount];
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const Aabb& bounds = primitiveBounds[primitives[i]];
+            const Float3& centroid = centroids[primitives[i]];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                Bin& bin = bins[axis][splits[axis].BinOf(centroid)];
+                bin.bounds.Grow(bounds);
+                ++bin.count;
+            }
+        }
+
+        Split best;
+        const float area = box.SurfaceArea();
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            if (!usable[axis]) continue;
+
+            // Площади и числа слева от каждой плоскости — проходом слева, справа — проходом справа
+            float leftCost[BinCount] = {};
+            Aabb left, right;
+            uint32_t leftCount = 0, rightCount = 0;
+            for (uint32_t i = 1; i < binCount; ++i)
+            {
+                left.Grow(bins[axis][i - 1].bounds);
+                leftCount += bins[axis][i - 1].count;
+                leftCost[i] = left.SurfaceArea() * leftCount;
+            }
+            for (uint32_t i = binCount - 1; i > 0; --i)
+            {
+                right.Grow(bins[axis][i].bounds);
+                rightCount += bins[axis][i].count;
+                if (rightCount == 0 || rightCount == count) continue;
+
+                const float cost = TraversalCost + IntersectionCost * (leftCost[i] + right.SurfaceArea() * rightCount) / (area > 0.0f ? area : 1.0f);
+                if (cost < best.cost)
+                {
+                    best = splits[axis];
+                    best.bin = i;
+                    best.cost = cost;
+                }
+            }
+        }
+        return best;
+    }
+
+    bool IntersectTriangle(const Float3& v0, const Float3& edge1, const Float3& edge2, const Float3& origin, const Float3& direction,
+        float tMax, float& t, float& u, float& v)
+    {
+        // Мёллер — Трумбор; тот же порядок операций, что в пакетной версии
+        const float px = direction.y * edge2.z - direction.z * edge2.y;
+        const float py = direction.z * edge2.x - direction.x * edge2.z;
+        const float pz = direction.x * edge2.y - direction.y * edge2.x;
+        const float det = edge1.x * px + edge1.y * py + edge1.z * pz;
+        if (det == 0.0f) return false;
+        const float inverseDet = 1.0f / det;
+
+        const float sx = origin.x - v0.x, sy = origin.y - v0.y, sz = origin.z - v0.z;
+        u = (sx * px + sy * py + sz * pz) * inverseDet;
+        if (!(u >= 0.0f && u <= 1.0f)) return false;
+
+        const float qx = sy * edge1.z - sz * edge1.y;
+        const float qy = sz * edge1.x - sx * edge1.z;
+        const float qz = sx * edge1.y - sy * edge1.x;
+        v = (direction.x * qx + direction.y * qy + direction.z * qz) * inverseDet;
+        if (!(v >= 0.0f && u + v <= 1.0f)) return false;
+
+        t = (edge2.x * qx + edge2.y * qy + edge2.z * qz) * inverseDet;
+        return t > 0.0f && t < tMax;
+    }
+
+    // Четыре значения пакета: SSE на x86/x64, иначе поэлементно. Маски — результат сравнений
+#if VECTOR_MATH_SSE
+    typedef __m128 Lanes;
+    typedef __m128 LaneMask;
+
+    inline Lanes Load(const float* p) { return _mm_loadu_ps(p); }
+    inline void Store(float* p, Lanes a) { _mm_storeu_ps(p, a); }
+    inline Lanes Splat(float value) { return _mm_set1_ps(value); }
+    inline Lanes Add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+    inline Lanes Sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+    inline Lanes Mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+    inline Lanes Div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+    inline Lanes Min(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+    inline Lanes Max(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+    inline LaneMask Less(Lanes a, Lanes b) { return _mm_cmplt_ps(a, b); }
+    inline LaneMask LessEqual(Lanes a, Lanes b) { return _mm_cmple_ps(a, b); }
+    inline LaneMask NotEqual(Lanes a, Lanes b) { return _mm_cmpneq_ps(a, b); }
+    inline LaneMask And(LaneMask a, LaneMask b) { return _mm_and_ps(a, b); }
+    inline Lanes Select(LaneMask mask, Lanes a, Lanes b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    inline unsigned Bits(LaneMask mask) { return (unsigned)_mm_movemask_ps(mask); }
+#else
+    struct Lanes
+    {
+        float f[RayPacketSize];
+    };
+
+    struct LaneMask
+    {
+        bool b[RayPacketSize];
+    };
+
+    template <typename Op>
+    inline Lanes Apply(Lanes a, Lanes b, Op op)
+    {
+        Lanes result;
+        for (size_t i = 0; i < RayPacketSize; ++i) result.f[i] = op(a.f[i], b.f[i]);
+        return result;
+    }
+
+    template <typename Op>
+    inline LaneMask Compare(Lanes a, Lanes b, Op op)
+    {
+        LaneMask result;
+        for (size_t i = 0; i < RayPacketSize; ++i) result.b[i] = op(a.f[i], b.f[i]);
+        return result;
+    }
+
+    inline Lanes Load(const float* p) { Lanes result; for (size_t i = 0; i < RayPacketSize; ++i) result.f[i] = p[i]; return result; }
+    inline void Store(float* p, Lanes a) { for (size_t i = 0; i < RayPacketSize; ++i) p[i] = a.f[i]; }
+    inline Lanes Splat(float value) { Lanes result; for (float& f : result.f) f = value; return result; }
+    inline Lanes Add(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return x + y; }); }
+    inline Lanes Sub(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return x - y; }); }
+    inline Lanes Mul(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return x * y; }); }
+    inline Lanes Div(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return x / y; }); }
+    inline Lanes Min(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return x < y ? x : y; }); }
+    inline Lanes Max(Lanes a, Lanes b) { return Apply(a, b, [](float x, float y) { return x > y ? x : y; }); }
+    inline LaneMask Less(Lanes a, Lanes b) { return Compare(a, b, [](float x, float y) { return x < y; }); }
+    inline LaneMask LessEqual(Lanes a, Lanes b) { return Compare(a, b, [](float x, float y) { return x <= y; }); }
+    inline LaneMask NotEqual(Lanes a, Lanes b) { return Compare(a, b, [](float x, float y) { return x != y; }); }
+    inline LaneMask And(LaneMask a, LaneMask b) { LaneMask result; for (size_t i = 0; i < RayPacketSize; ++i) result.b[i] = a.b[i] && b.b[i]; return result; }
+    inline Lanes Select(LaneMask mask, Lanes a, Lanes b) { Lanes result; for (size_t i = 0; i < RayPacketSize; ++i) result.f[i] = mask.b[i] ? a.f[i] : b.f[i]; return result; }
+    inline unsigned Bits(LaneMask mask) { unsigned bits = 0; for (size_t i = 0; i < RayPacketSize; ++i) bits |= mask.b[i] ? 1u << i : 0u; return bits; }
+#endif
+
+    struct PacketRays
+    {
+        Lanes originX, originY, originZ;
+        Lanes directionX, directionY, directionZ;
+        Lanes inverseX, inverseY, inverseZ;
+    };
+
+    // Маска лучей, задевающих бокс ближе tMax; enter — их вход
+    unsigned IntersectAabb(const Aabb& box, const PacketRays& rays, Lanes tMax, Lanes& enter)
+    {
+        const Lanes x0 = Mul(Sub(Splat(box.min.x), rays.originX), rays.inverseX), x1 = Mul(Sub(Splat(box.max.x), rays.originX), rays.inverseX);
+        const Lanes y0 = Mul(Sub(Splat(box.min.y), rays.originY), rays.inverseY), y1 = Mul(Sub(Splat(box.max.y), rays.originY), rays.inverseY);
+        const Lanes z0 = Mul(Sub(Splat(box.min.z), rays.originZ), rays.inverseZ), z1 = Mul(Sub(Splat(box.max.z), rays.originZ), rays.inverseZ);
+        enter = Max(Max(Min(x0, x1), Min(y0, y1)), Max(Min(z0, z1), Splat(0.0f)));
+        const Lanes exit = Min(Min(Max(x0, x1), Max(y0, y1)), Min(Max(z0, z1), tMax));
+        return Bits(LessEqual(enter, exit));
+    }
+
+    float NearestEnter(Lanes enter, unsigned mask)
+    {
+        float values[RayPacketSize];
+        Store(values, enter);
+        float nearest = INFINITY;
+        for (size_t i = 0; i < RayPacketSize; ++i)
+        {
+            if ((mask & (1u << i)) && values[i] < nearest) nearest = values[i];
+        }
+        return nearest;
+    }
+}
+
+void Aabb::Grow(const Float3& point)
+{
+    min = Float3(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+    max = Float3(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+}
+
+void Aabb::Grow(const Aabb& box)
+{
+    min = Float3(std::min(min.x, box.min.x), std::min(min.y, box.min.y), std::min(min.z, box.min.z));
+    max = Float3(std::max(max.x, box.max.x), std::max(max.y, box.max.y), std::max(max.z, box.max.z));
+}
+
+Float3 Aabb::Center() const
+{
+    return Float3((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f);
+}
+
+float Aabb::SurfaceArea() const
+{
+    if (Empty()) return 0.0f;
+    const float dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+Aabb TransformAabb(const Aabb& box, const Matrix& m)
+{
+    Aabb result;
+    if (box.Empty()) return result;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const Float3 point((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y, (corner & 4) ? box.max.z : box.min.z);
+        Float3 transformed;
+        StoreFloat3(&transformed, Vector3TransformCoord(LoadFloat3(&point), m));
+        result.Grow(transformed);
+    }
+    return result;
+}
+
+void RayPacket::Set(size_t lane, const Ray& ray)
+{
+    originX[lane] = ray.origin.x;
+    originY[lane] = ray.origin.y;
+    originZ[lane] = ray.origin.z;
+    directionX[lane] = ray.direction.x;
+    directionY[lane] = ray.direction.y;
+    directionZ[lane] = ray.direction.z;
+    tMax[lane] = ray.tMax;
+}
+
+void Bvh::Build(const std::vector<Aabb>& primitiveBounds, unsigned threadCount)
+{
+    const Clock::time_point start = Clock::now();
+    m_Nodes.clear();
+    m_Primitives.clear();
+    m_Stats = BvhStats();
+
+    const uint32_t count = (uint32_t)primitiveBounds.size();
+    if (count == 0) return;
+
+    std::vector<Float3> centroids(count);
+    m_Primitives.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        centroids[i] = primitiveBounds[i].Center();
+        m_Primitives[i] = i;
+    }
+
+    m_Nodes.reserve(2 * (size_t)count - 1);
+    m_Nodes.emplace_back();
+    const Range root = { 0, 0, count, 0 };
+    threadCount = std::max(1u, std::min(threadCount, count / MinSubtreePrimitives));
+    if (threadCount == 1)
+    {
+        Subdivide(m_Nodes, root, 0, nullptr, primitiveBounds, centroids);
+    }
+    else
+    {
+        // Поддеревьев в несколько раз больше, чем потоков, — чтобы потоки
+        // заканчивали примерно вместе; крупные разбираются первыми
+        const uint32_t deferCount = std::max(MinSubtreePrimitives, count / (threadCount * 8));
+        std::vector<Range> deferred;
+        Subdivide(m_Nodes, root, deferCount, &deferred, primitiveBounds, centroids);
+        std::sort(deferred.begin(), deferred.end(), [](const Range& a, const Range& b) { return a.count > b.count; });
+
+        // Поддерево строится в свой массив узлов с корнем в нуле; диапазоны примитивов не пересекаются
+        std::vector<std::vector<BvhNode>> subtrees(deferred.size());
+        std::atomic<size_t> next(0);
+        Jobs().RunTasks(threadCount, [&](unsigned)
+        {
+            for (size_t i = next++; i < deferred.size(); i = next++)
+            {
+                subtrees[i].reserve(2 * (size_t)deferred[i].count - 1);
+                subtrees[i].emplace_back();
+                const Range subtree = { 0, deferred[i].first, deferred[i].count, deferred[i].depth };
+                Subdivide(subtrees[i], subtree, 0, nullptr, primitiveBounds, centroids);
+            }
+        });
+
+        // Корень поддерева встаёт на место заготовки, остальные узлы — в конец
+        for (size_t i = 0; i < deferred.size(); ++i)
+        {
+            const uint32_t base = (uint32_t)m_Nodes.size();
+            const std::vector<BvhNode>& local = subtrees[i];
+            for (size_t j = 0; j < local.size(); ++j)
+            {
+                BvhNode node = local[j];
+                if (!node.Leaf()) node.first = base + node.first - 1;
+                if (j == 0) m_Nodes[deferred[i].node] = node;
+                else m_Nodes.push_back(node);
+            }
+        }
+    }
+
+    m_Stats.threads = threadCount;
+    UpdateStats();
+    m_Stats.buildMs = Milliseconds(start);
+}
+
+void Bvh::Subdivide(std::vector<BvhNode>& nodes, Range root, uint32_t deferCount, std::vector<Range>* pDeferred,
+    const std::vector<Aabb>& primitiveBounds, const std::vector<Float3>& centroids)
+{
+    std::vector<Range> stack(1, root);
+    while (!stack.empty())
+    {
+        const Range range = stack.back();
+        stack.pop_back();
+        if (pDeferred && range.count <= deferCount)
+        {
+            pDeferred->push_back(range);
+            continue;
+        }
+
+        uint32_t* primitives = m_Primitives.data() + range.first;
+        Aabb box, centroidBox;
+        for (uint32_t i = 0; i < range.count; ++i)
+        {
+            box.Grow(primitiveBounds[primitives[i]]);
+            centroidBox.Grow(centroids[primitives[i]]);
+        }
+        nodes[range.node].bounds = box;
+
+        // Лист, если делить дороже, чем проверить всё, или делить нечем
+        Split split;
+        if (range.count > 1 && range.depth + 1 < MaxDepth)
+            split = FindSplit(primitives, range.count, box, centroidBox, primitiveBounds, centroids);
+        const bool worthSplitting = split.axis >= 0 && split.cost < IntersectionCost * range.count;
+        if (range.count == 1 || range.depth + 1 >= MaxDepth || (range.count <= MaxLeafSize && !worthSplitting))
+        {
+            nodes[range.node].first = range.first;
+            nodes[range.node].count = range.count;
+            continue;
+        }
+
+        // Все центры в одной точке — делим пополам по порядку
+        uint32_t leftCount = range.count / 2;
+        if (split.axis >= 0)
+        {
+            uint32_t* middle = std::partition(primitives, primitives + range.count,
+                [&](uint32_t primitive) { return split.BinOf(centroids[primitive]) < split.bin; });
+            leftCount = (uint32_t)(middle - primitives);
+        }
+
+        const uint32_t children = (uint32_t)nodes.size();
+        nodes.emplace_back();
+        nodes.emplace_back();
+        nodes[range.node].first = children;
+        nodes[range.node].count = 0;
+
+        const Range left = { children, range.first, leftCount, range.depth + 1 };
+        const Range right = { children + 1, range.first + leftCount, range.count - leftCount, range.depth + 1 };
+        stack.push_back(right);
+        stack.push_back(left);
+    }
+}
+
+void Bvh::UpdateStats()
+{
+    m_Stats.primitives = m_Primitives.size();
+    m_Stats.nodes = m_Nodes.size();
+    m_Stats.leaves = 0;
+    m_Stats.depth = 0;
+    m_Stats.sahCost = 0.0f;
+    if (m_Nodes.empty()) return;
+
+    const float rootArea = m_Nodes[0].bounds.SurfaceArea();
+    std::vector<uint32_t> depths(m_Nodes.size(), 0);
+    for (size_t i = 0; i < m_Nodes.size(); ++i)
+    {
+        const BvhNode& node = m_Nodes[i];
+        const float probability = rootArea > 0.0f ? node.bounds.SurfaceArea() / rootArea : 1.0f;
+        m_Stats.depth = std::max(m_Stats.depth, depths[i]);
+        if (node.Leaf())
+        {
+            ++m_Stats.leaves;
+            m_Stats.sahCost += probability * IntersectionCost * node.count;
+        }
+        else
+        {
+            m_Stats.sahCost += probability * TraversalCost;
+            depths[node.first] = depths[i] + 1;
+            depths[node.first + 1] = depths[i] + 1;
+        }
+    }
+}
+
+void Bvh::Refit(const std::vector<Aabb>& primitiveBounds)
+{
+    const Clock::time_point start = Clock::now();
+
+    // Потомки всегда после родителя — обратный проход идёт снизу вверх
+    for (size_t i = m_Nodes.size(); i-- > 0;)
+    {
+        BvhNode& node = m_Nodes[i];
+        Aabb box;
+        if (node.Leaf())
+        {
+            for (uint32_t j = 0; j < node.count; ++j)
+                box.Grow(primitiveBounds[m_Primitives[node.first + j]]);
+        }
+        else
+        {
+            box = m_Nodes[node.first].bounds;
+            box.Grow(m_Nodes[node.first + 1].bounds);
+        }
+        node.bounds = box;
+    }
+
+    m_Stats.refitMs = Milliseconds(start);
+}
+
+void MeshBvh::Build(const Float3* positions, const uint32_t* indices, size_t indexCount, unsigned threadCount)
+{
+    const size_t triangleCount = indexCount / 3;
+    m_TriangleBounds.resize(triangleCount);
+    for (size_t i = 0; i < triangleCount; ++i)
+    {
+        Aabb box;
+        box.Grow(positions[indices[3 * i]]);
+        box.Grow(positions[indices[3 * i + 1]]);
+        box.Grow(positions[indices[3 * i + 2]]);
+        m_TriangleBounds[i] = box;
+    }
+    m_Bvh.Build(m_TriangleBounds, threadCount);
+
+    // Индексы — в порядке листьев, чтобы Refit и обход шли по памяти подряд
+    m_Indices.resize(3 * triangleCount);
+    for (size_t i = 0; i < triangleCount; ++i)
+    {
+        const uint32_t triangle = m_Bvh.Primitives()[i];
+        m_Indices[3 * i] = indices[3 * triangle];
+        m_Indices[3 * i + 1] = indices[3 * triangle + 1];
+        m_Indices[3 * i + 2] = indices[3 * triangle + 2];
+    }
+    m_Triangles.resize(triangleCount);
+    UpdateTriangles(positions, m_TriangleBounds);
+}
+
+void MeshBvh::Refit(const Float3* positions)
+{
+    UpdateTriangles(positions, m_TriangleBounds);
+    m_Bvh.Refit(m_TriangleBounds);
+}
+
+void MeshBvh::UpdateTriangles(const Float3* positions, std::vector<Aabb>& bounds)
+{
+    for (size_t i = 0; i < m_Triangles.size(); ++i)
+    {
+        const Float3& a = positions[m_Indices[3 * i]];
+        const Float3& b = positions[m_Indices[3 * i + 1]];
+        const Float3& c = positions[m_Indices[3 * i + 2]];
+        Triangle& triangle = m_Triangles[i];
+        triangle.v0 = a;
+        triangle.edge1 = Float3(b.x - a.x, b.y - a.y, b.z - a.z);
+        triangle.edge2 = Float3(c.x - a.x, c.y - a.y, c.z - a.z);
+
+        Aabb box;
+        box.Grow(a);
+        box.Grow(b);
+        box.Grow(c);
+        bounds[m_Bvh.Primitives()[i]] = box;
+    }
+}
+
+bool MeshBvh::Intersect(const Ray& ray, RayHit& hit) const
+{
+    bool found = false;
+    m_Bvh.Traverse(ray, hit, [&](uint32_t index, const Ray& r, RayHit& closest)
+    {
+        const Triangle& triangle = m_Triangles[index];
+        float t, u, v;
+        if (IntersectTriangle(triangle.v0, triangle.edge1, triangle.edge2, r.origin, r.direction, closest.t, t, u, v))
+        {
+            closest.t = t;
+            closest.u = u;
+            closest.v = v;
+            closest.primitive = m_Bvh.Primitives()[index];
+            found = true;
+        }
+    });
+    return found;
+}
+
+void MeshBvh::Intersect(const RayPacket& packet, RayHit hits[RayPacketSize]) const
+{
+    if (m_Bvh.Empty()) return;
+
+    PacketRays rays;
+    rays.originX = Load(packet.originX);
+    rays.originY = Load(packet.originY);
+    rays.originZ = Load(packet.originZ);
+    rays.directionX = Load(packet.directionX);
+    rays.directionY = Load(packet.directionY);
+    rays.directionZ = Load(packet.directionZ);
+    rays.inverseX = Div(Splat(1.0f), rays.directionX);
+    rays.inverseY = Div(Splat(1.0f), rays.directionY);
+    rays.inverseZ = Div(Splat(1.0f), rays.directionZ);
+
+    float closest[RayPacketSize], hitU[RayPacketSize], hitV[RayPacketSize];
+    uint32_t hitIndex[RayPacketSize];
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        closest[i] = std::min(hits[i].t, packet.tMax[i]);
+        hitU[i] = hits[i].u;
+        hitV[i] = hits[i].v;
+        hitIndex[i] = ~0u;
+    }
+    Lanes tClosest = Load(closest), u = Load(hitU), v = Load(hitV);
+
+    const std::vector<BvhNode>& nodes = m_Bvh.Nodes();
+    Lanes enter;
+    if (IntersectAabb(nodes[0].bounds, rays, tClosest, enter) == 0) return;
+
+    uint32_t stack[Bvh::MaxDepth];
+    size_t top = 0;
+    uint32_t node = 0;
+    const Lanes zero = Splat(0.0f), one = Splat(1.0f);
+    for (;;)
+    {
+        const BvhNode& current = nodes[node];
+        if (current.Leaf())
+        {
+            // Треугольник — сразу против всех лучей; операции те же, что в IntersectTriangle
+            for (uint32_t i = current.first; i < current.first + current.count; ++i)
+            {
+                const Triangle& triangle = m_Triangles[i];
+                const Lanes e1x = Splat(triangle.edge1.x), e1y = Splat(triangle.edge1.y), e1z = Splat(triangle.edge1.z);
+                const Lanes e2x = Splat(triangle.edge2.x), e2y = Splat(triangle.edge2.y), e2z = Splat(triangle.edge2.z);
+
+                const Lanes px = Sub(Mul(rays.directionY, e2z), Mul(rays.directionZ, e2y));
+                const Lanes py = Sub(Mul(rays.directionZ, e2x), Mul(rays.directionX, e2z));
+                const Lanes pz = Sub(Mul(rays.directionX, e2y), Mul(rays.directionY, e2x));
+                const Lanes det = Add(Add(Mul(e1x, px), Mul(e1y, py)), Mul(e1z, pz));
+                const Lanes inverseDet = Div(one, det);
+
+                const Lanes sx = Sub(rays.originX, Splat(triangle.v0.x));
+                const Lanes sy = Sub(rays.originY, Splat(triangle.v0.y));
+                const Lanes sz = Sub(rays.originZ, Splat(triangle.v0.z));
+                const Lanes hu = Mul(Add(Add(Mul(sx, px), Mul(sy, py)), Mul(sz, pz)), inverseDet);
+
+                const Lanes qx = Sub(Mul(sy, e1z), Mul(sz, e1y));
+                const Lanes qy = Sub(Mul(sz, e1x), Mul(sx, e1z));
+                const Lanes qz = Sub(Mul(sx, e1y), Mul(sy, e1x));
+                const Lanes hv = Mul(Add(Add(Mul(rays.directionX, qx), Mul(rays.directionY, qy)), Mul(rays.directionZ, qz)), inverseDet);
+                const Lanes ht = Mul(Add(Add(Mul(e2x, qx), Mul(e2y, qy)), Mul(e2z, qz)), inverseDet);
+
+                LaneMask valid = And(NotEqual(det, zero), And(LessEqual(zero, hu), LessEqual(hu, one)));
+                valid = And(valid, And(LessEqual(zero, hv), LessEqual(Add(hu, hv), one)));
+                valid = And(valid, And(Less(zero, ht), Less(ht, tClosest)));
+                const unsigned bits = Bits(valid);
+                if (bits == 0) continue;
+
+                tClosest = Select(valid, ht, tClosest);
+                u = Select(valid, hu, u);
+                v = Select(valid, hv, v);
+                for (size_t lane = 0; lane < RayPacketSize; ++lane)
+                {
+                    if (bits & (1u << lane)) hitIndex[lane] = i;
+                }
+            }
+        }
+        else
+        {
+            // Ближним считается потомок с меньшим входом среди задевающих его лучей
+            Lanes enterLeft, enterRight;
+            const unsigned left = IntersectAabb(nodes[current.first].bounds, rays, tClosest, enterLeft);
+            const unsigned right = IntersectAabb(nodes[current.first + 1].bounds, rays, tClosest, enterRight);
+            if (left && right)
+            {
+                const bool leftFirst = NearestEnter(enterLeft, left) <= NearestEnter(enterRight, right);
+                stack[top++] = leftFirst ? current.first + 1 : current.first;
+                node = leftFirst ? current.first : current.first + 1;
+                continue;
+            }
+            if (left || right)
+            {
+                node = left ? current.first : current.first + 1;
+                continue;
+            }
+        }
+
+        bool found = false;
+        while (top > 0 && !found)
+        {
+            node = stack[--top];
+            found = IntersectAabb(nodes[node].bounds, rays, tClosest, enter) != 0;
+        }
+        if (!found) break;
+    }
+
+    Store(closest, tClosest);
+    Store(hitU, u);
+    Store(hitV, v);
+    for (size_t i = 0; i < RayPacketSize; ++i)
+    {
+        if (hitIndex[i] == ~0u) continue;
+        hits[i].t = closest[i];
+        hits[i].u = hitU[i];
+        hits[i].v = hitV[i];
+        hits[i].primitive = m_Bvh.Primitives()[hitIndex[i]];
+    }
+}
+
+size_t MeshBvh::SizeBytes() const
+{
+    return m_Bvh.SizeBytes() + m_Triangles.capacity() * sizeof(Triangle) + m_Indices.capacity() * sizeof(uint32_t) +
+        m_TriangleBounds.capacity() * sizeof(Aabb);
+}
+
+namespace
+{
+    // Рельеф: сумма синусов, phase сдвигает волны (для проверки Refit)
+    float TerrainHeight(float x, float z, float phase)
+    {
+        return 0.6f * std::sin(0.35f * x + phase) * std::cos(0.3f * z) + 0.25f * std::sin(1.7f * x + 1.3f * z + 2.0f * phase);
+    }
+
+    void BuildTerrain(uint32_t side, float extent, float phase, std::vector<Float3>& positions)
+    {
+        positions.resize((size_t)(side + 1) * (side + 1));
+        for (uint32_t row = 0; row <= side; ++row)
+        {
+            for (uint32_t column = 0; column <= side; ++column)
+            {
+                const float x = (column / (float)side * 2.0f - 1.0f) * extent;
+                const float z = (row / (float)side * 2.0f - 1.0f) * extent;
+                positions[(size_t)row * (side + 1) + column] = Float3(x, TerrainHeight(x, z, phase), z);
+            }
+        }
+    }
+
+    // Ближнее попадание перебором всех треугольников
+    float BruteForce(const std::vector<Float3>& positions, const std::vector<uint32_t>& indices, const Ray& ray)
+    {
+        float closest = ray.tMax;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            const Float3& a = positions[indices[i]];
+            const Float3& b = positions[indices[i + 1]];
+            const Float3& c = positions[indices[i + 2]];
+            const Float3 edge1(b.x - a.x, b.y - a.y, b.z - a.z), edge2(c.x - a.x, c.y - a.y, c.z - a.z);
+            float t, u, v;
+            if (IntersectTriangle(a, edge1, edge2, ray.origin, ray.direction, closest, t, u, v)) closest = t;
+        }
+        return closest;
+    }
+}
+
+BvhBenchmark BenchmarkBvh(size_t triangleCount, size_t rayCount, unsigned threadCount)
+{
+    BvhBenchmark result;
+    const uint32_t side = std::max(2u, (uint32_t)std::sqrt(triangleCount / 2.0));
+    const float extent = 20.0f;
+    std::vector<Float3> positions;
+    BuildTerrain(side, extent, 0.0f, positions);
+
+    std::vector<uint32_t> indices;
+    indices.reserve((size_t)side * side * 6);
+    for (uint32_t row = 0; row < side; ++row)
+    {
+        for (uint32_t column = 0; column < side; ++column)
+        {
+            const uint32_t corner = row * (side + 1) + column;
+            const uint32_t quad[6] = { corner, corner + side + 1, corner + 1, corner + 1, corner + side + 1, corner + side + 2 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    result.triangles = indices.size() / 3;
+    result.threads = threadCount;
+
+    MeshBvh bvh;
+    bvh.Build(positions.data(), indices.data(), indices.size(), 1);
+    result.singleThreadBuildMs = bvh.Stats().buildMs;
+    bvh.Build(positions.data(), indices.data(), indices.size(), threadCount);
+    result.buildMs = bvh.Stats().buildMs;
+    result.nodes = bvh.Stats().nodes;
+    result.depth = bvh.Stats().depth;
+    result.sahCost = bvh.Stats().sahCost;
+
+    // Лучи из камеры над рельефом: квадраты 2x2 пикселя идут подряд — это пакеты
+    const uint32_t width = std::max(2u, ((uint32_t)std::sqrt((double)rayCount) + 1) & ~1u);
+    const uint32_t height = std::max(2u, (uint32_t)(rayCount / width) & ~1u);
+    const Float3 eye(0.0f, 8.0f, -extent * 1.2f);
+    const Float3 forward(0.0f, -0.45f, 1.0f), right(1.0f, 0.0f, 0.0f), up(0.0f, 1.0f, 0.45f);
+    std::vector<Ray> rays;
+    rays.reserve((size_t)width * height);
+    for (uint32_t y = 0; y < height; y += 2)
+    {
+        for (uint32_t x = 0; x < width; x += 2)
+        {
+            for (uint32_t pixel = 0; pixel < 4; ++pixel)
+            {
+                const float sx = ((x + (pixel & 1)) + 0.5f) / width * 2.0f - 1.0f;
+                const float sy = 1.0f - ((y + (pixel >> 1)) + 0.5f) / height * 2.0f;
+                Ray ray;
+                ray.origin = eye;
+                ray.direction = Float3(forward.x + right.x * sx + up.x * sy, forward.y + right.y * sx + up.y * sy, forward.z + right.z * sx + up.z * sy);
+                rays.push_back(ray);
+            }
+        }
+    }
+    result.rays = rays.size();
+
+    std::vector<RayHit> single(rays.size());
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < rays.size(); ++i)
+        bvh.Intersect(rays[i], single[i]);
+    result.coherentRaysPerSecond = rays.size() / (Milliseconds(start) / 1000.0);
+
+    std::vector<RayHit> packed(rays.size());
+    RayPacket packet;
+    start = Clock::now();
+    for (size_t i = 0; i + RayPacketSize <= rays.size(); i += RayPacketSize)
+    {
+        for (size_t lane = 0; lane < RayPacketSize; ++lane) packet.Set(lane, rays[i + lane]);
+        bvh.Intersect(packet, &packed[i]);
+    }
+    result.packetRaysPerSecond = rays.size() / (Milliseconds(start) / 1000.0);
+
+    // Пакет обязан давать ровно те же t; номер треугольника может отличаться только на общем ребре
+    size_t hits = 0;
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        if (single[i].Hit()) ++hits;
+        if (single[i].Hit() != packed[i].Hit() || (single[i].Hit() && single[i].t != packed[i].t)) ++result.mismatches;
+    }
+    result.hitRate = rays.empty() ? 0.0 : (double)hits / rays.size();
+
+    // Случайные лучи: начало в объёме над рельефом, направление — любое
+    std::mt19937 random(2024);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<Ray> incoherent(rays.size());
+    for (Ray& ray : incoherent)
+    {
+        ray.origin = Float3(unit(random) * extent, 2.0f + unit(random), unit(random) * extent);
+        ray.direction = Float3(unit(random), unit(random), unit(random));
+    }
+    std::vector<RayHit> scattered(incoherent.size());
+    start = Clock::now();
+    for (size_t i = 0; i < incoherent.size(); ++i)
+        bvh.Intersect(incoherent[i], scattered[i]);
+    result.incoherentRaysPerSecond = incoherent.size() / (Milliseconds(start) / 1000.0);
+
+    // Выборка сверяется с перебором всех треугольников — до и после Refit
+    const size_t samples = std::min<size_t>(32, rays.size());
+    auto check = [&](const std::vector<Ray>& sampleRays, const std::vector<RayHit>& sampleHits)
+    {
+        for (size_t n = 0; n < samples; ++n)
+        {
+            const size_t i = n * (sampleRays.size() / samples);
+            const float expected = BruteForce(positions, indices, sampleRays[i]);
+            const float actual = sampleHits[i].Hit() ? sampleHits[i].t : sampleRays[i].tMax;
+            if (expected != actual) ++result.mismatches;
+        }
+    };
+    check(rays, single);
+    check(incoherent, scattered);
+
+    BuildTerrain(side, extent, 1.0f, positions);
+    start = Clock::now();
+    bvh.Refit(positions.data());
+    result.refitMs = Milliseconds(start);
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        single[i] = RayHit();
+        bvh.Intersect(rays[i], single[i]);
+    }
+    check(rays, single);
+    return result;
+}
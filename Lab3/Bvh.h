@@ -0,0 +1,256 @@
+﻿#pragma once
+
+// Иерархия ограничивающих объёмов (BVH) для запросов лучом: выбор объекта
+// мышью и трассировка на CPU. Дерево строится по эвристике площади поверхности
+// (SAH) с корзинами: верхние уровни делятся в вызывающем потоке, поддеревья
+// под ними — параллельно. Для движущихся объектов есть Refit: объёмы узлов
+// пересчитываются снизу вверх при той же топологии, без перестройки.
+// D3D здесь нет.
+//
+// Два уровня: Bvh — по объёмам любых примитивов (объекты сцены), MeshBvh — по
+// треугольникам меша, с обходом одним лучом и пакетом из RayPacketSize лучей.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VectorMath.h"
+
+struct Aabb
+{
+    Math::Float3 min = Math::Float3(INFINITY, INFINITY, INFINITY);
+    Math::Float3 max = Math::Float3(-INFINITY, -INFINITY, -INFINITY);
+
+    void Grow(const Math::Float3& point);
+    void Grow(const Aabb& box);
+    bool Empty() const { return min.x > max.x; }
+    Math::Float3 Center() const;
+    float SurfaceArea() const; // 0 для пустого
+};
+
+// Объём преобразованного бокса (восемь углов, с делением на w)
+Aabb TransformAabb(const Aabb& box, const Math::Matrix& m);
+
+// Направление не обязано быть единичным: t считается в его длинах, поэтому
+// луч, переведённый в пространство объекта без нормализации, даёт то же t
+struct Ray
+{
+    Math::Float3 origin;
+    Math::Float3 direction;
+    float tMax = INFINITY;
+};
+
+struct RayHit
+{
+    float t = INFINITY;
+    uint32_t primitive = ~0u; // номер треугольника или объекта; ~0u — промах
+    float u = 0.0f;           // барицентрические координаты попадания в треугольник
+    float v = 0.0f;
+
+    bool Hit() const { return primitive != ~0u; }
+};
+
+// Лучи пакета обходят дерево вместе: узел посещается, если его задевает хотя бы
+// один луч, а проверка узла и треугольника идёт сразу для всех лучей (SSE)
+static const size_t RayPacketSize = 4;
+
+struct RayPacket
+{
+    float originX[RayPacketSize], originY[RayPacketSize], originZ[RayPacketSize];
+    float directionX[RayPacketSize], directionY[RayPacketSize], directionZ[RayPacketSize];
+    float tMax[RayPacketSize];
+
+    void Set(size_t lane, const Ray& ray);
+};
+
+struct BvhNode
+{
+    Aabb bounds;
+    uint32_t first = 0; // лист — первый примитив в Primitives(), узел — левый потомок (правый следом)
+    uint32_t count = 0; // число примитивов листа; 0 — внутренний узел
+
+    bool Leaf() const { return count > 0; }
+};
+
+struct BvhStats
+{
+    size_t primitives = 0;
+    size_t nodes = 0;
+    size_t leaves = 0;
+    uint32_t depth = 0;
+    float sahCost = 0.0f;   // ожидаемая цена обхода случайным лучом, в проверках примитива
+    unsigned threads = 0;   // сколько потоков строили поддеревья
+    double buildMs = 0.0;
+    double refitMs = 0.0;   // последнего Refit
+};
+
+class Bvh
+{
+public:
+    static const uint32_t MaxLeafSize = 8;
+    static const uint32_t MaxDepth = 64; // глубже — лист, каким бы большим он ни был; столько же в стеке обхода
+
+    // threadCount потоков строят поддеревья; форма дерева от их числа не зависит
+    void Build(const std::vector<Aabb>& primitiveBounds, unsigned threadCount);
+
+    // Новые объёмы тех же примитивов (по исходным номерам), топология прежняя.
+    // Дерево хуже подогнано, чем после Build, но остаётся верным
+    void Refit(const std::vector<Aabb>& primitiveBounds);
+
+    bool Empty() const { return m_Nodes.empty(); }
+    const std::vector<BvhNode>& Nodes() const { return m_Nodes; }
+    const std::vector<uint32_t>& Primitives() const { return m_Primitives; } // исходные номера в порядке листьев
+    const BvhStats& Stats() const { return m_Stats; }
+    size_t SizeBytes() const { return m_Nodes.capacity() * sizeof(BvhNode) + m_Primitives.capacity() * sizeof(uint32_t); }
+
+    // Ближнее попадание одним лучом. intersect(index, ray, hit) проверяет
+    // примитив Primitives()[index] и, если попадание ближе hit.t, обновляет hit;
+    // узлы дальше hit.t не посещаются
+    template <class IntersectFn>
+    void Traverse(const Ray& ray, RayHit& hit, IntersectFn intersect) const;
+
+private:
+    struct Range
+    {
+        uint32_t node;
+        uint32_t first;
+        uint32_t count;
+        uint32_t depth;
+    };
+
+    // Делит диапазон, пока не дойдёт до листьев; диапазоны не больше deferCount
+    // (если он не 0) остаются заготовками в deferred — их достроят потоки
+    void Subdivide(std::vector<BvhNode>& nodes, Range root, uint32_t deferCount, std::vector<Range>* pDeferred,
+        const std::vector<Aabb>& primitiveBounds, const std::vector<Math::Float3>& centroids);
+    void UpdateStats();
+
+    std::vector<BvhNode> m_Nodes;
+    std::vector<uint32_t> m_Primitives;
+    BvhStats m_Stats;
+};
+
+// Пересечение луча с боксом по плитам; tEnter — вход (не меньше 0)
+inline bool IntersectAabb(const Aabb& box, const Math::Float3& origin, const Math::Float3& inverseDirection, float tMax, float& tEnter)
+{
+    const float x0 = (box.min.x - origin.x) * inverseDirection.x, x1 = (box.max.x - origin.x) * inverseDirection.x;
+    const float y0 = (box.min.y - origin.y) * inverseDirection.y, y1 = (box.max.y - origin.y) * inverseDirection.y;
+    const float z0 = (box.min.z - origin.z) * inverseDirection.z, z1 = (box.max.z - origin.z) * inverseDirection.z;
+    tEnter = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+    const float tExit = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), tMax));
+    return tEnter <= tExit;
+}
+
+template <class IntersectFn>
+void Bvh::Traverse(const Ray& ray, RayHit& hit, IntersectFn intersect) const
+{
+    if (m_Nodes.empty()) return;
+
+    const Math::Float3 inverseDirection(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+    float tEnter = 0.0f;
+    if (hit.t > ray.tMax) hit.t = ray.tMax;
+    if (!IntersectAabb(m_Nodes[0].bounds, ray.origin, inverseDirection, hit.t, tEnter)) return;
+
+    uint32_t stack[MaxDepth];
+    size_t top = 0;
+    uint32_t node = 0;
+    for (;;)
+    {
+        const BvhNode& current = m_Nodes[node];
+        if (current.Leaf())
+        {
+            for (uint32_t i = 0; i < current.count; ++i)
+                intersect(current.first + i, ray, hit);
+        }
+        else
+        {
+            // Сначала ближний потомок; дальний — в стек, если его вообще задевает луч
+            float tLeft = 0.0f, tRight = 0.0f;
+            const bool left = IntersectAabb(m_Nodes[current.first].bounds, ray.origin, inverseDirection, hit.t, tLeft);
+            const bool right = IntersectAabb(m_Nodes[current.first + 1].bounds, ray.origin, inverseDirection, hit.t, tRight);
+            if (left && right)
+            {
+                const bool leftFirst = tLeft <= tRight;
+                stack[top++] = leftFirst ? current.first + 1 : current.first;
+                node = leftFirst ? current.first : current.first + 1;
+                continue;
+            }
+            if (left || right)
+            {
+                node = left ? current.first : current.first + 1;
+                continue;
+            }
+        }
+
+        // Из стека — только узлы, которые ещё могут оказаться ближе найденного
+        bool found = false;
+        while (top > 0 && !found)
+        {
+            node = stack[--top];
+            found = IntersectAabb(m_Nodes[node].bounds, ray.origin, inverseDirection, hit.t, tEnter);
+        }
+        if (!found) return;
+    }
+}
+
+// BVH по треугольникам меша. Треугольники хранятся в порядке листьев как
+// вершина и два ребра — так их проверяет Мёллер — Трумбор
+class MeshBvh
+{
+public:
+    // indices — тройки номеров вершин, все меньше числа вершин в positions
+    void Build(const Math::Float3* positions, const uint32_t* indices, size_t indexCount, unsigned threadCount);
+
+    // Вершины сдвинулись (анимация, деформация), индексы те же, что при Build
+    void Refit(const Math::Float3* positions);
+
+    // hit.primitive — номер треугольника в исходных индексах. true — попадание ближе hit.t
+    bool Intersect(const Ray& ray, RayHit& hit) const;
+
+    // Пакет; hits[i] — как Intersect для i-го луча
+    void Intersect(const RayPacket& packet, RayHit hits[RayPacketSize]) const;
+
+    bool Empty() const { return m_Bvh.Empty(); }
+    Aabb Bounds() const { return m_Bvh.Empty() ? Aabb() : m_Bvh.Nodes()[0].bounds; }
+    size_t TriangleCount() const { return m_Triangles.size(); }
+    const BvhStats& Stats() const { return m_Bvh.Stats(); }
+    size_t SizeBytes() const;
+
+private:
+    struct Triangle
+    {
+        Math::Float3 v0;
+        Math::Float3 edge1; // v1 - v0
+        Math::Float3 edge2; // v2 - v0
+    };
+
+    void UpdateTriangles(const Math::Float3* positions, std::vector<Aabb>& bounds);
+
+    Bvh m_Bvh;
+    std::vector<Triangle> m_Triangles;   // в порядке листьев
+    std::vector<uint32_t> m_Indices;     // исходные индексы, по тройке на треугольник в порядке листьев
+    std::vector<Aabb> m_TriangleBounds;  // рабочий массив Refit, по исходным номерам
+};
+
+struct BvhBenchmark
+{
+    size_t triangles = 0;
+    unsigned threads = 0;
+    double buildMs = 0.0;          // все потоки
+    double singleThreadBuildMs = 0.0;
+    double refitMs = 0.0;
+    size_t nodes = 0;
+    uint32_t depth = 0;
+    float sahCost = 0.0f;
+    size_t rays = 0;
+    double coherentRaysPerSecond = 0.0;  // лучи из камеры, по одному
+    double packetRaysPerSecond = 0.0;    // те же лучи пакетами
+    double incoherentRaysPerSecond = 0.0; // случайные направления, по одному
+    double hitRate = 0.0;                // доля лучей из камеры, попавших в меш
+    size_t mismatches = 0; // расхождения пакета с одиночным лучом и выборки лучей с перебором всех треугольников
+};
+
+// Рельеф-сетка примерно из triangleCount треугольников: построение в 1 и
+// threadCount потоков, Refit после сдвига вершин, rayCount лучей из камеры и
+// столько же случайных
+BvhBenchmark BenchmarkBvh(size_t triangleCount, size_t rayCount, unsigned threadCount);
@@ -0,0 +1,347 @@
+﻿#include "ClusteredLights.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace Math;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Меньше — быстрее в одном потоке, чем запуск потоков
+    const uint32_t MinLightsPerThread = 256;
+
+    uint32_t TileIndex(float ndc, uint32_t tiles)
+    {
+        float tile = std::floor((ndc + 1.0f) * 0.5f * tiles);
+        if (tile < 0.0f) return 0;
+        if (tile >= (float)tiles) return tiles - 1;
+        return (uint32_t)tile;
+    }
+
+    // Пределы x / z (в NDC) для отрезка [low, high] на глубинах [nearZ, farZ]; z > 0
+    void ProjectedRange(float low, float high, float nearZ, float farZ, float scale, float& ndcMin, float& ndcMax)
+    {
+        ndcMin = scale * low / (low < 0.0f ? nearZ : farZ);
+        ndcMax = scale * high / (high > 0.0f ? nearZ : farZ);
+    }
+
+    void AddLight(const PointLight& light, const Float3& position, const Float3& normal, Float3& result)
+    {
+        const float dx = light.position.x - position.x;
+        const float dy = light.position.y - position.y;
+        const float dz = light.position.z - position.z;
+        const float distanceSq = dx * dx + dy * dy + dz * dz;
+        if (distanceSq >= light.radius * light.radius) return;
+
+        const float distance = std::sqrt(distanceSq);
+        const float falloff = 1.0f - distance / light.radius;
+        const float diffuse = distance > 0.0f ? std::max(0.0f, (dx * normal.x + dy * normal.y + dz * normal.z) / distance) : 1.0f;
+        const float amount = light.intensity * diffuse * falloff * falloff;
+        result.x += light.color.x * amount;
+        result.y += light.color.y * amount;
+        result.z += light.color.z * amount;
+    }
+}
+
+uint32_t ClusterGrid::Slice(float viewZ) const
+{
+    if (viewZ <= nearZ) return 0;
+    const float slice = std::floor(std::log(viewZ / nearZ) * slices / std::log(farZ / nearZ));
+    return slice >= (float)slices ? slices - 1 : (uint32_t)slice;
+}
+
+float ClusterGrid::SliceNear(uint32_t slice) const
+{
+    return nearZ * std::pow(farZ / nearZ, (float)slice / slices);
+}
+
+float ClusterGrid::SliceScale() const
+{
+    return slices / std::log(farZ / nearZ);
+}
+
+float ClusterGrid::SliceBias() const
+{
+    return -std::log(nearZ) * SliceScale();
+}
+
+uint32_t ClusterGrid::ClusterIndex(float ndcX, float ndcY, float viewZ) const
+{
+    if (viewZ < nearZ || viewZ > farZ || std::fabs(ndcX) > 1.0f || std::fabs(ndcY) > 1.0f) return ~0u;
+    const uint32_t tileX = TileIndex(ndcX, tilesX);
+    const uint32_t tileY = TileIndex(-ndcY, tilesY); // строки плиток — сверху вниз, как пиксели
+    return (Slice(viewZ) * tilesY + tileY) * tilesX + tileX;
+}
+
+bool ClusterGrid::operator==(const ClusterGrid& other) const
+{
+    return tilesX == other.tilesX && tilesY == other.tilesY && slices == other.slices &&
+           nearZ == other.nearZ && farZ == other.farZ && projX == other.projX && projY == other.projY;
+}
+
+ClusterGrid ClusterGrid::FromProjection(const Matrix& projection, uint32_t tilesX, uint32_t tilesY, uint32_t slices)
+{
+    // range = f / (f - n) в [2][2], -range * n в [3][2]
+    Float4x4 m;
+    StoreFloat4x4(&m, projection);
+    const float range = m.m[2][2];
+
+    ClusterGrid grid;
+    grid.tilesX = std::max(1u, tilesX);
+    grid.tilesY = std::max(1u, tilesY);
+    grid.slices = std::max(1u, slices);
+    grid.projX = m.m[0][0];
+    grid.projY = m.m[1][1];
+    grid.nearZ = -m.m[3][2] / range;
+    grid.farZ = range * grid.nearZ / (range - 1.0f);
+    return grid;
+}
+
+void LightClusterer::SetGrid(const ClusterGrid& grid)
+{
+    if (grid == m_Grid && !m_Bounds.empty()) return;
+    m_Grid = grid;
+
+    // Рамка кластера — по углам плитки на ближней и дальней глубине среза
+    m_Bounds.resize(grid.ClusterCount());
+    for (uint32_t slice = 0; slice < grid.slices; ++slice)
+    {
+        const float z0 = grid.SliceNear(slice);
+        const float z1 = slice + 1 == grid.slices ? grid.farZ : grid.SliceNear(slice + 1);
+        for (uint32_t tileY = 0; tileY < grid.tilesY; ++tileY)
+        {
+            const float ndcTop = 1.0f - 2.0f * tileY / grid.tilesY;
+            const float ndcBottom = 1.0f - 2.0f * (tileY + 1) / grid.tilesY;
+            for (uint32_t tileX = 0; tileX < grid.tilesX; ++tileX)
+            {
+                const float ndcLeft = -1.0f + 2.0f * tileX / grid.tilesX;
+                const float ndcRight = -1.0f + 2.0f * (tileX + 1) / grid.tilesX;
+
+                Bounds& bounds = m_Bounds[(slice * grid.tilesY + tileY) * grid.tilesX + tileX];
+                bounds.min = Float3(std::min(ndcLeft * z0, ndcLeft * z1) / grid.projX, std::min(ndcBottom * z0, ndcBottom * z1) / grid.projY, z0);
+                bounds.max = Float3(std::max(ndcRight * z0, ndcRight * z1) / grid.projX, std::max(ndcTop * z0, ndcTop * z1) / grid.projY, z1);
+            }
+        }
+    }
+}
+
+void LightClusterer::CollectPairs(uint32_t firstLight, uint32_t lightCount, std::vector<uint64_t>& pairs, std::vector<uint32_t>& counts) const
+{
+    const ClusterGrid& grid = m_Grid;
+    pairs.clear();
+    counts.assign(grid.ClusterCount(), 0u);
+
+    for (uint32_t lightIndex = firstLight; lightIndex < firstLight + lightCount; ++lightIndex)
+    {
+        const PointLight& light = m_ViewLights[lightIndex];
+        const Float3& p = light.position;
+        const float r = light.radius;
+        if (p.z + r < grid.nearZ || p.z - r > grid.farZ) continue;
+
+        // Грубо: диапазон срезов и плиток по проекции рамки сферы, потом точно — сфера против рамки кластера
+        const float zNear = std::max(p.z - r, grid.nearZ);
+        const float zFar = std::min(p.z + r, grid.farZ);
+        float ndcMinX, ndcMaxX, ndcMinY, ndcMaxY;
+        ProjectedRange(p.x - r, p.x + r, zNear, zFar, grid.projX, ndcMinX, ndcMaxX);
+        ProjectedRange(p.y - r, p.y + r, zNear, zFar, grid.projY, ndcMinY, ndcMaxY);
+        if (ndcMinX > 1.0f || ndcMaxX < -1.0f || ndcMinY > 1.0f || ndcMaxY < -1.0f) continue;
+
+        const uint32_t slice0 = grid.Slice(zNear), slice1 = grid.Slice(zFar);
+        const uint32_t tileX0 = TileIndex(ndcMinX, grid.tilesX), tileX1 = TileIndex(ndcMaxX, grid.tilesX);
+        const uint32_t tileY0 = TileIndex(-ndcMaxY, grid.tilesY), tileY1 = TileIndex(-ndcMinY, grid.tilesY);
+        const float radiusSq = r * r;
+
+        for (uint32_t slice = slice0; slice <= slice1; ++slice)
+        {
+            for (uint32_t tileY = tileY0; tileY <= tileY1; ++tileY)
+            {
+                const uint32_t rowStart = (slice * grid.tilesY + tileY) * grid.tilesX;
+                for (uint32_t tileX = tileX0; tileX <= tileX1; ++tileX)
+                {
+                    const Bounds& bounds = m_Bounds[rowStart + tileX];
+                    const float dx = std::max(std::max(bounds.min.x - p.x, p.x - bounds.max.x), 0.0f);
+                    const float dy = std::max(std::max(bounds.min.y - p.y, p.y - bounds.max.y), 0.0f);
+                    const float dz = std::max(std::max(bounds.min.z - p.z, p.z - bounds.max.z), 0.0f);
+                    if (dx * dx + dy * dy + dz * dz > radiusSq) continue;
+
+                    pairs.push_back(((uint64_t)(rowStart + tileX) << 32) | lightIndex);
+                    ++counts[rowStart + tileX];
+                }
+            }
+        }
+    }
+}
+
+void LightClusterer::Assign(const std::vector<PointLight>& lights, const Matrix& view, unsigned threadCount)
+{
+    const Clock::time_point start = Clock::now();
+    const uint32_t clusterCount = m_Grid.ClusterCount();
+    const uint32_t lightCount = (uint32_t)lights.size();
+
+    // Центры — в пространство вида одним пакетом
+    m_ViewLights = lights;
+    m_Positions.resize(lightCount);
+    for (uint32_t i = 0; i < lightCount; ++i)
+        m_Positions[i] = lights[i].position;
+    Vector3TransformCoordStream(m_Positions.data(), m_Positions.data(), lightCount, view);
+    for (uint32_t i = 0; i < lightCount; ++i)
+        m_ViewLights[i].position = m_Positions[i];
+
+    threadCount = std::max(1u, std::min(threadCount, (lightCount + MinLightsPerThread - 1) / MinLightsPerThread));
+    m_ThreadPairs.resize(threadCount);
+    m_ThreadCounts.resize(threadCount);
+    const uint32_t lightsPerThread = (lightCount + threadCount - 1) / std::max(1u, threadCount);
+
+    // Фаза 1: каждый поток собирает пары (кластер, источник) для своей части источников
+    Jobs().RunTasks(threadCount, [&](unsigned thread)
+    {
+        const uint32_t first = std::min(lightCount, thread * lightsPerThread);
+        const uint32_t count = std::min(lightsPerThread, lightCount - first);
+        CollectPairs(first, count, m_ThreadPairs[thread], m_ThreadCounts[thread]);
+    });
+
+    // Смещения: кластеры подряд, внутри кластера — потоки по порядку, то есть источники по возрастанию
+    m_Ranges.resize(clusterCount);
+    uint32_t offset = 0;
+    m_Stats = LightCullingStats();
+    for (uint32_t cluster = 0; cluster < clusterCount; ++cluster)
+    {
+        m_Ranges[cluster].offset = offset;
+        for (unsigned thread = 0; thread < threadCount; ++thread)
+        {
+            const uint32_t count = m_ThreadCounts[thread][cluster];
+            m_ThreadCounts[thread][cluster] = offset;
+            offset += count;
+        }
+        m_Ranges[cluster].count = offset - m_Ranges[cluster].offset;
+        if (m_Ranges[cluster].count > 0) ++m_Stats.occupiedClusters;
+        m_Stats.maxClusterLights = std::max(m_Stats.maxClusterLights, m_Ranges[cluster].count);
+    }
+
+    // Фаза 2: раскладка по готовым смещениям. Пары потока уже идут по возрастанию
+    // источника, а участки разных потоков не пересекаются — пишут параллельно
+    m_Indices.resize(offset);
+    std::vector<uint8_t> visible(lightCount, 0);
+    Jobs().RunTasks(threadCount, [&](unsigned thread)
+    {
+        std::vector<uint32_t>& cursors = m_ThreadCounts[thread];
+        for (uint64_t pair : m_ThreadPairs[thread])
+        {
+            const uint32_t lightIndex = (uint32_t)pair;
+            m_Indices[cursors[pair >> 32]++] = lightIndex;
+            visible[lightIndex] = 1;
+        }
+    });
+
+    m_Stats.lights = lightCount;
+    m_Stats.indexCount = offset;
+    m_Stats.visibleLights = (size_t)std::count(visible.begin(), visible.end(), (uint8_t)1);
+    m_Stats.assignMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+size_t LightClusterer::CapacityBytes() const
+{
+    size_t bytes = m_Bounds.capacity() * sizeof(Bounds) + m_ViewLights.capacity() * sizeof(PointLight) +
+                   m_Positions.capacity() * sizeof(Float3) + m_Ranges.capacity() * sizeof(ClusterRange) +
+                   m_Indices.capacity() * sizeof(uint32_t);
+    for (const std::vector<uint64_t>& pairs : m_ThreadPairs) bytes += pairs.capacity() * sizeof(uint64_t);
+    for (const std::vector<uint32_t>& counts : m_ThreadCounts) bytes += counts.capacity() * sizeof(uint32_t);
+    return bytes;
+}
+
+Float3 LightClusterer::Shade(const Float3& viewPosition, const Float3& viewNormal) const
+{
+    Float3 result(0.0f, 0.0f, 0.0f);
+    if (viewPosition.z <= 0.0f) return result;
+
+    const float ndcX = viewPosition.x * m_Grid.projX / viewPosition.z;
+    const float ndcY = viewPosition.y * m_Grid.projY / viewPosition.z;
+    const uint32_t cluster = m_Grid.ClusterIndex(ndcX, ndcY, viewPosition.z);
+    if (cluster >= m_Ranges.size()) return result;
+
+    const ClusterRange& range = m_Ranges[cluster];
+    for (uint32_t i = range.offset; i < range.offset + range.count; ++i)
+        AddLight(m_ViewLights[m_Indices[i]], viewPosition, viewNormal, result);
+    return result;
+}
+
+Float3 ShadeAllLights(const std::vector<PointLight>& viewLights, const Float3& viewPosition, const Float3& viewNormal)
+{
+    Float3 result(0.0f, 0.0f, 0.0f);
+    for (const PointLight& light : viewLights)
+        AddLight(light, viewPosition, viewNormal, result);
+    return result;
+}
+
+std::vector<LightCullingBenchmark> BenchmarkLightCulling(const std::vector<size_t>& lightCounts, size_t shadePoints, unsigned threadCount)
+{
+    const Matrix view = MatrixLookAtLH(VectorSet(0.0f, 5.0f, -20.0f, 0.0f), VectorSet(0.0f, 0.0f, 20.0f, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const Matrix projection = MatrixPerspectiveFovLH(PiDiv2, 16.0f / 9.0f, 0.01f, 100.0f);
+
+    LightClusterer clusterer;
+    clusterer.SetGrid(ClusterGrid::FromProjection(projection, 16, 9, 24));
+
+    // Точки «экрана»: равномерно по NDC на случайной глубине, нормаль — к камере
+    std::mt19937 random(2024);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const ClusterGrid& grid = clusterer.Grid();
+    std::vector<Float3> points(shadePoints);
+    for (Float3& point : points)
+    {
+        const float z = 1.0f + unit(random) * 60.0f;
+        point = Float3((unit(random) * 2.0f - 1.0f) * z / grid.projX, (unit(random) * 2.0f - 1.0f) * z / grid.projY, z);
+    }
+    const Float3 normal(0.0f, 0.0f, -1.0f);
+    std::vector<Float3> clustered(shadePoints), naive(shadePoints);
+
+    std::vector<LightCullingBenchmark> results;
+    for (size_t lightCount : lightCounts)
+    {
+        // Источники в параллелепипеде перед камерой, радиус 2..6
+        std::vector<PointLight> lights(lightCount);
+        for (PointLight& light : lights)
+        {
+            light.position = Float3(unit(random) * 80.0f - 40.0f, unit(random) * 10.0f, unit(random) * 60.0f);
+            light.radius = 2.0f + unit(random) * 4.0f;
+            light.color = Float3(unit(random), unit(random), unit(random));
+            light.intensity = 1.0f;
+        }
+
+        LightCullingBenchmark result;
+        result.lights = lightCount;
+        result.assignMs = 1e30;
+        for (int repeat = 0; repeat < 5; ++repeat)
+        {
+            clusterer.Assign(lights, view, threadCount);
+            result.assignMs = std::min(result.assignMs, clusterer.Stats().assignMs);
+        }
+        const LightCullingStats& stats = clusterer.Stats();
+        result.averageClusterLights = stats.occupiedClusters > 0 ? (double)stats.indexCount / stats.occupiedClusters : 0.0;
+        result.maxClusterLights = stats.maxClusterLights;
+
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < shadePoints; ++i)
+            clustered[i] = clusterer.Shade(points[i], normal);
+        result.clusteredShadeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        start = Clock::now();
+        for (size_t i = 0; i < shadePoints; ++i)
+            naive[i] = ShadeAllLights(clusterer.ViewLights(), points[i], normal);
+        result.naiveShadeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        // Кластеры не должны терять вклад: разница — только от порядка сложения
+        for (size_t i = 0; i < shadePoints; ++i)
+        {
+            result.maxShadeError = std::max(result.maxShadeError, (double)std::fabs(clustered[i].x - naive[i].x));
+            result.maxShadeError = std::max(result.maxShadeError, (double)std::fabs(clustered[i].y - naive[i].y));
+            result.maxShadeError = std::max(result.maxShadeError, (double)std::fabs(clustered[i].z - naive[i].z));
+        }
+        results.push_back(result);
+    }
+    return results;
+}
@@ -0,0 +1,129 @@
+﻿#pragma once
+
+// Кластерное освещение: пирамида видимости делится на сетку кластеров —
+// плитки по экрану и экспоненциальные срезы по глубине. Каждый кадр источники
+// распределяются по кластерам на CPU, и шейдер перебирает только источники
+// своего кластера, а не все. Здесь нет D3D — только сетка и списки индексов;
+// загрузка на GPU — в main.cpp.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VectorMath.h"
+
+// Раскладка совпадает со StructuredBuffer<PointLight> в пиксельном шейдере
+struct PointLight
+{
+    Math::Float3 position; // в мировых координатах; после Assign — в пространстве вида
+    float radius = 1.0f;   // за радиусом вклад равен нулю
+    Math::Float3 color;
+    float intensity = 1.0f;
+};
+
+struct ClusterGrid
+{
+    uint32_t tilesX = 16;
+    uint32_t tilesY = 9;
+    uint32_t slices = 24;
+    float nearZ = 0.01f;
+    float farZ = 100.0f;
+    float projX = 1.0f; // масштабы проекции по x и y (m00, m11)
+    float projY = 1.0f;
+
+    uint32_t ClusterCount() const { return tilesX * tilesY * slices; }
+
+    // Срез по глубине в пространстве вида; за ближней и дальней плоскостью — крайние срезы
+    uint32_t Slice(float viewZ) const;
+    float SliceNear(uint32_t slice) const;
+
+    // Срез как floor(log(z) * SliceScale() + SliceBias()) — так его считает шейдер
+    float SliceScale() const;
+    float SliceBias() const;
+
+    // Кластер точки по NDC и глубине; ~0u — вне пирамиды
+    uint32_t ClusterIndex(float ndcX, float ndcY, float viewZ) const;
+
+    bool operator==(const ClusterGrid& other) const;
+    bool operator!=(const ClusterGrid& other) const { return !(*this == other); }
+
+    // Ближняя/дальняя плоскости и масштабы — из перспективной матрицы (LH, как MatrixPerspectiveFovLH)
+    static ClusterGrid FromProjection(const Math::Matrix& projection, uint32_t tilesX, uint32_t tilesY, uint32_t slices);
+};
+
+// Источники кластера: LightIndices()[offset .. offset + count)
+struct ClusterRange
+{
+    uint32_t offset;
+    uint32_t count;
+};
+
+struct LightCullingStats
+{
+    size_t lights = 0;
+    size_t visibleLights = 0;   // попали хотя бы в один кластер
+    size_t indexCount = 0;      // сумма длин списков
+    size_t occupiedClusters = 0;
+    uint32_t maxClusterLights = 0;
+    double assignMs = 0.0;
+};
+
+class LightClusterer
+{
+public:
+    void SetGrid(const ClusterGrid& grid);
+    const ClusterGrid& Grid() const { return m_Grid; }
+
+    // Переводит источники в пространство вида и раскладывает по кластерам.
+    // Источники делятся между threadCount потоками; порядок индексов в каждом
+    // кластере — по возрастанию, от числа потоков не зависит
+    void Assign(const std::vector<PointLight>& lights, const Math::Matrix& view, unsigned threadCount);
+
+    const std::vector<PointLight>& ViewLights() const { return m_ViewLights; }
+    const std::vector<ClusterRange>& Ranges() const { return m_Ranges; }
+    const std::vector<uint32_t>& LightIndices() const { return m_Indices; }
+    const LightCullingStats& Stats() const { return m_Stats; }
+    size_t CapacityBytes() const; // все рабочие массивы, включая потоковые
+
+    // Освещённость точки в пространстве вида по спискам кластера — то же, что
+    // считает пиксельный шейдер; для программной отрисовки и проверки
+    Math::Float3 Shade(const Math::Float3& viewPosition, const Math::Float3& viewNormal) const;
+
+private:
+    struct Bounds
+    {
+        Math::Float3 min;
+        Math::Float3 max;
+    };
+
+    // Кластеры, которые задевает сфера, — в pairs как (кластер << 32) | источник
+    void CollectPairs(uint32_t firstLight, uint32_t lightCount, std::vector<uint64_t>& pairs, std::vector<uint32_t>& counts) const;
+
+    ClusterGrid m_Grid;
+    std::vector<Bounds> m_Bounds; // AABB кластеров в пространстве вида
+    std::vector<PointLight> m_ViewLights;
+    std::vector<Math::Float3> m_Positions;
+    std::vector<ClusterRange> m_Ranges;
+    std::vector<uint32_t> m_Indices;
+    std::vector<std::vector<uint64_t>> m_ThreadPairs;
+    std::vector<std::vector<uint32_t>> m_ThreadCounts;
+    LightCullingStats m_Stats;
+};
+
+// Освещённость без кластеров — перебором всех источников
+Math::Float3 ShadeAllLights(const std::vector<PointLight>& viewLights, const Math::Float3& viewPosition, const Math::Float3& viewNormal);
+
+struct LightCullingBenchmark
+{
+    size_t lights = 0;
+    double assignMs = 0.0;        // распределение по кластерам, все потоки
+    double averageClusterLights = 0.0;
+    uint32_t maxClusterLights = 0;
+    double clusteredShadeMs = 0.0; // освещение набора точек по спискам кластеров
+    double naiveShadeMs = 0.0;     // то же перебором всех источников
+    double maxShadeError = 0.0;    // наибольшее расхождение двух способов по каналу
+};
+
+// Случайные источники в объёме перед камерой; lightCounts — ряд размеров (например, 16..16384),
+// shadePoints — сколько точек «экрана» освещать для сравнения с перебором
+std::vector<LightCullingBenchmark> BenchmarkLightCulling(const std::vector<size_t>& lightCounts, size_t shadePoints, unsigned threadCount);
@@ -0,0 +1,313 @@
+﻿#include "CoverageRaster.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+#if VECTOR_MATH_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace Math;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Стандартные позиции выборок D3D11 в 1/16 пикселя от центра
+    const int StandardPattern2[2][2] = { { 4, 4 }, { -4, -4 } };
+    const int StandardPattern4[4][2] = { { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 } };
+    const int StandardPattern8[8][2] = { { 1, -3 }, { -1, 3 }, { 5, 1 }, { -3, -5 }, { -5, 5 }, { -7, -1 }, { 3, 7 }, { 7, -7 } };
+
+    uint32_t PackColor(float r, float g, float b, float a)
+    {
+        auto channel = [](float value) { return (uint32_t)(std::min(1.0f, std::max(0.0f, value)) * 255.0f + 0.5f); };
+        return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (channel(a) << 24);
+    }
+
+    uint32_t LowestBit(uint32_t bits)
+    {
+        uint32_t index = 0;
+        while (!(bits & (1u << index))) ++index;
+        return index;
+    }
+
+    // Рёберная функция a -> b: E(p) = A * x + B * y + C, положительна внутри
+    // треугольника с положительной площадью
+    struct Edge
+    {
+        float a, b, c;
+        bool inclusive; // на самом ребре выборка считается покрытой — правило «верх-лево»
+
+        Edge(const RasterVertex& from, const RasterVertex& to)
+        {
+            a = from.y - to.y;
+            b = to.x - from.x;
+            c = from.x * to.y - from.y * to.x;
+            // Общее ребро двух треугольников у них направлено противоположно,
+            // так что выборку на нём получает ровно один
+            inclusive = a > 0.0f || (a == 0.0f && b < 0.0f);
+        }
+
+        float At(float x, float y) const { return a * x + b * y + c; }
+    };
+}
+
+void CoverageRasterizer::Resize(uint32_t width, uint32_t height, uint32_t sampleCount)
+{
+    m_SampleCount = sampleCount >= 8 ? 8 : sampleCount >= 4 ? 4 : sampleCount >= 2 ? 2 : 1;
+    m_Width = width;
+    m_Height = height;
+
+    for (uint32_t s = 0; s < MaxSamples; ++s)
+        m_SampleX[s] = m_SampleY[s] = 0.0f;
+    const int (*pattern)[2] = m_SampleCount == 8 ? StandardPattern8 : m_SampleCount == 4 ? StandardPattern4 : StandardPattern2;
+    if (m_SampleCount > 1)
+    {
+        for (uint32_t s = 0; s < m_SampleCount; ++s)
+        {
+            m_SampleX[s] = pattern[s][0] / 16.0f;
+            m_SampleY[s] = pattern[s][1] / 16.0f;
+        }
+    }
+
+    const size_t samples = (size_t)width * height * m_SampleCount;
+    m_Colors.assign(samples, 0u);
+    m_Depth.assign(samples, 1.0f);
+}
+
+void CoverageRasterizer::Clear(const Float4& color)
+{
+    std::fill(m_Colors.begin(), m_Colors.end(), PackColor(color.x, color.y, color.z, color.w));
+    std::fill(m_Depth.begin(), m_Depth.end(), 1.0f);
+}
+
+void CoverageRasterizer::DrawTriangle(const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2)
+{
+    const RasterVertex* v[3] = { &v0, &v1, &v2 };
+    float area = Edge(v0, v1).At(v2.x, v2.y);
+    if (area == 0.0f || !(std::fabs(area) < 1e30f)) return;
+    if (area < 0.0f)
+    {
+        std::swap(v[1], v[2]); // отсечения по обходу нет — рисуются обе стороны
+        area = -area;
+    }
+    ++m_Stats.triangles;
+
+    // Ребро i лежит напротив вершины i: его значение, делённое на площадь, — барицентрика вершины
+    const Edge edges[3] = { Edge(*v[1], *v[2]), Edge(*v[2], *v[0]), Edge(*v[0], *v[1]) };
+    const float invArea = 1.0f / area;
+
+    // Рамка пикселей, чьи выборки могут попасть в треугольник
+    const float minX = std::min(v[0]->x, std::min(v[1]->x, v[2]->x));
+    const float maxX = std::max(v[0]->x, std::max(v[1]->x, v[2]->x));
+    const float minY = std::min(v[0]->y, std::min(v[1]->y, v[2]->y));
+    const float maxY = std::max(v[0]->y, std::max(v[1]->y, v[2]->y));
+    const int x0 = (int)std::max(0.0f, std::floor(minX - 0.5f));
+    const int x1 = (int)std::min(m_Width - 1.0f, std::ceil(maxX + 0.5f));
+    const int y0 = (int)std::max(0.0f, std::floor(minY - 0.5f));
+    const int y1 = (int)std::min(m_Height - 1.0f, std::ceil(maxY + 0.5f));
+    if (x0 > x1 || y0 > y1) return;
+
+    // Смещения значений рёбер и глубины от центра пикселя к каждой выборке.
+    // Лишние дорожки получают -inf, и их биты маски всегда нулевые
+    const uint32_t lanes = m_SampleCount > 4 ? 8 : 4;
+    alignas(16) float edgeOffsets[3][MaxSamples];
+    float depthOffsets[MaxSamples];
+    const float depthA = (edges[0].a * v[0]->z + edges[1].a * v[1]->z + edges[2].a * v[2]->z) * invArea;
+    const float depthB = (edges[0].b * v[0]->z + edges[1].b * v[1]->z + edges[2].b * v[2]->z) * invArea;
+    for (uint32_t s = 0; s < MaxSamples; ++s)
+    {
+        for (int e = 0; e < 3; ++e)
+            edgeOffsets[e][s] = s < m_SampleCount ? edges[e].a * m_SampleX[s] + edges[e].b * m_SampleY[s] : -INFINITY;
+        depthOffsets[s] = depthA * m_SampleX[s] + depthB * m_SampleY[s];
+    }
+    const uint32_t fullMask = (1u << m_SampleCount) - 1;
+
+#if VECTOR_MATH_SSE
+    __m128 offsets[3][2];
+    for (int e = 0; e < 3; ++e)
+    {
+        offsets[e][0] = _mm_load_ps(&edgeOffsets[e][0]);
+        offsets[e][1] = _mm_load_ps(&edgeOffsets[e][4]);
+    }
+#endif
+
+    // Маска покрытия пикселя по значениям рёбер в его центре
+    auto coverage = [&](const float center[3])
+    {
+        uint32_t mask = 0;
+#if VECTOR_MATH_SSE
+        for (uint32_t group = 0; group < lanes / 4; ++group)
+        {
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int e = 0; e < 3; ++e)
+            {
+                const __m128 value = _mm_add_ps(_mm_set1_ps(center[e]), offsets[e][group]);
+                const __m128 test = edges[e].inclusive ? _mm_cmpge_ps(value, _mm_setzero_ps()) : _mm_cmpgt_ps(value, _mm_setzero_ps());
+                inside = _mm_and_ps(inside, test);
+            }
+            mask |= (uint32_t)_mm_movemask_ps(inside) << (group * 4);
+        }
+#else
+        for (uint32_t s = 0; s < lanes; ++s)
+        {
+            bool inside = true;
+            for (int e = 0; e < 3; ++e)
+            {
+                const float value = center[e] + edgeOffsets[e][s];
+                inside = inside && (edges[e].inclusive ? value >= 0.0f : value > 0.0f);
+            }
+            mask |= (uint32_t)inside << s;
+        }
+#endif
+        return mask & fullMask;
+    };
+
+    // Блоки 8x8 пикселей: рёберная функция линейна, поэтому по углам блока
+    // (с запасом на разнос выборок) видно, что он целиком снаружи или целиком внутри
+    const int BlockSize = 8;
+    for (int blockY = y0; blockY <= y1; blockY += BlockSize)
+    {
+        for (int blockX = x0; blockX <= x1; blockX += BlockSize)
+        {
+            const int blockX1 = std::min(blockX + BlockSize - 1, x1);
+            const int blockY1 = std::min(blockY + BlockSize - 1, y1);
+            bool blockOutside = false;
+            bool blockInside = true;
+            for (int e = 0; e < 3 && !blockOutside; ++e)
+            {
+                const float corner = edges[e].At(blockX + 0.5f, blockY + 0.5f);
+                const float spanX = edges[e].a * (blockX1 - blockX);
+                const float spanY = edges[e].b * (blockY1 - blockY);
+                const float reach = 0.5f * (std::fabs(edges[e].a) + std::fabs(edges[e].b));
+                blockOutside = corner + std::max(0.0f, spanX) + std::max(0.0f, spanY) + reach < 0.0f;
+                blockInside = blockInside && corner + std::min(0.0f, spanX) + std::min(0.0f, spanY) - reach > 0.0f;
+            }
+            if (blockOutside) continue;
+
+            for (int y = blockY; y <= blockY1; ++y)
+            {
+                for (int x = blockX; x <= blockX1; ++x)
+                {
+                    float center[3];
+                    for (int e = 0; e < 3; ++e)
+                        center[e] = edges[e].At(x + 0.5f, y + 0.5f);
+
+                    const uint32_t mask = blockInside ? fullMask : coverage(center);
+                    if (!mask) continue;
+
+                    // Глубина каждой покрытой выборки; цвет пока не считаем
+                    const size_t base = ((size_t)y * m_Width + x) * m_SampleCount;
+                    const float centerDepth = (center[0] * v[0]->z + center[1] * v[1]->z + center[2] * v[2]->z) * invArea;
+                    uint32_t passed = 0;
+                    for (uint32_t bits = mask; bits; bits &= bits - 1)
+                    {
+                        const uint32_t s = LowestBit(bits);
+                        if (centerDepth + depthOffsets[s] < m_Depth[base + s]) passed |= 1u << s;
+                    }
+                    if (!passed) continue;
+
+                    // Один «шейдер» на пиксель: в центре, если он покрыт, иначе в первой
+                    // покрытой выборке (как центроидная интерполяция)
+                    float w[3] = { center[0], center[1], center[2] };
+                    if (!(w[0] >= 0.0f && w[1] >= 0.0f && w[2] >= 0.0f))
+                    {
+                        const uint32_t s = LowestBit(passed);
+                        for (int e = 0; e < 3; ++e)
+                            w[e] = center[e] + edgeOffsets[e][s];
+                    }
+                    for (int e = 0; e < 3; ++e)
+                        w[e] = std::max(0.0f, w[e]) * invArea;
+                    const Float4& c0 = v[0]->color;
+                    const Float4& c1 = v[1]->color;
+                    const Float4& c2 = v[2]->color;
+                    const uint32_t color = PackColor(w[0] * c0.x + w[1] * c1.x + w[2] * c2.x, w[0] * c0.y + w[1] * c1.y + w[2] * c2.y,
+                                                     w[0] * c0.z + w[1] * c1.z + w[2] * c2.z, w[0] * c0.w + w[1] * c1.w + w[2] * c2.w);
+                    ++m_Stats.shadedPixels;
+                    if (mask != fullMask) ++m_Stats.partialPixels;
+
+                    for (uint32_t bits = passed; bits; bits &= bits - 1)
+                    {
+                        const uint32_t s = LowestBit(bits);
+                        m_Colors[base + s] = color;
+                        m_Depth[base + s] = centerDepth + depthOffsets[s];
+                        ++m_Stats.coveredSamples;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void CoverageRasterizer::Resolve(std::vector<uint8_t>& rgba) const
+{
+    const size_t pixels = (size_t)m_Width * m_Height;
+    rgba.resize(pixels * 4);
+    const uint32_t half = m_SampleCount / 2;
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        const uint32_t* samples = &m_Colors[i * m_SampleCount];
+        for (uint32_t channel = 0; channel < 4; ++channel)
+        {
+            uint32_t sum = half;
+            for (uint32_t s = 0; s < m_SampleCount; ++s)
+                sum += (samples[s] >> (channel * 8)) & 0xff;
+            rgba[i * 4 + channel] = (uint8_t)(sum / m_SampleCount);
+        }
+    }
+}
+
+std::vector<RasterBenchmark> BenchmarkCoverageRaster(uint32_t width, uint32_t height, size_t triangleCount)
+{
+    std::mt19937 random(777);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::vector<RasterVertex> vertices(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount; ++i)
+    {
+        const float cx = unit(random) * width;
+        const float cy = unit(random) * height;
+        const float size = 4.0f + unit(random) * unit(random) * 96.0f;
+        const float z = unit(random);
+        for (int k = 0; k < 3; ++k)
+        {
+            RasterVertex& vertex = vertices[i * 3 + k];
+            vertex.x = cx + (unit(random) - 0.5f) * size;
+            vertex.y = cy + (unit(random) - 0.5f) * size;
+            vertex.z = z;
+            vertex.color = Float4(unit(random), unit(random), unit(random), 1.0f);
+        }
+    }
+
+    std::vector<RasterBenchmark> results;
+    CoverageRasterizer rasterizer;
+    std::vector<uint8_t> resolved;
+    for (uint32_t samples = 1; samples <= CoverageRasterizer::MaxSamples; samples *= 2)
+    {
+        rasterizer.Resize(width, height, samples);
+
+        // Лучший из нескольких повторов
+        RasterBenchmark result;
+        result.sampleCount = samples;
+        result.drawMs = result.resolveMs = 1e30;
+        for (int repeat = 0; repeat < 3; ++repeat)
+        {
+            rasterizer.Clear(Float4(0.0f, 0.0f, 0.0f, 1.0f));
+            rasterizer.ResetStats();
+
+            Clock::time_point start = Clock::now();
+            for (size_t i = 0; i < triangleCount; ++i)
+                rasterizer.DrawTriangle(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+            result.drawMs = std::min(result.drawMs, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+
+            start = Clock::now();
+            rasterizer.Resolve(resolved);
+            result.resolveMs = std::min(result.resolveMs, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        result.stats = rasterizer.Stats();
+        results.push_back(result);
+    }
+    return results;
+}
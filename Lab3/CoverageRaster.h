@@ -0,0 +1,71 @@
+﻿#pragma once
+
+// Программная растеризация с MSAA. Для каждого пикселя треугольника строится
+// маска покрытия по стандартным позициям выборок D3D11 (1, 2, 4 или 8 на пиксель):
+// рёберные функции считаются сразу для четырёх выборок (SSE). Цвет вычисляется
+// один раз на пиксель и пишется во все покрытые выборки, прошедшие тест глубины;
+// Resolve усредняет выборки. Здесь нет D3D.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VectorMath.h"
+
+struct RasterVertex
+{
+    float x = 0.0f; // в пикселях от левого верхнего угла
+    float y = 0.0f;
+    float z = 0.0f; // глубина 0..1, меньше — ближе
+    Math::Float4 color = Math::Float4(1.0f, 1.0f, 1.0f, 1.0f);
+};
+
+struct RasterStats
+{
+    size_t triangles = 0;
+    size_t shadedPixels = 0;   // вызовы «шейдера» — по одному на пиксель с покрытием
+    size_t coveredSamples = 0; // выборки, прошедшие покрытие и глубину
+    size_t partialPixels = 0;  // пиксели, покрытые не всеми выборками, — край треугольника
+};
+
+class CoverageRasterizer
+{
+public:
+    static const uint32_t MaxSamples = 8;
+
+    // sampleCount — 1, 2, 4 или 8; иное округляется вниз до ближайшего из них
+    void Resize(uint32_t width, uint32_t height, uint32_t sampleCount);
+    void Clear(const Math::Float4& color);
+
+    void DrawTriangle(const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2);
+
+    // Среднее выборок каждого пикселя, RGBA8 построчно
+    void Resolve(std::vector<uint8_t>& rgba) const;
+
+    uint32_t Width() const { return m_Width; }
+    uint32_t Height() const { return m_Height; }
+    uint32_t SampleCount() const { return m_SampleCount; }
+    const RasterStats& Stats() const { return m_Stats; }
+    void ResetStats() { m_Stats = RasterStats(); }
+
+private:
+    uint32_t m_Width = 0;
+    uint32_t m_Height = 0;
+    uint32_t m_SampleCount = 1;
+    float m_SampleX[MaxSamples] = {}; // смещения выборок от центра пикселя
+    float m_SampleY[MaxSamples] = {};
+    std::vector<uint32_t> m_Colors; // RGBA8 на выборку; выборки пикселя подряд
+    std::vector<float> m_Depth;
+    RasterStats m_Stats;
+};
+
+struct RasterBenchmark
+{
+    uint32_t sampleCount = 1;
+    double drawMs = 0.0;
+    double resolveMs = 0.0;
+    RasterStats stats;
+};
+
+// Случайные треугольники размером от нескольких до сотни пикселей, для каждого числа выборок
+std::vector<RasterBenchmark> BenchmarkCoverageRaster(uint32_t width, uint32_t height, size_t triangleCount);
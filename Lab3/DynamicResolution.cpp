@@ -0,0 +1,115 @@
+﻿#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const double MaxError = 0.5;
+    const float Hysteresis = 0.8f; // в долях шага квантования
+}
+
+ResolutionController::ResolutionController(const ResolutionSettings& settings)
+{
+    SetSettings(settings);
+}
+
+void ResolutionController::SetSettings(const ResolutionSettings& settings)
+{
+    m_Settings = settings;
+    m_Settings.maxScale = std::max(0.01f, m_Settings.maxScale);
+    m_Settings.minScale = std::min(std::max(0.01f, m_Settings.minScale), m_Settings.maxScale);
+    Reset();
+}
+
+void ResolutionController::Reset()
+{
+    m_Area = (double)m_Settings.maxScale * m_Settings.maxScale;
+    m_Error1 = m_Error2 = 0.0;
+    m_Scale = Quantize(m_Area);
+    m_History.clear();
+    m_HistoryNext = 0;
+    m_ScaleChanges = 0;
+}
+
+float ResolutionController::Update(double frameMs)
+{
+    if (!(frameMs >= 0.0) || m_Settings.targetMs <= 0.0) return m_Scale;
+
+    double error = (m_Settings.targetMs - frameMs) / m_Settings.targetMs;
+    if (std::fabs(error) < m_Settings.deadband) error = 0.0;
+    error = std::max(-MaxError, std::min(MaxError, error)); // один провальный кадр не должен обрушить масштаб
+
+    const double change = m_Settings.kp * (error - m_Error1) + m_Settings.ki * error + m_Settings.kd * (error - 2.0 * m_Error1 + m_Error2);
+    m_Error2 = m_Error1;
+    m_Error1 = error;
+
+    const double minArea = (double)m_Settings.minScale * m_Settings.minScale;
+    const double maxArea = (double)m_Settings.maxScale * m_Settings.maxScale;
+    m_Area = std::max(minArea, std::min(maxArea, m_Area * std::max(0.25, 1.0 + change)));
+
+    // Гистерезис: шаг масштаба меняется, только когда регулятор ушёл от него
+    // заметно дальше половины шага, — шум не гоняет цель между соседними размерами
+    const float scale = Quantize(m_Area);
+    const float distance = std::fabs((float)std::sqrt(m_Area) - m_Scale);
+    if (scale != m_Scale && (distance >= Hysteresis * m_Settings.scaleStep || scale == m_Settings.minScale || scale == m_Settings.maxScale))
+    {
+        m_Scale = scale;
+        ++m_ScaleChanges;
+    }
+
+    const ResolutionSample sample = { frameMs, m_Scale };
+    if (m_History.size() < HistorySize)
+        m_History.push_back(sample);
+    else
+        m_History[m_HistoryNext] = sample;
+    m_HistoryNext = (m_HistoryNext + 1) % HistorySize;
+    return m_Scale;
+}
+
+void ResolutionController::ScaledSize(unsigned width, unsigned height, unsigned& scaledWidth, unsigned& scaledHeight) const
+{
+    scaledWidth = std::max(1u, (unsigned)(width * m_Scale + 0.5f));
+    scaledHeight = std::max(1u, (unsigned)(height * m_Scale + 0.5f));
+}
+
+std::vector<ResolutionSample> ResolutionController::History() const
+{
+    std::vector<ResolutionSample> history;
+    history.reserve(m_History.size());
+    const size_t start = m_History.size() < HistorySize ? 0 : m_HistoryNext;
+    for (size_t i = 0; i < m_History.size(); ++i)
+        history.push_back(m_History[(start + i) % m_History.size()]);
+    return history;
+}
+
+ResolutionStats ResolutionController::Stats() const
+{
+    ResolutionStats stats;
+    stats.scale = stats.minScale = stats.maxScale = stats.averageScale = m_Scale;
+    stats.frames = m_History.size();
+    stats.scaleChanges = m_ScaleChanges;
+    if (m_History.empty()) return stats;
+
+    double scaleSum = 0.0, frameSum = 0.0;
+    stats.minScale = stats.maxScale = m_History.front().scale;
+    for (const ResolutionSample& sample : m_History)
+    {
+        stats.minScale = std::min(stats.minScale, sample.scale);
+        stats.maxScale = std::max(stats.maxScale, sample.scale);
+        scaleSum += sample.scale;
+        frameSum += sample.frameMs;
+        if (sample.frameMs > m_Settings.targetMs) ++stats.overBudgetFrames;
+    }
+    stats.averageScale = (float)(scaleSum / m_History.size());
+    stats.averageFrameMs = frameSum / m_History.size();
+    return stats;
+}
+
+float ResolutionController::Quantize(double area) const
+{
+    const float scale = (float)std::sqrt(area);
+    const float step = m_Settings.scaleStep > 0.0f ? m_Settings.scaleStep : 1e-6f;
+    const float quantized = std::floor(scale / step + 0.5f) * step;
+    return std::max(m_Settings.minScale, std::min(m_Settings.maxScale, quantized));
+}
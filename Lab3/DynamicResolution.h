@@ -0,0 +1,76 @@
+﻿#pragma once
+
+// Динамическое разрешение: масштаб внутренней цели рендеринга подбирается
+// каждый кадр так, чтобы время кадра держалось у бюджета. Стоимость кадра
+// примерно пропорциональна числу пикселей, поэтому регулятор управляет площадью
+// (квадратом масштаба). ПИД в приращениях: на каждом кадре площадь умножается на
+// (1 + kp * Δe + ki * e + kd * Δ²e), где e = (бюджет - время) / бюджет. Такой
+// регулятор не накапливает интеграл при упоре в границы масштаба. Здесь нет D3D.
+
+#include <cstddef>
+#include <vector>
+
+struct ResolutionSettings
+{
+    double targetMs = 1000.0 / 60.0;
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float scaleStep = 1.0f / 32.0f; // масштаб квантуется, чтобы не плодить цели новых размеров
+    double kp = 0.15;
+    double ki = 0.2;                // устойчиво при ki < 2 без задержки; замеры GPU опаздывают на 2-3 кадра
+    double kd = 0.05;
+    double deadband = 0.03;         // относительная ошибка, которую не исправляем, — без дрожания у бюджета
+};
+
+struct ResolutionSample
+{
+    double frameMs;
+    float scale; // масштаб, с которым будет нарисован следующий кадр
+};
+
+struct ResolutionStats
+{
+    float scale = 1.0f;
+    float minScale = 1.0f;
+    float maxScale = 1.0f;
+    float averageScale = 1.0f;
+    double averageFrameMs = 0.0;
+    size_t frames = 0;          // кадров в истории
+    size_t overBudgetFrames = 0;
+    size_t scaleChanges = 0;    // сколько раз менялся квантованный масштаб
+};
+
+class ResolutionController
+{
+public:
+    static const size_t HistorySize = 240;
+
+    explicit ResolutionController(const ResolutionSettings& settings = ResolutionSettings());
+
+    void SetSettings(const ResolutionSettings& settings);
+    const ResolutionSettings& Settings() const { return m_Settings; }
+    void Reset(); // полный масштаб, пустая история
+
+    // Время очередного кадра (обычно наибольшее из GPU и CPU); возвращает масштаб следующего кадра
+    float Update(double frameMs);
+    float Scale() const { return m_Scale; }
+
+    // Размер внутренней цели для выхода width x height при текущем масштабе (не меньше 1x1)
+    void ScaledSize(unsigned width, unsigned height, unsigned& scaledWidth, unsigned& scaledHeight) const;
+
+    // От старых замеров к новым
+    std::vector<ResolutionSample> History() const;
+    ResolutionStats Stats() const;
+
+private:
+    float Quantize(double area) const;
+
+    ResolutionSettings m_Settings;
+    double m_Area = 1.0;      // непрерывное состояние регулятора — квадрат масштаба
+    double m_Error1 = 0.0;    // ошибки прошлого и позапрошлого кадров
+    double m_Error2 = 0.0;
+    float m_Scale = 1.0f;
+    std::vector<ResolutionSample> m_History; // кольцо
+    size_t m_HistoryNext = 0;
+    size_t m_ScaleChanges = 0;
+};
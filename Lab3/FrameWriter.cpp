@@ -0,0 +1,371 @@
+﻿#include "FrameWriter.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+    // CRC-32 для чанков PNG
+    struct CrcTable
+    {
+        uint32_t values[256];
+
+        CrcTable()
+        {
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                values[n] = c;
+            }
+        }
+    };
+
+    uint32_t Crc32(const uint8_t* data, size_t size)
+    {
+        static const CrcTable table;
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; ++i)
+            crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    // Adler-32 для zlib; остаток берётся раз в 5552 байта, а не на каждый байт
+    void Adler32Update(uint32_t& a, uint32_t& b, const uint8_t* data, size_t size)
+    {
+        while (size > 0)
+        {
+            size_t n = size < 5552 ? size : 5552;
+            size -= n;
+            for (size_t i = 0; i < n; ++i)
+            {
+                a += data[i];
+                b += a;
+            }
+            data += n;
+            a %= 65521;
+            b %= 65521;
+        }
+    }
+
+    void PutBE32(std::vector<uint8_t>& out, uint32_t v)
+    {
+        out.push_back((uint8_t)(v >> 24));
+        out.push_back((uint8_t)(v >> 16));
+        out.push_back((uint8_t)(v >> 8));
+        out.push_back((uint8_t)v);
+    }
+
+    void PutChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size)
+    {
+        PutBE32(out, (uint32_t)size);
+        size_t typeOffset = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data, data + size);
+        PutBE32(out, Crc32(out.data() + typeOffset, size + 4));
+    }
+
+    // PNG без сжатия: zlib-поток из stored-блоков. Кодирование почти бесплатное,
+    // что важнее для пакетной генерации, чем размер файлов.
+    void EncodePng(const Frame& frame, std::vector<uint8_t>& out)
+    {
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+        out.assign(signature, signature + 8);
+
+        uint8_t ihdr[13] = {};
+        for (int i = 0; i < 4; ++i)
+        {
+            ihdr[i] = (uint8_t)(frame.width >> (24 - 8 * i));
+            ihdr[4 + i] = (uint8_t)(frame.height >> (24 - 8 * i));
+        }
+        ihdr[8] = 8;  // бит на канал
+        ihdr[9] = 6;  // RGBA
+        PutChunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+        // Сырые данные: перед каждой строкой байт фильтра 0
+        const size_t rowSize = (size_t)frame.width * 4;
+        const size_t rawSize = (rowSize + 1) * frame.height;
+
+        std::vector<uint8_t> idat;
+        idat.reserve(rawSize + rawSize / 65535 * 5 + 16);
+        idat.push_back(0x78);
+        idat.push_back(0x01);
+
+        uint32_t adlerA = 1, adlerB = 0;
+        size_t blockLeft = 0;
+        size_t rawLeft = rawSize;
+        auto putRaw = [&](const uint8_t* data, size_t size)
+        {
+            while (size > 0)
+            {
+                if (blockLeft == 0)
+                {
+                    blockLeft = rawLeft < 65535 ? rawLeft : 65535;
+                    rawLeft -= blockLeft;
+                    idat.push_back(rawLeft == 0 ? 1 : 0);
+                    idat.push_back((uint8_t)blockLeft);
+                    idat.push_back((uint8_t)(blockLeft >> 8));
+                    idat.push_back((uint8_t)~blockLeft);
+                    idat.push_back((uint8_t)(~blockLeft >> 8));
+                }
+                size_t n = size < blockLeft ? size : blockLeft;
+                idat.insert(idat.end(), data, data + n);
+                Adler32Update(adlerA, adlerB, data, n);
+                data += n;
+                size -= n;
+                blockLeft -= n;
+            }
+        };
+
+        const uint8_t filterNone = 0;
+        for (uint32_t y = 0; y < frame.height; ++y)
+        {
+            putRaw(&filterNone, 1);
+            putRaw(frame.pixels.data() + y * rowSize, rowSize);
+        }
+        PutBE32(idat, (adlerB << 16) | adlerA);
+
+        PutChunk(out, "IDAT", idat.data(), idat.size());
+        PutChunk(out, "IEND", nullptr, 0);
+    }
+
+    // RGB -> YUV 4:4:4 (BT.601, ограниченный диапазон), планарно
+    void EncodeYuv444(const Frame& frame, std::vector<uint8_t>& out)
+    {
+        const size_t planeSize = (size_t)frame.width * frame.height;
+        out.resize(planeSize * 3);
+        uint8_t* pY = out.data();
+        uint8_t* pU = pY + planeSize;
+        uint8_t* pV = pU + planeSize;
+
+        const uint8_t* src = frame.pixels.data();
+        for (size_t i = 0; i < planeSize; ++i, src += 4)
+        {
+            int r = src[0], g = src[1], b = src[2];
+            pY[i] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            pU[i] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            pV[i] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+FrameWriter::~FrameWriter()
+{
+    Stop();
+}
+
+bool FrameWriter::Start(const std::string& pathPrefix, FrameFormat format, size_t maxQueued, unsigned threadCount)
+{
+    Stop();
+
+    m_PathPrefix = pathPrefix;
+    m_Format = format;
+    m_MaxQueued = maxQueued > 0 ? maxQueued : 1;
+    m_FramesWritten = 0;
+    m_BytesWritten = 0;
+    m_Y4mHeaderWritten = false;
+
+    if (m_Format == FrameFormat::Y4m)
+    {
+        m_Y4mFile.open(m_PathPrefix + ".y4m", std::ios::binary | std::ios::trunc);
+        if (!m_Y4mFile) return false;
+    }
+
+    if (m_Format == FrameFormat::Y4m || threadCount == 0) threadCount = 1;
+
+    m_StopRequested = false;
+    m_Running = true;
+    for (unsigned i = 0; i < threadCount; ++i)
+        m_Threads.emplace_back(&FrameWriter::WorkerLoop, this);
+    return true;
+}
+
+void FrameWriter::Stop()
+{
+    if (!m_Running) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_StopRequested = true;
+    }
+    m_QueueNotEmpty.notify_all();
+    for (std::thread& thread : m_Threads)
+        thread.join();
+    m_Threads.clear();
+
+    if (m_Y4mFile.is_open()) m_Y4mFile.close();
+    if (m_TimingLog.is_open()) m_TimingLog.close();
+    m_Running = false;
+}
+
+bool FrameWriter::OpenTimingLog(const std::string& path, bool append)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_TimingLog.is_open()) m_TimingLog.close();
+
+    bool writeHeader = true;
+    if (append)
+    {
+        std::ifstream existing(path);
+        writeHeader = !existing.good();
+    }
+
+    m_TimingLog.open(path, append ? std::ios::app : std::ios::trunc);
+    if (!m_TimingLog) return false;
+    if (writeHeader) m_TimingLog << "frame,render_ms,readback_ms,write_ms\n";
+    return true;
+}
+
+std::string FrameWriter::FramePath(uint32_t index) const
+{
+    if (m_Format == FrameFormat::Y4m) return m_PathPrefix + ".y4m";
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "_%06u.%s", index, m_Format == FrameFormat::Png ? "png" : "rgba");
+    return m_PathPrefix + suffix;
+}
+
+bool FrameWriter::FrameExists(uint32_t index) const
+{
+    if (m_Format == FrameFormat::Y4m) return false; // поток Y4M не докатывается
+    std::ifstream file(FramePath(index));
+    return file.good();
+}
+
+std::vector<uint8_t> FrameWriter::AcquireBuffer(size_t size)
+{
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_FreeBuffers.empty())
+        {
+            buffer = std::move(m_FreeBuffers.back());
+            m_FreeBuffers.pop_back();
+        }
+    }
+    buffer.resize(size);
+    return buffer;
+}
+
+void FrameWriter::Submit(Frame&& frame)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_QueueNotFull.wait(lock, [this] { return m_Queue.size() < m_MaxQueued; });
+    m_Queue.push_back(std::move(frame));
+    lock.unlock();
+    m_QueueNotEmpty.notify_one();
+}
+
+uint64_t FrameWriter::FramesWritten() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_FramesWritten;
+}
+
+uint64_t FrameWriter::BytesWritten() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_BytesWritten;
+}
+
+size_t FrameWriter::QueueDepth() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Queue.size();
+}
+
+uint64_t FrameWriter::BufferedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    uint64_t bytes = 0;
+    for (const Frame& frame : m_Queue) bytes += frame.pixels.capacity();
+    for (const std::vector<uint8_t>& buffer : m_FreeBuffers) bytes += buffer.capacity();
+    return bytes;
+}
+
+void FrameWriter::WorkerLoop()
+{
+    std::vector<uint8_t> scratch;
+    for (;;)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_QueueNotEmpty.wait(lock, [this] { return m_StopRequested || !m_Queue.empty(); });
+            if (m_Queue.empty()) return; // остановка, очередь дописана
+            frame = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+        m_QueueNotFull.notify_one();
+
+        WriteFrame(frame, scratch);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_FreeBuffers.push_back(std::move(frame.pixels));
+    }
+}
+
+bool FrameWriter::WriteFrame(const Frame& frame, std::vector<uint8_t>& scratch)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    switch (m_Format)
+    {
+    case FrameFormat::Raw:
+        data = frame.pixels.data();
+        size = frame.pixels.size();
+        break;
+    case FrameFormat::Png:
+        EncodePng(frame, scratch);
+        data = scratch.data();
+        size = scratch.size();
+        break;
+    case FrameFormat::Y4m:
+        EncodeYuv444(frame, scratch);
+        data = scratch.data();
+        size = scratch.size();
+        break;
+    }
+
+    bool ok = false;
+    if (m_Format == FrameFormat::Y4m)
+    {
+        if (!m_Y4mHeaderWritten)
+        {
+            m_Y4mFile << "YUV4MPEG2 W" << frame.width << " H" << frame.height << " F" << m_FrameRate << ":1 Ip A1:1 C444\n";
+            m_Y4mHeaderWritten = true;
+        }
+        m_Y4mFile << "FRAME\n";
+        m_Y4mFile.write(reinterpret_cast<const char*>(data), size);
+        ok = m_Y4mFile.good();
+    }
+    else
+    {
+        const std::string path = FramePath(frame.index);
+        const std::string partPath = path + ".part";
+        {
+            std::ofstream file(partPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(data), size);
+            ok = file.good();
+        }
+        std::remove(path.c_str());
+        ok = ok && std::rename(partPath.c_str(), path.c_str()) == 0;
+    }
+
+    double writeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (ok)
+    {
+        ++m_FramesWritten;
+        m_BytesWritten += size;
+        if (m_TimingLog.is_open())
+            m_TimingLog << frame.index << ',' << frame.renderMs << ',' << frame.readbackMs << ',' << writeMs << '\n';
+    }
+    return ok;
+}
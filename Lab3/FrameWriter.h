@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Формат, в котором кадры сохраняются на диск
+enum class FrameFormat
+{
+    Raw, // <prefix>_000000.rgba — сырые RGBA8 строки без заголовка
+    Png, // <prefix>_000000.png — PNG без сжатия (stored deflate)
+    Y4m, // <prefix>.y4m — один поток YUV 4:4:4
+};
+
+// Кадр в памяти: RGBA8, строки уложены плотно (width * 4 байт)
+struct Frame
+{
+    uint32_t index = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+
+    // Время рендера и ожидания чтения с GPU, попадает в журнал таймингов
+    double renderMs = 0.0;
+    double readbackMs = 0.0;
+};
+
+// Фоновая запись кадров на диск. Рендер только кладёт кадр в очередь,
+// кодирование и запись идут в отдельных потоках. Submit блокируется лишь
+// если очередь переполнена, чтобы не съесть всю память.
+// Покадровые файлы пишутся через временный файл и переименование, поэтому
+// существующий файл кадра всегда полный — на этом держится докат пакета.
+class FrameWriter
+{
+public:
+    FrameWriter() = default;
+    ~FrameWriter();
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    // threadCount > 1 кодирует кадры параллельно (для Y4M всегда один поток — поток упорядочен)
+    bool Start(const std::string& pathPrefix, FrameFormat format, size_t maxQueued = 8, unsigned threadCount = 1);
+    void Stop();
+    bool IsRunning() const { return m_Running; }
+
+    // Буфер из пула уже записанных кадров, чтобы не выделять память каждый кадр
+    std::vector<uint8_t> AcquireBuffer(size_t size);
+    void Submit(Frame&& frame);
+
+    // Частота кадров, записываемая в заголовок Y4M
+    void SetFrameRate(unsigned fps) { m_FrameRate = fps > 0 ? fps : 30; }
+
+    // CSV с покадровыми временами: frame,render_ms,readback_ms,write_ms
+    bool OpenTimingLog(const std::string& path, bool append);
+
+    std::string FramePath(uint32_t index) const;
+    bool FrameExists(uint32_t index) const;
+
+    uint64_t FramesWritten() const;
+    uint64_t BytesWritten() const;
+    size_t QueueDepth() const;
+    uint64_t BufferedBytes() const; // пиксели кадров в очереди и буферы в пуле
+
+private:
+    void WorkerLoop();
+    bool WriteFrame(const Frame& frame, std::vector<uint8_t>& scratch);
+
+    std::string m_PathPrefix;
+    FrameFormat m_Format = FrameFormat::Png;
+    size_t m_MaxQueued = 8;
+    unsigned m_FrameRate = 30;
+
+    std::vector<std::thread> m_Threads;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_QueueNotEmpty;
+    std::condition_variable m_QueueNotFull;
+    std::deque<Frame> m_Queue;
+    std::vector<std::vector<uint8_t>> m_FreeBuffers;
+    bool m_Running = false;
+    bool m_StopRequested = false;
+
+    uint64_t m_FramesWritten = 0;
+    uint64_t m_BytesWritten = 0;
+    std::ofstream m_Y4mFile;
+    bool m_Y4mHeaderWritten = false;
+    std::ofstream m_TimingLog;
+};
@@ -0,0 +1,100 @@
+﻿#include "GpuTimer.h"
+
+HRESULT GpuTimer::Init(ID3D11Device* pDevice, UINT maxFramesInFlight)
+{
+    Reset();
+
+    D3D11_QUERY_DESC disjoint = {};
+    disjoint.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+    D3D11_QUERY_DESC timestamp = {};
+    timestamp.Query = D3D11_QUERY_TIMESTAMP;
+
+    m_Sets.resize(maxFramesInFlight);
+    for (QuerySet& set : m_Sets)
+    {
+        HRESULT hr = pDevice->CreateQuery(&disjoint, set.pDisjoint.GetAddressOf());
+        if (SUCCEEDED(hr)) hr = pDevice->CreateQuery(&timestamp, set.pBegin.GetAddressOf());
+        if (SUCCEEDED(hr)) hr = pDevice->CreateQuery(&timestamp, set.pEnd.GetAddressOf());
+        if (FAILED(hr))
+        {
+            Reset();
+            return hr;
+        }
+    }
+    return S_OK;
+}
+
+void GpuTimer::Reset()
+{
+    m_Sets.clear();
+    m_Pending.clear();
+    m_NextSet = 0;
+    m_Open = false;
+    ResetAverage();
+}
+
+void GpuTimer::ResetAverage()
+{
+    m_TotalMs = 0.0;
+    m_Samples = 0;
+}
+
+void GpuTimer::Begin(ID3D11DeviceContext* pContext)
+{
+    if (m_Sets.empty() || m_Open || m_Pending.size() >= m_Sets.size()) return;
+
+    const QuerySet& set = m_Sets[m_NextSet];
+    pContext->Begin(set.pDisjoint.Get());
+    pContext->End(set.pBegin.Get());
+    m_Open = true;
+}
+
+void GpuTimer::End(ID3D11DeviceContext* pContext)
+{
+    if (!m_Open) return;
+
+    const QuerySet& set = m_Sets[m_NextSet];
+    pContext->End(set.pEnd.Get());
+    pContext->End(set.pDisjoint.Get());
+    m_Pending.push_back(m_NextSet);
+    m_NextSet = (m_NextSet + 1) % (UINT)m_Sets.size();
+    m_Open = false;
+}
+
+UINT GpuTimer::Poll(ID3D11DeviceContext* pContext, bool wait)
+{
+    UINT collected = 0;
+    while (!m_Pending.empty() && Collect(pContext, m_Sets[m_Pending.front()], wait))
+    {
+        m_Pending.pop_front();
+        ++collected;
+    }
+    return collected;
+}
+
+bool GpuTimer::Collect(ID3D11DeviceContext* pContext, const QuerySet& set, bool wait)
+{
+    auto get = [pContext, wait](ID3D11Query* pQuery, void* pData, UINT size)
+    {
+        HRESULT hr;
+        while ((hr = pContext->GetData(pQuery, pData, size, wait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH)) == S_FALSE && wait) {}
+        return hr == S_OK;
+    };
+
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+    UINT64 begin = 0, end = 0;
+    if (!get(set.pDisjoint.Get(), &disjoint, sizeof(disjoint)) ||
+        !get(set.pBegin.Get(), &begin, sizeof(begin)) ||
+        !get(set.pEnd.Get(), &end, sizeof(end)))
+    {
+        return false;
+    }
+
+    if (!disjoint.Disjoint && disjoint.Frequency > 0 && end >= begin)
+    {
+        m_LastMs = (end - begin) * 1000.0 / disjoint.Frequency;
+        m_TotalMs += m_LastMs;
+        ++m_Samples;
+    }
+    return true;
+}
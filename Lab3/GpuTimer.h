@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <deque>
+#include <vector>
+
+// Время кадра на GPU по запросам меток времени. Begin/End обрамляют работу
+// кадра, результат забирается позже через Poll, когда GPU его дописал —
+// рендер не ждёт запросов. Если все наборы запросов в полёте, кадр не меряется.
+class GpuTimer
+{
+public:
+    HRESULT Init(ID3D11Device* pDevice, UINT maxFramesInFlight);
+    void Reset();
+
+    void Begin(ID3D11DeviceContext* pContext);
+    void End(ID3D11DeviceContext* pContext);
+
+    // Забирает готовые замеры и возвращает их число; wait = true — дождаться всех, что в полёте
+    UINT Poll(ID3D11DeviceContext* pContext, bool wait);
+    double LastMs() const { return m_LastMs; } // самый свежий готовый замер
+
+    // Среднее по замерам с последнего ResetAverage (кадры с разрывом частоты отбрасываются)
+    double AverageMs() const { return m_Samples ? m_TotalMs / m_Samples : 0.0; }
+    size_t Samples() const { return m_Samples; }
+    void ResetAverage();
+
+private:
+    struct QuerySet
+    {
+        Microsoft::WRL::ComPtr<ID3D11Query> pDisjoint;
+        Microsoft::WRL::ComPtr<ID3D11Query> pBegin;
+        Microsoft::WRL::ComPtr<ID3D11Query> pEnd;
+    };
+
+    bool Collect(ID3D11DeviceContext* pContext, const QuerySet& set, bool wait);
+
+    std::vector<QuerySet> m_Sets;
+    std::deque<UINT> m_Pending; // наборы в полёте, от старого к новому
+    UINT m_NextSet = 0;
+    bool m_Open = false;        // Begin был, End ещё нет
+    double m_LastMs = 0.0;
+    double m_TotalMs = 0.0;
+    size_t m_Samples = 0;
+};
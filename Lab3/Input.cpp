@@ -0,0 +1,210 @@
+﻿#include "Input.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+}
+
+void InputBuffer::Push(const InputEvent& event)
+{
+    if (m_Events.size() >= Capacity)
+    {
+        ++m_Dropped;
+        return;
+    }
+    m_Events.push_back(event);
+}
+
+const InputFrame& InputBuffer::Sample(int64_t now)
+{
+    const int64_t begin = m_LastSample != 0 ? std::min(m_LastSample, now) : now;
+
+    m_Frame = InputFrame();
+    m_Frame.begin = begin;
+    m_Frame.end = now;
+    m_Frame.events = m_Events.size();
+
+    // Сообщения приходят почти по порядку, но мышь и клавиатура — разными путями
+    std::stable_sort(m_Events.begin(), m_Events.end(), [](const InputEvent& a, const InputEvent& b) { return a.time < b.time; });
+    if (!m_Events.empty())
+        m_Frame.firstEventTime = m_Events.front().time;
+
+    // Нажатые с прошлого кадра держатся с начала интервала
+    int64_t since[InputFrame::KeyCount];
+    int64_t held[InputFrame::KeyCount] = {};
+    for (size_t key = 0; key < InputFrame::KeyCount; ++key)
+        since[key] = begin;
+
+    for (const InputEvent& event : m_Events)
+    {
+        const int64_t time = std::min(std::max(event.time, begin), now);
+        switch (event.type)
+        {
+        case InputEventType::KeyDown:
+            if (!m_Down[event.key])
+            {
+                m_Down[event.key] = true;
+                since[event.key] = time;
+            }
+            break;
+        case InputEventType::KeyUp:
+            if (m_Down[event.key])
+            {
+                m_Down[event.key] = false;
+                held[event.key] += time - since[event.key];
+            }
+            break;
+        case InputEventType::MouseMove:
+            m_Frame.mouseDx += event.dx;
+            m_Frame.mouseDy += event.dy;
+            break;
+        case InputEventType::ReleaseAll:
+            for (size_t key = 0; key < InputFrame::KeyCount; ++key)
+            {
+                if (!m_Down[key]) continue;
+                m_Down[key] = false;
+                held[key] += time - since[key];
+            }
+            break;
+        }
+    }
+
+    for (size_t key = 0; key < InputFrame::KeyCount; ++key)
+    {
+        if (m_Down[key])
+            held[key] += now - since[key];
+        m_Frame.heldSeconds[key] = held[key] * 1e-6f;
+        m_Frame.down[key] = m_Down[key];
+    }
+
+    m_Events.clear();
+    m_LastSample = now;
+    return m_Frame;
+}
+
+bool CameraController::Update(const InputFrame& frame)
+{
+    float pitch = m_Pitch + m_Settings.turnSpeed * (frame.heldSeconds[InputKey::Up] - frame.heldSeconds[InputKey::Down]);
+    float yaw = m_Yaw + m_Settings.turnSpeed * (frame.heldSeconds[InputKey::Right] - frame.heldSeconds[InputKey::Left]);
+
+    // Мышь крутит камеру, только пока зажата правая кнопка: левая — выбор объекта
+    if (frame.down[InputKey::RightButton] || frame.heldSeconds[InputKey::RightButton] > 0.0f)
+    {
+        yaw += m_Settings.mouseSensitivity * frame.mouseDx;
+        pitch += m_Settings.mouseSensitivity * frame.mouseDy;
+    }
+    pitch = std::min(std::max(pitch, -m_Settings.maxPitch), m_Settings.maxPitch);
+
+    const bool changed = pitch != m_Pitch || yaw != m_Yaw;
+    m_Pitch = pitch;
+    m_Yaw = yaw;
+    return changed;
+}
+
+void LatencyTracker::Submit(uint64_t frameId, int64_t inputTime)
+{
+    if (m_Pending.size() >= MaxPending)
+        m_Pending.erase(m_Pending.begin());
+    m_Pending.push_back(Pending{ frameId, inputTime });
+}
+
+void LatencyTracker::Complete(uint64_t frameId, int64_t displayTime)
+{
+    size_t done = 0;
+    while (done < m_Pending.size() && m_Pending[done].frameId <= frameId)
+    {
+        const Pending& pending = m_Pending[done++];
+        if (pending.frameId != frameId || displayTime < pending.inputTime) continue;
+
+        const double ms = (displayTime - pending.inputTime) * 1e-3;
+        m_Stats.minMs = m_Stats.frames == 0 ? ms : std::min(m_Stats.minMs, ms);
+        m_Stats.maxMs = std::max(m_Stats.maxMs, ms);
+        m_Stats.lastMs = ms;
+        m_TotalMs += ms;
+        ++m_Stats.frames;
+        m_Stats.averageMs = m_TotalMs / m_Stats.frames;
+    }
+    m_Pending.erase(m_Pending.begin(), m_Pending.begin() + done);
+}
+
+InputBenchmark BenchmarkInput()
+{
+    const int64_t start = 1000000; // 0 у InputBuffer значит «ещё не было кадра»
+    const int64_t holdUs = 1000000;
+    const int64_t repeatDelayUs = 250000;
+    const double framesPerSecond[] = { 30.0, 60.0, 144.0, 240.0 };
+    const double repeatsPerSecond[] = { 10.0, 20.0, 33.0 };
+
+    InputBenchmark result;
+    double legacyMin = INFINITY, legacyMax = 0.0;
+    for (double fps : framesPerSecond)
+    {
+        for (double repeatRate : repeatsPerSecond)
+        {
+            const int64_t frameUs = (int64_t)(1e6 / fps);
+            const int64_t press = start + frameUs * 3 + frameUs * 37 / 100; // посреди кадра
+            const int64_t release = press + holdUs;
+
+            // Нажатие, автоповтор после задержки и отпускание — как их шлёт клавиатура
+            std::vector<InputEvent> events;
+            InputEvent event;
+            event.key = InputKey::Right;
+            event.type = InputEventType::KeyDown;
+            size_t messages = 0;
+            for (int64_t time = press; time < release; time += time == press ? repeatDelayUs : (int64_t)(1e6 / repeatRate))
+            {
+                event.time = time;
+                events.push_back(event);
+                ++messages;
+            }
+            event.type = InputEventType::KeyUp;
+            event.time = release;
+            events.push_back(event);
+
+            InputBuffer buffer;
+            CameraController camera;
+            size_t next = 0;
+            for (int64_t now = start; now <= release + 2 * frameUs; now += frameUs)
+            {
+                while (next < events.size() && events[next].time <= now)
+                    buffer.Push(events[next++]);
+                camera.Update(buffer.Sample(now));
+            }
+
+            const double expected = camera.Settings().turnSpeed * holdUs * 1e-6;
+            result.maxAngleError = std::max(result.maxAngleError, std::fabs(camera.Yaw() - expected));
+            legacyMin = std::min(legacyMin, 0.01 * messages);
+            legacyMax = std::max(legacyMax, 0.01 * messages);
+            ++result.combinations;
+        }
+    }
+    result.legacyAngleSpread = legacyMax - legacyMin;
+
+    // Цена Sample на кадр с большим числом событий мыши
+    const size_t Repeats = 100;
+    InputBuffer buffer;
+    buffer.Sample(start);
+    double totalUs = 0.0;
+    for (size_t repeat = 0; repeat < Repeats; ++repeat)
+    {
+        const int64_t frameStart = start + (int64_t)(repeat + 1) * 16667;
+        for (int32_t i = 0; i < 1000; ++i)
+        {
+            InputEvent move;
+            move.type = InputEventType::MouseMove;
+            move.time = frameStart - 16667 + i * 16;
+            move.dx = 1;
+            move.dy = i % 3 - 1;
+            buffer.Push(move);
+        }
+        const Clock::time_point begin = Clock::now();
+        buffer.Sample(frameStart);
+        totalUs += std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+    }
+    result.sampleUs = totalUs / Repeats;
+    return result;
+}
@@ -0,0 +1,156 @@
+﻿#pragma once
+
+// Ввод: события клавиш и мыши с отметкой времени копятся в буфере (WndProc,
+// сырой ввод WM_INPUT), а кадр забирает их как можно позже — прямо перед
+// построением матрицы вида — и двигает камеру по времени, а не по числу
+// сообщений: клавиша, нажатая посреди кадра, поворачивает камеру на свою долю
+// кадра, и скорость не зависит ни от автоповтора клавиатуры, ни от частоты
+// кадров. Здесь же учёт задержки от ввода до вывода кадра на экран.
+// Время — микросекунды общего монотонного счётчика (в main.cpp — QPC);
+// коды клавиш — виртуальные коды Windows, но самого Windows здесь нет.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class InputEventType : uint8_t
+{
+    KeyDown,    // повтор нажатой клавиши ничего не меняет
+    KeyUp,
+    MouseMove,  // относительное смещение, в отсчётах мыши
+    ReleaseAll, // окно потеряло фокус — отпускания уже не придут
+};
+
+struct InputEvent
+{
+    int64_t time = 0; // мкс
+    InputEventType type = InputEventType::KeyDown;
+    uint8_t key = 0;  // виртуальный код клавиши или кнопки мыши
+    int32_t dx = 0;
+    int32_t dy = 0;
+};
+
+// Ввод за один кадр: интервал [begin, end), сколько в нём была нажата каждая клавиша и сдвиг мыши
+struct InputFrame
+{
+    static const size_t KeyCount = 256;
+
+    int64_t begin = 0;
+    int64_t end = 0;
+    float heldSeconds[KeyCount] = {};
+    bool down[KeyCount] = {}; // на конец интервала
+    int32_t mouseDx = 0;
+    int32_t mouseDy = 0;
+    size_t events = 0;
+    int64_t firstEventTime = 0; // самое раннее событие кадра — от него считается задержка; 0 — событий не было
+
+    float Seconds() const { return (end - begin) * 1e-6f; }
+};
+
+class InputBuffer
+{
+public:
+    static const size_t Capacity = 4096; // события сверх этого до следующего Sample отбрасываются
+
+    void Push(const InputEvent& event);
+
+    // Применяет накопленные события и закрывает интервал от прошлого Sample до now.
+    // События старше начала интервала (пришли с опозданием) считаются пришедшими в его начале
+    const InputFrame& Sample(int64_t now);
+
+    const InputFrame& Frame() const { return m_Frame; }
+    size_t Pending() const { return m_Events.size(); }
+    size_t Dropped() const { return m_Dropped; }
+
+private:
+    std::vector<InputEvent> m_Events;
+    bool m_Down[InputFrame::KeyCount] = {};
+    int64_t m_LastSample = 0;
+    size_t m_Dropped = 0;
+    InputFrame m_Frame;
+};
+
+// Виртуальные коды, которые слушает камера
+namespace InputKey
+{
+    const uint8_t RightButton = 0x02;
+    const uint8_t Left = 0x25;
+    const uint8_t Up = 0x26;
+    const uint8_t Right = 0x27;
+    const uint8_t Down = 0x28;
+}
+
+struct CameraControlSettings
+{
+    float turnSpeed = 1.0f;          // рад/с, стрелки
+    float mouseSensitivity = 0.003f; // рад на отсчёт мыши, пока зажата правая кнопка
+    float maxPitch = 1.5f;           // |наклон| не больше, чтобы не перевернуться через полюс
+};
+
+// Орбитальная камера: стрелки вверх/вниз — наклон, влево/вправо — поворот,
+// мышь с правой кнопкой — и то и другое
+class CameraController
+{
+public:
+    void SetSettings(const CameraControlSettings& settings) { m_Settings = settings; }
+    const CameraControlSettings& Settings() const { return m_Settings; }
+
+    // true — камера сдвинулась
+    bool Update(const InputFrame& frame);
+
+    float Pitch() const { return m_Pitch; }
+    float Yaw() const { return m_Yaw; }
+
+private:
+    CameraControlSettings m_Settings;
+    float m_Pitch = 0.0f;
+    float m_Yaw = 0.0f;
+};
+
+struct LatencyStats
+{
+    size_t frames = 0; // кадров с вводом, дошедших до экрана
+    double minMs = 0.0;
+    double averageMs = 0.0;
+    double maxMs = 0.0;
+    double lastMs = 0.0;
+};
+
+// Задержка от ввода до экрана. Кадр с вводом отмечается при Present (Submit),
+// а когда известно, что он показан (статистика кадров DXGI) или хотя бы
+// дорисован GPU, — Complete. Кадры, показанные без отметки о времени (их
+// перекрыл следующий), в статистику не попадают
+class LatencyTracker
+{
+public:
+    static const size_t MaxPending = 16;
+
+    void Submit(uint64_t frameId, int64_t inputTime);
+    void Complete(uint64_t frameId, int64_t displayTime);
+
+    const LatencyStats& Stats() const { return m_Stats; }
+    void ResetStats() { m_Stats = LatencyStats(); m_TotalMs = 0.0; }
+
+private:
+    struct Pending
+    {
+        uint64_t frameId;
+        int64_t inputTime;
+    };
+
+    std::vector<Pending> m_Pending; // по возрастанию frameId
+    LatencyStats m_Stats;
+    double m_TotalMs = 0.0;
+};
+
+struct InputBenchmark
+{
+    double maxAngleError = 0.0;  // рад: поворот за удержание клавиши против скорость * время, по всем сочетаниям
+    double legacyAngleSpread = 0.0; // рад: разброс того же поворота по 0.01 рад на сообщение, как раньше
+    size_t combinations = 0;     // частоты кадров x частоты автоповтора
+    double sampleUs = 0.0;       // Sample с 1000 событий мыши
+};
+
+// Клавиша удерживается секунду при 30-240 кадрах в секунду и автоповторе 10-33 Гц,
+// нажата и отпущена посреди кадра; поворот камеры должен совпасть при любом сочетании
+InputBenchmark BenchmarkInput();
@@ -0,0 +1,476 @@
+﻿#include "JobSystem.h"
+
+#include <chrono>
+#include <cmath>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Столько раз поток без работы уступает процессор, прежде чем уснуть
+    const unsigned SpinRounds = 64;
+
+    // Пул и очередь текущего потока; у потоков вне пула — nullptr
+    thread_local const JobSystem* t_pSystem = nullptr;
+    thread_local size_t t_Queue = 0;
+    thread_local uint32_t t_Random = 0;
+
+    double Milliseconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // С какой очереди начинать кражу: по кругу с одного места все воры толпились бы у одной жертвы
+    uint32_t NextRandom()
+    {
+        if (t_Random == 0) t_Random = (uint32_t)std::hash<std::thread::id>()(std::this_thread::get_id()) | 1u;
+        t_Random ^= t_Random << 13;
+        t_Random ^= t_Random >> 17;
+        t_Random ^= t_Random << 5;
+        return t_Random;
+    }
+
+    void PinThread(std::thread& thread, unsigned core)
+    {
+        if (core >= std::thread::hardware_concurrency()) return;
+#if defined(_WIN32)
+        if (core < sizeof(DWORD_PTR) * 8)
+            SetThreadAffinityMask((HANDLE)thread.native_handle(), (DWORD_PTR)1 << core);
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+        (void)thread;
+        (void)core;
+#endif
+    }
+
+    void CallFunction(void* context, size_t, size_t)
+    {
+        std::unique_ptr<std::function<void()>> function(static_cast<std::function<void()>*>(context));
+        (*function)();
+    }
+
+    std::mutex g_JobsMutex;
+    JobSystemSettings g_JobsSettings;
+    std::atomic<JobSystem*> g_pJobs{ nullptr };
+}
+
+JobSystem::JobSystem(const JobSystemSettings& settings)
+{
+    unsigned threads = settings.threads;
+    if (threads == 0) threads = std::max(2u, std::thread::hardware_concurrency());
+
+    for (unsigned queue = 0; queue < threads; ++queue)
+        m_Queues.emplace_back(new Queue());
+    for (unsigned queue = 1; queue < threads; ++queue)
+    {
+        m_Threads.emplace_back(&JobSystem::WorkerLoop, this, (size_t)queue);
+        if (settings.pinThreads) PinThread(m_Threads.back(), queue);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    m_Stopping.store(true);
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Wake.notify_all();
+    }
+    for (std::thread& thread : m_Threads)
+        thread.join();
+
+    // Рабочие потоки ушли, не дожидаясь пустых очередей, — остаток здесь,
+    // чтобы счётчики обнулились и их ждущие не повисли
+    Job job;
+    while (Acquire(0, true, job))
+        Execute(0, job);
+}
+
+size_t JobSystem::CurrentQueue() const
+{
+    return t_pSystem == this ? t_Queue : 0;
+}
+
+void JobSystem::Submit(const Job& job, JobCounter* pAfter)
+{
+    if (job.pCounter) job.pCounter->m_Pending.fetch_add(1, std::memory_order_acq_rel);
+    if (pAfter)
+    {
+        std::lock_guard<std::mutex> lock(pAfter->m_Mutex);
+        if (pAfter->Pending() > 0)
+        {
+            pAfter->m_Waiting.push_back(job);
+            return;
+        }
+    }
+    Push(job);
+}
+
+void JobSystem::Run(std::function<void()> function, JobCounter* pCounter, JobCounter* pAfter, JobPriority priority)
+{
+    Job job;
+    job.function = &CallFunction;
+    job.context = new std::function<void()>(std::move(function));
+    job.pCounter = pCounter;
+    job.priority = priority;
+    Submit(job, pAfter);
+}
+
+void JobSystem::Spawn(const Job& job)
+{
+    m_Queues[CurrentQueue()]->splits.fetch_add(1, std::memory_order_relaxed);
+    job.pCounter->m_Pending.fetch_add(1, std::memory_order_acq_rel);
+    Push(job);
+}
+
+void JobSystem::Push(const Job& job)
+{
+    Queue& own = *m_Queues[CurrentQueue()];
+    if (job.priority == JobPriority::Background)
+    {
+        Lock(own, m_BackgroundMutex);
+        m_Background.push_back(job);
+        m_BackgroundSize.fetch_add(1, std::memory_order_relaxed);
+        m_BackgroundMutex.unlock();
+    }
+    else
+    {
+        Lock(own, own.mutex);
+        own.jobs.push_back(job);
+        own.size.fetch_add(1, std::memory_order_relaxed);
+        own.mutex.unlock();
+    }
+
+    // Счётчик — до проверки спящих, а спящий проверяет его после своей отметки:
+    // хотя бы один из двоих увидит другого, и будить никого не придётся напрасно
+    m_Queued.fetch_add(1);
+    if (m_Sleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_SleepMutex);
+        m_Wake.notify_one();
+    }
+}
+
+void JobSystem::Lock(Queue& queue, std::mutex& mutex)
+{
+    queue.locks.fetch_add(1, std::memory_order_relaxed);
+    if (mutex.try_lock()) return;
+    queue.contended.fetch_add(1, std::memory_order_relaxed);
+    mutex.lock();
+}
+
+bool JobSystem::Acquire(size_t queue, bool background, Job& job)
+{
+    // Своя очередь — с хвоста
+    Queue& own = *m_Queues[queue];
+    if (own.size.load(std::memory_order_relaxed) > 0)
+    {
+        Lock(own, own.mutex);
+        const bool found = !own.jobs.empty();
+        if (found)
+        {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            own.size.fetch_sub(1, std::memory_order_relaxed);
+        }
+        own.mutex.unlock();
+        if (found)
+        {
+            m_Queued.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // Чужие — с головы
+    const size_t queueCount = m_Queues.size();
+    if (queueCount > 1)
+    {
+        const size_t start = NextRandom() % queueCount;
+        for (size_t n = 0; n < queueCount; ++n)
+        {
+            const size_t victim = (start + n) % queueCount;
+            Queue& other = *m_Queues[victim];
+            if (victim == queue || other.size.load(std::memory_order_relaxed) == 0) continue;
+
+            Lock(own, other.mutex);
+            const bool found = !other.jobs.empty();
+            if (found)
+            {
+                job = other.jobs.front();
+                other.jobs.pop_front();
+                other.size.fetch_sub(1, std::memory_order_relaxed);
+            }
+            other.mutex.unlock();
+            if (found)
+            {
+                own.stolen.fetch_add(1, std::memory_order_relaxed);
+                m_Queued.fetch_sub(1);
+                return true;
+            }
+        }
+        own.failedSteals.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (!background || m_BackgroundSize.load(std::memory_order_relaxed) == 0) return false;
+    Lock(own, m_BackgroundMutex);
+    const bool found = !m_Background.empty();
+    if (found)
+    {
+        job = m_Background.front();
+        m_Background.pop_front();
+        m_BackgroundSize.fetch_sub(1, std::memory_order_relaxed);
+    }
+    m_BackgroundMutex.unlock();
+    if (found) m_Queued.fetch_sub(1);
+    return found;
+}
+
+void JobSystem::Execute(size_t queue, const Job& job)
+{
+    job.function(job.context, job.begin, job.end);
+    m_Queues[queue]->executed.fetch_add(1, std::memory_order_relaxed);
+    if (job.pCounter) Finish(*job.pCounter);
+}
+
+void JobSystem::Finish(JobCounter& counter)
+{
+    // Под мьютексом счётчика: Wait, увидев ноль, берёт тот же мьютекс и
+    // возвращается, только когда эта задача его отпустила
+    std::vector<Job> released;
+    {
+        std::lock_guard<std::mutex> lock(counter.m_Mutex);
+        if (counter.m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            released.swap(counter.m_Waiting);
+            counter.m_Zero.notify_all();
+        }
+    }
+    for (const Job& job : released)
+        Push(job);
+}
+
+void JobSystem::Wait(JobCounter& counter, bool helpBackground)
+{
+    const size_t queue = CurrentQueue();
+    const bool background = helpBackground || t_pSystem == this || m_Threads.empty();
+    unsigned idle = 0;
+    while (counter.Pending() > 0)
+    {
+        Job job;
+        if (Acquire(queue, background, job))
+        {
+            Execute(queue, job);
+            idle = 0;
+            continue;
+        }
+        if (++idle < SpinRounds)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Помогать нечем: спим до нуля, заглядывая за новыми задачами
+        std::unique_lock<std::mutex> lock(counter.m_Mutex);
+        counter.m_Zero.wait_for(lock, std::chrono::milliseconds(1), [&counter]() { return counter.Pending() == 0; });
+        idle = SpinRounds - 1;
+    }
+    std::lock_guard<std::mutex> lock(counter.m_Mutex);
+}
+
+void JobSystem::WorkerLoop(size_t queue)
+{
+    t_pSystem = this;
+    t_Queue = queue;
+
+    Queue& own = *m_Queues[queue];
+    unsigned idle = 0;
+    while (true)
+    {
+        Job job;
+        if (Acquire(queue, true, job))
+        {
+            Execute(queue, job);
+            idle = 0;
+            continue;
+        }
+        if (m_Stopping.load()) return;
+        if (++idle < SpinRounds)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_SleepMutex);
+        m_Sleeping.fetch_add(1);
+        if (m_Queued.load() == 0 && !m_Stopping.load())
+        {
+            own.sleeps.fetch_add(1, std::memory_order_relaxed);
+            m_Wake.wait(lock, [this]() { return m_Queued.load() > 0 || m_Stopping.load(); });
+        }
+        m_Sleeping.fetch_sub(1);
+        idle = 0;
+    }
+}
+
+JobStats JobSystem::Stats() const
+{
+    JobStats stats;
+    stats.threads = ThreadCount();
+    for (const std::unique_ptr<Queue>& queue : m_Queues)
+    {
+        const uint64_t executed = queue->executed.load(std::memory_order_relaxed);
+        stats.jobs += executed;
+        stats.stolen += queue->stolen.load(std::memory_order_relaxed);
+        stats.failedSteals += queue->failedSteals.load(std::memory_order_relaxed);
+        stats.splits += queue->splits.load(std::memory_order_relaxed);
+        stats.locks += queue->locks.load(std::memory_order_relaxed);
+        stats.contended += queue->contended.load(std::memory_order_relaxed);
+        stats.sleeps += queue->sleeps.load(std::memory_order_relaxed);
+        stats.threadJobs.push_back(executed);
+    }
+    return stats;
+}
+
+void JobSystem::ResetStats()
+{
+    for (const std::unique_ptr<Queue>& queue : m_Queues)
+    {
+        queue->executed.store(0, std::memory_order_relaxed);
+        queue->stolen.store(0, std::memory_order_relaxed);
+        queue->failedSteals.store(0, std::memory_order_relaxed);
+        queue->splits.store(0, std::memory_order_relaxed);
+        queue->locks.store(0, std::memory_order_relaxed);
+        queue->contended.store(0, std::memory_order_relaxed);
+        queue->sleeps.store(0, std::memory_order_relaxed);
+    }
+}
+
+JobSystem& Jobs()
+{
+    JobSystem* pJobs = g_pJobs.load(std::memory_order_acquire);
+    if (pJobs) return *pJobs;
+
+    std::lock_guard<std::mutex> lock(g_JobsMutex);
+    pJobs = g_pJobs.load(std::memory_order_relaxed);
+    if (!pJobs)
+    {
+        pJobs = new JobSystem(g_JobsSettings);
+        g_pJobs.store(pJobs, std::memory_order_release);
+    }
+    return *pJobs;
+}
+
+bool ConfigureJobs(const JobSystemSettings& settings)
+{
+    std::lock_guard<std::mutex> lock(g_JobsMutex);
+    if (g_pJobs.load(std::memory_order_relaxed)) return false;
+    g_JobsSettings = settings;
+    return true;
+}
+
+JobBenchmark BenchmarkJobs(unsigned maxThreads)
+{
+    const size_t Repeats = 3;
+    const size_t Elements = 1 << 20;
+    const size_t Layers = 16;
+    const size_t LayerJobs = 64;
+
+    // Цена элемента растёт к концу диапазона: ровное деление на потоки здесь
+    // оставило бы первые без работы, пока последние досчитывают
+    auto element = [](size_t i)
+    {
+        const unsigned steps = 1 + (unsigned)(i * 32 / Elements);
+        double value = (double)(i & 1023);
+        for (unsigned step = 0; step < steps; ++step)
+            value = std::sqrt(value + step);
+        return (uint64_t)value;
+    };
+    uint64_t expected = 0;
+    for (size_t i = 0; i < Elements; ++i)
+        expected += element(i);
+
+    JobBenchmark result;
+    result.elements = Elements;
+    result.graphJobs = Layers * LayerJobs;
+    maxThreads = std::max(1u, maxThreads);
+    for (unsigned threads = 1; ; threads = std::min(threads * 2, maxThreads))
+    {
+        JobSystemSettings settings;
+        settings.threads = threads;
+        JobSystem jobs(settings);
+
+        JobScalingPoint point;
+        point.threads = threads;
+        point.forMs = point.graphMs = INFINITY;
+        for (size_t repeat = 0; repeat < Repeats; ++repeat)
+        {
+            jobs.ResetStats();
+            std::atomic<uint64_t> sum(0);
+            Clock::time_point start = Clock::now();
+            jobs.ParallelFor(Elements, 256, [&](size_t begin, size_t end)
+            {
+                uint64_t partial = 0;
+                for (size_t i = begin; i < end; ++i)
+                    partial += element(i);
+                sum.fetch_add(partial, std::memory_order_relaxed);
+            });
+            const double forMs = Milliseconds(start);
+            if (sum.load() != expected) ++result.mismatches;
+            if (forMs < point.forMs)
+            {
+                const JobStats stats = jobs.Stats();
+                point.forMs = forMs;
+                point.stealRate = stats.StealRate();
+                point.contentionRate = stats.ContentionRate();
+                point.splits = stats.splits;
+            }
+
+            // Слой за слоем по зависимостям: задача видит слой перед собой законченным
+            std::vector<std::atomic<size_t>> finished(Layers);
+            std::vector<JobCounter> counters(Layers);
+            std::atomic<size_t> early(0);
+            for (std::atomic<size_t>& count : finished)
+                count.store(0);
+            start = Clock::now();
+            for (size_t layer = 0; layer < Layers; ++layer)
+            {
+                for (size_t n = 0; n < LayerJobs; ++n)
+                {
+                    jobs.Run([&, layer]()
+                    {
+                        if (layer > 0 && finished[layer - 1].load() != LayerJobs) ++early;
+                        double value = (double)layer;
+                        for (int step = 0; step < 2000; ++step)
+                            value = std::sqrt(value + step);
+                        if (value < 0.0) ++early; // не даёт выбросить расчёт
+                        ++finished[layer];
+                    }, &counters[layer], layer > 0 ? &counters[layer - 1] : nullptr);
+                }
+            }
+            jobs.Wait(counters[Layers - 1]);
+            for (JobCounter& counter : counters)
+                jobs.Wait(counter);
+            point.graphMs = std::min(point.graphMs, Milliseconds(start));
+            result.mismatches += early.load();
+        }
+        result.points.push_back(point);
+        if (threads == maxThreads) break;
+    }
+
+    for (JobScalingPoint& point : result.points)
+        point.speedup = point.forMs > 0.0 ? result.points[0].forMs / point.forMs : 0.0;
+    return result;
+}
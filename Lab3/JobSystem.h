@@ -0,0 +1,254 @@
+﻿#pragma once
+
+// Планировщик задач — общий пул потоков для всего параллельного на CPU:
+// отсечение видов, кластеры источников, BVH, позы и скиннинг, сжатие текстур,
+// разбор мешей и шаги запуска. У каждого потока своя очередь: свои задачи он
+// берёт с хвоста (последняя порождённая — ещё в кэше), а простаивающий поток
+// крадёт с головы чужой очереди самую старую — обычно самую крупную. Поток,
+// который ждёт счётчик (Wait), не спит, а выполняет задачи сам, поэтому пул
+// из одного потока — это просто последовательное выполнение.
+// Только стандартная библиотека; привязка потоков к ядрам — для Windows и Linux.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class JobPriority : uint8_t
+{
+    Normal,
+    Background, // долгие задачи (разбор файлов, шаги запуска): берутся, только когда обычных нет
+};
+
+class JobCounter;
+
+// Задача — функция над диапазоном [begin, end); context принадлежит тому, кто её запустил
+struct Job
+{
+    void (*function)(void* context, size_t begin, size_t end) = nullptr;
+    void* context = nullptr;
+    size_t begin = 0;
+    size_t end = 0;
+    JobCounter* pCounter = nullptr; // уменьшается, когда задача выполнена
+    JobPriority priority = JobPriority::Normal;
+};
+
+// Число незавершённых задач. Задачи, запущенные «после» счётчика, ждут его нуля
+// в нём самом и уходят в очередь, когда он обнулится. Счётчик должен пережить
+// свои задачи: JobSystem::Wait возвращается, только когда последняя его отпустила
+class JobCounter
+{
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    size_t Pending() const { return m_Pending.load(std::memory_order_acquire); }
+    bool Done() const { return Pending() == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<size_t> m_Pending{ 0 };
+    std::mutex m_Mutex;
+    std::condition_variable m_Zero;
+    std::vector<Job> m_Waiting; // зависимые задачи
+};
+
+struct JobSystemSettings
+{
+    // Вместе с потоком, который ждёт; 0 — по числу ядер, но не меньше двух. В пуле
+    // из одного потока рабочих нет, и фоновые задачи выполняются только в Wait
+    unsigned threads = 0;
+    bool pinThreads = false;  // рабочий поток n — на логическое ядро n (ядро 0 остаётся основному)
+};
+
+struct JobStats
+{
+    unsigned threads = 0;
+    uint64_t jobs = 0;         // выполнено
+    uint64_t stolen = 0;       // из них взято из чужой очереди
+    uint64_t failedSteals = 0; // заглянули в чужую очередь — пусто
+    uint64_t splits = 0;       // ParallelFor отдал половину диапазона
+    uint64_t locks = 0;        // захватов очередей
+    uint64_t contended = 0;    // из них пришлось ждать
+    uint64_t sleeps = 0;       // рабочий поток уснул без работы
+    std::vector<uint64_t> threadJobs; // по потокам; 0 — потоки вне пула
+
+    double StealRate() const { return jobs > 0 ? (double)stolen / jobs : 0.0; }
+    double ContentionRate() const { return locks > 0 ? (double)contended / locks : 0.0; }
+};
+
+class JobSystem
+{
+public:
+    explicit JobSystem(const JobSystemSettings& settings = JobSystemSettings());
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+    ~JobSystem(); // оставшиеся задачи выполняются в деструкторе
+
+    unsigned ThreadCount() const { return (unsigned)m_Queues.size(); }
+
+    // pAfter — задача начнётся, когда этот счётчик обнулится
+    void Submit(const Job& job, JobCounter* pAfter = nullptr);
+    void Run(std::function<void()> function, JobCounter* pCounter = nullptr, JobCounter* pAfter = nullptr,
+        JobPriority priority = JobPriority::Normal);
+
+    // Выполняет чужие задачи, пока счётчик не обнулится. Поток вне пула берёт
+    // фоновые задачи, только если рабочих потоков нет, — кадр не встанет на разборе меша.
+    // helpBackground — брать их всегда: ждущему больше нечего делать (шаги запуска)
+    void Wait(JobCounter& counter, bool helpBackground = false);
+
+    // body(begin, end) по кускам не меньше grain (кроме последнего). Диапазон
+    // делится пополам, только пока его кому-то отдавать: очередь потока пуста —
+    // значит, у него крадут, и половина остатка уходит в очередь; иначе поток идёт
+    // дальше кусками по grain. Так куски крупные, пока все заняты, и мелкие под конец
+    template <typename Body>
+    void ParallelFor(size_t count, size_t grain, const Body& body);
+
+    // body(task) для task в [0, taskCount) — по задаче на номер. Номер задачи
+    // можно использовать как номер рабочего буфера: задачи с одним номером не идут одновременно
+    template <typename Body>
+    void RunTasks(unsigned taskCount, const Body& body)
+    {
+        ParallelFor(taskCount, 1, [&body](size_t begin, size_t end)
+        {
+            for (size_t task = begin; task < end; ++task)
+                body((unsigned)task);
+        });
+    }
+
+    JobStats Stats() const;
+    void ResetStats();
+
+private:
+    // Очередь потока и его счётчики; дополнена до строки кэша, чтобы соседи не делили её
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+        std::atomic<size_t> size{ 0 };
+
+        std::atomic<uint64_t> executed{ 0 };
+        std::atomic<uint64_t> stolen{ 0 };
+        std::atomic<uint64_t> failedSteals{ 0 };
+        std::atomic<uint64_t> splits{ 0 };
+        std::atomic<uint64_t> locks{ 0 };
+        std::atomic<uint64_t> contended{ 0 };
+        std::atomic<uint64_t> sleeps{ 0 };
+        char padding[64];
+    };
+
+    template <typename Body>
+    struct RangeContext
+    {
+        JobSystem* pSystem;
+        const Body* pBody;
+        size_t grain;
+        JobCounter* pCounter;
+    };
+
+    template <typename Body>
+    static void RangeJob(void* context, size_t begin, size_t end);
+
+    size_t CurrentQueue() const; // 0 — потоки вне пула
+    bool ShouldSplit() const { return m_Queues.size() > 1 && m_Queues[CurrentQueue()]->size.load(std::memory_order_relaxed) == 0; }
+    void Spawn(const Job& job);
+    void Push(const Job& job);
+    void Lock(Queue& queue, std::mutex& mutex);
+    bool Acquire(size_t queue, bool background, Job& job);
+    void Execute(size_t queue, const Job& job);
+    void Finish(JobCounter& counter);
+    void WorkerLoop(size_t queue);
+
+    std::vector<std::unique_ptr<Queue>> m_Queues; // 0 — общая для потоков вне пула
+    std::deque<Job> m_Background;
+    std::atomic<size_t> m_BackgroundSize{ 0 };
+    std::mutex m_BackgroundMutex;
+    std::vector<std::thread> m_Threads;
+
+    std::atomic<size_t> m_Queued{ 0 }; // во всех очередях, включая фоновую
+    std::atomic<unsigned> m_Sleeping{ 0 };
+    std::mutex m_SleepMutex;
+    std::condition_variable m_Wake;
+    std::atomic<bool> m_Stopping{ false };
+};
+
+template <typename Body>
+void JobSystem::RangeJob(void* context, size_t begin, size_t end)
+{
+    const RangeContext<Body>& range = *static_cast<const RangeContext<Body>*>(context);
+    while (begin < end)
+    {
+        if (end - begin > range.grain && range.pSystem->ShouldSplit())
+        {
+            const size_t middle = begin + (end - begin) / 2;
+            Job job;
+            job.function = &RangeJob<Body>;
+            job.context = context;
+            job.begin = middle;
+            job.end = end;
+            job.pCounter = range.pCounter;
+            range.pSystem->Spawn(job);
+            end = middle;
+            continue;
+        }
+        const size_t stop = begin + std::min(range.grain, end - begin);
+        (*range.pBody)(begin, stop);
+        begin = stop;
+    }
+}
+
+template <typename Body>
+void JobSystem::ParallelFor(size_t count, size_t grain, const Body& body)
+{
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+    if (count <= grain || m_Queues.size() == 1)
+    {
+        body((size_t)0, count);
+        return;
+    }
+
+    // Весь диапазон начинает вызывающий поток, остальные получают его половины
+    JobCounter counter;
+    RangeContext<Body> context = { this, &body, grain, &counter };
+    RangeJob<Body>(&context, 0, count);
+    Wait(counter);
+}
+
+// Общий планировщик процесса. Создаётся при первом обращении с настройками
+// ConfigureJobs и не разрушается: его ждут деструкторы глобальных объектов при выходе
+JobSystem& Jobs();
+
+// До первого Jobs(); false — планировщик уже создан и настройки не применены
+bool ConfigureJobs(const JobSystemSettings& settings);
+
+struct JobScalingPoint
+{
+    unsigned threads = 0;
+    double forMs = 0.0;     // ParallelFor с неравномерной ценой элементов
+    double graphMs = 0.0;   // слои задач, каждый после предыдущего
+    double speedup = 0.0;   // forMs одного потока / forMs
+    double stealRate = 0.0;
+    double contentionRate = 0.0;
+    uint64_t splits = 0;
+};
+
+struct JobBenchmark
+{
+    size_t elements = 0;
+    size_t graphJobs = 0;
+    std::vector<JobScalingPoint> points; // 1, 2, 4 ... maxThreads
+    size_t mismatches = 0; // неверная сумма ParallelFor или задача слоя раньше предыдущего слоя
+};
+
+// Лучшее из нескольких повторов для каждого числа потоков
+JobBenchmark BenchmarkJobs(unsigned maxThreads);
@@ -0,0 +1,272 @@
+﻿#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace
+{
+    void AppendCounters(std::string& json, const char* name, const MemoryCounters& counters, bool last)
+    {
+        char text[640];
+        snprintf(text, sizeof(text),
+            "    \"%s\": {\"current_bytes\": %llu, \"peak_bytes\": %llu, \"live_allocations\": %llu, "
+            "\"allocations\": %llu, \"allocated_bytes\": %llu, \"freed_bytes\": %llu, "
+            "\"frame_allocations\": %llu, \"frame_allocated_bytes\": %llu, "
+            "\"average_frame_allocations\": %.3f, \"average_frame_allocated_bytes\": %.1f, \"budget_bytes\": %llu}%s\n",
+            name, (unsigned long long)counters.currentBytes, (unsigned long long)counters.peakBytes, (unsigned long long)counters.liveAllocations,
+            (unsigned long long)counters.allocations, (unsigned long long)counters.allocatedBytes, (unsigned long long)counters.freedBytes,
+            (unsigned long long)counters.frameAllocations, (unsigned long long)counters.frameAllocatedBytes,
+            counters.averageFrameAllocations, counters.averageFrameAllocatedBytes, (unsigned long long)counters.budgetBytes, last ? "" : ",");
+        json += text;
+    }
+}
+
+const char* MemoryDomainName(MemoryDomain domain)
+{
+    return domain == MemoryDomain::Gpu ? "gpu" : "cpu";
+}
+
+const char* MemoryCategoryName(MemoryCategory category)
+{
+    switch (category)
+    {
+    case MemoryCategory::Mesh: return "mesh";
+    case MemoryCategory::Texture: return "texture";
+    case MemoryCategory::Constant: return "constant";
+    case MemoryCategory::Staging: return "staging";
+    case MemoryCategory::Transient: return "transient";
+    case MemoryCategory::Target: return "target";
+    default: return "total";
+    }
+}
+
+bool ParseMemoryBudget(const std::string& text, MemoryDomain& domain, MemoryCategory& category, uint64_t& bytes)
+{
+    const size_t equals = text.find('=');
+    if (equals == std::string::npos) return false;
+
+    const std::string name = text.substr(0, equals);
+    const size_t dot = name.find('.');
+    const std::string domainName = name.substr(0, dot);
+    const std::string categoryName = dot == std::string::npos ? std::string("total") : name.substr(dot + 1);
+
+    if (domainName == "cpu") domain = MemoryDomain::Cpu;
+    else if (domainName == "gpu") domain = MemoryDomain::Gpu;
+    else return false;
+
+    bool found = false;
+    for (int i = 0; i <= (int)MemoryCategory::Count && !found; ++i)
+    {
+        if (categoryName == MemoryCategoryName((MemoryCategory)i))
+        {
+            category = (MemoryCategory)i;
+            found = true;
+        }
+    }
+    if (!found) return false;
+
+    const double megabytes = atof(text.c_str() + equals + 1);
+    if (!(megabytes >= 0.0)) return false;
+    bytes = (uint64_t)(megabytes * 1024.0 * 1024.0);
+    return true;
+}
+
+void MemoryTracker::Allocate(MemoryDomain domain, MemoryCategory category, uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Add(domain, category, bytes, true);
+}
+
+void MemoryTracker::Free(MemoryDomain domain, MemoryCategory category, uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Remove(domain, category, bytes, true);
+}
+
+void MemoryTracker::Track(MemoryDomain domain, MemoryCategory category, uint64_t& trackedBytes, uint64_t bytes)
+{
+    // Рост — одно выделение (перевыделение), число живых выделений не меняется
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (bytes > trackedBytes) Add(domain, category, bytes - trackedBytes, false);
+    else if (bytes < trackedBytes) Remove(domain, category, trackedBytes - bytes, false);
+    trackedBytes = bytes;
+}
+
+void MemoryTracker::Add(MemoryDomain domain, MemoryCategory category, uint64_t bytes, bool live)
+{
+    for (Slot* pSlot : { &SlotFor(domain, category), &SlotFor(domain, MemoryCategory::Count) })
+    {
+        MemoryCounters& counters = pSlot->counters;
+        counters.currentBytes += bytes;
+        counters.peakBytes = std::max(counters.peakBytes, counters.currentBytes);
+        if (live) ++counters.liveAllocations;
+        ++counters.allocations;
+        counters.allocatedBytes += bytes;
+        ++pSlot->pendingAllocations;
+        pSlot->pendingBytes += bytes;
+    }
+}
+
+void MemoryTracker::Remove(MemoryDomain domain, MemoryCategory category, uint64_t bytes, bool live)
+{
+    for (Slot* pSlot : { &SlotFor(domain, category), &SlotFor(domain, MemoryCategory::Count) })
+    {
+        // Лишнее освобождение — ошибка учёта у вызывающего; счётчик не уходит ниже нуля
+        MemoryCounters& counters = pSlot->counters;
+        const uint64_t freed = std::min(bytes, counters.currentBytes);
+        counters.currentBytes -= freed;
+        counters.freedBytes += freed;
+        if (live && counters.liveAllocations > 0) --counters.liveAllocations;
+    }
+}
+
+void MemoryTracker::SetBudget(MemoryDomain domain, MemoryCategory category, uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Slot& slot = SlotFor(domain, category);
+    slot.counters.budgetBytes = bytes;
+    slot.overBudget = false;
+}
+
+void MemoryTracker::SetEvictionCallback(MemoryDomain domain, MemoryCategory category, EvictFn evict)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    SlotFor(domain, category).evict = std::move(evict);
+}
+
+void MemoryTracker::SetWarningCallback(WarningFn warn)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Warn = std::move(warn);
+}
+
+void MemoryTracker::EndFrame()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        const size_t window = (size_t)std::min<uint64_t>(m_Frames + 1, (uint64_t)RateWindow);
+        const size_t position = (size_t)(m_Frames % RateWindow);
+        for (size_t domain = 0; domain < Domains; ++domain)
+        {
+            for (Slot& slot : m_Slots[domain])
+            {
+                MemoryCounters& counters = slot.counters;
+                counters.frameAllocations = slot.pendingAllocations;
+                counters.frameAllocatedBytes = slot.pendingBytes;
+                slot.windowAllocations[position] = slot.pendingAllocations;
+                slot.windowBytes[position] = slot.pendingBytes;
+                slot.pendingAllocations = 0;
+                slot.pendingBytes = 0;
+
+                uint64_t allocations = 0, bytes = 0;
+                for (size_t i = 0; i < window; ++i)
+                {
+                    allocations += slot.windowAllocations[i];
+                    bytes += slot.windowBytes[i];
+                }
+                counters.averageFrameAllocations = (double)allocations / window;
+                counters.averageFrameAllocatedBytes = (double)bytes / window;
+            }
+        }
+        ++m_Frames;
+    }
+
+    // Вытеснение и предупреждения — без блокировки: обработчики сами зовут Free
+    for (size_t domain = 0; domain < Domains; ++domain)
+    {
+        for (size_t category = 0; category < Slots; ++category)
+        {
+            const MemoryDomain d = (MemoryDomain)domain;
+            const MemoryCategory c = (MemoryCategory)category;
+            MemoryCounters counters = Counters(d, c);
+            if (counters.budgetBytes == 0 || counters.currentBytes <= counters.budgetBytes)
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                SlotFor(d, c).overBudget = false;
+                continue;
+            }
+
+            const uint64_t evicted = Evict(d, c, counters.currentBytes - counters.budgetBytes);
+            counters = Counters(d, c);
+
+            WarningFn warn;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                Slot& slot = SlotFor(d, c);
+                const bool over = counters.currentBytes > counters.budgetBytes;
+                if (over && !slot.overBudget) warn = m_Warn;
+                slot.overBudget = over;
+            }
+
+            if (warn)
+            {
+                MemoryBudgetEvent event = { d, c, counters.currentBytes, counters.budgetBytes, evicted };
+                warn(event);
+            }
+        }
+    }
+}
+
+uint64_t MemoryTracker::FrameCount() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Frames;
+}
+
+MemoryCounters MemoryTracker::Counters(MemoryDomain domain, MemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return SlotFor(domain, category).counters;
+}
+
+uint64_t MemoryTracker::Evict(MemoryDomain domain, MemoryCategory category, uint64_t bytesOver)
+{
+    // Для бюджета домена — вытеснение категорий по порядку, пока не наберётся превышение
+    const size_t first = category == MemoryCategory::Count ? 0 : (size_t)category;
+    const size_t last = category == MemoryCategory::Count ? (size_t)MemoryCategory::Count : first + 1;
+
+    uint64_t evicted = 0;
+    for (size_t i = first; i < last && evicted < bytesOver; ++i)
+    {
+        EvictFn evict;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            evict = SlotFor(domain, (MemoryCategory)i).evict;
+        }
+        if (evict) evicted += evict(bytesOver - evicted);
+    }
+    return evicted;
+}
+
+std::string MemoryTracker::SnapshotJson() const
+{
+    std::string json;
+    char text[64];
+    snprintf(text, sizeof(text), "{\n  \"frames\": %llu,\n", (unsigned long long)FrameCount());
+    json += text;
+
+    for (size_t domain = 0; domain < Domains; ++domain)
+    {
+        json += "  \"";
+        json += MemoryDomainName((MemoryDomain)domain);
+        json += "\": {\n";
+        for (size_t category = 0; category < Slots; ++category)
+        {
+            const MemoryCategory c = (MemoryCategory)category;
+            AppendCounters(json, MemoryCategoryName(c), Counters((MemoryDomain)domain, c), category + 1 == Slots);
+        }
+        json += domain + 1 == Domains ? "  }\n" : "  },\n";
+    }
+    json += "}\n";
+    return json;
+}
+
+bool MemoryTracker::WriteSnapshot(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) return false;
+    file << SnapshotJson();
+    return file.good();
+}
@@ -0,0 +1,121 @@
+﻿#pragma once
+
+// Учёт памяти по категориям: сколько занято сейчас, пик и сколько выделяется
+// за кадр, отдельно для CPU и GPU. Выделения отмечает тот, кто создаёт ресурс
+// (ResourceManager, загрузка текстур, main.cpp); сам трекер ничего не выделяет
+// и D3D не знает. Бюджеты проверяются в EndFrame: сверх бюджета сначала
+// вызывается вытеснение, потом, если не помогло, — предупреждение.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+enum class MemoryDomain
+{
+    Cpu,
+    Gpu,
+    Count,
+};
+
+enum class MemoryCategory
+{
+    Mesh,      // геометрия: разобранные меши на CPU, блоки вершин и индексов на GPU
+    Texture,
+    Constant,  // константные и структурные буферы, обновляемые каждый кадр
+    Staging,   // копии для чтения с GPU
+    Transient, // временные цели и данные на один кадр
+    Target,    // постоянные цели рендеринга: цепочка обмена, цели захвата
+    Count,     // в вызовах с бюджетом и счётчиками — весь домен
+};
+
+const char* MemoryDomainName(MemoryDomain domain);
+const char* MemoryCategoryName(MemoryCategory category);
+
+// "gpu.texture=256" или "cpu=512" — бюджет в мегабайтах на категорию или весь домен
+bool ParseMemoryBudget(const std::string& text, MemoryDomain& domain, MemoryCategory& category, uint64_t& bytes);
+
+struct MemoryCounters
+{
+    uint64_t currentBytes = 0;
+    uint64_t peakBytes = 0;
+    uint64_t liveAllocations = 0;
+    uint64_t allocations = 0;    // всего за время работы
+    uint64_t allocatedBytes = 0;
+    uint64_t freedBytes = 0;
+    uint64_t frameAllocations = 0;   // за последний завершённый кадр
+    uint64_t frameAllocatedBytes = 0;
+    double averageFrameAllocations = 0.0;   // за последние RateWindow кадров
+    double averageFrameAllocatedBytes = 0.0;
+    uint64_t budgetBytes = 0; // 0 — без бюджета
+};
+
+struct MemoryBudgetEvent
+{
+    MemoryDomain domain;
+    MemoryCategory category; // Count — бюджет всего домена
+    uint64_t currentBytes;
+    uint64_t budgetBytes;
+    uint64_t evictedBytes;   // сколько освободило вытеснение в этом кадре
+};
+
+class MemoryTracker
+{
+public:
+    static const size_t RateWindow = 60;
+
+    // Освобождает память категории (и сам отмечает это через Free); bytesOver —
+    // превышение бюджета. Возвращает освобождённое
+    typedef std::function<uint64_t(uint64_t bytesOver)> EvictFn;
+    typedef std::function<void(const MemoryBudgetEvent& event)> WarningFn;
+
+    // Потокобезопасны: выделения бывают и в фоновых потоках загрузки
+    void Allocate(MemoryDomain domain, MemoryCategory category, uint64_t bytes);
+    void Free(MemoryDomain domain, MemoryCategory category, uint64_t bytes);
+
+    // Для памяти, известной только итогом (ёмкость вектора, очередь стримера):
+    // разница с trackedBytes отмечается выделением или освобождением
+    void Track(MemoryDomain domain, MemoryCategory category, uint64_t& trackedBytes, uint64_t bytes);
+
+    void SetBudget(MemoryDomain domain, MemoryCategory category, uint64_t bytes);
+    void SetEvictionCallback(MemoryDomain domain, MemoryCategory category, EvictFn evict);
+    void SetWarningCallback(WarningFn warn);
+
+    // Конец кадра, основной поток: кадровые счётчики уходят в средние, проверяются
+    // бюджеты. Бюджет домена вытесняет по категориям в порядке перечисления.
+    // Предупреждение — одно на выход за бюджет, до возврата в него
+    void EndFrame();
+    uint64_t FrameCount() const;
+
+    MemoryCounters Counters(MemoryDomain domain, MemoryCategory category) const;
+
+    std::string SnapshotJson() const;
+    bool WriteSnapshot(const std::string& path) const;
+
+private:
+    static const size_t Domains = (size_t)MemoryDomain::Count;
+    static const size_t Slots = (size_t)MemoryCategory::Count + 1; // категории и весь домен
+
+    struct Slot
+    {
+        MemoryCounters counters;
+        uint64_t pendingAllocations = 0; // текущего, ещё не завершённого кадра
+        uint64_t pendingBytes = 0;
+        uint64_t windowAllocations[RateWindow] = {};
+        uint64_t windowBytes[RateWindow] = {};
+        EvictFn evict;
+        bool overBudget = false;
+    };
+
+    Slot& SlotFor(MemoryDomain domain, MemoryCategory category) { return m_Slots[(size_t)domain][(size_t)category]; }
+    const Slot& SlotFor(MemoryDomain domain, MemoryCategory category) const { return m_Slots[(size_t)domain][(size_t)category]; }
+    void Add(MemoryDomain domain, MemoryCategory category, uint64_t bytes, bool live);
+    void Remove(MemoryDomain domain, MemoryCategory category, uint64_t bytes, bool live);
+    uint64_t Evict(MemoryDomain domain, MemoryCategory category, uint64_t bytesOver);
+
+    mutable std::mutex m_Mutex;
+    Slot m_Slots[Domains][Slots];
+    WarningFn m_Warn;
+    uint64_t m_Frames = 0;
+};
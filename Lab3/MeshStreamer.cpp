@@ -0,0 +1,421 @@
+﻿#include "MeshStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    double Seconds(Clock::time_point time)
+    {
+        return std::chrono::duration<double>(time.time_since_epoch()).count();
+    }
+
+    const char* SkipSpaces(const char* p, const char* end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+        return p;
+    }
+
+    const char* SkipToken(const char* p, const char* end)
+    {
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') ++p;
+        return p;
+    }
+
+    // Индекс вершины в OBJ: 1-based или отрицательный относительно конца списка
+    bool ResolveIndex(long index, size_t vertexCount, uint32_t& result)
+    {
+        if (index > 0 && (size_t)index <= vertexCount) result = (uint32_t)(index - 1);
+        else if (index < 0 && (size_t)(-index) <= vertexCount) result = (uint32_t)(vertexCount + index);
+        else return false;
+        return true;
+    }
+}
+
+bool ParseObj(const char* text, size_t length, MeshData& mesh)
+{
+    mesh = MeshData();
+
+    std::vector<float> colors; // rgb на вершину; пусто, если в файле цветов нет
+    bool hasColors = true;
+    std::vector<uint32_t> polygon;
+
+    const char* p = text;
+    const char* end = text + length;
+    while (p < end)
+    {
+        const char* lineEnd = std::find(p, end, '\n');
+        p = SkipSpaces(p, lineEnd);
+
+        if (lineEnd - p > 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            // strtof останавливается на переводе строки, поэтому не выходит за lineEnd
+            char* next = const_cast<char*>(p + 1);
+            float values[6];
+            int count = 0;
+            while (count < 6)
+            {
+                const char* start = SkipSpaces(next, lineEnd);
+                if (start >= lineEnd || *start == '#') break;
+                values[count] = strtof(start, &next);
+                if (next == start) return false;
+                ++count;
+            }
+            if (count < 3) return false;
+
+            mesh.vertices.insert(mesh.vertices.end(), values, values + 3);
+            if (count == 6) colors.insert(colors.end(), values + 3, values + 6);
+            else hasColors = false;
+        }
+        else if (lineEnd - p > 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            const size_t vertexCount = mesh.vertices.size() / 3;
+            polygon.clear();
+            const char* token = SkipSpaces(p + 1, lineEnd);
+            while (token < lineEnd && *token != '#')
+            {
+                char* next = nullptr;
+                long index = strtol(token, &next, 10);
+                uint32_t resolved = 0;
+                if (next == token || !ResolveIndex(index, vertexCount, resolved)) return false;
+                polygon.push_back(resolved);
+
+                token = SkipSpaces(SkipToken(next, lineEnd), lineEnd);
+            }
+            if (polygon.size() < 3) return false;
+
+            for (size_t i = 1; i + 1 < polygon.size(); ++i)
+            {
+                mesh.indices.push_back(polygon[0]);
+                mesh.indices.push_back(polygon[i]);
+                mesh.indices.push_back(polygon[i + 1]);
+            }
+        }
+
+        p = lineEnd < end ? lineEnd + 1 : end;
+    }
+
+    const size_t vertexCount = mesh.vertices.size() / 3;
+    if (vertexCount == 0 || mesh.indices.empty()) return false;
+
+    // Позиции -> формат вершин приложения, заодно радиус и цвет по умолчанию
+    std::vector<float> positions;
+    positions.swap(mesh.vertices);
+    mesh.vertices.resize(vertexCount * MeshData::VertexFloats);
+
+    float radiusSq = 0.0f;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const float* position = &positions[i * 3];
+        radiusSq = std::max(radiusSq, position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+    }
+    mesh.radius = std::sqrt(radiusSq);
+
+    const float invRadius = mesh.radius > 0.0f ? 1.0f / mesh.radius : 0.0f;
+    hasColors = hasColors && colors.size() == vertexCount * 3;
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const float* position = &positions[i * 3];
+        float* vertex = &mesh.vertices[i * MeshData::VertexFloats];
+        vertex[0] = position[0];
+        vertex[1] = position[1];
+        vertex[2] = position[2];
+        for (int c = 0; c < 3; ++c)
+            vertex[3 + c] = hasColors ? colors[i * 3 + c] : position[c] * invRadius * 0.5f + 0.5f;
+        vertex[6] = 1.0f;
+    }
+    return true;
+}
+
+void MeshStreamer::Start(unsigned decodeJobs)
+{
+    Stop();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Running = true;
+    if (decodeJobs == 0) decodeJobs = 1;
+    m_MaxDecodeJobs = decodeJobs;
+    m_MaxDecodeBacklog = decodeJobs * 2;
+
+    m_IoThread = std::thread(&MeshStreamer::IoLoop, this);
+}
+
+void MeshStreamer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_Running) return;
+        m_Running = false;
+    }
+    m_IoCondition.notify_all();
+    m_DoneCondition.notify_all();
+
+    // Задачи разбора, увидев остановку, выходят, не трогая очередь
+    m_IoThread.join();
+    Jobs().Wait(m_DecodeJobs);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Entries.clear();
+    m_IdByPath.clear();
+    m_IoQueue.clear();
+    m_DecodeQueue.clear();
+    m_Ready.clear();
+    m_Loading = 0;
+    m_UploadHistory.clear();
+}
+
+uint32_t MeshStreamer::Request(const std::string& path, float priority)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    auto it = m_IdByPath.find(path);
+    if (it != m_IdByPath.end())
+    {
+        lock.unlock();
+        SetPriority(it->second, priority);
+        return it->second;
+    }
+
+    const uint32_t meshId = (uint32_t)m_Entries.size();
+    m_Entries.emplace_back();
+    m_Entries.back().path = path;
+    m_Entries.back().priority = priority;
+    m_IdByPath[path] = meshId;
+
+    m_IoQueue.push_back(meshId);
+    m_IoQueueDirty = true;
+    lock.unlock();
+
+    m_IoCondition.notify_one();
+    return meshId;
+}
+
+void MeshStreamer::SetPriority(uint32_t meshId, float priority)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (meshId >= m_Entries.size() || m_Entries[meshId].priority == priority) return;
+
+    m_Entries[meshId].priority = priority;
+    if (m_Entries[meshId].state == MeshState::Queued) m_IoQueueDirty = true;
+}
+
+MeshState MeshStreamer::State(uint32_t meshId) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return meshId < m_Entries.size() ? m_Entries[meshId].state : MeshState::Failed;
+}
+
+size_t MeshStreamer::Pump(uint64_t budgetBytes, double budgetMs, const UploadFn& upload)
+{
+    const Clock::time_point start = Clock::now();
+    uint64_t uploadedBytes = 0;
+    size_t uploaded = 0;
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    std::sort(m_Ready.begin(), m_Ready.end(), [this](uint32_t a, uint32_t b) { return HigherPriority(a, b); });
+
+    size_t next = 0;
+    for (; next < m_Ready.size(); ++next)
+    {
+        const uint32_t meshId = m_Ready[next];
+        const uint64_t size = m_Entries[meshId].data.SizeBytes();
+        if (uploaded > 0 && uploadedBytes + size > budgetBytes) break;
+
+        // Загрузка идёт без блокировки: потоки чтения и разбора в это время работают.
+        // Данные уже не в записи — Stats не должен считать их готовыми
+        MeshData data = std::move(m_Entries[meshId].data);
+        m_Entries[meshId].data = MeshData();
+        m_Entries[meshId].state = MeshState::Uploading;
+        lock.unlock();
+        const bool ok = upload(meshId, data);
+        lock.lock();
+
+        m_Entries[meshId].state = ok ? MeshState::Resident : MeshState::Failed;
+        uploadedBytes += size;
+        ++uploaded;
+
+        if (std::chrono::duration<double, std::milli>(Clock::now() - start).count() >= budgetMs)
+        {
+            ++next;
+            break;
+        }
+    }
+    m_Ready.erase(m_Ready.begin(), m_Ready.begin() + next);
+
+    const Clock::time_point now = Clock::now();
+    m_LastPumpBytes = uploadedBytes;
+    m_LastPumpMs = std::chrono::duration<double, std::milli>(now - start).count();
+    m_BytesUploaded += uploadedBytes;
+
+    const double nowSeconds = Seconds(now);
+    if (uploadedBytes > 0) m_UploadHistory.push_back(std::make_pair(nowSeconds, uploadedBytes));
+    while (!m_UploadHistory.empty() && nowSeconds - m_UploadHistory.front().first > 1.0)
+        m_UploadHistory.pop_front();
+
+    return uploaded;
+}
+
+void MeshStreamer::WaitUntilDecoded()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_DoneCondition.wait(lock, [this] { return !m_Running || (m_IoQueue.empty() && m_Loading == 0); });
+}
+
+bool MeshStreamer::IsIdle() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_IoQueue.empty() && m_Loading == 0 && m_Ready.empty();
+}
+
+StreamingStats MeshStreamer::Stats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    StreamingStats stats;
+    for (const Entry& entry : m_Entries)
+    {
+        switch (entry.state)
+        {
+        case MeshState::Queued: ++stats.queued; break;
+        case MeshState::Loading: ++stats.loading; break;
+        case MeshState::Ready: ++stats.ready; stats.readyBytes += entry.data.SizeBytes(); break;
+        case MeshState::Uploading: ++stats.uploading; break;
+        case MeshState::Resident: ++stats.resident; break;
+        case MeshState::Failed: ++stats.failed; break;
+        }
+    }
+    stats.bytesRead = m_BytesRead;
+    stats.bytesUploaded = m_BytesUploaded;
+    stats.lastPumpBytes = m_LastPumpBytes;
+    stats.lastPumpMs = m_LastPumpMs;
+
+    const double nowSeconds = Seconds(Clock::now());
+    for (const auto& upload : m_UploadHistory)
+    {
+        if (nowSeconds - upload.first <= 1.0) stats.uploadBytesPerSecond += (double)upload.second;
+    }
+    return stats;
+}
+
+void MeshStreamer::IoLoop()
+{
+    auto compare = [this](uint32_t a, uint32_t b) { return HigherPriority(b, a); };
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+        m_IoCondition.wait(lock, [this]
+        {
+            return !m_Running || (!m_IoQueue.empty() && m_DecodeQueue.size() < m_MaxDecodeBacklog);
+        });
+        if (!m_Running) return;
+
+        if (m_IoQueueDirty)
+        {
+            std::make_heap(m_IoQueue.begin(), m_IoQueue.end(), compare);
+            m_IoQueueDirty = false;
+        }
+        std::pop_heap(m_IoQueue.begin(), m_IoQueue.end(), compare);
+        const uint32_t meshId = m_IoQueue.back();
+        m_IoQueue.pop_back();
+
+        Entry& entry = m_Entries[meshId];
+        entry.state = MeshState::Loading;
+        ++m_Loading;
+        const std::string path = entry.path;
+        lock.unlock();
+
+        ReadFile file;
+        file.meshId = meshId;
+        std::ifstream stream(path, std::ios::binary);
+        const bool ok = (bool)stream;
+        if (ok) file.bytes.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+        lock.lock();
+        if (!ok)
+        {
+            lock.unlock();
+            Finish(meshId, false, MeshData());
+            lock.lock();
+            continue;
+        }
+
+        m_BytesRead += file.bytes.size();
+
+        // В пуле из одного потока рабочих нет, и фоновая задача ждала бы чужого
+        // Jobs().Wait — WaitUntilDecoded его не зовёт. Разбор здесь же, в потоке чтения
+        if (Jobs().ThreadCount() == 1)
+        {
+            lock.unlock();
+            MeshData data;
+            const bool parsed = ParseObj(file.bytes.data(), file.bytes.size(), data);
+            Finish(meshId, parsed, std::move(data));
+            lock.lock();
+            continue;
+        }
+
+        m_DecodeQueue.push_back(std::move(file));
+        if (m_ActiveDecodeJobs < m_MaxDecodeJobs)
+        {
+            ++m_ActiveDecodeJobs;
+            LaunchDecode();
+        }
+    }
+}
+
+// Под m_Mutex; место в m_ActiveDecodeJobs уже занято
+void MeshStreamer::LaunchDecode()
+{
+    Jobs().Run([this]() { DecodeJob(); }, &m_DecodeJobs, nullptr, JobPriority::Background);
+}
+
+// Один файл на задачу: между файлами поток планировщика успевает взять обычные задачи кадра
+void MeshStreamer::DecodeJob()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    if (!m_Running || m_DecodeQueue.empty())
+    {
+        --m_ActiveDecodeJobs;
+        return;
+    }
+
+    // Из прочитанного первым разбирается самый важный
+    auto best = std::min_element(m_DecodeQueue.begin(), m_DecodeQueue.end(),
+        [this](const ReadFile& a, const ReadFile& b) { return HigherPriority(a.meshId, b.meshId); });
+    ReadFile file = std::move(*best);
+    *best = std::move(m_DecodeQueue.back());
+    m_DecodeQueue.pop_back();
+    lock.unlock();
+
+    // Место в очереди разбора освободилось — поток чтения может продолжать
+    m_IoCondition.notify_one();
+
+    MeshData data;
+    const bool ok = ParseObj(file.bytes.data(), file.bytes.size(), data);
+    Finish(file.meshId, ok, std::move(data));
+
+    lock.lock();
+    if (m_Running && !m_DecodeQueue.empty())
+        LaunchDecode();
+    else
+        --m_ActiveDecodeJobs;
+}
+
+void MeshStreamer::Finish(uint32_t meshId, bool ok, MeshData&& data)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        Entry& entry = m_Entries[meshId];
+        entry.state = ok ? MeshState::Ready : MeshState::Failed;
+        entry.data = std::move(data);
+        if (ok) m_Ready.push_back(meshId);
+        --m_Loading;
+    }
+    m_DoneCondition.notify_all();
+}
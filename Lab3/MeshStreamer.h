@@ -0,0 +1,151 @@
+﻿#pragma once
+
+// Потоковая загрузка мешей. Чтение файлов идёт в отдельном потоке в порядке
+// приоритета, разбор — фоновыми задачами общего планировщика (JobSystem.h), а на GPU готовые меши попадают только
+// из Pump() в основном потоке и не больше бюджета на кадр. D3D здесь нет:
+// загрузку в видеопамять делает переданная функция, поэтому планировщик
+// работает и без устройства.
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "JobSystem.h"
+
+// Геометрия меша в формате вершин приложения: позиция xyz и цвет rgba
+struct MeshData
+{
+    static const size_t VertexFloats = 7;
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    float radius = 0.0f; // радиус сферы вокруг начала координат, охватывающей меш
+
+    size_t VertexCount() const { return vertices.size() / VertexFloats; }
+    size_t SizeBytes() const { return vertices.size() * sizeof(float) + indices.size() * sizeof(uint32_t); }
+};
+
+// Разбор Wavefront OBJ: v x y z [r g b], f с полигонами любой степени (веером),
+// индексы вида a, a/b, a//c, a/b/c и отрицательные. Без цвета вершина
+// раскрашивается по нормализованной позиции
+bool ParseObj(const char* text, size_t length, MeshData& mesh);
+
+enum class MeshState
+{
+    Queued,   // ждёт чтения
+    Loading,  // читается или разбирается
+    Ready,    // разобран, ждёт загрузки на GPU
+    Uploading, // данные у функции загрузки в Pump
+    Resident,
+    Failed,
+};
+
+struct StreamingStats
+{
+    size_t queued = 0;
+    size_t loading = 0;
+    size_t ready = 0;
+    size_t uploading = 0;
+    size_t resident = 0;
+    size_t failed = 0;
+    uint64_t readyBytes = 0; // разобранные меши, ещё не отданные на загрузку
+    uint64_t bytesRead = 0;
+    uint64_t bytesUploaded = 0;
+    double uploadBytesPerSecond = 0.0; // за последнюю секунду
+    uint64_t lastPumpBytes = 0;
+    double lastPumpMs = 0.0;
+};
+
+class MeshStreamer
+{
+public:
+    static const uint32_t InvalidMesh = ~0u;
+
+    // Загрузка разобранного меша на GPU; false — меш помечается как Failed
+    typedef std::function<bool(uint32_t meshId, const MeshData& mesh)> UploadFn;
+
+    MeshStreamer() = default;
+    MeshStreamer(const MeshStreamer&) = delete;
+    MeshStreamer& operator=(const MeshStreamer&) = delete;
+    ~MeshStreamer() { Stop(); }
+
+    // Разбирается не больше decodeJobs файлов одновременно — остальные задачи планировщика не ждут за разбором
+    void Start(unsigned decodeJobs);
+    void Stop(); // недочитанные запросы отбрасываются
+
+    // Один и тот же путь даёт один и тот же номер меша
+    uint32_t Request(const std::string& path, float priority);
+
+    // Приоритет — оценка размера на экране; больше — раньше
+    void SetPriority(uint32_t meshId, float priority);
+    MeshState State(uint32_t meshId) const;
+
+    // Загружает готовые меши в порядке приоритета, пока не исчерпан бюджет байт
+    // или миллисекунд. Первый меш загружается всегда, иначе меш больше бюджета
+    // не попал бы на GPU никогда. Возвращает число загруженных мешей
+    size_t Pump(uint64_t budgetBytes, double budgetMs, const UploadFn& upload);
+
+    // Ждёт, пока все запросы прочитаны и разобраны (пакетный режим)
+    void WaitUntilDecoded();
+    bool IsIdle() const;
+
+    StreamingStats Stats() const;
+
+private:
+    struct Entry
+    {
+        std::string path;
+        float priority = 0.0f;
+        MeshState state = MeshState::Queued;
+        MeshData data;
+    };
+
+    struct ReadFile
+    {
+        uint32_t meshId;
+        std::string bytes;
+    };
+
+    bool HigherPriority(uint32_t a, uint32_t b) const { return m_Entries[a].priority > m_Entries[b].priority; }
+    void IoLoop();
+    void LaunchDecode();
+    void DecodeJob();
+    void Finish(uint32_t meshId, bool ok, MeshData&& data);
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_IoCondition;
+    std::condition_variable m_DoneCondition;
+
+    std::deque<Entry> m_Entries; // индекс — номер меша
+    std::unordered_map<std::string, uint32_t> m_IdByPath;
+
+    // Очередь на чтение — куча по приоритету; после SetPriority перестраивается лениво
+    std::vector<uint32_t> m_IoQueue;
+    bool m_IoQueueDirty = false;
+
+    // Прочитанные файлы ждут разбора; чтение не уходит дальше MaxDecodeBacklog файлов вперёд
+    std::vector<ReadFile> m_DecodeQueue;
+    size_t m_MaxDecodeBacklog = 4;
+    size_t m_Loading = 0;
+
+    std::vector<uint32_t> m_Ready;
+
+    std::thread m_IoThread;
+    JobCounter m_DecodeJobs;
+    unsigned m_MaxDecodeJobs = 1;
+    unsigned m_ActiveDecodeJobs = 0;
+    bool m_Running = false;
+
+    uint64_t m_BytesRead = 0;
+    uint64_t m_BytesUploaded = 0;
+    uint64_t m_LastPumpBytes = 0;
+    double m_LastPumpMs = 0.0;
+    std::deque<std::pair<double, uint64_t>> m_UploadHistory; // (время в секундах, байты)
+};
@@ -0,0 +1,486 @@
+﻿#include "RenderGraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <queue>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    void AddUnique(std::vector<uint32_t>& list, uint32_t value)
+    {
+        if (std::find(list.begin(), list.end(), value) == list.end())
+            list.push_back(value);
+    }
+}
+
+void RenderGraph::PassBuilder::Read(GraphResource resource)
+{
+    m_Graph.m_Passes[m_Pass].accesses.push_back(Access{ resource, false, WriteMode::Partial });
+}
+
+void RenderGraph::PassBuilder::Write(GraphResource resource, WriteMode mode)
+{
+    m_Graph.m_Passes[m_Pass].accesses.push_back(Access{ resource, true, mode });
+}
+
+void RenderGraph::PassBuilder::SideEffect()
+{
+    m_Graph.m_Passes[m_Pass].sideEffect = true;
+}
+
+void RenderGraph::Reset()
+{
+    m_Passes.clear();
+    m_Resources.clear();
+    m_Compiled.clear();
+    m_PhysicalDescs.clear();
+    m_Stats = RenderGraphStats();
+}
+
+GraphResource RenderGraph::CreateTexture(const char* name, const GraphTextureDesc& desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    m_Resources.push_back(resource);
+    return (GraphResource)(m_Resources.size() - 1);
+}
+
+GraphResource RenderGraph::ImportTexture(const char* name, const GraphTextureDesc& desc, bool preserveContents)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = true;
+    resource.preserve = preserveContents;
+    resource.output = true;
+    m_Resources.push_back(resource);
+    return (GraphResource)(m_Resources.size() - 1);
+}
+
+void RenderGraph::MarkOutput(GraphResource resource)
+{
+    if (resource < m_Resources.size())
+        m_Resources[resource].output = true;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const char* name, ExecuteFn execute)
+{
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    m_Passes.push_back(std::move(pass));
+    return PassBuilder(*this, (uint32_t)(m_Passes.size() - 1));
+}
+
+bool RenderGraph::Compile()
+{
+    const Clock::time_point start = Clock::now();
+    m_Compiled.clear();
+    m_PhysicalDescs.clear();
+    m_Stats = RenderGraphStats();
+    m_Stats.passes = m_Passes.size();
+
+    const uint32_t passCount = (uint32_t)m_Passes.size();
+    for (const Pass& pass : m_Passes)
+    {
+        for (const Access& access : pass.accesses)
+        {
+            if (access.resource >= m_Resources.size()) return false;
+        }
+    }
+
+    // Писатели каждой цели в порядке объявления
+    std::vector<std::vector<uint32_t>> writers(m_Resources.size());
+    for (uint32_t p = 0; p < passCount; ++p)
+    {
+        for (const Access& access : m_Passes[p].accesses)
+        {
+            if (access.write) AddUnique(writers[access.resource], p);
+        }
+    }
+
+    // Два вида связей. needs — проходу нужен результат другого (чтение, дорисовка
+    // поверх): по ним решается, кто жив. after — только порядок: запись не должна
+    // обогнать предыдущую запись и чтения предыдущего содержимого
+    std::vector<std::vector<uint32_t>> needs(passCount), after(passCount);
+    for (uint32_t p = 0; p < passCount; ++p)
+    {
+        for (const Access& access : m_Passes[p].accesses)
+        {
+            const std::vector<uint32_t>& list = writers[access.resource];
+
+            // Ближайший писатель, объявленный раньше; если такого нет — ближайший позже
+            // (проход можно объявить раньше того, кто готовит его вход)
+            uint32_t previous = ~0u, next = ~0u;
+            for (uint32_t writer : list)
+            {
+                if (writer < p) previous = writer;
+                else if (writer > p && next == ~0u) next = writer;
+            }
+
+            if (!access.write)
+            {
+                const uint32_t source = previous != ~0u ? previous : next;
+                if (source != ~0u)
+                {
+                    AddUnique(needs[p], source);
+                    AddUnique(after[p], source);
+                }
+                continue;
+            }
+
+            if (previous == ~0u) continue;
+            AddUnique(after[p], previous);
+            if (access.mode == WriteMode::Partial) AddUnique(needs[p], previous);
+
+            // Читатели прежнего содержимого должны успеть до перезаписи
+            for (uint32_t reader = previous + 1; reader < p; ++reader)
+            {
+                for (const Access& other : m_Passes[reader].accesses)
+                {
+                    if (!other.write && other.resource == access.resource) AddUnique(after[p], reader);
+                }
+            }
+        }
+    }
+
+    // Живы проходы с побочным эффектом, пишущие в выход, и всё, что им нужно
+    std::vector<uint32_t> stack;
+    for (uint32_t p = 0; p < passCount; ++p)
+    {
+        Pass& pass = m_Passes[p];
+        pass.culled = true;
+        bool root = pass.sideEffect;
+        for (const Access& access : pass.accesses)
+            root = root || (access.write && m_Resources[access.resource].output);
+        if (root) stack.push_back(p);
+    }
+    while (!stack.empty())
+    {
+        const uint32_t p = stack.back();
+        stack.pop_back();
+        if (!m_Passes[p].culled) continue;
+        m_Passes[p].culled = false;
+        for (uint32_t dependency : needs[p])
+        {
+            if (m_Passes[dependency].culled) stack.push_back(dependency);
+        }
+    }
+
+    // Топологическая сортировка живых; из готовых первым идёт объявленный раньше
+    std::vector<uint32_t> pending(passCount, 0);
+    std::vector<std::vector<uint32_t>> dependents(passCount);
+    for (uint32_t p = 0; p < passCount; ++p)
+    {
+        if (m_Passes[p].culled) continue;
+        for (uint32_t dependency : after[p])
+        {
+            if (m_Passes[dependency].culled) continue;
+            ++pending[p];
+            dependents[dependency].push_back(p);
+        }
+    }
+
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+    size_t alive = 0;
+    for (uint32_t p = 0; p < passCount; ++p)
+    {
+        if (m_Passes[p].culled) continue;
+        ++alive;
+        if (pending[p] == 0) ready.push(p);
+    }
+
+    std::vector<uint32_t> order;
+    while (!ready.empty())
+    {
+        const uint32_t p = ready.top();
+        ready.pop();
+        order.push_back(p);
+        for (uint32_t dependent : dependents[p])
+        {
+            if (--pending[dependent] == 0) ready.push(dependent);
+        }
+    }
+    if (order.size() != alive) return false; // цикл
+
+    // Время жизни целей — в позициях порядка исполнения
+    for (Resource& resource : m_Resources)
+    {
+        resource.physical = ~0u;
+        resource.firstUse = ~0u;
+        resource.lastUse = 0;
+    }
+    for (uint32_t position = 0; position < order.size(); ++position)
+    {
+        for (const Access& access : m_Passes[order[position]].accesses)
+        {
+            Resource& resource = m_Resources[access.resource];
+            resource.firstUse = std::min(resource.firstUse, position);
+            resource.lastUse = std::max(resource.lastUse, position);
+        }
+    }
+
+    // Совмещение: по началу жизни, каждой цели — освободившаяся физическая с тем же
+    // описанием (из подходящих — освободившаяся последней), иначе новая
+    std::vector<GraphResource> transient;
+    for (GraphResource r = 0; r < m_Resources.size(); ++r)
+    {
+        if (!m_Resources[r].imported && m_Resources[r].firstUse != ~0u) transient.push_back(r);
+    }
+    std::stable_sort(transient.begin(), transient.end(), [this](GraphResource a, GraphResource b) { return m_Resources[a].firstUse < m_Resources[b].firstUse; });
+
+    std::vector<uint32_t> busyUntil;
+    for (GraphResource r : transient)
+    {
+        Resource& resource = m_Resources[r];
+        uint32_t best = ~0u;
+        for (uint32_t physical = 0; physical < m_PhysicalDescs.size(); ++physical)
+        {
+            if (busyUntil[physical] >= resource.firstUse || !m_PhysicalDescs[physical].Compatible(resource.desc)) continue;
+            if (best == ~0u || busyUntil[physical] > busyUntil[best]) best = physical;
+        }
+        if (best == ~0u)
+        {
+            best = (uint32_t)m_PhysicalDescs.size();
+            m_PhysicalDescs.push_back(resource.desc);
+            busyUntil.push_back(0);
+            m_Stats.physicalBytes += resource.desc.SizeBytes();
+        }
+        busyUntil[best] = resource.lastUse;
+        resource.physical = best;
+        m_Stats.transientBytes += resource.desc.SizeBytes();
+    }
+    m_Stats.transientResources = transient.size();
+    m_Stats.physicalResources = m_PhysicalDescs.size();
+
+    // Действия с целями. Цель, которую проход и читает, и пишет, — одно вложение с загрузкой
+    for (uint32_t position = 0; position < order.size(); ++position)
+    {
+        const Pass& pass = m_Passes[order[position]];
+        CompiledPass compiled;
+        compiled.pass = order[position];
+
+        for (int writes = 0; writes < 2; ++writes)
+        {
+            for (const Access& access : pass.accesses)
+            {
+                if (access.write != (writes == 1)) continue;
+
+                auto existing = std::find_if(compiled.attachments.begin(), compiled.attachments.end(),
+                    [&access](const GraphAttachment& attachment) { return attachment.resource == access.resource; });
+                if (existing != compiled.attachments.end())
+                {
+                    existing->write = existing->write || access.write;
+                    continue;
+                }
+
+                const Resource& resource = m_Resources[access.resource];
+                GraphAttachment attachment;
+                attachment.resource = access.resource;
+                attachment.write = access.write;
+                attachment.load = LoadAction::Load;
+                if (access.write && access.mode == WriteMode::Overwrite)
+                    attachment.load = LoadAction::DontCare;
+                else if (access.write && position == resource.firstUse && !resource.preserve)
+                    attachment.load = LoadAction::Clear;
+                attachment.store = position == resource.lastUse && !resource.output ? StoreAction::Discard : StoreAction::Store;
+                compiled.attachments.push_back(attachment);
+            }
+        }
+
+        for (const GraphAttachment& attachment : compiled.attachments)
+        {
+            if (attachment.load == LoadAction::Clear) ++m_Stats.clears;
+            if (attachment.store == StoreAction::Discard) ++m_Stats.discards;
+        }
+        m_Compiled.push_back(std::move(compiled));
+    }
+
+    m_Stats.culledPasses = passCount - order.size();
+    m_Stats.compileMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return true;
+}
+
+size_t RenderGraph::Validate() const
+{
+    size_t violations = 0;
+
+    // Совмещённые цели: одно описание, жизни не пересекаются
+    for (GraphResource a = 0; a < m_Resources.size(); ++a)
+    {
+        for (GraphResource b = a + 1; b < m_Resources.size(); ++b)
+        {
+            const Resource& first = m_Resources[a];
+            const Resource& second = m_Resources[b];
+            if (first.physical == ~0u || first.physical != second.physical) continue;
+            if (!first.desc.Compatible(second.desc)) ++violations;
+            if (first.firstUse <= second.lastUse && second.firstUse <= first.lastUse) ++violations;
+        }
+    }
+
+    // Временную цель сначала пишут, потом читают; первая запись её не загружает
+    std::vector<bool> written(m_Resources.size(), false);
+    for (const CompiledPass& pass : m_Compiled)
+    {
+        for (const GraphAttachment& attachment : pass.attachments)
+        {
+            const Resource& resource = m_Resources[attachment.resource];
+            if (!resource.imported && !written[attachment.resource] && (!attachment.write || attachment.load == LoadAction::Load)) ++violations;
+        }
+        for (const GraphAttachment& attachment : pass.attachments)
+        {
+            if (attachment.write) written[attachment.resource] = true;
+        }
+    }
+    return violations;
+}
+
+RenderGraphBenchmark BenchmarkRenderGraph(uint32_t width, uint32_t height, size_t compileCount)
+{
+    // Коды DXGI_FORMAT; граф их только сравнивает
+    const uint32_t Rgba16f = 10, R11G11B10 = 26, Rgba8 = 28, Rg16f = 34, D32 = 40, R32 = 41, R8 = 61;
+    auto desc = [](uint32_t w, uint32_t h, uint32_t format, uint32_t bytes)
+    {
+        GraphTextureDesc result;
+        result.width = std::max(1u, w);
+        result.height = std::max(1u, h);
+        result.format = format;
+        result.bytesPerSample = bytes;
+        return result;
+    };
+
+    RenderGraph graph;
+    auto build = [&]()
+    {
+        graph.Reset();
+        const GraphResource backBuffer = graph.ImportTexture("back buffer", desc(width, height, Rgba8, 4));
+
+        // Выход объявлен раньше, чем то, из чего он получается: порядок восстановит Compile
+        const GraphResource ldr = graph.CreateTexture("ldr", desc(width, height, Rgba8, 4));
+        RenderGraph::PassBuilder fxaa = graph.AddPass("fxaa", nullptr);
+        fxaa.Read(ldr);
+        fxaa.Write(backBuffer, WriteMode::Overwrite);
+
+        const GraphResource depth = graph.CreateTexture("depth", desc(width, height, D32, 4));
+        graph.AddPass("depth prepass", nullptr).Write(depth);
+
+        // Каскады рисуются по одному и сразу проецируются в маску тени — карты совмещаются
+        const GraphResource shadowMask = graph.CreateTexture("shadow mask", desc(width, height, R8, 1));
+        for (int cascade = 0; cascade < 4; ++cascade)
+        {
+            const GraphResource shadow = graph.CreateTexture("shadow cascade", desc(2048, 2048, D32, 4));
+            graph.AddPass("shadow cascade", nullptr).Write(shadow);
+            RenderGraph::PassBuilder mask = graph.AddPass("shadow mask", nullptr);
+            mask.Read(shadow);
+            mask.Read(depth);
+            mask.Write(shadowMask);
+        }
+
+        const GraphResource albedo = graph.CreateTexture("albedo", desc(width, height, Rgba8, 4));
+        const GraphResource normals = graph.CreateTexture("normals", desc(width, height, Rgba16f, 8));
+        const GraphResource material = graph.CreateTexture("material", desc(width, height, Rgba8, 4));
+        RenderGraph::PassBuilder gbuffer = graph.AddPass("gbuffer", nullptr);
+        gbuffer.Write(depth);
+        gbuffer.Write(albedo);
+        gbuffer.Write(normals);
+        gbuffer.Write(material);
+
+        // Векторы движения без TAA никто не читает
+        const GraphResource velocity = graph.CreateTexture("velocity", desc(width, height, Rg16f, 4));
+        RenderGraph::PassBuilder motion = graph.AddPass("velocity", nullptr);
+        motion.Read(depth);
+        motion.Write(velocity);
+
+        const GraphResource ao = graph.CreateTexture("ssao", desc(width / 2, height / 2, R8, 1));
+        RenderGraph::PassBuilder ssao = graph.AddPass("ssao", nullptr);
+        ssao.Read(depth);
+        ssao.Read(normals);
+        ssao.Write(ao, WriteMode::Overwrite);
+        const GraphResource aoBlurred = graph.CreateTexture("ssao blurred", desc(width / 2, height / 2, R8, 1));
+        RenderGraph::PassBuilder blur = graph.AddPass("ssao blur", nullptr);
+        blur.Read(ao);
+        blur.Write(aoBlurred, WriteMode::Overwrite);
+
+        const GraphResource hdr = graph.CreateTexture("hdr", desc(width, height, Rgba16f, 8));
+        RenderGraph::PassBuilder lighting = graph.AddPass("lighting", nullptr);
+        for (GraphResource input : { albedo, normals, material, aoBlurred, shadowMask, depth })
+            lighting.Read(input);
+        lighting.Write(hdr, WriteMode::Overwrite);
+        RenderGraph::PassBuilder sky = graph.AddPass("sky", nullptr);
+        sky.Read(depth);
+        sky.Write(hdr);
+
+        const GraphResource debug = graph.CreateTexture("debug normals", desc(width, height, Rgba8, 4));
+        RenderGraph::PassBuilder debugView = graph.AddPass("debug normals", nullptr);
+        debugView.Read(normals);
+        debugView.Write(debug, WriteMode::Overwrite);
+
+        // Гистограмма яркости уходит на CPU для экспозиции
+        const GraphResource histogram = graph.CreateTexture("histogram", desc(256, 1, R32, 4));
+        RenderGraph::PassBuilder luminance = graph.AddPass("luminance histogram", nullptr);
+        luminance.Read(hdr);
+        luminance.Write(histogram, WriteMode::Overwrite);
+        luminance.SideEffect();
+
+        // Bloom: вниз по половинам, затем вверх с добавлением уровня
+        GraphResource down[5];
+        GraphResource source = hdr;
+        for (int level = 0; level < 5; ++level)
+        {
+            down[level] = graph.CreateTexture("bloom down", desc(width >> (level + 1), height >> (level + 1), R11G11B10, 4));
+            RenderGraph::PassBuilder pass = graph.AddPass("bloom downsample", nullptr);
+            pass.Read(source);
+            pass.Write(down[level], WriteMode::Overwrite);
+            source = down[level];
+        }
+        for (int level = 3; level >= 0; --level)
+        {
+            const GraphResource up = graph.CreateTexture("bloom up", desc(width >> (level + 1), height >> (level + 1), R11G11B10, 4));
+            RenderGraph::PassBuilder pass = graph.AddPass("bloom upsample", nullptr);
+            pass.Read(source);
+            pass.Read(down[level]);
+            pass.Write(up, WriteMode::Overwrite);
+            source = up;
+        }
+
+        RenderGraph::PassBuilder tonemap = graph.AddPass("tonemap", nullptr);
+        tonemap.Read(hdr);
+        tonemap.Read(source);
+        tonemap.Write(ldr, WriteMode::Overwrite);
+
+        graph.AddPass("ui", nullptr).Write(backBuffer);
+    };
+
+    RenderGraphBenchmark result;
+    const Clock::time_point start = Clock::now();
+    bool compiled = true;
+    compileCount = std::max<size_t>(1, compileCount);
+    for (size_t i = 0; i < compileCount; ++i)
+    {
+        build();
+        compiled = graph.Compile() && compiled;
+    }
+    result.compileUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / compileCount;
+
+    const RenderGraphStats& stats = graph.Stats();
+    result.passes = stats.passes;
+    result.culledPasses = stats.culledPasses;
+    result.transientResources = stats.transientResources;
+    result.physicalResources = stats.physicalResources;
+    result.transientBytes = stats.transientBytes;
+    result.physicalBytes = stats.physicalBytes;
+    result.clears = stats.clears;
+    result.discards = stats.discards;
+    result.violations = compiled ? graph.Validate() : 1;
+    for (const CompiledPass& pass : graph.Passes())
+        result.order.push_back(graph.PassName(pass.pass));
+    for (uint32_t pass = 0; pass < stats.passes; ++pass)
+    {
+        if (graph.Culled(pass)) result.culled.push_back(graph.PassName(pass));
+    }
+    return result;
+}
@@ -0,0 +1,209 @@
+﻿#pragma once
+
+// Граф кадра: проходы объявляют, какие цели читают и пишут, а Compile по этим
+// объявлениям
+//   - отбрасывает проходы, результат которых никто не читает;
+//   - упорядочивает оставшиеся по зависимостям (при равенстве — в порядке объявления);
+//   - считает время жизни временных целей и раздаёт им физические цели так, что
+//     цели с одинаковым описанием и непересекающимся временем жизни делят одну;
+//   - выбирает, что делать с целью в начале и в конце прохода: загрузить,
+//     очистить или не трогать содержимое; сохранить или выбросить.
+// Сам граф не знает D3D: формат — просто число, физические цели создаёт и
+// очищает вызывающий (main.cpp), поэтому Compile проверяется где угодно.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "VectorMath.h"
+
+struct GraphTextureDesc
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t format = 0;        // DXGI_FORMAT у вызывающего; граф только сравнивает
+    uint32_t sampleCount = 1;
+    uint32_t bytesPerSample = 4; // для подсчёта памяти: цвет и глубина вместе, если они в одной цели
+    Math::Float4 clearColor = Math::Float4(0.0f, 0.0f, 0.0f, 0.0f); // на совместимость не влияет
+
+    uint64_t SizeBytes() const { return (uint64_t)width * height * sampleCount * bytesPerSample; }
+
+    // Цели можно совместить, только если одну физическую можно выдать за обе
+    bool Compatible(const GraphTextureDesc& other) const
+    {
+        return width == other.width && height == other.height && format == other.format &&
+            sampleCount == other.sampleCount && bytesPerSample == other.bytesPerSample;
+    }
+};
+
+typedef uint32_t GraphResource;
+static const GraphResource InvalidGraphResource = ~0u;
+
+// Что делать с содержимым цели перед проходом
+enum class LoadAction
+{
+    Load,     // нужно то, что записали раньше
+    Clear,    // первая запись рисует не всё — сначала очистить
+    DontCare, // первая запись перекрывает всё — прежнее содержимое не нужно
+};
+
+// Что делать после прохода
+enum class StoreAction
+{
+    Store,   // содержимое ещё прочитают (или цель внешняя)
+    Discard, // это было последнее использование
+};
+
+// Как проход пишет в цель
+enum class WriteMode
+{
+    Partial,   // рисует не каждый пиксель (сцена) — перед первой записью нужна очистка
+    Overwrite, // полноэкранный проход или копия — очистка не нужна
+};
+
+struct GraphAttachment
+{
+    GraphResource resource = InvalidGraphResource;
+    bool write = false;
+    LoadAction load = LoadAction::Load;
+    StoreAction store = StoreAction::Store;
+};
+
+struct CompiledPass
+{
+    uint32_t pass = 0; // номер в порядке объявления
+    std::vector<GraphAttachment> attachments; // сначала чтения, затем записи
+};
+
+struct RenderGraphStats
+{
+    size_t passes = 0;            // объявлено
+    size_t culledPasses = 0;
+    size_t transientResources = 0; // временных целей, которые кто-то использует
+    size_t physicalResources = 0;
+    uint64_t transientBytes = 0;  // если бы у каждой временной цели была своя
+    uint64_t physicalBytes = 0;   // после совмещения
+    size_t clears = 0;
+    size_t discards = 0;
+    double compileMs = 0.0;
+
+    uint64_t SavedBytes() const { return transientBytes - physicalBytes; }
+};
+
+class RenderGraph
+{
+public:
+    typedef std::function<void()> ExecuteFn;
+
+    // Объявление одного прохода; действительно до следующего AddPass
+    class PassBuilder
+    {
+    public:
+        PassBuilder(RenderGraph& graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+
+        void Read(GraphResource resource);
+        void Write(GraphResource resource, WriteMode mode = WriteMode::Partial);
+        void SideEffect(); // результат уходит за пределы графа (чтение на CPU) — не отбрасывать
+
+    private:
+        RenderGraph& m_Graph;
+        uint32_t m_Pass;
+    };
+
+    void Reset();
+
+    // Временная цель: её время жизни — от первого до последнего прохода, который её использует
+    GraphResource CreateTexture(const char* name, const GraphTextureDesc& desc);
+
+    // Внешняя цель (back buffer, цель вызывающего): не совмещается, в конце сохраняется;
+    // preserveContents — первый проход загружает прежнее содержимое, а не очищает
+    GraphResource ImportTexture(const char* name, const GraphTextureDesc& desc, bool preserveContents = false);
+
+    // Проходы, которые в итоге пишут в эту цель, не отбрасываются; внешние цели — выход всегда
+    void MarkOutput(GraphResource resource);
+
+    PassBuilder AddPass(const char* name, ExecuteFn execute);
+
+    // false — цикл в зависимостях или ссылка на несуществующую цель; граф тогда не исполняется
+    bool Compile();
+
+    // Порядок исполнения и действия с целями; пусто до Compile
+    const std::vector<CompiledPass>& Passes() const { return m_Compiled; }
+    void Run(const CompiledPass& pass) const { if (m_Passes[pass.pass].execute) m_Passes[pass.pass].execute(); }
+
+    size_t ResourceCount() const { return m_Resources.size(); }
+    const GraphTextureDesc& Desc(GraphResource resource) const { return m_Resources[resource].desc; }
+    const std::string& Name(GraphResource resource) const { return m_Resources[resource].name; }
+    bool Imported(GraphResource resource) const { return m_Resources[resource].imported; }
+
+    // Физическая цель временной; ~0u — внешняя или никем не используемая
+    uint32_t Physical(GraphResource resource) const { return m_Resources[resource].physical; }
+    size_t PhysicalCount() const { return m_PhysicalDescs.size(); }
+    const GraphTextureDesc& PhysicalDesc(uint32_t physical) const { return m_PhysicalDescs[physical]; }
+
+    const std::string& PassName(uint32_t pass) const { return m_Passes[pass].name; }
+    bool Culled(uint32_t pass) const { return m_Passes[pass].culled; }
+    const RenderGraphStats& Stats() const { return m_Stats; }
+
+    // Самопроверка результата Compile: у совмещённых целей одно описание и
+    // непересекающиеся времена жизни, каждое чтение — после записи. Число нарушений
+    size_t Validate() const;
+
+private:
+    struct Access
+    {
+        GraphResource resource;
+        bool write;
+        WriteMode mode;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        ExecuteFn execute;
+        std::vector<Access> accesses;
+        bool sideEffect = false;
+        bool culled = false;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        GraphTextureDesc desc;
+        bool imported = false;
+        bool preserve = false;
+        bool output = false;
+        uint32_t physical = ~0u;
+        uint32_t firstUse = ~0u; // позиции в порядке исполнения
+        uint32_t lastUse = 0;
+    };
+
+    std::vector<Pass> m_Passes;
+    std::vector<Resource> m_Resources;
+    std::vector<CompiledPass> m_Compiled;
+    std::vector<GraphTextureDesc> m_PhysicalDescs;
+    RenderGraphStats m_Stats;
+};
+
+struct RenderGraphBenchmark
+{
+    size_t passes = 0;
+    size_t culledPasses = 0;
+    size_t transientResources = 0;
+    size_t physicalResources = 0;
+    uint64_t transientBytes = 0;
+    uint64_t physicalBytes = 0;
+    size_t clears = 0;
+    size_t discards = 0;
+    double compileUs = 0.0;  // среднее на одно объявление графа вместе с Compile
+    size_t violations = 0;   // Validate
+    std::vector<std::string> order;  // исполняемые проходы
+    std::vector<std::string> culled;
+};
+
+// Типичный отложенный кадр width x height: тени, предварительная глубина,
+// G-буфер, SSAO, освещение, цепочка bloom, тонмаппинг, FXAA, интерфейс и пара
+// отладочных проходов, которые никто не читает
+RenderGraphBenchmark BenchmarkRenderGraph(uint32_t width, uint32_t height, size_t compileCount);
@@ -0,0 +1,150 @@
+﻿#include "RenderQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    uint64_t Field(uint32_t value, uint32_t bits, uint32_t shift)
+    {
+        return ((uint64_t)value & ((1ull << bits) - 1)) << shift;
+    }
+
+    struct DrawState
+    {
+        uint32_t shader;
+        uint32_t material;
+        uint32_t mesh;
+    };
+
+    size_t CountStateChanges(const std::vector<DrawItem>& items, const std::vector<DrawState>& states)
+    {
+        size_t changes = 0;
+        const DrawState* pPrevious = nullptr;
+        for (const DrawItem& item : items)
+        {
+            const DrawState& state = states[item.payload];
+            if (!pPrevious || state.shader != pPrevious->shader) ++changes;
+            if (!pPrevious || state.material != pPrevious->material) ++changes;
+            if (!pPrevious || state.mesh != pPrevious->mesh) ++changes;
+            pPrevious = &state;
+        }
+        return changes;
+    }
+}
+
+uint32_t SortKey::QuantizeDepth(float depth)
+{
+    if (!(depth > 0.0f)) return 0; // отрицательные и NaN — в самое начало
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits >> (32 - DepthBits);
+}
+
+uint64_t SortKey::Opaque(uint32_t shader, uint32_t material, uint32_t mesh, float depth)
+{
+    return Field((uint32_t)RenderPass::Opaque, 2, 62) |
+           Field(shader, ShaderBits, 54) |
+           Field(material, MaterialBits, 40) |
+           Field(mesh, MeshBits, 24) |
+           Field(QuantizeDepth(depth), DepthBits, 0);
+}
+
+uint64_t SortKey::Transparent(uint32_t shader, uint32_t material, uint32_t mesh, float depth)
+{
+    const uint32_t invertedDepth = ((1u << DepthBits) - 1) - QuantizeDepth(depth);
+    return Field((uint32_t)RenderPass::Transparent, 2, 62) |
+           Field(invertedDepth, DepthBits, 38) |
+           Field(shader, ShaderBits, 30) |
+           Field(material, MaterialBits, 16) |
+           Field(mesh, MeshBits, 0);
+}
+
+double RenderQueue::Sort()
+{
+    const Clock::time_point start = Clock::now();
+    const size_t count = m_Items.size();
+
+    if (count > 1)
+    {
+        // Гистограммы всех разрядов — за один проход по данным
+        static const int DigitBits = 11;
+        static const int Digits = (64 + DigitBits - 1) / DigitBits;
+        static const uint32_t Buckets = 1u << DigitBits;
+        static const uint64_t DigitMask = Buckets - 1;
+
+        std::vector<uint32_t> histograms(Digits * Buckets, 0u);
+        for (const DrawItem& item : m_Items)
+        {
+            for (int digit = 0; digit < Digits; ++digit)
+                ++histograms[digit * Buckets + ((item.key >> (digit * DigitBits)) & DigitMask)];
+        }
+
+        m_Scratch.resize(count);
+        DrawItem* pSource = m_Items.data();
+        DrawItem* pTarget = m_Scratch.data();
+        for (int digit = 0; digit < Digits; ++digit)
+        {
+            const int shift = digit * DigitBits;
+            uint32_t* histogram = &histograms[digit * Buckets];
+            if (histogram[(pSource[0].key >> shift) & DigitMask] == count) continue; // разряд одинаков у всех
+
+            uint32_t offset = 0;
+            for (uint32_t bucket = 0; bucket < Buckets; ++bucket)
+            {
+                const uint32_t size = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += size;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+                pTarget[histogram[(pSource[i].key >> shift) & DigitMask]++] = pSource[i];
+            std::swap(pSource, pTarget);
+        }
+
+        if (pSource != m_Items.data()) m_Items.swap(m_Scratch);
+    }
+
+    m_LastSortMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return m_LastSortMs;
+}
+
+SortBenchmark BenchmarkRenderQueue(size_t drawCount, uint32_t shaderCount, uint32_t materialCount, uint32_t meshCount)
+{
+    SortBenchmark result;
+    result.draws = drawCount;
+    if (drawCount == 0) return result;
+
+    std::mt19937 random(12345);
+    std::vector<DrawState> states(drawCount);
+    RenderQueue queue;
+    queue.Reserve(drawCount);
+    for (size_t i = 0; i < drawCount; ++i)
+    {
+        DrawState& state = states[i];
+        state.shader = random() % std::max(1u, shaderCount);
+        state.material = random() % std::max(1u, materialCount);
+        state.mesh = random() % std::max(1u, meshCount);
+        const float depth = 0.1f + (random() % 100000) * 0.001f;
+
+        // Каждая десятая отрисовка — прозрачная
+        const uint64_t key = i % 10 == 0 ? SortKey::Transparent(state.shader, state.material, state.mesh, depth)
+                                         : SortKey::Opaque(state.shader, state.material, state.mesh, depth);
+        queue.Push(key, (uint32_t)i);
+    }
+
+    result.unsortedStateChanges = CountStateChanges(queue.Items(), states);
+
+    std::vector<DrawItem> copy = queue.Items();
+    const Clock::time_point start = Clock::now();
+    std::sort(copy.begin(), copy.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+    result.stdSortMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    result.radixSortMs = queue.Sort();
+    result.sortedStateChanges = CountStateChanges(queue.Items(), states);
+    return result;
+}
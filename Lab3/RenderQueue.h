@@ -0,0 +1,90 @@
+﻿#pragma once
+
+// Очередь отрисовки: каждая отрисовка кодирует своё состояние в 64-битный ключ,
+// очередь сортируется поразрядно, и соседние отрисовки чаще всего разделяют
+// шейдер, материал и меш — их не приходится перепривязывать.
+//
+// Раскладка ключа, от старших битов к младшим:
+//   непрозрачные: проход(2) | шейдер(8) | материал(14) | меш(16) | глубина(24), ближние раньше
+//   прозрачные:   проход(2) | обратная глубина(24) | шейдер(8) | материал(14) | меш(16), дальние раньше
+// Прозрачным порядок по глубине важнее состояния: иначе смешивание даст неверную картинку.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class RenderPass : uint32_t
+{
+    Opaque = 0,
+    Transparent = 1,
+};
+
+namespace SortKey
+{
+    const uint32_t ShaderBits = 8;
+    const uint32_t MaterialBits = 14;
+    const uint32_t MeshBits = 16;
+    const uint32_t DepthBits = 24;
+
+    // Глубина (расстояние вдоль взгляда, >= 0) -> 24 бита с сохранением порядка.
+    // Берутся старшие биты представления float: для неотрицательных чисел оно монотонно
+    uint32_t QuantizeDepth(float depth);
+
+    uint64_t Opaque(uint32_t shader, uint32_t material, uint32_t mesh, float depth);
+    uint64_t Transparent(uint32_t shader, uint32_t material, uint32_t mesh, float depth);
+
+    inline RenderPass Pass(uint64_t key) { return (RenderPass)(key >> 62); }
+}
+
+struct DrawItem
+{
+    uint64_t key;
+    uint32_t payload; // индекс отрисовки у вызывающего
+};
+
+class RenderQueue
+{
+public:
+    void Clear() { m_Items.clear(); }
+    void Reserve(size_t count) { m_Items.reserve(count); m_Scratch.reserve(count); }
+    void Push(uint64_t key, uint32_t payload) { m_Items.push_back(DrawItem{ key, payload }); }
+
+    // Поразрядная сортировка по 11-битным разрядам ключа (LSD, устойчивая, 6 проходов);
+    // разряды, одинаковые у всех элементов, пропускаются. Возвращает время в миллисекундах
+    double Sort();
+
+    const std::vector<DrawItem>& Items() const { return m_Items; }
+    size_t CapacityBytes() const { return (m_Items.capacity() + m_Scratch.capacity()) * sizeof(DrawItem); }
+    size_t Size() const { return m_Items.size(); }
+    double LastSortMs() const { return m_LastSortMs; }
+
+private:
+    std::vector<DrawItem> m_Items;
+    std::vector<DrawItem> m_Scratch;
+    double m_LastSortMs = 0.0;
+};
+
+// Счётчики смен состояния при отправке отсортированной очереди
+struct RenderQueueStats
+{
+    size_t draws = 0;
+    size_t passChanges = 0;
+    size_t shaderChanges = 0;
+    size_t materialChanges = 0;
+    size_t meshChanges = 0;
+    double sortMs = 0.0;
+
+    size_t StateChanges() const { return passChanges + shaderChanges + materialChanges + meshChanges; }
+};
+
+struct SortBenchmark
+{
+    size_t draws = 0;
+    double radixSortMs = 0.0;
+    double stdSortMs = 0.0;
+    size_t unsortedStateChanges = 0;
+    size_t sortedStateChanges = 0;
+};
+
+// Синтетическая сцена из drawCount отрисовок со случайными шейдером, материалом, мешем и глубиной
+SortBenchmark BenchmarkRenderQueue(size_t drawCount, uint32_t shaderCount, uint32_t materialCount, uint32_t meshCount);
@@ -0,0 +1,167 @@
+﻿#include "RenderTarget.h"
+
+HRESULT CreateRenderTarget(ID3D11Device* pDevice, UINT width, UINT height, DXGI_FORMAT format, RenderTarget& target, UINT sampleCount)
+{
+    target = RenderTarget();
+
+    D3D11_TEXTURE2D_DESC td = {};
+    td.Width = width;
+    td.Height = height;
+    td.MipLevels = 1;
+    td.ArraySize = 1;
+    td.Format = format;
+    td.SampleDesc.Count = sampleCount;
+    td.SampleDesc.Quality = 0;
+    td.Usage = D3D11_USAGE_DEFAULT;
+    td.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+    td.CPUAccessFlags = 0;
+
+    HRESULT hr = pDevice->CreateTexture2D(&td, nullptr, target.pTexture.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    hr = pDevice->CreateRenderTargetView(target.pTexture.Get(), nullptr, target.pRenderTargetView.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    hr = pDevice->CreateShaderResourceView(target.pTexture.Get(), nullptr, target.pShaderResourceView.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    hr = CreateDepthBuffer(pDevice, width, height, target.pDepthStencilView, sampleCount);
+    if (FAILED(hr)) return hr;
+
+    target.width = width;
+    target.height = height;
+    target.format = format;
+    target.sampleCount = sampleCount;
+    target.sizeBytes = (uint64_t)width * height * sampleCount * (FormatBytesPerPixel(format) + FormatBytesPerPixel(DXGI_FORMAT_D24_UNORM_S8_UINT));
+    return S_OK;
+}
+
+UINT FormatBytesPerPixel(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R32G32B32A32_FLOAT: return 16;
+    case DXGI_FORMAT_R16G16B16A16_FLOAT: return 8;
+    case DXGI_FORMAT_R8_UNORM: return 1;
+    case DXGI_FORMAT_R8G8_UNORM:
+    case DXGI_FORMAT_R16_FLOAT: return 2;
+    default: return 4;
+    }
+}
+
+HRESULT CreateDepthBuffer(ID3D11Device* pDevice, UINT width, UINT height, Microsoft::WRL::ComPtr<ID3D11DepthStencilView>& depthStencilView, UINT sampleCount)
+{
+    depthStencilView.Reset();
+
+    D3D11_TEXTURE2D_DESC td = {};
+    td.Width = width;
+    td.Height = height;
+    td.MipLevels = 1;
+    td.ArraySize = 1;
+    td.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+    td.SampleDesc.Count = sampleCount;
+    td.SampleDesc.Quality = 0;
+    td.Usage = D3D11_USAGE_DEFAULT;
+    td.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+    td.CPUAccessFlags = 0;
+
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> pDepth;
+    HRESULT hr = pDevice->CreateTexture2D(&td, nullptr, pDepth.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    return pDevice->CreateDepthStencilView(pDepth.Get(), nullptr, depthStencilView.GetAddressOf());
+}
+
+HRESULT ReadbackRing::Init(ID3D11Device* pDevice, UINT width, UINT height, DXGI_FORMAT format, UINT slotCount)
+{
+    Reset();
+
+    D3D11_TEXTURE2D_DESC td = {};
+    td.Width = width;
+    td.Height = height;
+    td.MipLevels = 1;
+    td.ArraySize = 1;
+    td.Format = format;
+    td.SampleDesc.Count = 1;
+    td.Usage = D3D11_USAGE_STAGING;
+    td.BindFlags = 0;
+    td.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+    m_Slots.resize(slotCount);
+    for (Slot& slot : m_Slots)
+    {
+        HRESULT hr = pDevice->CreateTexture2D(&td, nullptr, slot.pStaging.GetAddressOf());
+        if (FAILED(hr))
+        {
+            Reset();
+            return hr;
+        }
+    }
+
+    m_Width = width;
+    m_Height = height;
+    m_SizeBytes = (uint64_t)width * height * FormatBytesPerPixel(format) * slotCount;
+    return S_OK;
+}
+
+void ReadbackRing::Reset()
+{
+    m_Slots.clear();
+    m_Head = 0;
+    m_InFlight = 0;
+    m_Failures = 0;
+    m_LastError = S_OK;
+    m_Width = 0;
+    m_Height = 0;
+    m_SizeBytes = 0;
+}
+
+void ReadbackRing::Enqueue(ID3D11DeviceContext* pContext, ID3D11Texture2D* pSource, UINT frameIndex)
+{
+    if (!CanEnqueue()) return;
+
+    Slot& slot = m_Slots[(m_Head + m_InFlight) % m_Slots.size()];
+    pContext->CopyResource(slot.pStaging.Get(), pSource);
+    slot.frameIndex = frameIndex;
+    ++m_InFlight;
+}
+
+UINT ReadbackRing::Poll(ID3D11DeviceContext* pContext, bool wait, const ReadyCallback& onReady)
+{
+    UINT completed = 0;
+    while (m_InFlight > 0)
+    {
+        Slot& slot = m_Slots[m_Head];
+
+        D3D11_MAPPED_SUBRESOURCE mapped = {};
+        const bool block = wait && completed == 0;
+        HRESULT hr = pContext->Map(slot.pStaging.Get(), 0, D3D11_MAP_READ, block ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+        if (hr == DXGI_ERROR_WAS_STILL_DRAWING) break; // слоты завершаются по порядку, дальше ждать нечего
+        if (FAILED(hr))
+        {
+            // Иначе слот остался бы в полёте навсегда, а Enqueue молча терял бы кадры
+            ++m_Failures;
+            m_LastError = hr;
+        }
+        else
+        {
+            onReady(slot.frameIndex, mapped);
+            pContext->Unmap(slot.pStaging.Get(), 0);
+            ++completed;
+        }
+
+        m_Head = (m_Head + 1) % (UINT)m_Slots.size();
+        --m_InFlight;
+    }
+    return completed;
+}
+
+void ReadbackRing::Drain(ID3D11DeviceContext* pContext, const ReadyCallback& onReady)
+{
+    while (m_InFlight > 0)
+    {
+        const UINT inFlight = m_InFlight;
+        Poll(pContext, true, onReady);
+        if (m_InFlight == inFlight) break; // блокирующий Map не продвинулся
+    }
+}
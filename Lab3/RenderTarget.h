@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Внеэкранная цель рендеринга произвольного размера и формата (с буфером глубины).
+// При sampleCount > 1 цель многовыборочная: её нужно разрешить (ResolveSubresource)
+// в обычную текстуру, прежде чем читать или копировать
+struct RenderTarget
+{
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> pTexture;
+    Microsoft::WRL::ComPtr<ID3D11RenderTargetView> pRenderTargetView;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> pShaderResourceView;
+    Microsoft::WRL::ComPtr<ID3D11DepthStencilView> pDepthStencilView;
+    UINT width = 0;
+    UINT height = 0;
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    UINT sampleCount = 1;
+    uint64_t sizeBytes = 0; // цвет и глубина со всеми выборками
+};
+
+// Байт на пиксель для форматов целей и глубины, которые здесь создаются; прочие считаются как 4
+UINT FormatBytesPerPixel(DXGI_FORMAT format);
+
+HRESULT CreateRenderTarget(ID3D11Device* pDevice, UINT width, UINT height, DXGI_FORMAT format, RenderTarget& target, UINT sampleCount = 1);
+HRESULT CreateDepthBuffer(ID3D11Device* pDevice, UINT width, UINT height, Microsoft::WRL::ComPtr<ID3D11DepthStencilView>& depthStencilView, UINT sampleCount = 1);
+
+// Асинхронное чтение кадров с GPU через кольцо staging-текстур.
+// Enqueue копирует цель в свободный слот, Poll отдаёт слоты, которые GPU
+// уже дописал, не дожидаясь остальных — рендер не стоит на Map.
+class ReadbackRing
+{
+public:
+    typedef std::function<void(UINT frameIndex, const D3D11_MAPPED_SUBRESOURCE& mapped)> ReadyCallback;
+
+    HRESULT Init(ID3D11Device* pDevice, UINT width, UINT height, DXGI_FORMAT format, UINT slotCount);
+    void Reset();
+
+    bool CanEnqueue() const { return m_InFlight < m_Slots.size(); }
+    UINT InFlight() const { return m_InFlight; }
+    UINT Failures() const { return m_Failures; }   // слоты, снятые из-за ошибки Map: их кадры потеряны
+    HRESULT LastError() const { return m_LastError; }
+    UINT Width() const { return m_Width; }
+    UINT Height() const { return m_Height; }
+    uint64_t SizeBytes() const { return m_SizeBytes; } // все staging-текстуры
+
+    void Enqueue(ID3D11DeviceContext* pContext, ID3D11Texture2D* pSource, UINT frameIndex);
+
+    // Забирает готовые слоты по порядку. wait = true — блокироваться на самом
+    // старом слоте, чтобы гарантированно освободить хотя бы один. Слот, который
+    // Map не смог прочитать, освобождается без onReady и считается в Failures
+    UINT Poll(ID3D11DeviceContext* pContext, bool wait, const ReadyCallback& onReady);
+    void Drain(ID3D11DeviceContext* pContext, const ReadyCallback& onReady);
+
+private:
+    struct Slot
+    {
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> pStaging;
+        UINT frameIndex = 0;
+    };
+
+    std::vector<Slot> m_Slots;
+    UINT m_Head = 0;     // самый старый слот в полёте
+    UINT m_InFlight = 0;
+    UINT m_Failures = 0;
+    HRESULT m_LastError = S_OK;
+    UINT m_Width = 0;
+    UINT m_Height = 0;
+    uint64_t m_SizeBytes = 0;
+};
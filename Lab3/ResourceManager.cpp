@@ -0,0 +1,315 @@
+﻿#include "ResourceManager.h"
+
+#include <thread>
+
+HRESULT FrameFence::Init(ID3D11Device* pDevice, UINT maxFramesInFlight)
+{
+    Reset();
+
+    D3D11_QUERY_DESC qd = {};
+    qd.Query = D3D11_QUERY_EVENT;
+    qd.MiscFlags = 0;
+
+    m_Queries.resize(maxFramesInFlight);
+    for (Microsoft::WRL::ComPtr<ID3D11Query>& query : m_Queries)
+    {
+        HRESULT hr = pDevice->CreateQuery(&qd, query.GetAddressOf());
+        if (FAILED(hr))
+        {
+            Reset();
+            return hr;
+        }
+    }
+    return S_OK;
+}
+
+void FrameFence::Reset()
+{
+    m_Queries.clear();
+    m_Pending.clear();
+    m_NextQuery = 0;
+    m_CompletedFrame = 0;
+    m_Lost = false;
+}
+
+void FrameFence::Lose()
+{
+    m_Lost = true;
+    if (!m_Pending.empty()) m_CompletedFrame = m_Pending.back().frameIndex;
+    m_Pending.clear();
+}
+
+void FrameFence::Signal(ID3D11DeviceContext* pContext, uint64_t frameIndex)
+{
+    if (m_Queries.empty()) return;
+
+    // Все запросы заняты — ждём самый старый кадр, уступая ядро между опросами
+    while (!m_Lost && m_Pending.size() >= m_Queries.size())
+    {
+        const Pending& oldest = m_Pending.front();
+        const HRESULT hr = pContext->GetData(m_Queries[oldest.query].Get(), nullptr, 0, 0);
+        if (FAILED(hr))
+        {
+            Lose();
+            break;
+        }
+        if (hr == S_OK)
+        {
+            m_CompletedFrame = oldest.frameIndex;
+            m_Pending.pop_front();
+            continue;
+        }
+        std::this_thread::yield();
+    }
+    if (m_Lost)
+    {
+        m_CompletedFrame = frameIndex;
+        return;
+    }
+
+    Pending pending = { frameIndex, m_NextQuery };
+    pContext->End(m_Queries[m_NextQuery].Get());
+    m_Pending.push_back(pending);
+    m_NextQuery = (m_NextQuery + 1) % (UINT)m_Queries.size();
+}
+
+uint64_t FrameFence::Poll(ID3D11DeviceContext* pContext)
+{
+    while (!m_Pending.empty())
+    {
+        const Pending& oldest = m_Pending.front();
+        const HRESULT hr = pContext->GetData(m_Queries[oldest.query].Get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH);
+        if (FAILED(hr))
+        {
+            Lose();
+            break;
+        }
+        if (hr != S_OK) break;
+
+        m_CompletedFrame = oldest.frameIndex;
+        m_Pending.pop_front();
+    }
+    return m_CompletedFrame;
+}
+
+HRESULT ResourceManager::Init(ID3D11Device* pDevice)
+{
+    Shutdown();
+
+    m_pDevice = pDevice;
+    m_VertexPool.bindFlags = D3D11_BIND_VERTEX_BUFFER;
+    m_IndexPool.bindFlags = D3D11_BIND_INDEX_BUFFER;
+    m_FrameIndex = 1;
+
+    return m_Fence.Init(pDevice, MaxFramesInFlight);
+}
+
+void ResourceManager::Shutdown()
+{
+    m_PendingReleases.RetireAll([](GpuBuffer&) {});
+    m_TransientTargets.Clear([this](const RenderTarget& target) { TrackGpu(MemoryCategory::Transient, target.sizeBytes, false); });
+    m_FreeConstantBuffers.clear();
+    TrackGpu(MemoryCategory::Constant, m_ConstantBytes, false);
+    m_ConstantBytes = 0;
+
+    for (GeometryPool* pPool : { &m_VertexPool, &m_IndexPool })
+    {
+        TrackGpu(MemoryCategory::Mesh, pPool->allocator.CapacityBytes(), false);
+        pPool->blocks.clear();
+        pPool->allocator.Reset();
+    }
+
+    m_Fence.Reset();
+    m_pDevice.Reset();
+}
+
+void ResourceManager::BeginFrame(ID3D11DeviceContext* pContext)
+{
+    uint64_t completedFrame = m_Fence.Poll(pContext);
+    m_PendingReleases.Retire(completedFrame, [this](GpuBuffer& buffer) { ReturnToPool(buffer); });
+}
+
+void ResourceManager::EndFrame(ID3D11DeviceContext* pContext)
+{
+    m_TransientTargets.EndFrame(m_FrameIndex, [this](const RenderTarget& target) { TrackGpu(MemoryCategory::Transient, target.sizeBytes, false); });
+    m_Fence.Signal(pContext, m_FrameIndex);
+    ++m_FrameIndex;
+}
+
+HRESULT ResourceManager::CreateBuffer(BufferKind kind, UINT size, const void* pInitialData, GpuBuffer& buffer)
+{
+    buffer = GpuBuffer();
+    if (size == 0) return E_INVALIDARG;
+
+    HRESULT hr = kind == BufferKind::Constant ? AllocateConstant(size, buffer) : AllocateGeometry(PoolFor(kind), size, buffer);
+    if (FAILED(hr)) return hr;
+
+    buffer.kind = kind;
+    buffer.size = size;
+
+    if (pInitialData)
+    {
+        Microsoft::WRL::ComPtr<ID3D11DeviceContext> pContext;
+        m_pDevice->GetImmediateContext(pContext.GetAddressOf());
+        UpdateBuffer(pContext.Get(), buffer, pInitialData, size);
+    }
+    return S_OK;
+}
+
+void ResourceManager::UpdateBuffer(ID3D11DeviceContext* pContext, const GpuBuffer& buffer, const void* pData, UINT size)
+{
+    if (!buffer.IsValid()) return;
+
+    if (buffer.kind == BufferKind::Constant)
+    {
+        pContext->UpdateSubresource(buffer.pBuffer.Get(), 0, nullptr, pData, 0, 0);
+        return;
+    }
+
+    D3D11_BOX box = {};
+    box.left = buffer.offset;
+    box.right = buffer.offset + size;
+    box.top = 0;
+    box.bottom = 1;
+    box.front = 0;
+    box.back = 1;
+    pContext->UpdateSubresource(buffer.pBuffer.Get(), 0, &box, pData, 0, 0);
+}
+
+void ResourceManager::Release(GpuBuffer& buffer)
+{
+    if (!buffer.IsValid()) return;
+
+    m_PendingReleases.Push(m_FrameIndex, buffer);
+    buffer = GpuBuffer();
+}
+
+RenderTarget* ResourceManager::AcquireTransientTarget(UINT width, UINT height, DXGI_FORMAT format, UINT sampleCount)
+{
+    TransientTargetKey key = { width, height, format, sampleCount };
+    RenderTarget* pTarget = m_TransientTargets.Acquire(key, m_FrameIndex);
+    if (pTarget) return pTarget;
+
+    RenderTarget target;
+    if (FAILED(CreateRenderTarget(m_pDevice.Get(), width, height, format, target, sampleCount))) return nullptr;
+    TrackGpu(MemoryCategory::Transient, target.sizeBytes, true);
+    return m_TransientTargets.Add(key, target, m_FrameIndex);
+}
+
+uint64_t ResourceManager::TrimTransientTargets()
+{
+    uint64_t freed = 0;
+    m_TransientTargets.Trim([this, &freed](const RenderTarget& target)
+    {
+        TrackGpu(MemoryCategory::Transient, target.sizeBytes, false);
+        freed += target.sizeBytes;
+    });
+    return freed;
+}
+
+uint64_t ResourceManager::TrimConstantBuffers()
+{
+    uint64_t freed = 0;
+    for (const auto& sizeClass : m_FreeConstantBuffers)
+        freed += (uint64_t)sizeClass.first * sizeClass.second.size();
+    m_FreeConstantBuffers.clear();
+
+    TrackGpu(MemoryCategory::Constant, freed, false);
+    m_ConstantBytes -= freed;
+    return freed;
+}
+
+void ResourceManager::TrackGpu(MemoryCategory category, uint64_t bytes, bool allocated)
+{
+    if (!m_pMemory || bytes == 0) return;
+    if (allocated) m_pMemory->Allocate(MemoryDomain::Gpu, category, bytes);
+    else m_pMemory->Free(MemoryDomain::Gpu, category, bytes);
+}
+
+ResourceStats ResourceManager::Stats() const
+{
+    ResourceStats stats;
+    for (const GeometryPool* pPool : { &m_VertexPool, &m_IndexPool })
+    {
+        stats.geometryBlocks += pPool->allocator.BlockCount();
+        stats.geometryCapacityBytes += pPool->allocator.CapacityBytes();
+        stats.geometryUsedBytes += pPool->allocator.UsedBytes();
+    }
+    for (const auto& sizeClass : m_FreeConstantBuffers)
+        stats.pooledConstantBuffers += sizeClass.second.size();
+    stats.pendingReleases = m_PendingReleases.Size();
+    stats.fenceLost = m_Fence.Lost();
+    stats.transientTargets = m_TransientTargets.Size();
+    return stats;
+}
+
+HRESULT ResourceManager::AllocateGeometry(GeometryPool& pool, UINT size, GpuBuffer& buffer)
+{
+    Suballocation allocation = pool.allocator.Allocate(size, GeometryAlignment);
+    if (!allocation.IsValid())
+    {
+        // Места нет — новый блок; крупный запрос получает блок под свой размер
+        UINT blockSize = GeometryBlockSize;
+        uint64_t roundedSize = BlockSuballocator::RoundedSize(size);
+        if (roundedSize > blockSize) blockSize = (UINT)roundedSize;
+
+        D3D11_BUFFER_DESC bd = {};
+        bd.Usage = D3D11_USAGE_DEFAULT;
+        bd.ByteWidth = blockSize;
+        bd.BindFlags = pool.bindFlags;
+        bd.CPUAccessFlags = 0;
+
+        Microsoft::WRL::ComPtr<ID3D11Buffer> pBlock;
+        HRESULT hr = m_pDevice->CreateBuffer(&bd, nullptr, pBlock.GetAddressOf());
+        if (FAILED(hr)) return hr;
+
+        pool.blocks.push_back(pBlock);
+        pool.allocator.AddBlock(blockSize);
+        TrackGpu(MemoryCategory::Mesh, blockSize, true);
+
+        allocation = pool.allocator.Allocate(size, GeometryAlignment);
+        if (!allocation.IsValid()) return E_OUTOFMEMORY;
+    }
+
+    buffer.pBuffer = pool.blocks[allocation.block];
+    buffer.offset = (UINT)allocation.offset;
+    buffer.allocation = allocation;
+    return S_OK;
+}
+
+HRESULT ResourceManager::AllocateConstant(UINT size, GpuBuffer& buffer)
+{
+    const UINT pooledSize = (UINT)AlignUp(size, 16);
+
+    std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>>& freeList = m_FreeConstantBuffers[pooledSize];
+    if (!freeList.empty())
+    {
+        buffer.pBuffer = freeList.back();
+        freeList.pop_back();
+        return S_OK;
+    }
+
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DEFAULT; // DEFAULT usage for UpdateSubresource
+    bd.ByteWidth = pooledSize;
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    bd.CPUAccessFlags = 0;
+
+    HRESULT hr = m_pDevice->CreateBuffer(&bd, nullptr, buffer.pBuffer.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    m_ConstantBytes += pooledSize;
+    TrackGpu(MemoryCategory::Constant, pooledSize, true);
+    return S_OK;
+}
+
+void ResourceManager::ReturnToPool(GpuBuffer& buffer)
+{
+    if (buffer.kind == BufferKind::Constant)
+    {
+        m_FreeConstantBuffers[(UINT)AlignUp(buffer.size, 16)].push_back(buffer.pBuffer);
+        return;
+    }
+
+    PoolFor(buffer.kind).allocator.Free(buffer.allocation);
+}
@@ -0,0 +1,156 @@
+﻿#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "BufferAllocator.h"
+#include "MemoryTracker.h"
+#include "RenderTarget.h"
+
+enum class BufferKind
+{
+    Vertex,
+    Index,
+    Constant,
+};
+
+// Буфер из пула. Вершины и индексы — кусок общего большого блока, привязывается
+// со смещением offset. Константы — отдельный буфер из пула по размеру (в D3D11.0
+// константный буфер нельзя привязать со смещением); его размер кратен 16 байтам,
+// и UpdateSubresource должен получать данные на весь буфер.
+struct GpuBuffer
+{
+    Microsoft::WRL::ComPtr<ID3D11Buffer> pBuffer;
+    UINT offset = 0;
+    UINT size = 0;
+    BufferKind kind = BufferKind::Vertex;
+    Suballocation allocation;
+
+    bool IsValid() const { return pBuffer.Get() != nullptr; }
+};
+
+// Ограда по номеру кадра: событийный запрос в конце каждого кадра.
+// Если в полёте уже maxFramesInFlight кадров, Signal ждёт самый старый.
+// Ошибка GetData (устройство потеряно) делает ограду потерянной: GPU больше
+// ничего не исполнит, поэтому все отмеченные кадры считаются завершёнными.
+class FrameFence
+{
+public:
+    HRESULT Init(ID3D11Device* pDevice, UINT maxFramesInFlight);
+    void Reset();
+
+    void Signal(ID3D11DeviceContext* pContext, uint64_t frameIndex);
+    uint64_t Poll(ID3D11DeviceContext* pContext); // последний завершённый кадр (0 — ещё ни одного)
+    bool Lost() const { return m_Lost; }
+
+private:
+    void Lose();
+
+    struct Pending
+    {
+        uint64_t frameIndex;
+        UINT query;
+    };
+
+    std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> m_Queries;
+    std::deque<Pending> m_Pending;
+    UINT m_NextQuery = 0;
+    uint64_t m_CompletedFrame = 0;
+    bool m_Lost = false;
+};
+
+struct ResourceStats
+{
+    size_t geometryBlocks = 0;
+    uint64_t geometryCapacityBytes = 0;
+    uint64_t geometryUsedBytes = 0;
+    size_t pooledConstantBuffers = 0;
+    size_t pendingReleases = 0;
+    bool fenceLost = false;
+    size_t transientTargets = 0;
+};
+
+// Владелец GPU-буферов и временных целей рендеринга. Создание и уничтожение
+// идут через пулы, а освобождённое возвращается в пул только после того,
+// как GPU закончил кадр, в котором ресурс был отпущен. Видеопамять пулов
+// отмечается в трекере: блоки геометрии — Mesh, константные буферы — Constant,
+// временные цели — Transient.
+class ResourceManager
+{
+public:
+    static const UINT MaxFramesInFlight = 3;
+    static const UINT GeometryBlockSize = 4 * 1024 * 1024;
+    static const UINT GeometryAlignment = 16;
+
+    HRESULT Init(ID3D11Device* pDevice);
+    void Shutdown();
+
+    // Трекер задаётся до Init и должен пережить Shutdown
+    void SetMemoryTracker(MemoryTracker* pTracker) { m_pMemory = pTracker; }
+
+    void BeginFrame(ID3D11DeviceContext* pContext);
+    void EndFrame(ID3D11DeviceContext* pContext);
+    uint64_t FrameIndex() const { return m_FrameIndex; }
+
+    HRESULT CreateBuffer(BufferKind kind, UINT size, const void* pInitialData, GpuBuffer& buffer);
+    void UpdateBuffer(ID3D11DeviceContext* pContext, const GpuBuffer& buffer, const void* pData, UINT size);
+    void Release(GpuBuffer& buffer);
+
+    // Временная цель на текущий кадр; указатель действителен до EndFrame
+    RenderTarget* AcquireTransientTarget(UINT width, UINT height, DXGI_FORMAT format, UINT sampleCount = 1);
+
+    // Вернуть временную цель до конца кадра (её последний проход уже отправлен);
+    // D3D11 сам упорядочит работу следующего владельца после прежней
+    void ReleaseTransientTarget(const RenderTarget* pTarget) { m_TransientTargets.Release(pTarget); }
+
+    ResourceStats Stats() const;
+
+    // Вытеснение по бюджету памяти: удаляют то, что сейчас не используется,
+    // и возвращают освобождённые байты. Звать между кадрами
+    uint64_t TrimTransientTargets();
+    uint64_t TrimConstantBuffers();
+
+private:
+    struct GeometryPool
+    {
+        UINT bindFlags = 0;
+        std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>> blocks;
+        BlockSuballocator allocator;
+    };
+
+    struct TransientTargetKey
+    {
+        UINT width;
+        UINT height;
+        DXGI_FORMAT format;
+        UINT sampleCount;
+
+        bool operator==(const TransientTargetKey& other) const
+        {
+            return width == other.width && height == other.height && format == other.format && sampleCount == other.sampleCount;
+        }
+    };
+
+    GeometryPool& PoolFor(BufferKind kind) { return kind == BufferKind::Index ? m_IndexPool : m_VertexPool; }
+    HRESULT AllocateGeometry(GeometryPool& pool, UINT size, GpuBuffer& buffer);
+    HRESULT AllocateConstant(UINT size, GpuBuffer& buffer);
+    void ReturnToPool(GpuBuffer& buffer);
+    void TrackGpu(MemoryCategory category, uint64_t bytes, bool allocated);
+
+    Microsoft::WRL::ComPtr<ID3D11Device> m_pDevice;
+    GeometryPool m_VertexPool;
+    GeometryPool m_IndexPool;
+    std::map<UINT, std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>>> m_FreeConstantBuffers; // размер -> свободные
+
+    DeferredReleaseQueue<GpuBuffer> m_PendingReleases;
+    TransientPool<TransientTargetKey, RenderTarget> m_TransientTargets;
+    FrameFence m_Fence;
+    uint64_t m_FrameIndex = 1;
+
+    MemoryTracker* m_pMemory = nullptr;
+    uint64_t m_ConstantBytes = 0; // созданные константные буферы: выданные, ждущие и в пуле
+};
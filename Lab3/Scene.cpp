@@ -0,0 +1,226 @@
+﻿#include "Scene.h"
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+using namespace Math;
+
+namespace
+{
+    // Читает файл построчно, отдавая непустые строки без комментариев
+    template <typename Handler>
+    bool ForEachLine(const std::string& path, Handler handler)
+    {
+        std::ifstream file(path);
+        if (!file) return false;
+
+        std::string line;
+        while (std::getline(file, line))
+        {
+            size_t comment = line.find('#');
+            if (comment != std::string::npos) line.erase(comment);
+
+            std::istringstream stream(line);
+            std::string keyword;
+            if (!(stream >> keyword)) continue;
+            if (!handler(keyword, stream)) return false;
+        }
+        return true;
+    }
+
+    float CatmullRom(float p0, float p1, float p2, float p3, float s)
+    {
+        float s2 = s * s;
+        float s3 = s2 * s;
+        return 0.5f * ((2.0f * p1) + (-p0 + p2) * s + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * s2 + (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * s3);
+    }
+
+    Float3 CatmullRom(const Float3& p0, const Float3& p1, const Float3& p2, const Float3& p3, float s)
+    {
+        return Float3(CatmullRom(p0.x, p1.x, p2.x, p3.x, s),
+                      CatmullRom(p0.y, p1.y, p2.y, p3.y, s),
+                      CatmullRom(p0.z, p1.z, p2.z, p3.z, s));
+    }
+}
+
+Scene DefaultScene()
+{
+    Scene scene;
+    scene.objects.push_back(SceneObject());
+    return scene;
+}
+
+bool LoadScene(const std::string& path, Scene& scene)
+{
+    scene = Scene();
+
+    const size_t slash = path.find_last_of("\\/");
+    const std::string directory = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+    auto resolve = [&directory](const std::string& file)
+    {
+        bool absolute = file.find(':') != std::string::npos || file[0] == '\\' || file[0] == '/';
+        return absolute ? file : directory + file;
+    };
+
+    std::string texture;
+    bool ok = ForEachLine(path, [&](const std::string& keyword, std::istringstream& stream)
+    {
+        if (keyword == "clear")
+        {
+            return (bool)(stream >> scene.clearColor.x >> scene.clearColor.y >> scene.clearColor.z);
+        }
+        if (keyword == "cube")
+        {
+            SceneObject object;
+            if (!(stream >> object.position.x >> object.position.y >> object.position.z)) return false;
+            stream >> object.scale >> object.spin; // необязательные поля
+            object.texture = texture;
+            scene.objects.push_back(object);
+            return true;
+        }
+        if (keyword == "mesh")
+        {
+            SceneObject object;
+            if (!(stream >> object.mesh >> object.position.x >> object.position.y >> object.position.z)) return false;
+            stream >> object.scale >> object.spin;
+            object.mesh = resolve(object.mesh);
+            object.texture = texture;
+            scene.objects.push_back(object);
+            return true;
+        }
+        if (keyword == "texture")
+        {
+            if (!(stream >> texture)) return false;
+            texture = texture == "none" ? std::string() : resolve(texture);
+            return true;
+        }
+        if (keyword == "light")
+        {
+            SceneLight light;
+            if (!(stream >> light.position.x >> light.position.y >> light.position.z >> light.radius >>
+                  light.color.x >> light.color.y >> light.color.z)) return false;
+            stream >> light.intensity;
+            if (light.radius <= 0.0f) return false;
+            scene.lights.push_back(light);
+            return true;
+        }
+        if (keyword == "lights")
+        {
+            size_t count;
+            Float3 center;
+            float extent, radius;
+            if (!(stream >> count >> center.x >> center.y >> center.z >> extent >> radius)) return false;
+            unsigned seed = 1;
+            stream >> seed;
+            if (radius <= 0.0f) return false;
+
+            std::mt19937 random(seed);
+            std::uniform_real_distribution<float> offset(-extent, extent);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            for (size_t i = 0; i < count; ++i)
+            {
+                SceneLight light;
+                light.position = Float3(center.x + offset(random), center.y + offset(random), center.z + offset(random));
+                light.radius = radius * (0.5f + unit(random));
+                light.color = Float3(unit(random), unit(random), unit(random));
+                light.bob = 0.5f * radius * unit(random);
+                light.phase = TwoPi * unit(random);
+                scene.lights.push_back(light);
+            }
+            return true;
+        }
+        if (keyword == "character")
+        {
+            SceneCharacter character;
+            if (!(stream >> character.position.x >> character.position.y >> character.position.z)) return false;
+            stream >> character.scale >> character.phase;
+            scene.characters.push_back(character);
+            return true;
+        }
+        if (keyword == "crowd")
+        {
+            size_t count;
+            Float3 center;
+            float extent;
+            if (!(stream >> count >> center.x >> center.y >> center.z >> extent)) return false;
+            unsigned seed = 1;
+            stream >> seed;
+
+            std::mt19937 random(seed);
+            std::uniform_real_distribution<float> offset(-extent, extent);
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            for (size_t i = 0; i < count; ++i)
+            {
+                SceneCharacter character;
+                character.position = Float3(center.x + offset(random), center.y, center.z + offset(random));
+                character.heading = TwoPi * unit(random);
+                character.scale = 0.75f + 0.5f * unit(random);
+                character.phase = 2.0f * unit(random);
+                character.speed = 0.8f + 0.4f * unit(random);
+                scene.characters.push_back(character);
+            }
+            return true;
+        }
+        return false;
+    });
+    return ok && !scene.objects.empty();
+}
+
+bool LoadCameraPath(const std::string& path, CameraPath& cameraPath)
+{
+    cameraPath = CameraPath();
+    bool ok = ForEachLine(path, [&cameraPath](const std::string& keyword, std::istringstream& stream)
+    {
+        if (keyword == "fps")
+        {
+            return (bool)(stream >> cameraPath.fps) && cameraPath.fps > 0.0f;
+        }
+        if (keyword == "key")
+        {
+            CameraKey key;
+            if (!(stream >> key.time >> key.eye.x >> key.eye.y >> key.eye.z >> key.at.x >> key.at.y >> key.at.z)) return false;
+            cameraPath.keys.push_back(key);
+            return true;
+        }
+        return false;
+    });
+    if (!ok || cameraPath.keys.empty()) return false;
+
+    std::stable_sort(cameraPath.keys.begin(), cameraPath.keys.end(),
+        [](const CameraKey& a, const CameraKey& b) { return a.time < b.time; });
+    return true;
+}
+
+void SampleCameraPath(const CameraPath& cameraPath, float t, Float3& eye, Float3& at)
+{
+    const std::vector<CameraKey>& keys = cameraPath.keys;
+    if (keys.empty()) return;
+
+    if (keys.size() == 1 || t <= keys.front().time)
+    {
+        eye = keys.front().eye;
+        at = keys.front().at;
+        return;
+    }
+    if (t >= keys.back().time)
+    {
+        eye = keys.back().eye;
+        at = keys.back().at;
+        return;
+    }
+
+    // Сегмент [i1, i2], содержащий t; соседние ключи повторяются на краях
+    size_t i2 = std::upper_bound(keys.begin(), keys.end(), t,
+        [](float value, const CameraKey& key) { return value < key.time; }) - keys.begin();
+    size_t i1 = i2 - 1;
+    size_t i0 = i1 > 0 ? i1 - 1 : i1;
+    size_t i3 = i2 + 1 < keys.size() ? i2 + 1 : i2;
+
+    float span = keys[i2].time - keys[i1].time;
+    float s = span > 0.0f ? (t - keys[i1].time) / span : 0.0f;
+
+    eye = CatmullRom(keys[i0].eye, keys[i1].eye, keys[i2].eye, keys[i3].eye, s);
+    at = CatmullRom(keys[i0].at, keys[i1].at, keys[i2].at, keys[i3].at, s);
+}
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+
+#include "VectorMath.h"
+
+// Объект сцены: кубик или меш из файла с положением, масштабом и скоростью вращения вокруг Y
+struct SceneObject
+{
+    Math::Float3 position = Math::Float3(0.0f, 0.0f, 0.0f);
+    float scale = 1.0f;
+    float spin = 1.0f; // радиан в секунду
+    std::string mesh;    // путь к OBJ; пусто — кубик
+    std::string texture; // путь к изображению; пусто — без текстуры
+};
+
+// Точечный источник; bob — амплитуда покачивания по Y, источники с ней движутся каждый кадр
+struct SceneLight
+{
+    Math::Float3 position = Math::Float3(0.0f, 0.0f, 0.0f);
+    float radius = 5.0f;
+    Math::Float3 color = Math::Float3(1.0f, 1.0f, 1.0f);
+    float intensity = 1.0f;
+    float bob = 0.0f;
+    float phase = 0.0f;
+};
+
+// Анимированный персонаж (процедурный, Animation.h); phase — сдвиг по клипу, секунды
+struct SceneCharacter
+{
+    Math::Float3 position = Math::Float3(0.0f, 0.0f, 0.0f);
+    float heading = 0.0f; // поворот вокруг Y, радианы
+    float scale = 1.0f;
+    float phase = 0.0f;
+    float speed = 1.0f;
+};
+
+struct Scene
+{
+    Math::Float4 clearColor = Math::Float4(0.0f, 0.2f, 0.4f, 1.0f);
+    std::vector<SceneObject> objects;
+    std::vector<SceneLight> lights; // пусто — объекты без освещения, только цвет и текстура
+    std::vector<SceneCharacter> characters;
+};
+
+// Ключевой кадр камеры: момент времени, позиция и точка, куда смотрим
+struct CameraKey
+{
+    float time = 0.0f;
+    Math::Float3 eye = Math::Float3(0.0f, 1.0f, -5.0f);
+    Math::Float3 at = Math::Float3(0.0f, 1.0f, 0.0f);
+};
+
+struct CameraPath
+{
+    float fps = 30.0f;
+    std::vector<CameraKey> keys; // отсортированы по времени
+
+    float Duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+    unsigned FrameCount() const { return keys.empty() ? 0 : (unsigned)(Duration() * fps) + 1; }
+};
+
+// Сцена по умолчанию — один кубик в начале координат, как в интерактивном режиме
+Scene DefaultScene();
+
+// Текстовые форматы, по одной записи на строку, '#' — комментарий:
+//   сцена:  clear r g b | cube x y z [scale [spin]] | mesh path x y z [scale [spin]]
+//           | texture path|none — текстура для следующих объектов
+//           | light x y z radius r g b [intensity]
+//           | lights count x y z extent radius [seed] — случайные покачивающиеся источники в кубе
+//           | character x y z [scale [phase]]
+//           | crowd count x y z extent [seed] — персонажи в квадрате на высоте y, фазы и повороты случайные
+//           (пути — относительно файла сцены)
+//   камера: fps f | key t eyeX eyeY eyeZ atX atY atZ
+bool LoadScene(const std::string& path, Scene& scene);
+bool LoadCameraPath(const std::string& path, CameraPath& cameraPath);
+
+// Положение камеры в момент t (Catmull-Rom по ключам)
+void SampleCameraPath(const CameraPath& cameraPath, float t, Math::Float3& eye, Math::Float3& at);
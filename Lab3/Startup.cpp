@@ -0,0 +1,138 @@
+﻿#include "Startup.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+    double Milliseconds(StartupTimeline::Clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+void StartupTimeline::Restart()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Origin = Clock::now();
+    m_Phases.clear();
+    m_Threads = 0;
+    m_FirstFrameMs = 0.0;
+}
+
+bool StartupTimeline::Measure(const char* name, unsigned thread, const std::function<bool()>& step)
+{
+    const Clock::time_point start = Clock::now();
+    const bool succeeded = step();
+    Record(name, thread, start, Clock::now(), succeeded);
+    return succeeded;
+}
+
+void StartupTimeline::Record(const char* name, unsigned thread, Clock::time_point start, Clock::time_point end, bool succeeded)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    StartupPhase phase;
+    phase.name = name;
+    phase.thread = thread;
+    phase.startMs = Milliseconds(start - m_Origin);
+    phase.durationMs = Milliseconds(end - start);
+    phase.succeeded = succeeded;
+    m_Phases.push_back(phase);
+}
+
+StartupTimeline::Clock::time_point StartupTimeline::Mark(const char* name, unsigned thread, Clock::time_point start, bool succeeded)
+{
+    const Clock::time_point now = Clock::now();
+    Record(name, thread, start, now, succeeded);
+    return now;
+}
+
+unsigned StartupTimeline::NewThread()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return ++m_Threads;
+}
+
+void StartupTimeline::MarkFirstFrame()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_FirstFrameMs == 0.0)
+        m_FirstFrameMs = Milliseconds(Clock::now() - m_Origin);
+}
+
+double StartupTimeline::FirstFrameMs() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_FirstFrameMs;
+}
+
+std::vector<StartupPhase> StartupTimeline::Phases() const
+{
+    std::vector<StartupPhase> phases;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        phases = m_Phases;
+    }
+    std::stable_sort(phases.begin(), phases.end(), [](const StartupPhase& a, const StartupPhase& b) { return a.startMs < b.startMs; });
+    return phases;
+}
+
+double StartupTimeline::ElapsedMs() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return Milliseconds(Clock::now() - m_Origin);
+}
+
+std::string StartupTimeline::Report() const
+{
+    std::string report;
+    char line[256];
+    for (const StartupPhase& phase : Phases())
+    {
+        snprintf(line, sizeof(line), "Startup: %-24s thread %u, %8.2f .. %8.2f ms (%.2f ms)%s\n", phase.name.c_str(), phase.thread,
+            phase.startMs, phase.startMs + phase.durationMs, phase.durationMs, phase.succeeded ? "" : ", failed");
+        report += line;
+    }
+
+    const double firstFrameMs = FirstFrameMs();
+    if (firstFrameMs > 0.0)
+        snprintf(line, sizeof(line), "Startup: time to first frame %.2f ms\n", firstFrameMs);
+    else
+        snprintf(line, sizeof(line), "Startup: no frame yet, %.2f ms elapsed\n", ElapsedMs());
+    report += line;
+    return report;
+}
+
+bool StartupTimeline::WriteCsv(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) return false;
+
+    const double firstFrameMs = FirstFrameMs();
+    file << "phase,thread,start_ms,duration_ms,succeeded\n";
+    for (const StartupPhase& phase : Phases())
+        file << phase.name << ',' << phase.thread << ',' << phase.startMs << ',' << phase.durationMs << ',' << (phase.succeeded ? 1 : 0) << '\n';
+    file << "first_frame,0," << firstFrameMs << ",0," << (firstFrameMs > 0.0 ? 1 : 0) << '\n';
+    return file.good();
+}
+
+void StartupTask::Start(StartupTimeline& timeline, const char* name, std::function<bool(unsigned thread)> step)
+{
+    Wait();
+    m_Started = true;
+    m_Result = false;
+
+    const unsigned thread = timeline.NewThread();
+    Jobs().Run([this, &timeline, name, thread, step]()
+    {
+        m_Result = timeline.Measure(name, thread, [&step, thread]() { return step(thread); });
+    }, &m_Done, nullptr, JobPriority::Background);
+}
+
+bool StartupTask::Wait()
+{
+    // Шаги фоновые, и без помощи ждущего на двух ядрах (один рабочий) шли бы по очереди
+    if (m_Started) Jobs().Wait(m_Done, true);
+    return m_Started && m_Result;
+}
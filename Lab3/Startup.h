@@ -0,0 +1,85 @@
+﻿#pragma once
+
+// Запуск приложения по фазам. Независимые шаги (компиляция шейдеров, загрузка
+// сцены, создание устройства) идут параллельно в StartupTask, каждая фаза
+// попадает в StartupTimeline с потоком, началом и длительностью — отсюда видно,
+// что стоит на пути к первому кадру. D3D здесь нет.
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+
+struct StartupPhase
+{
+    std::string name;
+    unsigned thread = 0; // 0 — основной поток, дальше — задачи в порядке запуска
+    double startMs = 0.0;    // от начала запуска
+    double durationMs = 0.0;
+    bool succeeded = true;
+};
+
+class StartupTimeline
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    StartupTimeline() : m_Origin(Clock::now()) {}
+
+    // Отсчёт с нуля; фазы и первый кадр забываются
+    void Restart();
+
+    // Выполняет шаг и записывает его фазу. Потокобезопасно
+    bool Measure(const char* name, unsigned thread, const std::function<bool()>& step);
+    void Record(const char* name, unsigned thread, Clock::time_point start, Clock::time_point end, bool succeeded);
+
+    // Записывает фазу [start, сейчас) и возвращает «сейчас» — начало следующей фазы:
+    // phase = timeline.Mark("device", 0, phase, SUCCEEDED(hr));
+    Clock::time_point Mark(const char* name, unsigned thread, Clock::time_point start, bool succeeded = true);
+
+    unsigned NewThread();
+
+    // Первый кадр показан (или прочитан в пакетном режиме); повторные вызовы не считаются
+    void MarkFirstFrame();
+    double FirstFrameMs() const; // 0 — первого кадра ещё не было
+
+    std::vector<StartupPhase> Phases() const; // по времени начала
+    double ElapsedMs() const;
+
+    // Фазы по строке на каждую и время до первого кадра — для OutputDebugString;
+    // WriteCsv — то же в CSV для автоматических прогонов
+    std::string Report() const;
+    bool WriteCsv(const std::string& path) const;
+
+private:
+    mutable std::mutex m_Mutex;
+    Clock::time_point m_Origin;
+    std::vector<StartupPhase> m_Phases;
+    unsigned m_Threads = 0;
+    double m_FirstFrameMs = 0.0;
+};
+
+// Шаг запуска — фоновая задача общего планировщика; шаг получает номер потока
+// для фаз (номер задачи запуска, а не потока ОС), чтобы записывать вложенные
+// фазы. Wait дожидается его и возвращает результат; деструктор тоже ждёт, так
+// что задача не переживает данные, на которые ссылается
+class StartupTask
+{
+public:
+    StartupTask() = default;
+    StartupTask(const StartupTask&) = delete;
+    StartupTask& operator=(const StartupTask&) = delete;
+    ~StartupTask() { Wait(); }
+
+    void Start(StartupTimeline& timeline, const char* name, std::function<bool(unsigned thread)> step);
+    bool Wait();
+    bool Started() const { return m_Started; }
+
+private:
+    JobCounter m_Done;
+    bool m_Started = false;
+    bool m_Result = false;
+};
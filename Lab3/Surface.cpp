@@ -0,0 +1,145 @@
+﻿#include "Surface.h"
+#include "RenderTarget.h"
+
+HRESULT Surface::Create(ID3D11Device* pDevice, HWND hWnd)
+{
+    Release();
+
+    RECT rc;
+    GetClientRect(hWnd, &rc);
+    m_ClientWidth = rc.right - rc.left;
+    m_ClientHeight = rc.bottom - rc.top;
+
+    // Фабрика берётся у адаптера устройства, чтобы цепочка обмена жила на нём же
+    Microsoft::WRL::ComPtr<IDXGIDevice> pDxgiDevice;
+    HRESULT hr = pDevice->QueryInterface(__uuidof(IDXGIDevice), reinterpret_cast<void**>(pDxgiDevice.GetAddressOf()));
+    if (FAILED(hr)) return hr;
+
+    Microsoft::WRL::ComPtr<IDXGIAdapter> pAdapter;
+    hr = pDxgiDevice->GetAdapter(pAdapter.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    Microsoft::WRL::ComPtr<IDXGIFactory> pFactory;
+    hr = pAdapter->GetParent(__uuidof(IDXGIFactory), reinterpret_cast<void**>(pFactory.GetAddressOf()));
+    if (FAILED(hr)) return hr;
+
+    DXGI_SWAP_CHAIN_DESC sd = {};
+    sd.BufferCount = BufferCount;
+    sd.BufferDesc.Width = m_ClientWidth;
+    sd.BufferDesc.Height = m_ClientHeight;
+    sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    sd.BufferDesc.RefreshRate.Numerator = 60;
+    sd.BufferDesc.RefreshRate.Denominator = 1;
+    sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    sd.OutputWindow = hWnd;
+    sd.SampleDesc.Count = 1;
+    sd.SampleDesc.Quality = 0;
+    sd.Windowed = TRUE;
+    sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+    sd.Flags = 0;
+
+    hr = pFactory->CreateSwapChain(pDevice, &sd, m_pSwapChain.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    m_pDevice = pDevice;
+    m_hWnd = hWnd;
+
+    hr = CreateSizeDependentResources(m_ClientWidth, m_ClientHeight);
+    if (FAILED(hr)) return hr;
+
+    m_BufferWidth = m_ClientWidth;
+    m_BufferHeight = m_ClientHeight;
+    return S_OK;
+}
+
+void Surface::Release()
+{
+    ReleaseSizeDependentResources();
+    m_pSwapChain.Reset();
+    m_pDevice.Reset();
+    m_hWnd = nullptr;
+    m_BufferWidth = m_BufferHeight = 0;
+    m_ClientWidth = m_ClientHeight = 0;
+    m_Minimized = m_InSizeMove = m_ResizePending = false;
+}
+
+void Surface::OnSize(UINT width, UINT height, bool minimized)
+{
+    m_Minimized = minimized;
+    if (minimized) return;
+
+    m_ClientWidth = width;
+    m_ClientHeight = height;
+    m_ResizePending = width != m_BufferWidth || height != m_BufferHeight;
+}
+
+void Surface::OnEnterSizeMove()
+{
+    m_InSizeMove = true;
+}
+
+void Surface::OnExitSizeMove()
+{
+    m_InSizeMove = false;
+}
+
+HRESULT Surface::Update(ID3D11DeviceContext* pContext)
+{
+    if (!m_pSwapChain || !m_ResizePending || m_InSizeMove || m_Minimized) return S_OK;
+    if (m_ClientWidth == 0 || m_ClientHeight == 0) return S_OK;
+
+    return Rebuild(pContext, m_ClientWidth, m_ClientHeight);
+}
+
+HRESULT Surface::Present(UINT syncInterval)
+{
+    return m_pSwapChain->Present(syncInterval, 0);
+}
+
+float Surface::AspectRatio() const
+{
+    if (m_ClientWidth == 0 || m_ClientHeight == 0)
+        return m_BufferHeight ? m_BufferWidth / (float)m_BufferHeight : 1.0f;
+    return m_ClientWidth / (float)m_ClientHeight;
+}
+
+HRESULT Surface::Rebuild(ID3D11DeviceContext* pContext, UINT width, UINT height)
+{
+    // ResizeBuffers требует, чтобы на back buffer не осталось ни одной ссылки,
+    // включая привязку к контексту
+    pContext->OMSetRenderTargets(0, nullptr, nullptr);
+    ReleaseSizeDependentResources();
+
+    // Новый размер принимается, только когда пересоздано всё; до того поверхность
+    // невидима (RTV нет), а m_ResizePending остаётся — Update попробует снова
+    HRESULT hr = m_pSwapChain->ResizeBuffers(0, width, height, DXGI_FORMAT_UNKNOWN, 0);
+    if (FAILED(hr)) return hr;
+
+    hr = CreateSizeDependentResources(width, height);
+    if (FAILED(hr)) return hr;
+
+    m_BufferWidth = width;
+    m_BufferHeight = height;
+    m_ResizePending = false;
+    ++m_RebuildCount;
+    return S_OK;
+}
+
+// Всё или ничего: при ошибке созданное частично освобождается
+HRESULT Surface::CreateSizeDependentResources(UINT width, UINT height)
+{
+    HRESULT hr = m_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(m_pBackBuffer.GetAddressOf()));
+    if (SUCCEEDED(hr))
+        hr = m_pDevice->CreateRenderTargetView(m_pBackBuffer.Get(), nullptr, m_pRenderTargetView.GetAddressOf());
+    if (SUCCEEDED(hr))
+        hr = CreateDepthBuffer(m_pDevice.Get(), width, height, m_pDepthStencilView);
+    if (FAILED(hr)) ReleaseSizeDependentResources();
+    return hr;
+}
+
+void Surface::ReleaseSizeDependentResources()
+{
+    m_pDepthStencilView.Reset();
+    m_pRenderTargetView.Reset();
+    m_pBackBuffer.Reset();
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstdint>
+
+// Поверхность вывода в окно: цепочка обмена и всё, что зависит от её размера
+// (RTV back buffer'а, буфер глубины). Изменение размера откладывается:
+// WM_SIZE только запоминает новый размер, а пересоздание буферов делается
+// в одном месте — Update(), не чаще раза за кадр и не во время перетаскивания
+// рамки окна. Пока пользователь тянет рамку, кадр рисуется в старые буферы,
+// а flip-модель DXGI растягивает их на окно.
+class Surface
+{
+public:
+    static const UINT BufferCount = 2;
+
+    HRESULT Create(ID3D11Device* pDevice, HWND hWnd);
+    void Release();
+
+    // Обработчики сообщений окна
+    void OnSize(UINT width, UINT height, bool minimized);
+    void OnEnterSizeMove();
+    void OnExitSizeMove();
+
+    // Единственная точка пересоздания размерных ресурсов; вызывать перед рендером кадра
+    HRESULT Update(ID3D11DeviceContext* pContext);
+
+    HRESULT Present(UINT syncInterval);
+
+    // Пока пересоздание не удалось (RTV нет), в поверхность не рисуют; Update повторит его в следующем кадре
+    bool IsVisible() const { return !m_Minimized && m_BufferWidth > 0 && m_BufferHeight > 0 && m_pRenderTargetView.Get() != nullptr; }
+    HWND Window() const { return m_hWnd; }
+    IDXGISwapChain* SwapChain() const { return m_pSwapChain.Get(); }
+    ID3D11Texture2D* BackBuffer() const { return m_pBackBuffer.Get(); }
+    ID3D11RenderTargetView* RenderTargetView() const { return m_pRenderTargetView.Get(); }
+    ID3D11DepthStencilView* DepthStencilView() const { return m_pDepthStencilView.Get(); }
+
+    UINT BufferWidth() const { return m_BufferWidth; }
+    UINT BufferHeight() const { return m_BufferHeight; }
+
+    // Видеопамять back buffer'ов и буфера глубины
+    uint64_t SizeBytes() const { return (uint64_t)m_BufferWidth * m_BufferHeight * 4 * (BufferCount + 1); }
+
+    // Соотношение сторон окна (а не буфера) — во время перетаскивания они расходятся
+    float AspectRatio() const;
+
+    UINT RebuildCount() const { return m_RebuildCount; }
+
+private:
+    HRESULT Rebuild(ID3D11DeviceContext* pContext, UINT width, UINT height);
+    HRESULT CreateSizeDependentResources(UINT width, UINT height);
+    void ReleaseSizeDependentResources();
+
+    Microsoft::WRL::ComPtr<ID3D11Device> m_pDevice;
+    Microsoft::WRL::ComPtr<IDXGISwapChain> m_pSwapChain;
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> m_pBackBuffer;
+    Microsoft::WRL::ComPtr<ID3D11RenderTargetView> m_pRenderTargetView;
+    Microsoft::WRL::ComPtr<ID3D11DepthStencilView> m_pDepthStencilView;
+
+    HWND m_hWnd = nullptr;
+    UINT m_BufferWidth = 0;
+    UINT m_BufferHeight = 0;
+    UINT m_ClientWidth = 0;
+    UINT m_ClientHeight = 0;
+    bool m_Minimized = false;
+    bool m_InSizeMove = false;
+    bool m_ResizePending = false;
+    UINT m_RebuildCount = 0;
+};
@@ -0,0 +1,188 @@
+﻿#include "Texture.h"
+#include "JobSystem.h"
+
+#include <wincodec.h>
+#include <vector>
+
+namespace
+{
+    HRESULT DecodeImage(const std::string& path, Image& image)
+    {
+        Microsoft::WRL::ComPtr<IWICImagingFactory> pFactory;
+        HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(pFactory.GetAddressOf()));
+        if (FAILED(hr)) return hr;
+
+        int size = MultiByteToWideChar(CP_ACP, 0, path.c_str(), -1, nullptr, 0);
+        if (size <= 1) return E_INVALIDARG;
+        std::wstring widePath(size - 1, L'\0');
+        MultiByteToWideChar(CP_ACP, 0, path.c_str(), -1, &widePath[0], size);
+
+        Microsoft::WRL::ComPtr<IWICBitmapDecoder> pDecoder;
+        hr = pFactory->CreateDecoderFromFilename(widePath.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, pDecoder.GetAddressOf());
+        if (FAILED(hr)) return hr;
+
+        Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> pFrame;
+        hr = pDecoder->GetFrame(0, pFrame.GetAddressOf());
+        if (FAILED(hr)) return hr;
+
+        // Любой исходный формат пикселей приводится к RGBA8
+        Microsoft::WRL::ComPtr<IWICFormatConverter> pConverter;
+        hr = pFactory->CreateFormatConverter(pConverter.GetAddressOf());
+        if (FAILED(hr)) return hr;
+        hr = pConverter->Initialize(pFrame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+        if (FAILED(hr)) return hr;
+
+        UINT width = 0, height = 0;
+        hr = pConverter->GetSize(&width, &height);
+        if (FAILED(hr)) return hr;
+        if (width == 0 || height == 0) return E_FAIL;
+
+        image.width = width;
+        image.height = height;
+        image.rgba.resize((size_t)width * height * 4);
+        return pConverter->CopyPixels(nullptr, width * 4, (UINT)image.rgba.size(), image.rgba.data());
+    }
+}
+
+HRESULT LoadImageFile(const std::string& path, Image& image)
+{
+    // WIC работает в любой модели потоков; если COM уже инициализирован иначе, это не ошибка
+    HRESULT hrCom = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    if (FAILED(hrCom) && hrCom != RPC_E_CHANGED_MODE) return hrCom;
+
+    HRESULT hr = DecodeImage(path, image);
+
+    if (SUCCEEDED(hrCom)) CoUninitialize();
+    return hr;
+}
+
+TextureFormat ChooseTextureFormat(const Image& image)
+{
+    if (image.width % 4 != 0 || image.height % 4 != 0) return TextureFormat::Rgba8;
+    return HasAlpha(image) ? TextureFormat::BC7 : TextureFormat::BC1;
+}
+
+uint64_t TextureData::SizeBytes() const
+{
+    uint64_t bytes = 0;
+    for (const Image& mip : mips) bytes += mip.rgba.size();
+    for (const std::vector<uint8_t>& level : compressed) bytes += level.size();
+    return bytes;
+}
+
+HRESULT PrepareTexture(const Image& image, TextureFormat format, TextureData& data)
+{
+    data = TextureData();
+    if (image.width == 0 || image.height == 0) return E_INVALIDARG;
+    if (format != TextureFormat::Rgba8 && (image.width % 4 != 0 || image.height % 4 != 0)) return E_INVALIDARG;
+
+    data.format = format;
+    data.mips = GenerateMips(image);
+    data.hasAlpha = HasAlpha(image);
+    if (format == TextureFormat::Rgba8) return S_OK;
+
+    const unsigned threadCount = Jobs().ThreadCount();
+
+    const BlockFormat blockFormat = format == TextureFormat::BC1 ? BlockFormat::BC1 : BlockFormat::BC7;
+    data.compressed.resize(data.mips.size());
+    for (size_t level = 0; level < data.mips.size(); ++level)
+        CompressImage(data.mips[level], blockFormat, data.compressed[level], threadCount);
+    return S_OK;
+}
+
+HRESULT CreateTexture(ID3D11Device* pDevice, const TextureData& data, Texture& texture)
+{
+    texture = Texture();
+    if (data.mips.empty()) return E_INVALIDARG;
+    if (data.format != TextureFormat::Rgba8 && data.compressed.size() != data.mips.size()) return E_INVALIDARG;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> initData(data.mips.size());
+    for (size_t level = 0; level < data.mips.size(); ++level)
+    {
+        const Image& mip = data.mips[level];
+        D3D11_SUBRESOURCE_DATA& subresource = initData[level];
+        subresource.SysMemSlicePitch = 0;
+
+        if (data.format == TextureFormat::Rgba8)
+        {
+            subresource.pSysMem = mip.rgba.data();
+            subresource.SysMemPitch = mip.width * 4;
+            texture.sizeBytes += mip.rgba.size();
+        }
+        else
+        {
+            const BlockFormat blockFormat = data.format == TextureFormat::BC1 ? BlockFormat::BC1 : BlockFormat::BC7;
+            subresource.pSysMem = data.compressed[level].data();
+            subresource.SysMemPitch = (UINT)(((mip.width + 3) / 4) * BlockBytes(blockFormat));
+            texture.sizeBytes += data.compressed[level].size();
+        }
+        texture.rgba8SizeBytes += mip.rgba.size();
+    }
+
+    const Image& image = data.mips[0];
+    D3D11_TEXTURE2D_DESC td = {};
+    td.Width = image.width;
+    td.Height = image.height;
+    td.MipLevels = (UINT)data.mips.size();
+    td.ArraySize = 1;
+    td.Format = data.format == TextureFormat::BC1 ? DXGI_FORMAT_BC1_UNORM :
+                data.format == TextureFormat::BC7 ? DXGI_FORMAT_BC7_UNORM : DXGI_FORMAT_R8G8B8A8_UNORM;
+    td.SampleDesc.Count = 1;
+    td.SampleDesc.Quality = 0;
+    td.Usage = D3D11_USAGE_IMMUTABLE;
+    td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    td.CPUAccessFlags = 0;
+    td.MiscFlags = 0;
+
+    HRESULT hr = pDevice->CreateTexture2D(&td, initData.data(), texture.pTexture.GetAddressOf());
+    if (FAILED(hr))
+    {
+        texture = Texture();
+        return hr;
+    }
+
+    hr = pDevice->CreateShaderResourceView(texture.pTexture.Get(), nullptr, texture.pShaderResourceView.GetAddressOf());
+    if (FAILED(hr))
+    {
+        texture = Texture();
+        return hr;
+    }
+
+    texture.width = image.width;
+    texture.height = image.height;
+    texture.mipLevels = (UINT)data.mips.size();
+    texture.format = data.format;
+    texture.hasAlpha = data.hasAlpha;
+    return S_OK;
+}
+
+HRESULT CreateTexture(ID3D11Device* pDevice, const Image& image, TextureFormat format, Texture& texture)
+{
+    TextureData data;
+    HRESULT hr = PrepareTexture(image, format, data);
+    if (FAILED(hr))
+    {
+        texture = Texture();
+        return hr;
+    }
+    return CreateTexture(pDevice, data, texture);
+}
+
+HRESULT LoadTexture(ID3D11Device* pDevice, const std::string& path, Texture& texture)
+{
+    Image image;
+    HRESULT hr = LoadImageFile(path, image);
+    if (FAILED(hr)) return hr;
+
+    return CreateTexture(pDevice, image, ChooseTextureFormat(image), texture);
+}
+
+const char* TextureFormatName(TextureFormat format)
+{
+    switch (format)
+    {
+    case TextureFormat::BC1: return "BC1";
+    case TextureFormat::BC7: return "BC7";
+    default: return "RGBA8";
+    }
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TextureCodec.h"
+
+enum class TextureFormat
+{
+    Rgba8,
+    BC1,
+    BC7,
+};
+
+struct Texture
+{
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> pTexture;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> pShaderResourceView;
+    UINT width = 0;
+    UINT height = 0;
+    UINT mipLevels = 0;
+    TextureFormat format = TextureFormat::Rgba8;
+    bool hasAlpha = false;       // есть полупрозрачные пиксели — рисуется прозрачным проходом
+    uint64_t sizeBytes = 0;      // вся цепочка mip-уровней в видеопамяти
+    uint64_t rgba8SizeBytes = 0; // та же цепочка без сжатия — для сравнения
+};
+
+// Чтение PNG/JPEG/BMP и др. через WIC в RGBA8
+HRESULT LoadImageFile(const std::string& path, Image& image);
+
+// Без альфы — BC1 (в 8 раз меньше RGBA8), с альфой — BC7 (в 4 раза).
+// Блочные форматы требуют размеров нулевого уровня, кратных 4; иначе — RGBA8
+TextureFormat ChooseTextureFormat(const Image& image);
+
+// Mip-цепочка в формате видеопамяти, готовая к созданию текстуры
+struct TextureData
+{
+    TextureFormat format = TextureFormat::Rgba8;
+    std::vector<Image> mips;                      // RGBA8, от нулевого уровня
+    std::vector<std::vector<uint8_t>> compressed; // блоки BC1/BC7 по уровням; для RGBA8 пусто
+    bool hasAlpha = false;
+
+    uint64_t SizeBytes() const; // вся цепочка RGBA8 и блоки
+};
+
+// Строит mip-цепочку и сжимает её (параллельно по строкам блоков). Устройство
+// не нужно — можно делать в фоне, пока оно создаётся
+HRESULT PrepareTexture(const Image& image, TextureFormat format, TextureData& data);
+
+// Неизменяемая текстура из готовой цепочки
+HRESULT CreateTexture(ID3D11Device* pDevice, const TextureData& data, Texture& texture);
+
+// PrepareTexture и CreateTexture подряд
+HRESULT CreateTexture(ID3D11Device* pDevice, const Image& image, TextureFormat format, Texture& texture);
+
+HRESULT LoadTexture(ID3D11Device* pDevice, const std::string& path, Texture& texture);
+
+const char* TextureFormatName(TextureFormat format);
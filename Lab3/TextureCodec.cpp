@@ -0,0 +1,528 @@
+﻿#include "TextureCodec.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Главная ось облака точек (power iteration по ковариации)
+    template <int N>
+    void PrincipalAxis(const float (&points)[16][N], float (&mean)[N], float (&axis)[N])
+    {
+        for (int c = 0; c < N; ++c)
+        {
+            mean[c] = 0.0f;
+            for (int i = 0; i < 16; ++i) mean[c] += points[i][c];
+            mean[c] /= 16.0f;
+        }
+
+        float covariance[N][N] = {};
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int a = 0; a < N; ++a)
+            {
+                for (int b = 0; b < N; ++b)
+                    covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+            }
+        }
+
+        for (int c = 0; c < N; ++c) axis[c] = 1.0f;
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            float next[N] = {};
+            float length = 0.0f;
+            for (int a = 0; a < N; ++a)
+            {
+                for (int b = 0; b < N; ++b) next[a] += covariance[a][b] * axis[b];
+                length += next[a] * next[a];
+            }
+            if (length < 1e-12f) break; // однородный блок — ось не важна
+            length = 1.0f / std::sqrt(length);
+            for (int c = 0; c < N; ++c) axis[c] = next[c] * length;
+        }
+    }
+
+    // Концы отрезка: проекции крайних точек на главную ось
+    template <int N>
+    void FitEndpoints(const float (&points)[16][N], float (&low)[N], float (&high)[N])
+    {
+        float mean[N], axis[N];
+        PrincipalAxis(points, mean, axis);
+
+        float minProjection = 0.0f, maxProjection = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            float projection = 0.0f;
+            for (int c = 0; c < N; ++c) projection += (points[i][c] - mean[c]) * axis[c];
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+
+        for (int c = 0; c < N; ++c)
+        {
+            low[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minProjection));
+            high[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxProjection));
+        }
+    }
+
+    uint16_t Pack565(const float color[3])
+    {
+        int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+        int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+        int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+        return (uint16_t)((r << 11) | (g << 5) | b);
+    }
+
+    void Unpack565(uint16_t packed, int color[3])
+    {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // Палитра BC1 в 4-цветном режиме: c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1
+    void PaletteBC1(uint16_t c0, uint16_t c1, int palette[4][3])
+    {
+        Unpack565(c0, palette[0]);
+        Unpack565(c1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    }
+
+    // Ближайшие индексы палитры; возвращает суммарную квадратичную ошибку
+    int AssignBC1(const float (&points)[16][3], const int palette[4][3], uint8_t indices[16])
+    {
+        int total = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestError = 0x7fffffff;
+            for (int p = 0; p < 4; ++p)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; ++c)
+                {
+                    int d = (int)points[i][c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices[i] = (uint8_t)best;
+            total += bestError;
+        }
+        return total;
+    }
+
+    // Концы по методу наименьших квадратов при фиксированных индексах
+    bool RefineBC1(const float (&points)[16][3], const uint8_t indices[16], float (&low)[3], float (&high)[3])
+    {
+        static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f }; // доля c0
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[3] = {}, bx[3] = {};
+        for (int i = 0; i < 16; ++i)
+        {
+            float a = weights[indices[i]];
+            float b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < 3; ++c)
+            {
+                ax[c] += a * points[i][c];
+                bx[c] += b * points[i][c];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f) return false;
+        determinant = 1.0f / determinant;
+        for (int c = 0; c < 3; ++c)
+        {
+            high[c] = std::min(255.0f, std::max(0.0f, (ax[c] * bb - bx[c] * ab) * determinant));
+            low[c] = std::min(255.0f, std::max(0.0f, (bx[c] * aa - ax[c] * ab) * determinant));
+        }
+        return true;
+    }
+
+    // Концы в порядке c0 > c1 (4-цветный режим), индексы и ошибка
+    int EncodeBC1(const float (&points)[16][3], const float low[3], const float high[3], uint16_t& c0, uint16_t& c1, uint8_t indices[16])
+    {
+        c0 = Pack565(high);
+        c1 = Pack565(low);
+        if (c0 < c1) std::swap(c0, c1);
+        if (c0 == c1)
+        {
+            // Одноцветный блок: все индексы указывают на c0
+            std::fill(indices, indices + 16, (uint8_t)0);
+            int palette[4][3];
+            PaletteBC1(c0, c1, palette);
+            int total = 0;
+            for (int i = 0; i < 16; ++i)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    int d = (int)points[i][c] - palette[0][c];
+                    total += d * d;
+                }
+            }
+            return total;
+        }
+
+        int palette[4][3];
+        PaletteBC1(c0, c1, palette);
+        return AssignBC1(points, palette, indices);
+    }
+
+    // Запись битов блока BC7 младшими вперёд
+    struct BitWriter
+    {
+        uint8_t* block;
+        unsigned position = 0;
+
+        explicit BitWriter(uint8_t* target) : block(target) { std::fill(block, block + 16, (uint8_t)0); }
+
+        void Write(uint32_t value, unsigned count)
+        {
+            for (unsigned i = 0; i < count; ++i, ++position)
+            {
+                if (value & (1u << i)) block[position >> 3] |= (uint8_t)(1u << (position & 7));
+            }
+        }
+    };
+
+    struct BitReader
+    {
+        const uint8_t* block;
+        unsigned position = 0;
+
+        explicit BitReader(const uint8_t* source) : block(source) {}
+
+        uint32_t Read(unsigned count)
+        {
+            uint32_t value = 0;
+            for (unsigned i = 0; i < count; ++i, ++position)
+                value |= (uint32_t)((block[position >> 3] >> (position & 7)) & 1) << i;
+            return value;
+        }
+    };
+
+    const int Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    int Interpolate(int e0, int e1, int weight)
+    {
+        return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+    }
+
+    // Конец режима 6: 7 бит на канал плюс общий младший бит p; p выбирается по ошибке
+    void QuantizeBC7(const float endpoint[4], uint8_t quantized[4], uint8_t& pBit)
+    {
+        float bestError = 1e30f;
+        for (int p = 0; p < 2; ++p)
+        {
+            uint8_t candidate[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c)
+            {
+                int q = (int)std::floor((endpoint[c] - p) * 0.5f + 0.5f);
+                q = std::min(127, std::max(0, q));
+                candidate[c] = (uint8_t)q;
+                float d = (float)((q << 1) | p) - endpoint[c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                pBit = (uint8_t)p;
+                std::copy(candidate, candidate + 4, quantized);
+            }
+        }
+    }
+
+    void CompressRows(const Image& image, BlockFormat format, uint32_t firstRow, uint32_t rowCount, uint8_t* output)
+    {
+        const uint32_t blocksPerRow = (image.width + 3) / 4;
+        const size_t blockBytes = BlockBytes(format);
+
+        uint8_t pixels[64];
+        for (uint32_t blockY = firstRow; blockY < firstRow + rowCount; ++blockY)
+        {
+            for (uint32_t blockX = 0; blockX < blocksPerRow; ++blockX)
+            {
+                for (uint32_t y = 0; y < 4; ++y)
+                {
+                    uint32_t sourceY = std::min(blockY * 4 + y, image.height - 1);
+                    for (uint32_t x = 0; x < 4; ++x)
+                    {
+                        uint32_t sourceX = std::min(blockX * 4 + x, image.width - 1);
+                        std::copy(image.Pixel(sourceX, sourceY), image.Pixel(sourceX, sourceY) + 4, pixels + (y * 4 + x) * 4);
+                    }
+                }
+
+                uint8_t* block = output + ((size_t)(blockY - firstRow) * blocksPerRow + blockX) * blockBytes;
+                if (format == BlockFormat::BC1) CompressBlockBC1(pixels, block);
+                else CompressBlockBC7(pixels, block);
+            }
+        }
+    }
+}
+
+size_t CompressedSize(uint32_t width, uint32_t height, BlockFormat format)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+bool HasAlpha(const Image& image)
+{
+    for (size_t i = 3; i < image.rgba.size(); i += 4)
+    {
+        if (image.rgba[i] != 255) return true;
+    }
+    return false;
+}
+
+std::vector<Image> GenerateMips(const Image& image)
+{
+    std::vector<Image> mips;
+    mips.push_back(image);
+
+    while (mips.back().width > 1 || mips.back().height > 1)
+    {
+        const Image& source = mips.back();
+        Image level;
+        level.width = std::max(1u, source.width / 2);
+        level.height = std::max(1u, source.height / 2);
+        level.rgba.resize((size_t)level.width * level.height * 4);
+
+        for (uint32_t y = 0; y < level.height; ++y)
+        {
+            // Последняя строка нечётного уровня забирает и крайнюю строку источника
+            uint32_t y0 = std::min(y * 2, source.height - 1);
+            uint32_t y1 = y + 1 == level.height ? source.height - 1 : std::min(y * 2 + 1, source.height - 1);
+            for (uint32_t x = 0; x < level.width; ++x)
+            {
+                uint32_t x0 = std::min(x * 2, source.width - 1);
+                uint32_t x1 = x + 1 == level.width ? source.width - 1 : std::min(x * 2 + 1, source.width - 1);
+
+                uint32_t sum[4] = {};
+                for (uint32_t sy = y0; sy <= y1; ++sy)
+                {
+                    for (uint32_t sx = x0; sx <= x1; ++sx)
+                    {
+                        const uint8_t* pixel = source.Pixel(sx, sy);
+                        for (int c = 0; c < 4; ++c) sum[c] += pixel[c];
+                    }
+                }
+
+                const uint32_t count = (x1 - x0 + 1) * (y1 - y0 + 1);
+                uint8_t* target = &level.rgba[((size_t)y * level.width + x) * 4];
+                for (int c = 0; c < 4; ++c) target[c] = (uint8_t)((sum[c] + count / 2) / count);
+            }
+        }
+
+        mips.push_back(std::move(level));
+    }
+    return mips;
+}
+
+void CompressImage(const Image& image, BlockFormat format, std::vector<uint8_t>& blocks, unsigned threadCount)
+{
+    blocks.resize(CompressedSize(image.width, image.height, format));
+    if (image.width == 0 || image.height == 0) return;
+
+    const uint32_t blockRows = (image.height + 3) / 4;
+    const size_t rowBytes = (size_t)((image.width + 3) / 4) * BlockBytes(format);
+    threadCount = std::max(1u, std::min(threadCount, blockRows));
+
+    if (threadCount == 1)
+    {
+        CompressRows(image, format, 0, blockRows, blocks.data());
+        return;
+    }
+
+    // Цена строки зависит от содержимого (BC7 перебирает разбиения), поэтому
+    // строки не делятся поровну заранее, а раздаются кусками по ходу
+    Jobs().ParallelFor(blockRows, 1, [&](size_t first, size_t end)
+    {
+        CompressRows(image, format, (uint32_t)first, (uint32_t)(end - first), blocks.data() + first * rowBytes);
+    });
+}
+
+void CompressBlockBC1(const uint8_t pixels[64], uint8_t block[8])
+{
+    float points[16][3];
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 3; ++c) points[i][c] = pixels[i * 4 + c];
+    }
+
+    float low[3], high[3];
+    FitEndpoints(points, low, high);
+
+    uint16_t c0, c1;
+    uint8_t indices[16];
+    int error = EncodeBC1(points, low, high, c0, c1, indices);
+
+    // Одна итерация уточнения концов; берётся, только если стало лучше
+    if (c0 != c1 && RefineBC1(points, indices, low, high))
+    {
+        uint16_t refined0, refined1;
+        uint8_t refinedIndices[16];
+        if (EncodeBC1(points, low, high, refined0, refined1, refinedIndices) < error)
+        {
+            c0 = refined0;
+            c1 = refined1;
+            std::copy(refinedIndices, refinedIndices + 16, indices);
+        }
+    }
+
+    block[0] = (uint8_t)(c0 & 0xff);
+    block[1] = (uint8_t)(c0 >> 8);
+    block[2] = (uint8_t)(c1 & 0xff);
+    block[3] = (uint8_t)(c1 >> 8);
+    for (int row = 0; row < 4; ++row)
+    {
+        block[4 + row] = (uint8_t)(indices[row * 4] | (indices[row * 4 + 1] << 2) | (indices[row * 4 + 2] << 4) | (indices[row * 4 + 3] << 6));
+    }
+}
+
+void CompressBlockBC7(const uint8_t pixels[64], uint8_t block[16])
+{
+    float points[16][4];
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 4; ++c) points[i][c] = pixels[i * 4 + c];
+    }
+
+    float low[4], high[4];
+    FitEndpoints(points, low, high);
+
+    uint8_t quantized[2][4];
+    uint8_t pBits[2];
+    QuantizeBC7(low, quantized[0], pBits[0]);
+    QuantizeBC7(high, quantized[1], pBits[1]);
+
+    int endpoints[2][4];
+    for (int e = 0; e < 2; ++e)
+    {
+        for (int c = 0; c < 4; ++c) endpoints[e][c] = (quantized[e][c] << 1) | pBits[e];
+    }
+
+    int palette[16][4];
+    for (int w = 0; w < 16; ++w)
+    {
+        for (int c = 0; c < 4; ++c) palette[w][c] = Interpolate(endpoints[0][c], endpoints[1][c], Bc7Weights4[w]);
+    }
+
+    uint8_t indices[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        int best = 0, bestError = 0x7fffffff;
+        for (int w = 0; w < 16; ++w)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                int d = pixels[i * 4 + c] - palette[w][c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                best = w;
+            }
+        }
+        indices[i] = (uint8_t)best;
+    }
+
+    // Старший бит индекса первого пикселя не хранится и должен быть нулём
+    if (indices[0] & 8)
+    {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (int i = 0; i < 16; ++i) indices[i] = (uint8_t)(15 - indices[i]);
+    }
+
+    BitWriter writer(block);
+    writer.Write(1u << 6, 7); // режим 6
+    for (int c = 0; c < 4; ++c)
+    {
+        writer.Write(quantized[0][c], 7);
+        writer.Write(quantized[1][c], 7);
+    }
+    writer.Write(pBits[0], 1);
+    writer.Write(pBits[1], 1);
+    writer.Write(indices[0], 3);
+    for (int i = 1; i < 16; ++i) writer.Write(indices[i], 4);
+}
+
+void DecompressBlockBC1(const uint8_t block[8], uint8_t pixels[64])
+{
+    const uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+    const uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+
+    int palette[4][4];
+    Unpack565(c0, palette[0]);
+    Unpack565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (c0 > c1)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    if (c0 <= c1) palette[3][3] = 0; // 3-цветный режим: прозрачный чёрный
+
+    for (int i = 0; i < 16; ++i)
+    {
+        const int index = (block[4 + i / 4] >> ((i % 4) * 2)) & 3;
+        for (int c = 0; c < 4; ++c) pixels[i * 4 + c] = (uint8_t)palette[index][c];
+    }
+}
+
+void DecompressBlockBC7Mode6(const uint8_t block[16], uint8_t pixels[64])
+{
+    BitReader reader(block);
+    if (reader.Read(7) != (1u << 6))
+    {
+        std::fill(pixels, pixels + 64, (uint8_t)0);
+        return;
+    }
+
+    int quantized[2][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        quantized[0][c] = (int)reader.Read(7);
+        quantized[1][c] = (int)reader.Read(7);
+    }
+    int pBits[2];
+    pBits[0] = (int)reader.Read(1);
+    pBits[1] = (int)reader.Read(1);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        const int index = (int)reader.Read(i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; ++c)
+        {
+            const int e0 = (quantized[0][c] << 1) | pBits[0];
+            const int e1 = (quantized[1][c] << 1) | pBits[1];
+            pixels[i * 4 + c] = (uint8_t)Interpolate(e0, e1, Bc7Weights4[index]);
+        }
+    }
+}
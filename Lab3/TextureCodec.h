@@ -0,0 +1,48 @@
+﻿#pragma once
+
+// Подготовка текстур на CPU: цепочка mip-уровней и блочное сжатие BC1/BC7.
+// Здесь нет D3D — только пиксели и байты блоков; создание текстуры на GPU — в Texture.h.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Изображение RGBA8 без выравнивания строк
+struct Image
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;
+
+    const uint8_t* Pixel(uint32_t x, uint32_t y) const { return &rgba[((size_t)y * width + x) * 4]; }
+};
+
+enum class BlockFormat
+{
+    BC1, // 4 бита на пиксель, RGB (альфа игнорируется)
+    BC7, // 8 бит на пиксель, RGBA (режим 6)
+};
+
+// Байт на блок 4x4
+inline size_t BlockBytes(BlockFormat format) { return format == BlockFormat::BC1 ? 8 : 16; }
+
+// Размер уровня в байтах после сжатия: блоки по 4x4, края дополняются
+size_t CompressedSize(uint32_t width, uint32_t height, BlockFormat format);
+
+bool HasAlpha(const Image& image);
+
+// Уровни от исходного (нулевого) до 1x1; каждый следующий — среднее 2x2,
+// нечётная сторона захватывает крайний пиксель
+std::vector<Image> GenerateMips(const Image& image);
+
+// Сжатие уровня; блоки, выходящие за край, дополняются повтором крайних пикселей.
+// threadCount > 1 — строки блоков сжимаются задачами общего планировщика (JobSystem.h)
+void CompressImage(const Image& image, BlockFormat format, std::vector<uint8_t>& blocks, unsigned threadCount = 1);
+
+// Один блок 4x4; pixels — 16 пикселей RGBA построчно
+void CompressBlockBC1(const uint8_t pixels[64], uint8_t block[8]);
+void CompressBlockBC7(const uint8_t pixels[64], uint8_t block[16]);
+
+// Обратное преобразование — для проверки качества сжатия
+void DecompressBlockBC1(const uint8_t block[8], uint8_t pixels[64]);
+void DecompressBlockBC7Mode6(const uint8_t block[16], uint8_t pixels[64]);
@@ -0,0 +1,193 @@
+﻿#include "TiledTexture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define TILED_TEXTURE_SSE2 1
+#include <emmintrin.h>
+#else
+#define TILED_TEXTURE_SSE2 0
+#endif
+
+namespace
+{
+    // Координаты четырёх текселей билинейной выборки и веса по x и y
+    struct Footprint
+    {
+        uint32_t x0, x1, y0, y1;
+        float fx, fy;
+    };
+
+    Footprint ComputeFootprint(float u, float v, uint32_t width, uint32_t height)
+    {
+        // Сначала повтор в [0, 1): тогда левый тексель лежит в [-1, size - 1],
+        // и для повтора достаточно сравнений вместо деления по модулю
+        u -= std::floor(u);
+        v -= std::floor(v);
+
+        const float x = u * width - 0.5f;
+        const float y = v * height - 0.5f;
+        const float floorX = std::floor(x);
+        const float floorY = std::floor(y);
+        const int ix = (int)floorX;
+        const int iy = (int)floorY;
+
+        Footprint footprint;
+        footprint.x0 = ix < 0 ? width - 1 : (uint32_t)ix;
+        footprint.x1 = ix + 1 >= (int)width ? 0 : (uint32_t)(ix + 1);
+        footprint.y0 = iy < 0 ? height - 1 : (uint32_t)iy;
+        footprint.y1 = iy + 1 >= (int)height ? 0 : (uint32_t)(iy + 1);
+        footprint.fx = x - floorX;
+        footprint.fy = y - floorY;
+        return footprint;
+    }
+
+#if TILED_TEXTURE_SSE2
+    // RGBA8 -> четыре float по каналам
+    __m128 Unpack(uint32_t texel)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i channels = _mm_cvtsi32_si128((int)texel);
+        channels = _mm_unpacklo_epi8(channels, zero);
+        channels = _mm_unpacklo_epi16(channels, zero);
+        return _mm_cvtepi32_ps(channels);
+    }
+
+    __m128 Lerp(__m128 a, __m128 b, float t)
+    {
+        return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t)));
+    }
+#endif
+}
+
+void TiledTexture::Build(const std::vector<Image>& mips)
+{
+    m_Levels.clear();
+    m_Levels.resize(mips.size());
+
+    for (size_t i = 0; i < mips.size(); ++i)
+    {
+        const Image& image = mips[i];
+        Level& level = m_Levels[i];
+        level.width = image.width;
+        level.height = image.height;
+        level.tilesPerRow = (image.width + 3) / 4;
+        level.texels.assign((size_t)level.tilesPerRow * ((image.height + 3) / 4) * 16, 0u);
+
+        for (uint32_t y = 0; y < image.height; ++y)
+        {
+            for (uint32_t x = 0; x < image.width; ++x)
+            {
+                const uint8_t* pixel = image.Pixel(x, y);
+                level.texels[TexelIndex(level, x, y)] =
+                    (uint32_t)pixel[0] | ((uint32_t)pixel[1] << 8) | ((uint32_t)pixel[2] << 16) | ((uint32_t)pixel[3] << 24);
+            }
+        }
+    }
+}
+
+size_t TiledTexture::SizeBytes() const
+{
+    size_t size = 0;
+    for (const Level& level : m_Levels)
+        size += level.texels.size() * sizeof(uint32_t);
+    return size;
+}
+
+uint32_t TiledTexture::Texel(uint32_t level, uint32_t x, uint32_t y) const
+{
+    const Level& source = m_Levels[level];
+    return source.texels[TexelIndex(source, x, y)];
+}
+
+void TiledTexture::SampleBilinear(float u, float v, uint32_t level, float rgba[4]) const
+{
+    if (m_Levels.empty())
+    {
+        std::fill(rgba, rgba + 4, 0.0f);
+        return;
+    }
+
+    const Level& source = m_Levels[std::min<uint32_t>(level, (uint32_t)m_Levels.size() - 1)];
+    const Footprint f = ComputeFootprint(u, v, source.width, source.height);
+    const uint32_t t00 = source.texels[TexelIndex(source, f.x0, f.y0)];
+    const uint32_t t10 = source.texels[TexelIndex(source, f.x1, f.y0)];
+    const uint32_t t01 = source.texels[TexelIndex(source, f.x0, f.y1)];
+    const uint32_t t11 = source.texels[TexelIndex(source, f.x1, f.y1)];
+
+#if TILED_TEXTURE_SSE2
+    __m128 top = Lerp(Unpack(t00), Unpack(t10), f.fx);
+    __m128 bottom = Lerp(Unpack(t01), Unpack(t11), f.fx);
+    _mm_storeu_ps(rgba, _mm_mul_ps(Lerp(top, bottom, f.fy), _mm_set1_ps(1.0f / 255.0f)));
+#else
+    for (int c = 0; c < 4; ++c)
+    {
+        const int shift = c * 8;
+        float c00 = (float)((t00 >> shift) & 0xff), c10 = (float)((t10 >> shift) & 0xff);
+        float c01 = (float)((t01 >> shift) & 0xff), c11 = (float)((t11 >> shift) & 0xff);
+        float top = c00 + (c10 - c00) * f.fx;
+        float bottom = c01 + (c11 - c01) * f.fx;
+        rgba[c] = (top + (bottom - top) * f.fy) * (1.0f / 255.0f);
+    }
+#endif
+}
+
+void TiledTexture::SampleTrilinear(float u, float v, float lod, float rgba[4]) const
+{
+    const float maxLod = m_Levels.empty() ? 0.0f : (float)(m_Levels.size() - 1);
+    lod = std::min(std::max(lod, 0.0f), maxLod);
+
+    const uint32_t level = (uint32_t)lod;
+    const float blend = lod - (float)level;
+    SampleBilinear(u, v, level, rgba);
+    if (blend <= 0.0f) return;
+
+    float next[4];
+    SampleBilinear(u, v, level + 1, next);
+#if TILED_TEXTURE_SSE2
+    _mm_storeu_ps(rgba, Lerp(_mm_loadu_ps(rgba), _mm_loadu_ps(next), blend));
+#else
+    for (int c = 0; c < 4; ++c) rgba[c] += (next[c] - rgba[c]) * blend;
+#endif
+}
+
+SamplerBenchmark BenchmarkSampler(const TiledTexture& texture, uint32_t sampleCount)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    SamplerBenchmark result;
+    if (texture.MipCount() == 0 || sampleCount == 0) return result;
+
+    // «Экран» размером с текстуру: шаг выборки — один тексель нулевого уровня
+    const uint32_t screenWidth = texture.Width();
+    const float du = 1.0f / texture.Width();
+    const float dv = 1.0f / texture.Height();
+
+    float sink[4] = {};
+    float rgba[4];
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < sampleCount; ++i)
+    {
+        texture.SampleBilinear((i % screenWidth + 0.5f) * du, (i / screenWidth + 0.5f) * dv, 0, rgba);
+        sink[0] += rgba[0];
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.bilinearSamplesPerSecond = seconds > 0.0 ? sampleCount / seconds : 0.0;
+
+    start = Clock::now();
+    for (uint32_t i = 0; i < sampleCount; ++i)
+    {
+        texture.SampleTrilinear((i % screenWidth + 0.5f) * du, (i / screenWidth + 0.5f) * dv, 0.5f, rgba);
+        sink[1] += rgba[1];
+    }
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.trilinearSamplesPerSecond = seconds > 0.0 ? sampleCount / seconds : 0.0;
+
+    // Результат выборок должен быть «использован», иначе оптимизатор выбросит циклы
+    volatile float keep = sink[0] + sink[1];
+    (void)keep;
+    return result;
+}
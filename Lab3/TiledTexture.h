@@ -0,0 +1,59 @@
+﻿#pragma once
+
+// Текстура для выборки на CPU. Тексели хранятся плитками 4x4 (64 байта —
+// одна кэш-линия), поэтому четыре текселя билинейной выборки почти всегда
+// лежат в одной линии, а соседние строки экрана переиспользуют те же плитки.
+// Фильтрация векторизована по каналам RGBA (SSE2 там, где он есть).
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TextureCodec.h"
+
+class TiledTexture
+{
+public:
+    // Уровни от нулевого; размеры — как у GenerateMips
+    void Build(const std::vector<Image>& mips);
+
+    uint32_t Width() const { return m_Levels.empty() ? 0 : m_Levels[0].width; }
+    uint32_t Height() const { return m_Levels.empty() ? 0 : m_Levels[0].height; }
+    uint32_t MipCount() const { return (uint32_t)m_Levels.size(); }
+    size_t SizeBytes() const;
+
+    // Адресация с повтором; результат — RGBA в [0, 1]
+    void SampleBilinear(float u, float v, uint32_t level, float rgba[4]) const;
+    void SampleTrilinear(float u, float v, float lod, float rgba[4]) const;
+
+    uint32_t Texel(uint32_t level, uint32_t x, uint32_t y) const;
+
+private:
+    struct Level
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t tilesPerRow = 0;
+        std::vector<uint32_t> texels; // плитки 4x4 построчно, внутри плитки — тоже построчно
+    };
+
+    static size_t TexelIndex(const Level& level, uint32_t x, uint32_t y)
+    {
+        return (((size_t)(y >> 2) * level.tilesPerRow + (x >> 2)) << 4) + ((y & 3) << 2) + (x & 3);
+    }
+
+    std::vector<Level> m_Levels;
+};
+
+struct SamplerBenchmark
+{
+    double bilinearSamplesPerSecond = 0.0;
+    double trilinearSamplesPerSecond = 0.0;
+
+    // Билинейная выборка читает 4 текселя, трилинейная — 8
+    double BilinearTexelsPerSecond() const { return bilinearSamplesPerSecond * 4.0; }
+    double TrilinearTexelsPerSecond() const { return trilinearSamplesPerSecond * 8.0; }
+};
+
+// Выборка вдоль строк «экрана» sampleCount раз с шагом около текселя, как у растеризатора
+SamplerBenchmark BenchmarkSampler(const TiledTexture& texture, uint32_t sampleCount);
@@ -0,0 +1,126 @@
+﻿#include "Upscale.h"
+
+#include <d3dcompiler.h>
+
+#include "AntiAliasing.h"
+
+namespace
+{
+    const char* upscalePixelShaderCode = R"(
+Texture2D Source : register(t0);
+SamplerState LinearClamp : register(s0);
+
+cbuffer UpscaleConstants : register(b0)
+{
+    float4 SourceSize; // ширина, высота, 1 / ширина, 1 / высота
+};
+
+float4 main(float4 pos : SV_POSITION, float2 uv : TEXCOORD0) : SV_Target
+{
+    // Веса Катмулла — Рома для четырёх текселей по каждой оси; средние два
+    // объединяются в одну билинейную выборку между ними
+    float2 position = uv * SourceSize.xy;
+    float2 center = floor(position - 0.5) + 0.5;
+    float2 f = position - center;
+
+    float2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    float2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    float2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    float2 w3 = f * f * (-0.5 + 0.5 * f);
+    float2 w12 = w1 + w2;
+    float2 offset12 = w2 / w12;
+
+    float2 uv0 = (center - 1) * SourceSize.zw;
+    float2 uv3 = (center + 2) * SourceSize.zw;
+    float2 uv12 = (center + offset12) * SourceSize.zw;
+
+    float4 result = 0;
+    result += Source.SampleLevel(LinearClamp, float2(uv0.x, uv0.y), 0) * w0.x * w0.y;
+    result += Source.SampleLevel(LinearClamp, float2(uv12.x, uv0.y), 0) * w12.x * w0.y;
+    result += Source.SampleLevel(LinearClamp, float2(uv3.x, uv0.y), 0) * w3.x * w0.y;
+    result += Source.SampleLevel(LinearClamp, float2(uv0.x, uv12.y), 0) * w0.x * w12.y;
+    result += Source.SampleLevel(LinearClamp, float2(uv12.x, uv12.y), 0) * w12.x * w12.y;
+    result += Source.SampleLevel(LinearClamp, float2(uv3.x, uv12.y), 0) * w3.x * w12.y;
+    result += Source.SampleLevel(LinearClamp, float2(uv0.x, uv3.y), 0) * w0.x * w3.y;
+    result += Source.SampleLevel(LinearClamp, float2(uv12.x, uv3.y), 0) * w12.x * w3.y;
+    result += Source.SampleLevel(LinearClamp, float2(uv3.x, uv3.y), 0) * w3.x * w3.y;
+    return saturate(result);
+}
+)";
+
+    struct UpscaleConstants
+    {
+        float sourceSize[4];
+    };
+}
+
+HRESULT UpscalePass::Init(ID3D11Device* pDevice)
+{
+    Release();
+
+    HRESULT hr = CreateFullscreenVertexShader(pDevice, m_pVertexShader);
+    if (FAILED(hr)) return hr;
+
+    Microsoft::WRL::ComPtr<ID3DBlob> pPSBlob;
+    hr = D3DCompile(upscalePixelShaderCode, strlen(upscalePixelShaderCode), "upscalePixelShader", nullptr, nullptr, "main", "ps_5_0", 0, 0, &pPSBlob, nullptr);
+    if (FAILED(hr)) return hr;
+
+    hr = pDevice->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, m_pPixelShader.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    D3D11_SAMPLER_DESC sd = {};
+    sd.Filter = D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT;
+    sd.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+    sd.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+    sd.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+    sd.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    sd.MaxLOD = D3D11_FLOAT32_MAX;
+    hr = pDevice->CreateSamplerState(&sd, m_pSampler.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    D3D11_BUFFER_DESC bd = {};
+    bd.Usage = D3D11_USAGE_DEFAULT;
+    bd.ByteWidth = sizeof(UpscaleConstants);
+    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    return pDevice->CreateBuffer(&bd, nullptr, m_pConstants.GetAddressOf());
+}
+
+void UpscalePass::Release()
+{
+    m_pVertexShader.Reset();
+    m_pPixelShader.Reset();
+    m_pSampler.Reset();
+    m_pConstants.Reset();
+    m_SourceWidth = m_SourceHeight = 0;
+}
+
+void UpscalePass::Apply(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSource, UINT sourceWidth, UINT sourceHeight,
+    ID3D11RenderTargetView* pTarget, UINT width, UINT height)
+{
+    if (sourceWidth != m_SourceWidth || sourceHeight != m_SourceHeight)
+    {
+        UpscaleConstants constants = { { (float)sourceWidth, (float)sourceHeight, 1.0f / sourceWidth, 1.0f / sourceHeight } };
+        pContext->UpdateSubresource(m_pConstants.Get(), 0, nullptr, &constants, 0, 0);
+        m_SourceWidth = sourceWidth;
+        m_SourceHeight = sourceHeight;
+    }
+
+    pContext->OMSetRenderTargets(1, &pTarget, nullptr);
+    D3D11_VIEWPORT vp = {};
+    vp.Width = (FLOAT)width;
+    vp.Height = (FLOAT)height;
+    vp.MaxDepth = 1.0f;
+    pContext->RSSetViewports(1, &vp);
+
+    pContext->IASetInputLayout(nullptr);
+    pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    pContext->VSSetShader(m_pVertexShader.Get(), nullptr, 0);
+    pContext->PSSetShader(m_pPixelShader.Get(), nullptr, 0);
+    pContext->PSSetShaderResources(0, 1, &pSource);
+    pContext->PSSetSamplers(0, 1, m_pSampler.GetAddressOf());
+    pContext->PSSetConstantBuffers(0, 1, m_pConstants.GetAddressOf());
+    pContext->Draw(3, 0);
+
+    ID3D11ShaderResourceView* pNull = nullptr;
+    pContext->PSSetShaderResources(0, 1, &pNull);
+}
@@ -0,0 +1,28 @@
+﻿#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+// Растяжение кадра внутреннего разрешения на выход: бикубический фильтр
+// Катмулла — Рома, собранный из девяти билинейных выборок вместо шестнадцати
+// точечных. Резче билинейного и без заметного звона на краях.
+class UpscalePass
+{
+public:
+    HRESULT Init(ID3D11Device* pDevice);
+    void Release();
+    bool Ready() const { return m_pConstants.Get() != nullptr; } // Init прошёл целиком
+
+    // pSource — обычная текстура sourceWidth x sourceHeight; пишет во весь pTarget размером width x height.
+    // Меняет шейдеры, входной лейаут и привязки PS t0/s0/b0 — вызывающий восстанавливает своё
+    void Apply(ID3D11DeviceContext* pContext, ID3D11ShaderResourceView* pSource, UINT sourceWidth, UINT sourceHeight,
+        ID3D11RenderTargetView* pTarget, UINT width, UINT height);
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> m_pVertexShader;
+    Microsoft::WRL::ComPtr<ID3D11PixelShader> m_pPixelShader;
+    Microsoft::WRL::ComPtr<ID3D11SamplerState> m_pSampler;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> m_pConstants;
+    UINT m_SourceWidth = 0;
+    UINT m_SourceHeight = 0;
+};
@@ -0,0 +1,271 @@
+﻿#include "VectorMath.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#if VECTOR_MATH_AVX2
+#include <immintrin.h>
+#endif
+
+namespace Math
+{
+#if VECTOR_MATH_AVX2
+    namespace
+    {
+        // Элементы матрицы, размноженные на восемь дорожек: m[строка][столбец]
+        struct BroadcastMatrix
+        {
+            __m256 m[4][4];
+
+            explicit BroadcastMatrix(const Matrix& matrix)
+            {
+                Float4x4 stored;
+                StoreFloat4x4(&stored, matrix);
+                for (int row = 0; row < 4; ++row)
+                    for (int column = 0; column < 4; ++column)
+                        m[row][column] = _mm256_set1_ps(stored.m[row][column]);
+            }
+        };
+
+        // Восемь точек в раскладке SoA: дорожка — точка. Порядок операций в каждой
+        // дорожке тот же, что у Vector3TransformCoord/Normal, поэтому и биты те же
+        __m256 TransformComponent(__m256 x, __m256 y, __m256 z, const BroadcastMatrix& b, int column, bool coord)
+        {
+            __m256 result = _mm256_mul_ps(z, b.m[2][column]);
+            if (coord) result = _mm256_add_ps(result, b.m[3][column]);
+            result = _mm256_add_ps(_mm256_mul_ps(y, b.m[1][column]), result);
+            return _mm256_add_ps(_mm256_mul_ps(x, b.m[0][column]), result);
+        }
+
+        void TransformStream8(Float3* output, const Float3* input, size_t count, const Matrix& m, bool coord, size_t& done)
+        {
+            const BroadcastMatrix b(m);
+
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                // 24 float подряд -> x, y, z по восемь; в каждой 128-битной половине — свои четыре точки
+                const float* p = &input[i].x;
+                const __m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 0)), _mm_loadu_ps(p + 12), 1);
+                const __m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+                const __m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+                const __m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+                const __m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+                const __m256 x = _mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0));
+                const __m256 y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+                const __m256 z = _mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1));
+
+                __m256 ox = TransformComponent(x, y, z, b, 0, coord);
+                __m256 oy = TransformComponent(x, y, z, b, 1, coord);
+                __m256 oz = TransformComponent(x, y, z, b, 2, coord);
+                if (coord)
+                {
+                    const __m256 ow = TransformComponent(x, y, z, b, 3, coord);
+                    ox = _mm256_div_ps(ox, ow);
+                    oy = _mm256_div_ps(oy, ow);
+                    oz = _mm256_div_ps(oz, ow);
+                }
+
+                // Обратная перестановка в x, y, z подряд
+                const __m256 rxy = _mm256_shuffle_ps(ox, oy, _MM_SHUFFLE(2, 0, 2, 0));
+                const __m256 ryz = _mm256_shuffle_ps(oy, oz, _MM_SHUFFLE(3, 1, 3, 1));
+                const __m256 rzx = _mm256_shuffle_ps(oz, ox, _MM_SHUFFLE(3, 1, 2, 0));
+                const __m256 r03 = _mm256_shuffle_ps(rxy, rzx, _MM_SHUFFLE(2, 0, 2, 0));
+                const __m256 r14 = _mm256_shuffle_ps(ryz, rxy, _MM_SHUFFLE(3, 1, 2, 0));
+                const __m256 r25 = _mm256_shuffle_ps(rzx, ryz, _MM_SHUFFLE(3, 1, 3, 1));
+                float* q = &output[i].x;
+                _mm_storeu_ps(q + 0, _mm256_castps256_ps128(r03));
+                _mm_storeu_ps(q + 4, _mm256_castps256_ps128(r14));
+                _mm_storeu_ps(q + 8, _mm256_castps256_ps128(r25));
+                _mm_storeu_ps(q + 12, _mm256_extractf128_ps(r03, 1));
+                _mm_storeu_ps(q + 16, _mm256_extractf128_ps(r14, 1));
+                _mm_storeu_ps(q + 20, _mm256_extractf128_ps(r25, 1));
+            }
+            done = i;
+        }
+
+        // Две строки входной матрицы за раз: splat внутри 128-битных половин
+        __m256 MultiplyRows2(__m256 rows, const __m256 b[4])
+        {
+            const __m256 x = _mm256_mul_ps(_mm256_permute_ps(rows, 0x00), b[0]);
+            const __m256 y = _mm256_mul_ps(_mm256_permute_ps(rows, 0x55), b[1]);
+            const __m256 z = _mm256_mul_ps(_mm256_permute_ps(rows, 0xAA), b[2]);
+            const __m256 w = _mm256_mul_ps(_mm256_permute_ps(rows, 0xFF), b[3]);
+            return _mm256_add_ps(_mm256_add_ps(x, z), _mm256_add_ps(y, w));
+        }
+
+        void MultiplyStream(Float4x4* output, const Float4x4* input, size_t count, const Matrix& m, bool transpose)
+        {
+            __m256 b[4];
+            for (int row = 0; row < 4; ++row)
+                b[row] = _mm256_broadcast_ps(&m.r[row]);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const __m256 rows01 = MultiplyRows2(_mm256_loadu_ps(&input[i].m[0][0]), b);
+                const __m256 rows23 = MultiplyRows2(_mm256_loadu_ps(&input[i].m[2][0]), b);
+                if (!transpose)
+                {
+                    _mm256_storeu_ps(&output[i].m[0][0], rows01);
+                    _mm256_storeu_ps(&output[i].m[2][0], rows23);
+                    continue;
+                }
+
+                __m128 r0 = _mm256_castps256_ps128(rows01);
+                __m128 r1 = _mm256_extractf128_ps(rows01, 1);
+                __m128 r2 = _mm256_castps256_ps128(rows23);
+                __m128 r3 = _mm256_extractf128_ps(rows23, 1);
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                _mm_storeu_ps(output[i].m[0], r0);
+                _mm_storeu_ps(output[i].m[1], r1);
+                _mm_storeu_ps(output[i].m[2], r2);
+                _mm_storeu_ps(output[i].m[3], r3);
+            }
+        }
+    }
+#endif
+
+    void Vector3TransformCoordStream(Float3* output, const Float3* input, size_t count, const Matrix& m)
+    {
+        size_t i = 0;
+#if VECTOR_MATH_AVX2
+        TransformStream8(output, input, count, m, true, i);
+#endif
+        for (; i < count; ++i)
+            StoreFloat3(&output[i], Vector3TransformCoord(LoadFloat3(&input[i]), m));
+    }
+
+    void Vector3TransformNormalStream(Float3* output, const Float3* input, size_t count, const Matrix& m)
+    {
+        size_t i = 0;
+#if VECTOR_MATH_AVX2
+        TransformStream8(output, input, count, m, false, i);
+#endif
+        for (; i < count; ++i)
+            StoreFloat3(&output[i], Vector3TransformNormal(LoadFloat3(&input[i]), m));
+    }
+
+    void MatrixMultiplyStream(Float4x4* output, const Float4x4* input, size_t count, const Matrix& m)
+    {
+#if VECTOR_MATH_AVX2
+        MultiplyStream(output, input, count, m, false);
+#else
+        for (size_t i = 0; i < count; ++i)
+            StoreFloat4x4(&output[i], MatrixMultiply(LoadFloat4x4(&input[i]), m));
+#endif
+    }
+
+    void MatrixMultiplyTransposeStream(Float4x4* output, const Float4x4* input, size_t count, const Matrix& m)
+    {
+#if VECTOR_MATH_AVX2
+        MultiplyStream(output, input, count, m, true);
+#else
+        for (size_t i = 0; i < count; ++i)
+            StoreFloat4x4(&output[i], MatrixTranspose(MatrixMultiply(LoadFloat4x4(&input[i]), m)));
+#endif
+    }
+
+    const char* BackendName()
+    {
+#if VECTOR_MATH_AVX2
+        return "AVX2";
+#elif VECTOR_MATH_SSE
+        return "SSE";
+#elif VECTOR_MATH_NEON
+        return "NEON";
+#else
+        return "scalar";
+#endif
+    }
+}
+
+MathBenchmark BenchmarkVectorMath(size_t count)
+{
+    using namespace Math;
+    typedef std::chrono::steady_clock Clock;
+
+    MathBenchmark result;
+    result.count = count;
+    if (count == 0) return result;
+
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+
+    std::vector<Float3> points(count), transformed(count);
+    for (Float3& point : points)
+        point = Float3(distribution(random), distribution(random), distribution(random));
+
+    std::vector<Float4x4> matrices(count), products(count);
+    for (Float4x4& matrix : matrices)
+        StoreFloat4x4(&matrix, MatrixScaling(1.5f, 1.5f, 1.5f) * MatrixRotationY(distribution(random)) *
+                               MatrixTranslation(distribution(random), distribution(random), distribution(random)));
+
+    const Matrix viewProjection = MatrixLookAtLH(VectorSet(0.0f, 1.0f, -5.0f, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+                                  MatrixPerspectiveFovLH(Pi / 2, 16.0f / 9.0f, 0.01f, 100.0f);
+
+    // Лучшее из нескольких повторов — меньше шума от планировщика
+    const int repeats = 5;
+    auto measure = [&](auto&& body)
+    {
+        double best = 1e30;
+        for (int repeat = 0; repeat < repeats; ++repeat)
+        {
+            const Clock::time_point start = Clock::now();
+            body();
+            best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+        }
+        return best / count;
+    };
+
+    result.transformCoordNs = measure([&]
+    {
+        for (size_t i = 0; i < count; ++i)
+            StoreFloat3(&transformed[i], Vector3TransformCoord(LoadFloat3(&points[i]), viewProjection));
+    });
+    result.transformCoordStreamNs = measure([&] { Vector3TransformCoordStream(transformed.data(), points.data(), count, viewProjection); });
+
+    result.matrixMultiplyNs = measure([&]
+    {
+        for (size_t i = 0; i < count; ++i)
+            StoreFloat4x4(&products[i], MatrixMultiply(LoadFloat4x4(&matrices[i]), viewProjection));
+    });
+    result.matrixMultiplyStreamNs = measure([&] { MatrixMultiplyStream(products.data(), matrices.data(), count, viewProjection); });
+
+    // Пакетные функции обещают те же биты, что и поэлементные
+    std::vector<Float3> single(count);
+    std::vector<Float4x4> singleProducts(count);
+    auto countMismatches = [&result](const void* a, const void* b, size_t size, size_t elements)
+    {
+        for (size_t i = 0; i < elements; ++i)
+            if (memcmp(static_cast<const char*>(a) + i * size, static_cast<const char*>(b) + i * size, size) != 0) ++result.mismatches;
+    };
+    for (int coord = 0; coord < 2; ++coord)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Vector point = LoadFloat3(&points[i]);
+            StoreFloat3(&single[i], coord ? Vector3TransformCoord(point, viewProjection) : Vector3TransformNormal(point, viewProjection));
+        }
+        if (coord)
+            Vector3TransformCoordStream(transformed.data(), points.data(), count, viewProjection);
+        else
+            Vector3TransformNormalStream(transformed.data(), points.data(), count, viewProjection);
+        countMismatches(single.data(), transformed.data(), sizeof(Float3), count);
+    }
+    for (int transpose = 0; transpose < 2; ++transpose)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Matrix product = MatrixMultiply(LoadFloat4x4(&matrices[i]), viewProjection);
+            StoreFloat4x4(&singleProducts[i], transpose ? MatrixTranspose(product) : product);
+        }
+        if (transpose)
+            MatrixMultiplyTransposeStream(products.data(), matrices.data(), count, viewProjection);
+        else
+            MatrixMultiplyStream(products.data(), matrices.data(), count, viewProjection);
+        countMismatches(singleProducts.data(), products.data(), sizeof(Float4x4), count);
+    }
+    return result;
+}
@@ -0,0 +1,457 @@
+﻿#pragma once
+
+// Векторная математика для CPU-стороны: то подмножество DirectXMath, которым
+// пользуется Lab3, без зависимости от заголовков Windows.
+//
+// Результаты совпадают с DirectXMath побитово (его SSE-путь, который собирается
+// по умолчанию): каждая функция повторяет тот же порядок умножений и сложений,
+// те же полиномы синуса/косинуса и то же деление, без FMA. Поэтому и компилятору
+// нельзя сливать a * b + c в FMA: MSVC этого не делает без /fp:contract, GCC и
+// Clang — в режиме -std=c++14 (не gnu++14).
+//
+// Бэкенды выбираются при сборке: SSE на x86/x64, NEON на ARM64, иначе скаляр.
+// VECTOR_MATH_NO_SIMD принудительно включает скалярный путь — в нём все функции,
+// кроме нормализации и LookAt (им нужен sqrt), constexpr. Пакетные функции
+// в конце файла на AVX2 (/arch:AVX2, -mavx2) обрабатывают по две строки или
+// по восемь точек за раз и дают те же биты.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#if !defined(VECTOR_MATH_NO_SIMD) && (defined(_M_ARM64) || defined(__aarch64__))
+#define VECTOR_MATH_SSE 0
+#define VECTOR_MATH_NEON 1
+#include <arm_neon.h>
+#elif !defined(VECTOR_MATH_NO_SIMD) && (defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define VECTOR_MATH_SSE 1
+#define VECTOR_MATH_NEON 0
+#include <xmmintrin.h>
+#else
+#define VECTOR_MATH_SSE 0
+#define VECTOR_MATH_NEON 0
+#endif
+
+#if VECTOR_MATH_SSE && defined(__AVX2__)
+#define VECTOR_MATH_AVX2 1
+#else
+#define VECTOR_MATH_AVX2 0
+#endif
+
+#if VECTOR_MATH_SSE || VECTOR_MATH_NEON
+#define VECTOR_MATH_CONSTEXPR inline
+#else
+#define VECTOR_MATH_CONSTEXPR constexpr
+#endif
+
+namespace Math
+{
+    constexpr float Pi = 3.141592654f;
+    constexpr float TwoPi = 6.283185307f;
+    constexpr float OneDivTwoPi = 0.159154943f;
+    constexpr float PiDiv2 = 1.570796327f;
+
+    // Хранение в памяти: вершины, сцена, константные буферы
+    struct Float3
+    {
+        float x, y, z;
+
+        Float3() = default;
+        constexpr Float3(float x_, float y_, float z_) : x(x_), y(y_), z(z_) {}
+    };
+
+    struct Float4
+    {
+        float x, y, z, w;
+
+        Float4() = default;
+        constexpr Float4(float x_, float y_, float z_, float w_) : x(x_), y(y_), z(z_), w(w_) {}
+    };
+
+    // Построчно, как XMFLOAT4X4; в HLSL уходит транспонированной
+    struct Float4x4
+    {
+        float m[4][4];
+    };
+
+    // Регистр из четырёх float
+#if VECTOR_MATH_SSE
+    typedef __m128 Vector;
+#elif VECTOR_MATH_NEON
+    typedef float32x4_t Vector;
+#else
+    struct Vector
+    {
+        float f[4];
+    };
+#endif
+
+    // Строки матрицы; векторы — строки, умножаются слева (v * M), как в DirectXMath
+    struct Matrix
+    {
+        Vector r[4];
+    };
+
+    // ---------------------------------------------------------------------
+    // Примитивы бэкенда
+
+#if VECTOR_MATH_SSE
+    inline Vector VectorSet(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+    inline Vector VectorZero() { return _mm_setzero_ps(); }
+    inline Vector VectorReplicate(float value) { return _mm_set1_ps(value); }
+
+    inline float VectorGetX(Vector v) { return _mm_cvtss_f32(v); }
+    inline float VectorGetY(Vector v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))); }
+    inline float VectorGetZ(Vector v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))); }
+    inline float VectorGetW(Vector v) { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+    inline Vector VectorSplatX(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)); }
+    inline Vector VectorSplatY(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)); }
+    inline Vector VectorSplatZ(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)); }
+    inline Vector VectorSplatW(Vector v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+    inline Vector VectorAdd(Vector a, Vector b) { return _mm_add_ps(a, b); }
+    inline Vector VectorSubtract(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+    inline Vector VectorMultiply(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+    inline Vector VectorDivide(Vector a, Vector b) { return _mm_div_ps(a, b); }
+
+    inline Vector LoadFloat4(const Float4* p) { return _mm_loadu_ps(&p->x); }
+    inline void StoreFloat4(Float4* p, Vector v) { _mm_storeu_ps(&p->x, v); }
+#elif VECTOR_MATH_NEON
+    inline Vector VectorSet(float x, float y, float z, float w)
+    {
+        const float values[4] = { x, y, z, w };
+        return vld1q_f32(values);
+    }
+    inline Vector VectorZero() { return vdupq_n_f32(0.0f); }
+    inline Vector VectorReplicate(float value) { return vdupq_n_f32(value); }
+
+    inline float VectorGetX(Vector v) { return vgetq_lane_f32(v, 0); }
+    inline float VectorGetY(Vector v) { return vgetq_lane_f32(v, 1); }
+    inline float VectorGetZ(Vector v) { return vgetq_lane_f32(v, 2); }
+    inline float VectorGetW(Vector v) { return vgetq_lane_f32(v, 3); }
+
+    inline Vector VectorSplatX(Vector v) { return vdupq_laneq_f32(v, 0); }
+    inline Vector VectorSplatY(Vector v) { return vdupq_laneq_f32(v, 1); }
+    inline Vector VectorSplatZ(Vector v) { return vdupq_laneq_f32(v, 2); }
+    inline Vector VectorSplatW(Vector v) { return vdupq_laneq_f32(v, 3); }
+
+    inline Vector VectorAdd(Vector a, Vector b) { return vaddq_f32(a, b); }
+    inline Vector VectorSubtract(Vector a, Vector b) { return vsubq_f32(a, b); }
+    inline Vector VectorMultiply(Vector a, Vector b) { return vmulq_f32(a, b); }
+    inline Vector VectorDivide(Vector a, Vector b) { return vdivq_f32(a, b); }
+
+    inline Vector LoadFloat4(const Float4* p) { return vld1q_f32(&p->x); }
+    inline void StoreFloat4(Float4* p, Vector v) { vst1q_f32(&p->x, v); }
+#else
+    constexpr Vector VectorSet(float x, float y, float z, float w) { return Vector{ { x, y, z, w } }; }
+    constexpr Vector VectorZero() { return Vector{ { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+    constexpr Vector VectorReplicate(float value) { return Vector{ { value, value, value, value } }; }
+
+    constexpr float VectorGetX(Vector v) { return v.f[0]; }
+    constexpr float VectorGetY(Vector v) { return v.f[1]; }
+    constexpr float VectorGetZ(Vector v) { return v.f[2]; }
+    constexpr float VectorGetW(Vector v) { return v.f[3]; }
+
+    constexpr Vector VectorSplatX(Vector v) { return VectorReplicate(v.f[0]); }
+    constexpr Vector VectorSplatY(Vector v) { return VectorReplicate(v.f[1]); }
+    constexpr Vector VectorSplatZ(Vector v) { return VectorReplicate(v.f[2]); }
+    constexpr Vector VectorSplatW(Vector v) { return VectorReplicate(v.f[3]); }
+
+    constexpr Vector VectorAdd(Vector a, Vector b) { return VectorSet(a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3]); }
+    constexpr Vector VectorSubtract(Vector a, Vector b) { return VectorSet(a.f[0] - b.f[0], a.f[1] - b.f[1], a.f[2] - b.f[2], a.f[3] - b.f[3]); }
+    constexpr Vector VectorMultiply(Vector a, Vector b) { return VectorSet(a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3]); }
+    constexpr Vector VectorDivide(Vector a, Vector b) { return VectorSet(a.f[0] / b.f[0], a.f[1] / b.f[1], a.f[2] / b.f[2], a.f[3] / b.f[3]); }
+
+    constexpr Vector LoadFloat4(const Float4* p) { return VectorSet(p->x, p->y, p->z, p->w); }
+    inline void StoreFloat4(Float4* p, Vector v) { *p = Float4(v.f[0], v.f[1], v.f[2], v.f[3]); }
+#endif
+
+    // ---------------------------------------------------------------------
+    // Общие функции поверх примитивов; порядок операций — как в DirectXMath
+
+    VECTOR_MATH_CONSTEXPR Vector LoadFloat3(const Float3* p) { return VectorSet(p->x, p->y, p->z, 0.0f); }
+
+    inline void StoreFloat3(Float3* p, Vector v)
+    {
+        p->x = VectorGetX(v);
+        p->y = VectorGetY(v);
+        p->z = VectorGetZ(v);
+    }
+
+#if VECTOR_MATH_SSE || VECTOR_MATH_NEON
+    inline Matrix LoadFloat4x4(const Float4x4* p)
+    {
+        return Matrix{ { LoadFloat4(reinterpret_cast<const Float4*>(p->m[0])), LoadFloat4(reinterpret_cast<const Float4*>(p->m[1])),
+                         LoadFloat4(reinterpret_cast<const Float4*>(p->m[2])), LoadFloat4(reinterpret_cast<const Float4*>(p->m[3])) } };
+    }
+#else
+    constexpr Matrix LoadFloat4x4(const Float4x4* p)
+    {
+        return Matrix{ { VectorSet(p->m[0][0], p->m[0][1], p->m[0][2], p->m[0][3]),
+                         VectorSet(p->m[1][0], p->m[1][1], p->m[1][2], p->m[1][3]),
+                         VectorSet(p->m[2][0], p->m[2][1], p->m[2][2], p->m[2][3]),
+                         VectorSet(p->m[3][0], p->m[3][1], p->m[3][2], p->m[3][3]) } };
+    }
+#endif
+
+    inline void StoreFloat4x4(Float4x4* p, const Matrix& m)
+    {
+        for (int row = 0; row < 4; ++row)
+            StoreFloat4(reinterpret_cast<Float4*>(p->m[row]), m.r[row]);
+    }
+
+    // Знак через вычитание из нуля: -(+0) даёт +0, как XMVectorNegate
+    VECTOR_MATH_CONSTEXPR Vector VectorNegate(Vector v) { return VectorSubtract(VectorZero(), v); }
+
+    // Синус и косинус многочленами 11-й и 10-й степени после приведения к [-pi/2, pi/2] (XMScalarSinCos)
+    VECTOR_MATH_CONSTEXPR void ScalarSinCos(float* pSin, float* pCos, float value)
+    {
+        float quotient = OneDivTwoPi * value;
+        if (value >= 0.0f)
+            quotient = static_cast<float>(static_cast<int>(quotient + 0.5f));
+        else
+            quotient = static_cast<float>(static_cast<int>(quotient - 0.5f));
+        float y = value - TwoPi * quotient;
+
+        float sign = 1.0f;
+        if (y > PiDiv2)
+        {
+            y = Pi - y;
+            sign = -1.0f;
+        }
+        else if (y < -PiDiv2)
+        {
+            y = -Pi - y;
+            sign = -1.0f;
+        }
+
+        const float y2 = y * y;
+        *pSin = (((((-2.3889859e-08f * y2 + 2.7525562e-06f) * y2 - 0.00019840874f) * y2 + 0.0083333310f) * y2 - 0.16666667f) * y2 + 1.0f) * y;
+        const float p = ((((-2.6051615e-07f * y2 + 2.4760495e-05f) * y2 - 0.0013888378f) * y2 + 0.041666638f) * y2 - 0.5f) * y2 + 1.0f;
+        *pCos = sign * p;
+    }
+
+    VECTOR_MATH_CONSTEXPR Matrix MatrixIdentity()
+    {
+        return Matrix{ { VectorSet(1.0f, 0.0f, 0.0f, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+                         VectorSet(0.0f, 0.0f, 1.0f, 0.0f), VectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+    }
+
+    // Строка на матрицу: (x * r0 + z * r2) + (y * r1 + w * r3)
+    VECTOR_MATH_CONSTEXPR Vector MultiplyRow(Vector row, const Matrix& m)
+    {
+        const Vector x = VectorMultiply(VectorSplatX(row), m.r[0]);
+        const Vector y = VectorMultiply(VectorSplatY(row), m.r[1]);
+        const Vector z = VectorMultiply(VectorSplatZ(row), m.r[2]);
+        const Vector w = VectorMultiply(VectorSplatW(row), m.r[3]);
+        return VectorAdd(VectorAdd(x, z), VectorAdd(y, w));
+    }
+
+    VECTOR_MATH_CONSTEXPR Matrix MatrixMultiply(const Matrix& a, const Matrix& b)
+    {
+        return Matrix{ { MultiplyRow(a.r[0], b), MultiplyRow(a.r[1], b), MultiplyRow(a.r[2], b), MultiplyRow(a.r[3], b) } };
+    }
+
+    VECTOR_MATH_CONSTEXPR Matrix operator*(const Matrix& a, const Matrix& b) { return MatrixMultiply(a, b); }
+
+#if VECTOR_MATH_SSE
+    inline Matrix MatrixTranspose(const Matrix& m)
+    {
+        Matrix result = m;
+        _MM_TRANSPOSE4_PS(result.r[0], result.r[1], result.r[2], result.r[3]);
+        return result;
+    }
+#else
+    VECTOR_MATH_CONSTEXPR Matrix MatrixTranspose(const Matrix& m)
+    {
+        return Matrix{ { VectorSet(VectorGetX(m.r[0]), VectorGetX(m.r[1]), VectorGetX(m.r[2]), VectorGetX(m.r[3])),
+                         VectorSet(VectorGetY(m.r[0]), VectorGetY(m.r[1]), VectorGetY(m.r[2]), VectorGetY(m.r[3])),
+                         VectorSet(VectorGetZ(m.r[0]), VectorGetZ(m.r[1]), VectorGetZ(m.r[2]), VectorGetZ(m.r[3])),
+                         VectorSet(VectorGetW(m.r[0]), VectorGetW(m.r[1]), VectorGetW(m.r[2]), VectorGetW(m.r[3])) } };
+    }
+#endif
+
+    // Общая обратная матрица через миноры 2x2 (как XMMatrixInverse). Совпадает
+    // с DirectXMath до нескольких последних бит, но не побитово. Для вырожденной
+    // матрицы определитель 0, а элементы — бесконечности или NaN
+    VECTOR_MATH_CONSTEXPR Matrix MatrixInverse(Vector* pDeterminant, const Matrix& m)
+    {
+        const float a00 = VectorGetX(m.r[0]), a01 = VectorGetY(m.r[0]), a02 = VectorGetZ(m.r[0]), a03 = VectorGetW(m.r[0]);
+        const float a10 = VectorGetX(m.r[1]), a11 = VectorGetY(m.r[1]), a12 = VectorGetZ(m.r[1]), a13 = VectorGetW(m.r[1]);
+        const float a20 = VectorGetX(m.r[2]), a21 = VectorGetY(m.r[2]), a22 = VectorGetZ(m.r[2]), a23 = VectorGetW(m.r[2]);
+        const float a30 = VectorGetX(m.r[3]), a31 = VectorGetY(m.r[3]), a32 = VectorGetZ(m.r[3]), a33 = VectorGetW(m.r[3]);
+
+        // Миноры верхних двух строк (s) и нижних двух (c)
+        const float s0 = a00 * a11 - a10 * a01, s1 = a00 * a12 - a10 * a02, s2 = a00 * a13 - a10 * a03;
+        const float s3 = a01 * a12 - a11 * a02, s4 = a01 * a13 - a11 * a03, s5 = a02 * a13 - a12 * a03;
+        const float c0 = a20 * a31 - a30 * a21, c1 = a20 * a32 - a30 * a22, c2 = a20 * a33 - a30 * a23;
+        const float c3 = a21 * a32 - a31 * a22, c4 = a21 * a33 - a31 * a23, c5 = a22 * a33 - a32 * a23;
+
+        const float determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        if (pDeterminant) *pDeterminant = VectorReplicate(determinant);
+        const float r = 1.0f / determinant;
+
+        return Matrix{ { VectorSet((a11 * c5 - a12 * c4 + a13 * c3) * r, (-a01 * c5 + a02 * c4 - a03 * c3) * r,
+                                   (a31 * s5 - a32 * s4 + a33 * s3) * r, (-a21 * s5 + a22 * s4 - a23 * s3) * r),
+                         VectorSet((-a10 * c5 + a12 * c2 - a13 * c1) * r, (a00 * c5 - a02 * c2 + a03 * c1) * r,
+                                   (-a30 * s5 + a32 * s2 - a33 * s1) * r, (a20 * s5 - a22 * s2 + a23 * s1) * r),
+                         VectorSet((a10 * c4 - a11 * c2 + a13 * c0) * r, (-a00 * c4 + a01 * c2 - a03 * c0) * r,
+                                   (a30 * s4 - a31 * s2 + a33 * s0) * r, (-a20 * s4 + a21 * s2 - a23 * s0) * r),
+                         VectorSet((-a10 * c3 + a11 * c1 - a12 * c0) * r, (a00 * c3 - a01 * c1 + a02 * c0) * r,
+                                   (-a30 * s3 + a31 * s1 - a32 * s0) * r, (a20 * s3 - a21 * s1 + a22 * s0) * r) } };
+    }
+
+    VECTOR_MATH_CONSTEXPR Matrix MatrixScaling(float x, float y, float z)
+    {
+        return Matrix{ { VectorSet(x, 0.0f, 0.0f, 0.0f), VectorSet(0.0f, y, 0.0f, 0.0f),
+                         VectorSet(0.0f, 0.0f, z, 0.0f), VectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+    }
+
+    VECTOR_MATH_CONSTEXPR Matrix MatrixTranslation(float x, float y, float z)
+    {
+        return Matrix{ { VectorSet(1.0f, 0.0f, 0.0f, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+                         VectorSet(0.0f, 0.0f, 1.0f, 0.0f), VectorSet(x, y, z, 1.0f) } };
+    }
+
+    VECTOR_MATH_CONSTEXPR Matrix MatrixRotationX(float angle)
+    {
+        float s = 0.0f, c = 0.0f;
+        ScalarSinCos(&s, &c, angle);
+        return Matrix{ { VectorSet(1.0f, 0.0f, 0.0f, 0.0f), VectorSet(0.0f, c, s, 0.0f),
+                         VectorSet(0.0f, -s, c, 0.0f), VectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+    }
+
+    VECTOR_MATH_CONSTEXPR Matrix MatrixRotationY(float angle)
+    {
+        float s = 0.0f, c = 0.0f;
+        ScalarSinCos(&s, &c, angle);
+        return Matrix{ { VectorSet(c, 0.0f, -s, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+                         VectorSet(s, 0.0f, c, 0.0f), VectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+    }
+
+    VECTOR_MATH_CONSTEXPR Matrix MatrixRotationZ(float angle)
+    {
+        float s = 0.0f, c = 0.0f;
+        ScalarSinCos(&s, &c, angle);
+        return Matrix{ { VectorSet(c, s, 0.0f, 0.0f), VectorSet(-s, c, 0.0f, 0.0f),
+                         VectorSet(0.0f, 0.0f, 1.0f, 0.0f), VectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+    }
+
+    // Сначала крен, затем тангаж, затем рыскание. Совпадает с XMMatrixRotationRollPitchYaw
+    // с точностью до последнего бита, но не побитово: DirectXMath считает её векторным синусом
+    VECTOR_MATH_CONSTEXPR Matrix MatrixRotationRollPitchYaw(float pitch, float yaw, float roll)
+    {
+        return MatrixRotationZ(roll) * MatrixRotationX(pitch) * MatrixRotationY(yaw);
+    }
+
+    VECTOR_MATH_CONSTEXPR Matrix MatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+    {
+        float sinFov = 0.0f, cosFov = 0.0f;
+        ScalarSinCos(&sinFov, &cosFov, 0.5f * fovAngleY);
+        const float range = farZ / (farZ - nearZ);
+        const float height = cosFov / sinFov;
+        const float width = height / aspectRatio;
+        return Matrix{ { VectorSet(width, 0.0f, 0.0f, 0.0f), VectorSet(0.0f, height, 0.0f, 0.0f),
+                         VectorSet(0.0f, 0.0f, range, 1.0f), VectorSet(0.0f, 0.0f, -range * nearZ, 0.0f) } };
+    }
+
+    // (x1 * x2 + y1 * y2) + z1 * z2 во всех компонентах
+    VECTOR_MATH_CONSTEXPR Vector Vector3Dot(Vector a, Vector b)
+    {
+        const Vector product = VectorMultiply(a, b);
+        return VectorReplicate((VectorGetX(product) + VectorGetY(product)) + VectorGetZ(product));
+    }
+
+    VECTOR_MATH_CONSTEXPR Vector Vector3Cross(Vector a, Vector b)
+    {
+        const float ax = VectorGetX(a), ay = VectorGetY(a), az = VectorGetZ(a);
+        const float bx = VectorGetX(b), by = VectorGetY(b), bz = VectorGetZ(b);
+        return VectorSet(ay * bz - az * by, az * bx - ax * bz, ax * by - ay * bx, 0.0f);
+    }
+
+    // Деление на корень из длины (не rsqrt); нулевой вектор остаётся нулевым, бесконечная длина даёт QNaN
+    inline Vector Vector3Normalize(Vector v)
+    {
+        const float lengthSq = VectorGetX(Vector3Dot(v, v));
+        if (lengthSq == INFINITY)
+        {
+            const uint32_t qnanBits = 0x7FC00000;
+            float qnan;
+            memcpy(&qnan, &qnanBits, sizeof(qnan));
+            return VectorReplicate(qnan);
+        }
+        const float length = std::sqrt(lengthSq);
+        if (length == 0.0f) return VectorZero();
+        return VectorDivide(v, VectorReplicate(length));
+    }
+
+    // ((z * r2 + r3) + y * r1) + x * r0, затем деление на w
+    VECTOR_MATH_CONSTEXPR Vector Vector3TransformCoord(Vector v, const Matrix& m)
+    {
+        Vector result = VectorAdd(VectorMultiply(VectorSplatZ(v), m.r[2]), m.r[3]);
+        result = VectorAdd(VectorMultiply(VectorSplatY(v), m.r[1]), result);
+        result = VectorAdd(VectorMultiply(VectorSplatX(v), m.r[0]), result);
+        return VectorDivide(result, VectorSplatW(result));
+    }
+
+    VECTOR_MATH_CONSTEXPR Vector Vector3TransformNormal(Vector v, const Matrix& m)
+    {
+        Vector result = VectorMultiply(VectorSplatZ(v), m.r[2]);
+        result = VectorAdd(VectorMultiply(VectorSplatY(v), m.r[1]), result);
+        return VectorAdd(VectorMultiply(VectorSplatX(v), m.r[0]), result);
+    }
+
+    inline Matrix MatrixLookToLH(Vector eyePosition, Vector eyeDirection, Vector upDirection)
+    {
+        const Vector r2 = Vector3Normalize(eyeDirection);
+        const Vector r0 = Vector3Normalize(Vector3Cross(upDirection, r2));
+        const Vector r1 = Vector3Cross(r2, r0);
+
+        const Vector negEye = VectorNegate(eyePosition);
+        const float d0 = VectorGetX(Vector3Dot(r0, negEye));
+        const float d1 = VectorGetX(Vector3Dot(r1, negEye));
+        const float d2 = VectorGetX(Vector3Dot(r2, negEye));
+
+        const Matrix m = { { VectorSet(VectorGetX(r0), VectorGetY(r0), VectorGetZ(r0), d0),
+                             VectorSet(VectorGetX(r1), VectorGetY(r1), VectorGetZ(r1), d1),
+                             VectorSet(VectorGetX(r2), VectorGetY(r2), VectorGetZ(r2), d2),
+                             VectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+        return MatrixTranspose(m);
+    }
+
+    inline Matrix MatrixLookAtLH(Vector eyePosition, Vector focusPosition, Vector upDirection)
+    {
+        return MatrixLookToLH(eyePosition, VectorSubtract(focusPosition, eyePosition), upDirection);
+    }
+
+    // ---------------------------------------------------------------------
+    // Пакетные функции (VectorMath.cpp); вход и выход могут совпадать
+
+    // output[i] = input[i] * m с делением на w
+    void Vector3TransformCoordStream(Float3* output, const Float3* input, size_t count, const Matrix& m);
+    void Vector3TransformNormalStream(Float3* output, const Float3* input, size_t count, const Matrix& m);
+
+    // output[i] = input[i] * m
+    void MatrixMultiplyStream(Float4x4* output, const Float4x4* input, size_t count, const Matrix& m);
+
+    // output[i] = transpose(input[i] * m) — мировые матрицы сразу в раскладке константного буфера
+    void MatrixMultiplyTransposeStream(Float4x4* output, const Float4x4* input, size_t count, const Matrix& m);
+
+    // Имя бэкенда, с которым собран модуль: "AVX2", "SSE", "NEON" или "scalar"
+    const char* BackendName();
+}
+
+// Скорость по одному элементу и пакетом, в наносекундах на элемент
+struct MathBenchmark
+{
+    size_t count = 0;
+    double transformCoordNs = 0.0;
+    double transformCoordStreamNs = 0.0;
+    double matrixMultiplyNs = 0.0;
+    double matrixMultiplyStreamNs = 0.0;
+    size_t mismatches = 0; // пакетный результат разошёлся с поэлементным хотя бы в одном бите
+};
+
+MathBenchmark BenchmarkVectorMath(size_t count);
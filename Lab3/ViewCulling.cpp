@@ -0,0 +1,195 @@
+﻿#include "ViewCulling.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace Math;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    double Milliseconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    Float4 NormalizePlane(float a, float b, float c, float d)
+    {
+        const float length = std::sqrt(a * a + b * b + c * c);
+        const float inverse = length > 0.0f ? 1.0f / length : 0.0f;
+        return Float4(a * inverse, b * inverse, c * inverse, d * inverse);
+    }
+
+    void CullView(const std::vector<ViewObject>& objects, SceneView& view)
+    {
+        const Clock::time_point start = Clock::now();
+        const Frustum frustum = FrustumFromMatrix(view.view * view.projection);
+
+        view.visibleObjects.clear();
+        view.centers.clear();
+        for (size_t i = 0; i < objects.size(); ++i)
+        {
+            if (!FrustumIntersectsAabb(frustum, objects[i].bounds)) continue;
+            view.visibleObjects.push_back((uint32_t)i);
+            view.centers.push_back(objects[i].center);
+        }
+
+        // Глубина в ключе — по центрам видимых, пакетом
+        Vector3TransformCoordStream(view.centers.data(), view.centers.data(), view.centers.size(), view.view);
+
+        view.queue.Clear();
+        view.queue.Reserve(view.visibleObjects.size());
+        for (size_t n = 0; n < view.visibleObjects.size(); ++n)
+        {
+            const ViewObject& object = objects[view.visibleObjects[n]];
+            const float depth = std::max(0.0f, view.centers[n].z);
+            view.queue.Push(object.transparent ? SortKey::Transparent(object.shader, object.material, object.mesh, depth) :
+                SortKey::Opaque(object.shader, object.material, object.mesh, depth), view.visibleObjects[n]);
+        }
+        view.visible = view.visibleObjects.size();
+        view.cullMs = Milliseconds(start);
+        view.sortMs = view.queue.Sort();
+    }
+}
+
+Frustum FrustumFromMatrix(const Matrix& viewProjection)
+{
+    // Столбцы матрицы: clip = v * M, внутри -w <= x, y <= w и 0 <= z <= w
+    Float4x4 m;
+    StoreFloat4x4(&m, viewProjection);
+    Frustum frustum;
+    frustum.planes[0] = NormalizePlane(m.m[0][3] + m.m[0][0], m.m[1][3] + m.m[1][0], m.m[2][3] + m.m[2][0], m.m[3][3] + m.m[3][0]); // левая
+    frustum.planes[1] = NormalizePlane(m.m[0][3] - m.m[0][0], m.m[1][3] - m.m[1][0], m.m[2][3] - m.m[2][0], m.m[3][3] - m.m[3][0]); // правая
+    frustum.planes[2] = NormalizePlane(m.m[0][3] + m.m[0][1], m.m[1][3] + m.m[1][1], m.m[2][3] + m.m[2][1], m.m[3][3] + m.m[3][1]); // нижняя
+    frustum.planes[3] = NormalizePlane(m.m[0][3] - m.m[0][1], m.m[1][3] - m.m[1][1], m.m[2][3] - m.m[2][1], m.m[3][3] - m.m[3][1]); // верхняя
+    frustum.planes[4] = NormalizePlane(m.m[0][2], m.m[1][2], m.m[2][2], m.m[3][2]);                                                 // ближняя
+    frustum.planes[5] = NormalizePlane(m.m[0][3] - m.m[0][2], m.m[1][3] - m.m[1][2], m.m[2][3] - m.m[2][2], m.m[3][3] - m.m[3][2]); // дальняя
+    return frustum;
+}
+
+bool FrustumIntersectsAabb(const Frustum& frustum, const Aabb& box)
+{
+    if (box.Empty()) return false;
+
+    // Для каждой плоскости — угол бокса, дальше всех продвинутый внутрь
+    for (const Float4& plane : frustum.planes)
+    {
+        const float x = plane.x >= 0.0f ? box.max.x : box.min.x;
+        const float y = plane.y >= 0.0f ? box.max.y : box.min.y;
+        const float z = plane.z >= 0.0f ? box.max.z : box.min.z;
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) return false;
+    }
+    return true;
+}
+
+ViewCullingStats CullViews(const std::vector<ViewObject>& objects, SceneView* const* views, size_t viewCount, unsigned threadCount)
+{
+    const Clock::time_point start = Clock::now();
+    threadCount = (unsigned)std::max<size_t>(1, std::min<size_t>(threadCount, viewCount));
+
+    std::atomic<size_t> next(0);
+    Jobs().RunTasks(threadCount, [&](unsigned)
+    {
+        for (size_t view = next++; view < viewCount; view = next++)
+            CullView(objects, *views[view]);
+    });
+
+    ViewCullingStats stats;
+    stats.views = viewCount;
+    stats.objects = objects.size();
+    stats.threads = threadCount;
+    for (size_t view = 0; view < viewCount; ++view)
+        stats.visible += views[view]->visible;
+    stats.ms = Milliseconds(start);
+    return stats;
+}
+
+ViewCullingBenchmark BenchmarkViewCulling(size_t objectCount, size_t viewCount, unsigned threadCount)
+{
+    const size_t Repeats = 5;
+    const float radius = 50.0f;
+
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * Pi);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<ViewObject> objects(objectCount);
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        // Равномерно по площади круга, высота и размер — немного случайные
+        const float a = angle(random), r = radius * std::sqrt(unit(random));
+        const float size = 0.25f + unit(random);
+        ViewObject& object = objects[i];
+        object.center = Float3(r * std::cos(a), 2.0f * unit(random), r * std::sin(a));
+        object.bounds.Grow(Float3(object.center.x - size, object.center.y - size, object.center.z - size));
+        object.bounds.Grow(Float3(object.center.x + size, object.center.y + size, object.center.z + size));
+        object.material = (uint32_t)(random() % 64);
+        object.mesh = (uint32_t)(random() % 256);
+        object.transparent = random() % 8 == 0;
+    }
+
+    std::vector<SceneView> views(viewCount);
+    std::vector<SceneView> serialViews(viewCount);
+    std::vector<SceneView*> pointers(viewCount), serialPointers(viewCount);
+    for (size_t v = 0; v < viewCount; ++v)
+    {
+        const float a = 2.0f * Pi * v / viewCount;
+        const Matrix view = MatrixLookAtLH(VectorSet(0.2f * radius * std::cos(a), 2.0f, 0.2f * radius * std::sin(a), 0.0f),
+            VectorSet(radius * std::cos(a), 0.0f, radius * std::sin(a), 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        const Matrix projection = MatrixPerspectiveFovLH(PiDiv2, 16.0f / 9.0f, 0.1f, 200.0f);
+        views[v].view = serialViews[v].view = view;
+        views[v].projection = serialViews[v].projection = projection;
+        pointers[v] = &views[v];
+        serialPointers[v] = &serialViews[v];
+    }
+
+    ViewCullingBenchmark result;
+    result.objects = objectCount;
+    result.views = viewCount;
+    result.threads = (unsigned)std::max<size_t>(1, std::min<size_t>(threadCount, viewCount));
+    result.singleViewMs = result.serialMs = result.parallelMs = INFINITY;
+    for (size_t repeat = 0; repeat < Repeats; ++repeat)
+    {
+        result.singleViewMs = std::min(result.singleViewMs, CullViews(objects, serialPointers.data(), 1, 1).ms);
+        result.serialMs = std::min(result.serialMs, CullViews(objects, serialPointers.data(), viewCount, 1).ms);
+        result.parallelMs = std::min(result.parallelMs, CullViews(objects, pointers.data(), viewCount, threadCount).ms);
+    }
+
+    // Сверка: центр внутри пирамиды — объект обязан остаться; потоки не меняют результат
+    for (size_t v = 0; v < viewCount; ++v)
+    {
+        const SceneView& view = views[v];
+        result.visibleFraction += objectCount > 0 ? (double)view.visible / objectCount / viewCount : 0.0;
+
+        std::vector<bool> kept(objectCount, false);
+        for (uint32_t object : view.visibleObjects)
+            kept[object] = true;
+        const Matrix viewProjection = view.view * view.projection;
+        for (size_t i = 0; i < objectCount; ++i)
+        {
+            const Vector center = LoadFloat3(&objects[i].center);
+            const Vector ndc = Vector3TransformCoord(center, viewProjection);
+            const bool inside = VectorGetZ(Vector3TransformCoord(center, view.view)) > 0.0f &&
+                std::fabs(VectorGetX(ndc)) <= 1.0f && std::fabs(VectorGetY(ndc)) <= 1.0f && VectorGetZ(ndc) >= 0.0f && VectorGetZ(ndc) <= 1.0f;
+            if (inside && !kept[i]) ++result.mismatches;
+        }
+
+        const std::vector<DrawItem>& items = view.queue.Items();
+        const std::vector<DrawItem>& serialItems = serialViews[v].queue.Items();
+        if (items.size() != serialItems.size())
+        {
+            ++result.mismatches;
+            continue;
+        }
+        for (size_t n = 0; n < items.size(); ++n)
+        {
+            if (items[n].key != serialItems[n].key || items[n].payload != serialItems[n].payload)
+                ++result.mismatches;
+        }
+    }
+    return result;
+}
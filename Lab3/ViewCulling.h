@@ -0,0 +1,87 @@
+﻿#pragma once
+
+// Отсечение общей сцены несколькими видами (окна, захват) и сборка очереди
+// отрисовки каждого вида. Мировые объёмы и ключи состояния объектов считаются
+// раз в кадр и общие для всех видов; на вид приходятся только отсечение
+// пирамидой видимости, глубина для ключа и сортировка, и виды считаются
+// параллельно. Отправка очередей в D3D — у вызывающего (main.cpp), D3D здесь нет.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bvh.h"
+#include "RenderQueue.h"
+#include "VectorMath.h"
+
+// Плоскости (a, b, c, d): точка внутри, если a*x + b*y + c*z + d >= 0 для всех шести
+struct Frustum
+{
+    Math::Float4 planes[6];
+};
+
+// Из матрицы вид * проекция (v * M, глубина отсечения 0..1, как у D3D)
+Frustum FrustumFromMatrix(const Math::Matrix& viewProjection);
+
+// Консервативно: false — бокс целиком снаружи одной из плоскостей
+bool FrustumIntersectsAabb(const Frustum& frustum, const Aabb& box);
+
+// Объект сцены, каким его видят все виды
+struct ViewObject
+{
+    Aabb bounds;         // мировой
+    Math::Float3 center = Math::Float3(0.0f, 0.0f, 0.0f); // по глубине этой точки сортируется объект
+    uint32_t shader = 0;
+    uint32_t material = 0;
+    uint32_t mesh = 0;
+    bool transparent = false;
+};
+
+// Один вид: камера на входе, видимые объекты в порядке отправки на выходе
+struct SceneView
+{
+    Math::Matrix view = Math::MatrixIdentity();
+    Math::Matrix projection = Math::MatrixIdentity();
+
+    RenderQueue queue;    // payload — номер объекта
+    size_t visible = 0;
+    double cullMs = 0.0;  // отсечение и ключи
+    double sortMs = 0.0;
+
+    std::vector<uint32_t> visibleObjects; // рабочие массивы вида
+    std::vector<Math::Float3> centers;
+
+    size_t CapacityBytes() const
+    {
+        return queue.CapacityBytes() + visibleObjects.capacity() * sizeof(uint32_t) + centers.capacity() * sizeof(Math::Float3);
+    }
+};
+
+struct ViewCullingStats
+{
+    size_t views = 0;
+    size_t objects = 0;
+    size_t visible = 0;   // сумма по видам
+    unsigned threads = 0;
+    double ms = 0.0;      // все виды, до последней отсортированной очереди
+};
+
+// Отсекает objects каждым видом и собирает его очередь. Виды раздаются потокам
+// по одному: поток, закончивший свой, берёт следующий
+ViewCullingStats CullViews(const std::vector<ViewObject>& objects, SceneView* const* views, size_t viewCount, unsigned threadCount);
+
+struct ViewCullingBenchmark
+{
+    size_t objects = 0;
+    size_t views = 0;
+    unsigned threads = 0;
+    double singleViewMs = 0.0;     // один вид
+    double serialMs = 0.0;         // все виды в одном потоке
+    double parallelMs = 0.0;       // все виды в threads потоках
+    double visibleFraction = 0.0;  // в среднем по видам
+    size_t mismatches = 0; // отброшенные объекты с центром внутри пирамиды и расхождения параллельного прогона с последовательным
+};
+
+// Случайная сцена из objectCount кубиков на круге; камеры видов стоят у центра
+// и смотрят наружу в разные стороны. Лучшее из нескольких повторов
+ViewCullingBenchmark BenchmarkViewCulling(size_t objectCount, size_t viewCount, unsigned threadCount);
@@ -0,0 +1,106 @@
+﻿#include "Bvh.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// Замеры без окна и D3D — то же, что ключи -*bench у Lab3.exe, но для Linux и CI.
+// Без ключей запускает всё; код возврата ненулевой при расхождениях.
+//   Lab3Bench [-jobs N] [-bvhbench [треугольники]] [-jobbench [потоки]]
+
+namespace
+{
+    struct BenchOptions
+    {
+        unsigned jobThreads = 0;
+        size_t bvhBenchmarkTriangles = 0;
+        unsigned jobBenchmarkThreads = 0;
+    };
+
+    bool HasValue(int i, int argc, char* argv[])
+    {
+        return i + 1 < argc && argv[i + 1][0] != '-';
+    }
+
+    int RunBvhBenchmark(size_t triangleCount)
+    {
+        const unsigned threads = Jobs().ThreadCount();
+        const BvhBenchmark result = BenchmarkBvh(triangleCount, 1 << 20, threads);
+
+        std::printf("BVH benchmark: %zu triangles, %zu nodes, depth %u, SAH cost %.1f\n", result.triangles, result.nodes, result.depth, result.sahCost);
+        std::printf("  build %.1f ms on %u threads, %.1f ms on one; refit %.2f ms\n", result.buildMs, result.threads, result.singleThreadBuildMs, result.refitMs);
+        std::printf("  %zu camera rays (%.0f%% hit): %.2f Mrays/s single, %.2f Mrays/s in packets of %zu; random rays %.2f Mrays/s\n",
+            result.rays, result.hitRate * 100.0, result.coherentRaysPerSecond / 1e6, result.packetRaysPerSecond / 1e6, RayPacketSize, result.incoherentRaysPerSecond / 1e6);
+        std::printf("  mismatches against single rays and brute force: %zu\n", result.mismatches);
+        return result.mismatches == 0 ? 0 : 1;
+    }
+
+    int RunJobBenchmark(unsigned maxThreads)
+    {
+        const JobBenchmark result = BenchmarkJobs(maxThreads);
+        std::printf("Job system benchmark: parallel for over %zu uneven elements, %zu jobs in dependent layers, %u cores\n",
+            result.elements, result.graphJobs, std::thread::hardware_concurrency());
+        for (const JobScalingPoint& point : result.points)
+        {
+            std::printf("  %2u threads: for %.2f ms (%.2fx), layers %.2f ms, %.1f%% stolen, %.2f%% contended, %llu splits\n",
+                point.threads, point.forMs, point.speedup, point.graphMs, point.stealRate * 100.0, point.contentionRate * 100.0,
+                (unsigned long long)point.splits);
+        }
+        std::printf("  mismatches: %zu\n", result.mismatches);
+        return result.mismatches == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    bool any = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-bvhbench") == 0)
+        {
+            options.bvhBenchmarkTriangles = 2000000;
+            if (HasValue(i, argc, argv))
+                options.bvhBenchmarkTriangles = (size_t)std::strtoull(argv[++i], nullptr, 10);
+            any = true;
+        }
+        else if (std::strcmp(argv[i], "-jobbench") == 0)
+        {
+            options.jobBenchmarkThreads = 64;
+            if (HasValue(i, argc, argv))
+                options.jobBenchmarkThreads = (unsigned)std::max(1, std::atoi(argv[++i]));
+            any = true;
+        }
+        else if (std::strcmp(argv[i], "-jobs") == 0 && i + 1 < argc)
+        {
+            options.jobThreads = (unsigned)std::max(1, std::atoi(argv[++i]));
+        }
+        else
+        {
+            std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (!any)
+    {
+        options.bvhBenchmarkTriangles = 2000000;
+        options.jobBenchmarkThreads = 64;
+    }
+
+    if (options.jobThreads > 0)
+    {
+        JobSystemSettings settings;
+        settings.threads = options.jobThreads;
+        ConfigureJobs(settings);
+    }
+
+    int result = 0;
+    if (options.bvhBenchmarkTriangles > 0 && RunBvhBenchmark(options.bvhBenchmarkTriangles) != 0)
+        result = 1;
+    if (options.jobBenchmarkThreads > 0 && RunJobBenchmark(options.jobBenchmarkThreads) != 0)
+        result = 1;
+    return result;
+}
@@ -1,37 +1,288 @@
 ﻿#include <windows.h>
+#include <windowsx.h>
 #include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
-#include <DirectXMath.h>
+#include <DirectXMath.h> // только для сравнения в -mathbench
 #include <wrl/client.h> // For Microsoft::WRL::ComPtr
+#include <shellapi.h>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Animation.h"
+#include "AntiAliasing.h"
+#include "Bvh.h"
+#include "ClusteredLights.h"
+#include "CoverageRaster.h"
+#include "DynamicResolution.h"
+#include "FrameWriter.h"
+#include "GpuTimer.h"
+#include "Input.h"
+#include "JobSystem.h"
+#include "MemoryTracker.h"
+#include "MeshStreamer.h"
+#include "RenderGraph.h"
+#include "RenderQueue.h"
+#include "RenderTarget.h"
+#include "ResourceManager.h"
+#include "Scene.h"
+#include "Startup.h"
+#include "Surface.h"
+#include "Texture.h"
+#include "TiledTexture.h"
+#include "Upscale.h"
+#include "VectorMath.h"
+#include "ViewCulling.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "dxgi.lib")
 #pragma comment(lib, "winmm.lib")
 #pragma comment(lib, "user32.lib")
+#pragma comment(lib, "shell32.lib")
+#pragma comment(lib, "ole32.lib")
+#pragma comment(lib, "windowscodecs.lib")
 
-using namespace DirectX;
+using namespace Math;
 
 // Глобальные переменные
-Microsoft::WRL::ComPtr<IDXGISwapChain> g_pSwapChain = nullptr;
 Microsoft::WRL::ComPtr<ID3D11Device> g_pd3dDevice = nullptr;
 Microsoft::WRL::ComPtr<ID3D11DeviceContext> g_pImmediateContext = nullptr;
-Microsoft::WRL::ComPtr<ID3D11RenderTargetView> g_pRenderTargetView = nullptr;
+
+// Окна вывода (-views N) на одном устройстве. У окна свои цепочка обмена,
+// камера (общая орбита, повёрнутая вокруг сцены на yawOffset) и очередь
+// отрисовки; сцена, ресурсы, пулы и шейдеры общие. Первое окно главное: его
+// закрытие завершает программу, остальные закрываются по одному
+struct OutputWindow
+{
+    HWND hWnd = nullptr;
+    Surface surface;
+    float yawOffset = 0.0f;
+    SceneView sceneView;
+    RenderQueueStats renderStats;
+    RenderGraphStats graphStats;
+};
+std::vector<std::unique_ptr<OutputWindow>> g_Windows;
 
 Microsoft::WRL::ComPtr<ID3D11VertexShader> g_pVertexShader = nullptr;
 Microsoft::WRL::ComPtr<ID3D11PixelShader> g_pPixelShader = nullptr;
 Microsoft::WRL::ComPtr<ID3D11InputLayout> g_pVertexLayout = nullptr;
-Microsoft::WRL::ComPtr<ID3D11Buffer> g_pVertexBuffer = nullptr;
-Microsoft::WRL::ComPtr<ID3D11Buffer> g_pIndexBuffer = nullptr;
-Microsoft::WRL::ComPtr<ID3D11Buffer> g_pConstantBufferWorld = nullptr;
-Microsoft::WRL::ComPtr<ID3D11Buffer> g_pConstantBufferViewProjection = nullptr;
 
-float g_CameraPitch = 0.0f;
-float g_CameraYaw = 0.0f;
+// Буферы берутся из пулов менеджера ресурсов; вершины и индексы — со смещением в общем блоке
+ResourceManager g_Resources;
+GpuBuffer g_VertexBuffer;
+GpuBuffer g_IndexBuffer;
+GpuBuffer g_ConstantBufferWorld;
+GpuBuffer g_ConstantBufferViewProjection;
+
+// Ввод копится в буфере с отметками времени (WndProc, сырой ввод) и забирается
+// в Render прямо перед матрицей вида; камера движется по времени удержания клавиш.
+// Без сырого ввода (не зарегистрировался) клавиши берутся из WM_KEYDOWN/WM_KEYUP
+InputBuffer g_Input;
+CameraController g_Camera;
+bool g_RawInput = false;
+
+// Задержка от ввода до экрана по главному окну: время показа кадра берётся из
+// статистики кадров DXGI, а если цепочка обмена её не даёт — момент, когда GPU
+// дорисовал кадр (запрос-событие), то есть без времени вывода на экран
+enum class LatencySource
+{
+    Scanout,
+    GpuDone,
+};
+struct LatencyProbe
+{
+    Microsoft::WRL::ComPtr<ID3D11Query> pQuery;
+    uint64_t frameId = 0;
+    bool pending = false;
+};
+LatencyTracker g_InputLatency;
+LatencySource g_LatencySource = LatencySource::Scanout;
+LatencyProbe g_LatencyProbes[4];
+uint64_t g_LatencyFrame = 0;
+
+// Таймер, которым кадры рисуются во время перетаскивания рамки окна
+const UINT_PTR g_SizeMoveTimerId = 1;
+
+Scene g_Scene = DefaultScene();
+
+// Меши сцены грузятся в фоне; пока меш не на GPU, на его месте рисуется кубик
+struct ResidentMesh
+{
+    GpuBuffer vertexBuffer;
+    GpuBuffer indexBuffer;
+    UINT indexCount = 0;
+};
+
+MeshStreamer g_MeshStreamer;
+std::vector<ResidentMesh> g_Meshes;   // по номеру меша в стримере
+std::vector<uint32_t> g_ObjectMeshes; // номер меша для каждого объекта сцены
+const uint64_t g_UploadBudgetBytes = 8 * 1024 * 1024;
+const double g_UploadBudgetMs = 2.0;
+
+// Выбор объекта мышью: BVH по мировым объёмам объектов (под вращение его подгоняет
+// Refit) и BVH по треугольникам меша — его строит фоновая задача сразу после загрузки
+// меша на GPU, а копия позиций и индексов живёт только до конца построения
+struct PickableMesh
+{
+    std::vector<Float3> positions; // копия с загрузки на GPU для задачи построения
+    std::vector<uint32_t> indices;
+    Aabb bounds;
+    MeshBvh bvh;                        // пока bvhReady == false, его пишет задача построения
+    std::unique_ptr<JobCounter> pBuild; // задача запущена, основной поток её ещё не принял
+    bool bvhReady = false;
+
+    uint64_t SizeBytes() const
+    {
+        return positions.capacity() * sizeof(Float3) + indices.capacity() * sizeof(uint32_t) + (bvhReady ? bvh.SizeBytes() : 0);
+    }
+};
+std::vector<PickableMesh> g_PickMeshes; // по номеру меша в стримере
+MeshBvh g_CubeBvh;
+Bvh g_ObjectBvh;
+std::vector<Aabb> g_ObjectBounds;
+bool g_PickRequested = false;
+OutputWindow* g_pPickWindow = nullptr;
+int g_PickX = 0;
+int g_PickY = 0;
+
+// Текстуры сцены; объекты без текстуры рисуются с белой 1x1, то есть цветом вершин
+Microsoft::WRL::ComPtr<ID3D11SamplerState> g_pSamplerLinear = nullptr;
+Texture g_WhiteTexture;
+std::vector<Texture> g_Textures;
+std::vector<uint32_t> g_ObjectTextures; // индекс в g_Textures для каждого объекта; ~0u — белая
+
+// Текстуры, подготовленные до создания устройства (декодированы и сжаты), по файлу;
+// LoadSceneTextures создаёт из них текстуры на GPU и очищает список
+struct PreparedTexture
+{
+    std::string path;
+    TextureData data;
+    bool prepared = false;
+};
+std::vector<PreparedTexture> g_PreparedTextures;
+
+// Отрисовки сортируются по ключу состояния; объекты с полупрозрачной текстурой
+// рисуются вторым проходом, от дальних к ближним, со смешиванием и без записи глубины.
+// Мировые матрицы, объёмы и ключи объектов считаются раз в кадр на все виды;
+// отсечение и очереди видов (окна, захват) — в CullViews, виды параллельно
+std::vector<Float4x4> g_ObjectWorlds; // транспонированные, как их ждёт буфер b0
+std::vector<ViewObject> g_ViewObjects;
+ViewCullingStats g_ViewCullingStats; // окон последнего кадра
+SceneView g_OffscreenView;           // захват и пакетный режим
+RenderQueueStats g_RenderStats; // последнего вызова RenderScene
+Microsoft::WRL::ComPtr<ID3D11BlendState> g_pBlendAlpha = nullptr;
+Microsoft::WRL::ComPtr<ID3D11DepthStencilState> g_pDepthReadOnly = nullptr;
+
+// Динамический структурный буфер для чтения в шейдере: растёт до степени двойки
+// и перезаписывается целиком через Map с WRITE_DISCARD
+struct StructuredBuffer
+{
+    Microsoft::WRL::ComPtr<ID3D11Buffer> pBuffer;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> pShaderResourceView;
+    UINT capacity = 0; // в элементах
+    uint64_t sizeBytes = 0;
+};
+
+// Кластерное освещение: источники раскладываются по кластерам на CPU каждый кадр,
+// пиксельный шейдер перебирает только список своего кластера (t1 — источники,
+// t2 — диапазоны кластеров, t3 — индексы источников)
+LightClusterer g_LightClusterer;
+std::vector<PointLight> g_FrameLights; // источники сцены в момент t, в мировых координатах
+StructuredBuffer g_LightBuffer;
+StructuredBuffer g_ClusterRangeBuffer;
+StructuredBuffer g_LightIndexBuffer;
+GpuBuffer g_ConstantBufferLighting;
+const float g_AmbientLight = 0.15f;
+
+// Сглаживание (F9 — следующий режим) и его цена: время кадра на GPU по режимам,
+// среднее за последнюю секунду в каждом режиме
+AntiAliasingMode g_AntiAliasing = AntiAliasingMode::None;
+UINT g_SupportedSamples[(int)AntiAliasingMode::Count] = {}; // сколько выборок режим реально получит на этом устройстве
+Microsoft::WRL::ComPtr<ID3D11RasterizerState> g_pRasterizerMultisample = nullptr;
+FxaaPass g_Fxaa;
+GpuTimer g_GpuTimer;
+double g_AntiAliasingGpuMs[(int)AntiAliasingMode::Count] = {}; // 0 — режим ещё не мерили
+
+// Динамическое разрешение окна (F8 — вкл/выкл): сцена рисуется во внутреннюю цель,
+// масштаб которой регулятор подбирает по времени кадра, и растягивается на back buffer
+ResolutionController g_Resolution;
+bool g_DynamicResolution = true;
+UpscalePass g_Upscale;
+
+// Граф кадра: проходы вида (сцена, сглаживание, растяжение) объявляются заново на
+// каждый кадр, а какие промежуточные цели взять из пула, какие из них совместить,
+// что очистить и что выбросить, решает RenderGraph::Compile. DiscardView есть
+// только у контекста D3D11.1 — без него выбрасывание просто пропускается
+struct GraphTarget
+{
+    ID3D11Texture2D* pTexture = nullptr;
+    ID3D11RenderTargetView* pRenderTargetView = nullptr;
+    ID3D11ShaderResourceView* pShaderResourceView = nullptr;
+    ID3D11DepthStencilView* pDepthStencilView = nullptr;
+};
+RenderGraph g_FrameGraph;
+std::vector<GraphTarget> g_GraphTargets; // по номеру цели графа: внешние — от вызывающего, временные — из пула на время ExecuteGraph
+Microsoft::WRL::ComPtr<ID3D11DeviceContext1> g_pImmediateContext1;
+
+// Учёт памяти по категориям (F7 — снимок в memory.json). Пулы ResourceManager
+// и текстуры отмечают выделения сами; то, что известно только итогом, сверяется
+// раз в кадр в TrackFrameMemory
+MemoryTracker g_Memory;
 
-HWND g_hWnd = nullptr;
+struct TrackedMemory
+{
+    uint64_t surface = 0;         // GPU, Target: цепочка обмена и глубина окна
+    uint64_t streamingMeshes = 0; // CPU, Mesh: разобранные меши, ждущие загрузки на GPU
+    uint64_t frameData = 0;       // CPU, Transient: очередь отрисовки, источники и кластеры кадра
+    uint64_t frameWriter = 0;     // CPU, Staging: кадры в очереди записи и пул их буферов
+};
+TrackedMemory g_TrackedMemory;
+
+// Фазы запуска и время до первого кадра. Отсчёт — от создания глобальных
+// объектов, то есть почти от старта процесса
+StartupTimeline g_Startup;
+bool g_FirstFramePresented = false;
+
+// Захват кадров во внеэкранную цель (F12) с потоковой записью на диск
+const UINT g_CaptureWidth = 1920;
+const UINT g_CaptureHeight = 1080;
+const UINT g_CaptureReadbackSlots = 3;
+const UINT g_BatchReadbackSlots = 4;
+
+ReadbackRing g_CaptureReadback;
+FrameWriter g_FrameWriter;
+bool g_CaptureEnabled = false;
+UINT g_CaptureFrameIndex = 0;
+
+// Анимированные персонажи сцены (F6 — где считается скиннинг). Позы толпы
+// считаются параллельно на CPU; на GPU вершинный шейдер смешивает кости по
+// палитрам из структурного буфера, одной инстансной отрисовкой на всех, на CPU —
+// пакетный скиннинг пишет готовые вершины в общий буфер
+enum class SkinningMode
+{
+    Gpu,
+    Cpu,
+};
 
-bool g_CameraUpdated = false; // Флаг для обновления камеры
+SkinningMode g_SkinningMode = SkinningMode::Gpu;
+CrowdAnimator g_Crowd;
+std::vector<CharacterInstance> g_Characters;
+Microsoft::WRL::ComPtr<ID3D11VertexShader> g_pSkinnedVertexShader = nullptr;
+Microsoft::WRL::ComPtr<ID3D11InputLayout> g_pSkinnedVertexLayout = nullptr;
+GpuBuffer g_CharacterVertexBuffer; // поза привязки: позиция и цвет
+GpuBuffer g_CharacterSkinBuffer;   // кости и веса вершин, второй поток
+GpuBuffer g_CharacterIndexBuffer;
+GpuBuffer g_SkinnedVertexBuffer;   // результат CPU-скиннинга, персонажи подряд
+GpuBuffer g_ConstantBufferSkinning;
+StructuredBuffer g_BoneBuffer;     // палитры всех персонажей, по четыре строки на матрицу
+float g_AnimatedTime = -1.0f;      // момент, для которого посчитаны позы и вершины; <0 — ещё не считались
+SkinningMode g_AnimatedMode = SkinningMode::Gpu;
 
 // Встроенные шейдеры
 const char* vertexShaderCode = R"(
@@ -56,6 +307,8 @@ struct PS_INPUT
 {
     float4 Pos : SV_POSITION;
     float4 Color : COLOR;
+    float3 ObjectPos : TEXCOORD0;
+    float3 ViewPos : TEXCOORD1;
 };
 
 PS_INPUT main(VS_INPUT input)
@@ -63,47 +316,266 @@ PS_INPUT main(VS_INPUT input)
     PS_INPUT output;
     output.Pos = mul(input.Pos, mWorld);
     output.Pos = mul(output.Pos, mView);
+    output.ViewPos = output.Pos.xyz;
+    output.Pos = mul(output.Pos, mProjection);
+    output.Color = input.Color;
+    output.ObjectPos = input.Pos.xyz;
+    return output;
+}
+)";
+
+// Скиннинг на GPU: позиция — сумма вершины, переведённой костями, по весам.
+// Палитра персонажа выбирается по номеру экземпляра; матрицы мировые, поэтому mWorld не нужен
+const char* skinnedVertexShaderCode = R"(
+cbuffer ConstantBufferViewProjection : register(b1)
+{
+    matrix mView;
+    matrix mProjection;
+};
+
+cbuffer ConstantBufferSkinning : register(b3)
+{
+    uint4 Skinning; // x — суставов на персонажа
+};
+
+// Строки матриц как на CPU (v * M), поэтому float4x4 собирается из строк без транспонирования
+StructuredBuffer<float4> Bones : register(t0);
+
+struct VS_INPUT
+{
+    float4 Pos : POSITION;
+    float4 Color : COLOR;
+    uint4 Joints : BLENDINDICES;
+    float4 Weights : BLENDWEIGHT;
+    uint Instance : SV_InstanceID;
+};
+
+struct PS_INPUT
+{
+    float4 Pos : SV_POSITION;
+    float4 Color : COLOR;
+    float3 ObjectPos : TEXCOORD0;
+    float3 ViewPos : TEXCOORD1;
+};
+
+float4x4 Bone(uint index)
+{
+    return float4x4(Bones[index * 4], Bones[index * 4 + 1], Bones[index * 4 + 2], Bones[index * 4 + 3]);
+}
+
+PS_INPUT main(VS_INPUT input)
+{
+    uint first = input.Instance * Skinning.x;
+    float4 position = float4(input.Pos.xyz, 1);
+    float4 world = 0;
+    [unroll] for (uint i = 0; i < 4; ++i)
+        world += input.Weights[i] * mul(position, Bone(first + input.Joints[i]));
+
+    PS_INPUT output;
+    output.Pos = mul(world, mView);
+    output.ViewPos = output.Pos.xyz;
     output.Pos = mul(output.Pos, mProjection);
     output.Color = input.Color;
+    output.ObjectPos = input.Pos.xyz;
     return output;
 }
 )";
 
 const char* pixelShaderCode = R"(
+Texture2D DiffuseTexture : register(t0);
+SamplerState LinearSampler : register(s0);
+
+// Раскладка — как у PointLight в ClusteredLights.h; позиции в пространстве вида
+struct PointLight
+{
+    float3 Position;
+    float Radius;
+    float3 Color;
+    float Intensity;
+};
+
+StructuredBuffer<PointLight> Lights : register(t1);
+StructuredBuffer<uint2> ClusterRanges : register(t2); // смещение и число индексов кластера
+StructuredBuffer<uint> LightIndices : register(t3);
+
+cbuffer ConstantBufferLighting : register(b2)
+{
+    uint4 ClusterDims;   // плитки по x и y, срезы, число источников (0 — без освещения)
+    float4 ScreenSlices; // ширина и высота цели, масштаб и сдвиг среза по log(z)
+    float4 Ambient;
+};
+
 struct PS_INPUT
 {
     float4 Pos : SV_POSITION;
     float4 Color : COLOR;
+    float3 ObjectPos : TEXCOORD0;
+    float3 ViewPos : TEXCOORD1;
 };
 
+// Сумма источников кластера пикселя — та же формула, что LightClusterer::Shade
+float3 ClusterLighting(float2 pixel, float3 viewPos)
+{
+    float3 normal = normalize(cross(ddx(viewPos), ddy(viewPos)));
+    if (dot(normal, viewPos) > 0) normal = -normal;
+
+    uint2 tile = min(uint2(pixel / ScreenSlices.xy * ClusterDims.xy), ClusterDims.xy - 1);
+    uint slice = (uint)clamp(floor(log(max(viewPos.z, 1e-6)) * ScreenSlices.z + ScreenSlices.w), 0, ClusterDims.z - 1);
+    uint2 range = ClusterRanges[(slice * ClusterDims.y + tile.y) * ClusterDims.x + tile.x];
+
+    float3 result = Ambient.rgb;
+    for (uint i = range.x; i < range.x + range.y; ++i)
+    {
+        PointLight light = Lights[LightIndices[i]];
+        float3 toLight = light.Position - viewPos;
+        float distanceSq = dot(toLight, toLight);
+        if (distanceSq >= light.Radius * light.Radius) continue;
+
+        float distance = sqrt(distanceSq);
+        float falloff = 1 - distance / light.Radius;
+        float diffuse = distance > 0 ? max(0, dot(toLight, normal) / distance) : 1;
+        result += light.Color * (light.Intensity * diffuse * falloff * falloff);
+    }
+    return result;
+}
+
 float4 main(PS_INPUT input) : SV_Target
 {
-    return input.Color;
+    // У вершин нет UV: текстура проецируется на грань по её доминирующей оси,
+    // нормаль грани берётся из производных позиции в пространстве объекта
+    float3 n = abs(cross(ddx(input.ObjectPos), ddy(input.ObjectPos)));
+    float2 uv = n.x > n.y && n.x > n.z ? input.ObjectPos.zy : (n.y > n.z ? input.ObjectPos.xz : input.ObjectPos.xy);
+    uv = float2(uv.x, -uv.y) * 0.5 + 0.5;
+    float4 color = DiffuseTexture.Sample(LinearSampler, uv) * input.Color;
+
+    // Без источников сцена выглядит как раньше — без освещения
+    if (ClusterDims.w > 0)
+        color.rgb *= ClusterLighting(input.Pos.xy, input.ViewPos);
+    return color;
 }
 )";
 
 // Определение структуры вершины
 struct SimpleVertex
 {
-    XMFLOAT3 Pos;
-    XMFLOAT4 Color;
+    Float3 Pos;
+    Float4 Color;
 };
 
 // Структуры для константных буферов
 struct ConstantBufferWorld
 {
-    XMMATRIX mWorld;
+    Float4x4 mWorld;
 };
 
 struct ConstantBufferViewProjection
 {
-    XMMATRIX mView;
-    XMMATRIX mProjection;
+    Float4x4 mView;
+    Float4x4 mProjection;
+};
+
+struct ConstantBufferLighting
+{
+    uint32_t clusterDims[4]; // плитки x, y, срезы, число источников
+    Float4 screenSlices;     // ширина, высота, масштаб и сдвиг среза по log(z)
+    Float4 ambient;
+};
+
+struct ConstantBufferSkinning
+{
+    uint32_t skinning[4]; // суставов на персонажа, остальное — выравнивание
 };
 
 HRESULT InitDevice(HWND hWnd);
 void CleanupDevice();
 void Render();
+void RenderFrame(ID3D11Texture2D* pOutput, ID3D11RenderTargetView* pOutputView, ID3D11DepthStencilView* pOutputDepth, UINT width, UINT height, float aspectRatio, const Matrix& view, float t);
+void RenderView(const GraphTarget& output, UINT width, UINT height, UINT renderWidth, UINT renderHeight, const SceneView& sceneView, float t);
+void RenderScene(ID3D11RenderTargetView* pRenderTargetView, ID3D11DepthStencilView* pDepthStencilView, UINT width, UINT height, const SceneView& sceneView, float t);
+Matrix ObjectWorld(const SceneObject& object, float t);
+Matrix SceneProjection(float aspectRatio);
+void UpdateViewObjects(float t);
+void ReportRenderStats();
+void SetAntiAliasing(AntiAliasingMode mode);
+bool EnsureFxaa();
+bool EnsureUpscale();
+bool EnsureMultisampleRasterizer();
+bool EnsureCharacters();
+bool AnimateCharacters(float t);
+void RenderCharacters(float t);
+void UpdateLighting(const Matrix& view, const Matrix& projection, UINT width, UINT height, float t);
+bool PrepareScene(const std::string& scenePath, unsigned thread);
+void PrepareSceneTextures();
+void LoadSceneTextures();
+void StartMeshStreaming();
+void UpdateMeshStreaming(const Matrix& view);
+void FlushMeshStreaming();
+void StopMeshStreaming();
+Ray CameraRay(Vector eye, Vector at, Vector up, float x, float y, UINT width, UINT height, float aspectRatio);
+Aabb ObjectLocalBounds(size_t object);
+void PickAt(const Ray& ray, float t);
+HRESULT StartCapture();
+void StopCapture();
+int64_t NowMicroseconds();
+const InputFrame& SampleInput();
+void TrackInputLatency(Surface& surface, int64_t inputTime);
+void PumpCapture(bool wait);
+void TrackFrameMemory(const FrameWriter& writer);
+void ReportMemory();
+
+// Пакетный (оффлайн) рендер последовательности кадров по пути камеры
+struct BatchOptions
+{
+    std::string scenePath;
+    std::string cameraPath;
+    std::string outputPrefix;
+    FrameFormat format = FrameFormat::Png;
+    UINT width = 1920;
+    UINT height = 1080;
+    unsigned encodeThreads = 0; // 0 — по числу ядер
+    std::string textureBenchmarkPath;
+    size_t sortBenchmarkDraws = 0;
+    size_t mathBenchmarkCount = 0;
+    bool lightBenchmark = false;
+    size_t bvhBenchmarkTriangles = 0;
+    bool antiAliasingBenchmark = false;
+    size_t animationBenchmarkCharacters = 0;
+    bool renderGraphBenchmark = false;
+    size_t viewBenchmarkObjects = 0;
+    bool inputBenchmark = false;
+    unsigned jobBenchmarkThreads = 0;
+    unsigned jobThreads = 0; // 0 — по числу ядер
+    bool pinJobThreads = false;
+    UINT viewCount = 1;
+    SkinningMode skinning = SkinningMode::Gpu;
+    AntiAliasingMode antiAliasing = AntiAliasingMode::None;
+    double frameBudgetMs = 1000.0 / 60.0; // 0 — без динамического разрешения
+
+    struct MemoryBudget
+    {
+        MemoryDomain domain;
+        MemoryCategory category;
+        uint64_t bytes;
+    };
+    std::vector<MemoryBudget> memoryBudgets;
+    std::string memoryDumpPath; // снимок памяти при выходе из интерактивного режима
+};
+
+void ConfigureMemoryTracking(const BatchOptions& options);
+
+bool ParseBatchOptions(BatchOptions& options);
+int RunBatch(const BatchOptions& options);
+int RunTextureBenchmark(const std::string& imagePath);
+int RunSortBenchmark(size_t drawCount);
+int RunMathBenchmark(size_t count);
+int RunLightBenchmark();
+int RunBvhBenchmark(size_t triangleCount);
+int RunAntiAliasingBenchmark(const std::string& scenePath);
+int RunAnimationBenchmark(size_t characterCount);
+int RunRenderGraphBenchmark();
+int RunViewCullingBenchmark(size_t objectCount);
+int RunInputBenchmark();
+int RunJobBenchmark(unsigned maxThreads);
 
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 
@@ -114,20 +586,99 @@ int WINAPI wWinMain(
     _In_ int nCmdShow
 )
 {
+    BatchOptions batchOptions;
+    bool batch = ParseBatchOptions(batchOptions);
+    JobSystemSettings jobSettings;
+    jobSettings.threads = batchOptions.jobThreads;
+    jobSettings.pinThreads = batchOptions.pinJobThreads;
+    ConfigureJobs(jobSettings);
+    g_AntiAliasing = batchOptions.antiAliasing;
+    g_SkinningMode = batchOptions.skinning;
+    g_DynamicResolution = batchOptions.frameBudgetMs > 0.0;
+    if (g_DynamicResolution)
+    {
+        ResolutionSettings settings;
+        settings.targetMs = batchOptions.frameBudgetMs;
+        g_Resolution.SetSettings(settings);
+    }
+    ConfigureMemoryTracking(batchOptions);
+    if (batch)
+        return RunBatch(batchOptions);
+    if (!batchOptions.textureBenchmarkPath.empty())
+        return RunTextureBenchmark(batchOptions.textureBenchmarkPath);
+    if (batchOptions.sortBenchmarkDraws > 0)
+        return RunSortBenchmark(batchOptions.sortBenchmarkDraws);
+    if (batchOptions.mathBenchmarkCount > 0)
+        return RunMathBenchmark(batchOptions.mathBenchmarkCount);
+    if (batchOptions.lightBenchmark)
+        return RunLightBenchmark();
+    if (batchOptions.bvhBenchmarkTriangles > 0)
+        return RunBvhBenchmark(batchOptions.bvhBenchmarkTriangles);
+    if (batchOptions.antiAliasingBenchmark)
+        return RunAntiAliasingBenchmark(batchOptions.scenePath);
+    if (batchOptions.animationBenchmarkCharacters > 0)
+        return RunAnimationBenchmark(batchOptions.animationBenchmarkCharacters);
+    if (batchOptions.renderGraphBenchmark)
+        return RunRenderGraphBenchmark();
+    if (batchOptions.viewBenchmarkObjects > 0)
+        return RunViewCullingBenchmark(batchOptions.viewBenchmarkObjects);
+    if (batchOptions.inputBenchmark)
+        return RunInputBenchmark();
+    if (batchOptions.jobBenchmarkThreads > 0)
+        return RunJobBenchmark(batchOptions.jobBenchmarkThreads);
+
+    // Сцена (файл, запуск загрузки мешей, подготовка текстур) грузится параллельно
+    // с окном и устройством; не загрузившаяся заменяется сценой по умолчанию
+    StartupTask sceneTask;
+    sceneTask.Start(g_Startup, "scene", [&batchOptions](unsigned thread)
+    {
+        if (PrepareScene(batchOptions.scenePath, thread)) return true;
+        g_Scene = DefaultScene();
+        PrepareScene(std::string(), thread);
+        return false;
+    });
+
+    StartupTimeline::Clock::time_point phase = StartupTimeline::Clock::now();
     WNDCLASSEX wcex = { sizeof(WNDCLASSEX), CS_HREDRAW | CS_VREDRAW, WndProc, 0, 0, hInstance, nullptr, nullptr, nullptr, nullptr, L"DirectXApp", nullptr };
     RegisterClassEx(&wcex);
 
-    g_hWnd = CreateWindow(L"DirectXApp", L"DirectX App", WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT, 1000, 600, nullptr, nullptr, hInstance, nullptr);
-    if (!g_hWnd) return -1;
+    // Камеры окон расставлены по кругу вокруг сцены; окно, которое не создалось, пропускается
+    for (UINT view = 0; view < batchOptions.viewCount; ++view)
+    {
+        std::unique_ptr<OutputWindow> window(new OutputWindow());
+        window->yawOffset = TwoPi * view / batchOptions.viewCount;
+        const std::wstring title = view == 0 ? std::wstring(L"DirectX App") : L"DirectX App - view " + std::to_wstring(view + 1);
+        window->hWnd = CreateWindow(L"DirectXApp", title.c_str(), WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT, 1000, 600, nullptr, nullptr, hInstance, nullptr);
+        if (window->hWnd)
+            g_Windows.push_back(std::move(window));
+    }
+    g_Startup.Mark("window", 0, phase, g_Windows.size() == batchOptions.viewCount);
+    if (g_Windows.empty()) return -1;
+
+    // Сырой ввод мыши и клавиатуры приходит окну в фокусе, без автоповтора и ускорения курсора
+    const RAWINPUTDEVICE rawDevices[2] = { { 0x01, 0x02, 0, nullptr }, { 0x01, 0x06, 0, nullptr } };
+    g_RawInput = RegisterRawInputDevices(rawDevices, 2, sizeof(RAWINPUTDEVICE)) != FALSE;
+    if (!g_RawInput)
+        OutputDebugStringA("Input: raw input unavailable, using keyboard messages\n");
 
-    if (FAILED(InitDevice(g_hWnd)))
+    if (FAILED(InitDevice(g_Windows[0]->hWnd)))
     {
         CleanupDevice();
         return -1;
     }
 
-    ShowWindow(g_hWnd, nCmdShow);
-    UpdateWindow(g_hWnd);
+    phase = StartupTimeline::Clock::now();
+    sceneTask.Wait();
+    phase = g_Startup.Mark("wait for scene", 0, phase);
+    LoadSceneTextures();
+    phase = g_Startup.Mark("texture upload", 0, phase);
+
+    for (const std::unique_ptr<OutputWindow>& window : g_Windows)
+    {
+        ShowWindow(window->hWnd, nCmdShow);
+        UpdateWindow(window->hWnd);
+    }
+    g_Startup.Mark("show window", 0, phase);
 
     MSG msg = { 0 };
     while (WM_QUIT != msg.message)
@@ -143,6 +694,8 @@ int WINAPI wWinMain(
         }
     }
 
+    if (!batchOptions.memoryDumpPath.empty())
+        g_Memory.WriteSnapshot(batchOptions.memoryDumpPath);
     CleanupDevice();
     return (int)msg.wParam;
 }
@@ -151,31 +704,26 @@ HRESULT InitDevice(HWND hWnd)
 {
     HRESULT hr = S_OK;
 
-    RECT rc;
-    GetClientRect(hWnd, &rc);
-    UINT width = rc.right - rc.left;
-    UINT height = rc.bottom - rc.top;
+    // Шейдеры сцены компилируются в фоне, пока создаются устройство и цепочка обмена.
+    // Задача объявлена после блобов — её деструктор дождётся компиляции раньше,
+    // чем блобы будут освобождены, при любом выходе из функции
+    Microsoft::WRL::ComPtr<ID3DBlob> pVSBlob;
+    Microsoft::WRL::ComPtr<ID3DBlob> pPSBlob;
+    HRESULT hrVS = E_FAIL, hrPS = E_FAIL;
+    StartupTask shaderTask;
+    shaderTask.Start(g_Startup, "compile shaders", [&](unsigned)
+    {
+        hrVS = D3DCompile(vertexShaderCode, strlen(vertexShaderCode), "vertexShader", nullptr, nullptr, "main", "vs_5_0", 0, 0, &pVSBlob, nullptr);
+        hrPS = D3DCompile(pixelShaderCode, strlen(pixelShaderCode), "pixelShader", nullptr, nullptr, "main", "ps_5_0", 0, 0, &pPSBlob, nullptr);
+        return SUCCEEDED(hrVS) && SUCCEEDED(hrPS);
+    });
+    StartupTimeline::Clock::time_point phase = StartupTimeline::Clock::now();
 
     UINT createDeviceFlags = 0;
 #ifdef _DEBUG
     createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
 
-    DXGI_SWAP_CHAIN_DESC sd = {};
-    sd.BufferCount = 2;
-    sd.BufferDesc.Width = width;
-    sd.BufferDesc.Height = height;
-    sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-    sd.BufferDesc.RefreshRate.Numerator = 60;
-    sd.BufferDesc.RefreshRate.Denominator = 1;
-    sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    sd.OutputWindow = hWnd;
-    sd.SampleDesc.Count = 1;
-    sd.SampleDesc.Quality = 0;
-    sd.Windowed = TRUE;
-    sd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-    sd.Flags = 0;
-
     D3D_DRIVER_TYPE driverTypes[] =
     {
         D3D_DRIVER_TYPE_HARDWARE,
@@ -194,37 +742,39 @@ HRESULT InitDevice(HWND hWnd)
 
     for (UINT driverTypeIndex = 0; driverTypeIndex < numDriverTypes; ++driverTypeIndex)
     {
-        hr = D3D11CreateDeviceAndSwapChain(nullptr, driverTypes[driverTypeIndex], nullptr, createDeviceFlags, featureLevels, numFeatureLevels,
-            D3D11_SDK_VERSION, &sd, &g_pSwapChain, &g_pd3dDevice, nullptr, &g_pImmediateContext);
+        hr = D3D11CreateDevice(nullptr, driverTypes[driverTypeIndex], nullptr, createDeviceFlags, featureLevels, numFeatureLevels,
+            D3D11_SDK_VERSION, &g_pd3dDevice, nullptr, &g_pImmediateContext);
         if (SUCCEEDED(hr)) break;
     }
+    phase = g_Startup.Mark("device", 0, phase, SUCCEEDED(hr));
     if (FAILED(hr)) return hr;
 
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> pBackBuffer;
-    hr = g_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(pBackBuffer.GetAddressOf()));
-    if (FAILED(hr)) return hr;
-
-    hr = g_pd3dDevice->CreateRenderTargetView(pBackBuffer.Get(), nullptr, g_pRenderTargetView.GetAddressOf());
-    if (FAILED(hr)) return hr;
-
-    g_pImmediateContext->OMSetRenderTargets(1, g_pRenderTargetView.GetAddressOf(), nullptr);
+    // Контекст D3D11.1 нужен только для DiscardView; на старой системе его нет — и не надо
+    g_pImmediateContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(g_pImmediateContext1.GetAddressOf()));
 
-    D3D11_VIEWPORT vp = {};
-    vp.Width = (FLOAT)width;
-    vp.Height = (FLOAT)height;
-    vp.MinDepth = 0.0f;
-    vp.MaxDepth = 1.0f;
-    vp.TopLeftX = 0;
-    vp.TopLeftY = 0;
-    g_pImmediateContext->RSSetViewports(1, &vp);
+    // Без окна (пакетный режим) цепочки обмена не нужны; у каждого окна своя на общем устройстве
+    if (hWnd)
+    {
+        for (const std::unique_ptr<OutputWindow>& window : g_Windows)
+        {
+            hr = window->surface.Create(g_pd3dDevice.Get(), window->hWnd);
+            if (FAILED(hr)) break;
+        }
+        phase = g_Startup.Mark("swap chain", 0, phase, SUCCEEDED(hr));
+        if (FAILED(hr)) return hr;
+    }
 
-    // Компиляция вершинного шейдера
-    Microsoft::WRL::ComPtr<ID3DBlob> pVSBlob;
-    hr = D3DCompile(vertexShaderCode, strlen(vertexShaderCode), "vertexShader", nullptr, nullptr, "main", "vs_5_0", 0, 0, &pVSBlob, nullptr);
-    if (FAILED(hr))
+    shaderTask.Wait();
+    phase = g_Startup.Mark("wait for shaders", 0, phase);
+    if (FAILED(hrVS))
     {
         MessageBox(hWnd, L"Error compiling vertex shader", L"Error", MB_OK);
-        return hr;
+        return hrVS;
+    }
+    if (FAILED(hrPS))
+    {
+        MessageBox(hWnd, L"Error compiling pixel shader", L"Error", MB_OK);
+        return hrPS;
     }
 
     hr = g_pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, g_pVertexShader.GetAddressOf());
@@ -241,31 +791,24 @@ HRESULT InitDevice(HWND hWnd)
     hr = g_pd3dDevice->CreateInputLayout(layout, numElements, pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), g_pVertexLayout.GetAddressOf());
     if (FAILED(hr)) return hr;
 
-    g_pImmediateContext->IASetInputLayout(g_pVertexLayout.Get());
-
     // Создание вершинного буфера
     SimpleVertex vertices[] =
     {
-        { XMFLOAT3(-1.0f, 1.0f, -1.0f), XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f) },
-        { XMFLOAT3(1.0f, 1.0f, -1.0f), XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f) },
-        { XMFLOAT3(1.0f, 1.0f, 1.0f), XMFLOAT4(0.0f, 1.0f, 1.0f, 1.0f) },
-        { XMFLOAT3(-1.0f, 1.0f, 1.0f), XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f) },
-        { XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT4(1.0f, 0.0f, 1.0f, 1.0f) },
-        { XMFLOAT3(1.0f, -1.0f, -1.0f), XMFLOAT4(1.0f, 1.0f, 0.0f, 1.0f) },
-        { XMFLOAT3(1.0f, -1.0f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) },
-        { XMFLOAT3(-1.0f, -1.0f, 1.0f), XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f) },
+        { Float3(-1.0f, 1.0f, -1.0f), Float4(0.0f, 0.0f, 1.0f, 1.0f) },
+        { Float3(1.0f, 1.0f, -1.0f), Float4(0.0f, 1.0f, 0.0f, 1.0f) },
+        { Float3(1.0f, 1.0f, 1.0f), Float4(0.0f, 1.0f, 1.0f, 1.0f) },
+        { Float3(-1.0f, 1.0f, 1.0f), Float4(1.0f, 0.0f, 0.0f, 1.0f) },
+        { Float3(-1.0f, -1.0f, -1.0f), Float4(1.0f, 0.0f, 1.0f, 1.0f) },
+        { Float3(1.0f, -1.0f, -1.0f), Float4(1.0f, 1.0f, 0.0f, 1.0f) },
+        { Float3(1.0f, -1.0f, 1.0f), Float4(1.0f, 1.0f, 1.0f, 1.0f) },
+        { Float3(-1.0f, -1.0f, 1.0f), Float4(0.0f, 0.0f, 0.0f, 1.0f) },
     };
 
-    D3D11_BUFFER_DESC bd = {};
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = sizeof(SimpleVertex) * 8;
-    bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    bd.CPUAccessFlags = 0;
-
-    D3D11_SUBRESOURCE_DATA InitData = {};
-    InitData.pSysMem = vertices;
+    g_Resources.SetMemoryTracker(&g_Memory);
+    hr = g_Resources.Init(g_pd3dDevice.Get());
+    if (FAILED(hr)) return hr;
 
-    hr = g_pd3dDevice->CreateBuffer(&bd, &InitData, g_pVertexBuffer.GetAddressOf());
+    hr = g_Resources.CreateBuffer(BufferKind::Vertex, sizeof(vertices), vertices, g_VertexBuffer);
     if (FAILED(hr)) return hr;
 
     // Создание индексного буфера
@@ -290,65 +833,239 @@ HRESULT InitDevice(HWND hWnd)
         7,4,6,
     };
 
-    bd.Usage = D3D11_USAGE_DEFAULT;
-    bd.ByteWidth = sizeof(WORD) * 36;
-    bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    bd.CPUAccessFlags = 0;
-    InitData.pSysMem = indices;
-
-    hr = g_pd3dDevice->CreateBuffer(&bd, &InitData, g_pIndexBuffer.GetAddressOf());
+    hr = g_Resources.CreateBuffer(BufferKind::Index, sizeof(indices), indices, g_IndexBuffer);
     if (FAILED(hr)) return hr;
 
-    // Создание константных буферов
-    bd.Usage = D3D11_USAGE_DEFAULT; // DEFAULT usage for UpdateSubresource
-    bd.ByteWidth = sizeof(ConstantBufferWorld);
-    bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    bd.CPUAccessFlags = 0;
+    // Тот же кубик на CPU — для выбора мышью
+    Float3 cubePositions[ARRAYSIZE(vertices)];
+    uint32_t cubeIndices[ARRAYSIZE(indices)];
+    for (size_t i = 0; i < ARRAYSIZE(vertices); ++i) cubePositions[i] = vertices[i].Pos;
+    for (size_t i = 0; i < ARRAYSIZE(indices); ++i) cubeIndices[i] = indices[i];
+    g_CubeBvh.Build(cubePositions, cubeIndices, ARRAYSIZE(cubeIndices), 1);
 
-    hr = g_pd3dDevice->CreateBuffer(&bd, nullptr, g_pConstantBufferWorld.GetAddressOf());
+    // Создание константных буферов
+    hr = g_Resources.CreateBuffer(BufferKind::Constant, sizeof(ConstantBufferWorld), nullptr, g_ConstantBufferWorld);
     if (FAILED(hr)) return hr;
 
-    bd.ByteWidth = sizeof(ConstantBufferViewProjection);
-    hr = g_pd3dDevice->CreateBuffer(&bd, nullptr, g_pConstantBufferViewProjection.GetAddressOf());
+    hr = g_Resources.CreateBuffer(BufferKind::Constant, sizeof(ConstantBufferViewProjection), nullptr, g_ConstantBufferViewProjection);
     if (FAILED(hr)) return hr;
 
-    // Компиляция пиксельного шейдера
-    Microsoft::WRL::ComPtr<ID3DBlob> pPSBlob;
-    hr = D3DCompile(pixelShaderCode, strlen(pixelShaderCode), "pixelShader", nullptr, nullptr, "main", "ps_5_0", 0, 0, &pPSBlob, nullptr);
-    if (FAILED(hr))
-    {
-        MessageBox(hWnd, L"Error compiling pixel shader", L"Error", MB_OK);
-        return hr;
-    }
+    hr = g_Resources.CreateBuffer(BufferKind::Constant, sizeof(ConstantBufferLighting), nullptr, g_ConstantBufferLighting);
+    if (FAILED(hr)) return hr;
 
     hr = g_pd3dDevice->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, g_pPixelShader.GetAddressOf());
     if (FAILED(hr)) return hr;
+    phase = g_Startup.Mark("shaders and buffers", 0, phase);
+
+    // Трилинейная фильтрация с повтором
+    D3D11_SAMPLER_DESC sd = {};
+    sd.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    sd.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+    sd.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+    sd.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+    sd.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    sd.MinLOD = 0;
+    sd.MaxLOD = D3D11_FLOAT32_MAX;
+    hr = g_pd3dDevice->CreateSamplerState(&sd, g_pSamplerLinear.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    Image white;
+    white.width = 1;
+    white.height = 1;
+    white.rgba.assign(4, 255);
+    hr = CreateTexture(g_pd3dDevice.Get(), white, TextureFormat::Rgba8, g_WhiteTexture);
+    if (FAILED(hr)) return hr;
+    g_Memory.Allocate(MemoryDomain::Gpu, MemoryCategory::Texture, g_WhiteTexture.sizeBytes);
+
+    // Состояния прозрачного прохода: обычное альфа-смешивание, глубина только проверяется
+    D3D11_BLEND_DESC bd = {};
+    bd.RenderTarget[0].BlendEnable = TRUE;
+    bd.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+    bd.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+    bd.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+    bd.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+    bd.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+    bd.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+    bd.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+    hr = g_pd3dDevice->CreateBlendState(&bd, g_pBlendAlpha.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    D3D11_DEPTH_STENCIL_DESC dsd = {};
+    dsd.DepthEnable = TRUE;
+    dsd.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+    dsd.DepthFunc = D3D11_COMPARISON_LESS;
+    hr = g_pd3dDevice->CreateDepthStencilState(&dsd, g_pDepthReadOnly.GetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    // Сглаживание: режимы MSAA, которых нет на устройстве, опускаются до поддерживаемого числа выборок.
+    // Проходы FXAA и растяжения и растеризатор MSAA первому кадру не нужны — см. Ensure*
+    for (int mode = 0; mode < (int)AntiAliasingMode::Count; ++mode)
+        g_SupportedSamples[mode] = SupportedSampleCount(g_pd3dDevice.Get(), DXGI_FORMAT_R8G8B8A8_UNORM, SampleCount((AntiAliasingMode)mode));
 
+    hr = g_GpuTimer.Init(g_pd3dDevice.Get(), ResourceManager::MaxFramesInFlight + 1);
+    if (FAILED(hr)) return hr;
+
+    g_Startup.Mark("states", 0, phase);
     return S_OK;
 }
 
+// Проходы и состояния, которые первому кадру не нужны, создаются при первом
+// использовании; время создания попадает в фазы запуска. После неудачи режим
+// рисуется без прохода, повторных попыток нет
+template <typename Create>
+bool CreateOnFirstUse(const char* name, bool& failed, Create create)
+{
+    if (failed) return false;
+
+    const StartupTimeline::Clock::time_point start = StartupTimeline::Clock::now();
+    const HRESULT hr = create();
+    g_Startup.Mark(name, 0, start, SUCCEEDED(hr));
+    if (SUCCEEDED(hr)) return true;
+
+    char line[128];
+    snprintf(line, sizeof(line), "Startup: failed to create %s (0x%08lx)\n", name, (unsigned long)hr);
+    OutputDebugStringA(line);
+    failed = true;
+    return false;
+}
+
+bool EnsureFxaa()
+{
+    static bool failed = false;
+    return g_Fxaa.Ready() || CreateOnFirstUse("lazy: FXAA pass", failed, []() { return g_Fxaa.Init(g_pd3dDevice.Get()); });
+}
+
+bool EnsureUpscale()
+{
+    static bool failed = false;
+    return g_Upscale.Ready() || CreateOnFirstUse("lazy: upscale pass", failed, []() { return g_Upscale.Init(g_pd3dDevice.Get()); });
+}
+
+bool EnsureMultisampleRasterizer()
+{
+    static bool failed = false;
+    return g_pRasterizerMultisample.Get() != nullptr || CreateOnFirstUse("lazy: MSAA rasterizer", failed, []()
+    {
+        D3D11_RASTERIZER_DESC rd = {};
+        rd.FillMode = D3D11_FILL_SOLID;
+        rd.CullMode = D3D11_CULL_BACK;
+        rd.DepthClipEnable = TRUE;
+        rd.MultisampleEnable = TRUE;
+        return g_pd3dDevice->CreateRasterizerState(&rd, g_pRasterizerMultisample.GetAddressOf());
+    });
+}
+
+// Скелет, меш и шейдер персонажей — только если в сцене есть персонажи
+bool EnsureCharacters()
+{
+    static bool failed = false;
+    return g_pSkinnedVertexShader.Get() != nullptr || CreateOnFirstUse("lazy: skinned characters", failed, []()
+    {
+        Microsoft::WRL::ComPtr<ID3DBlob> pBlob;
+        HRESULT hr = D3DCompile(skinnedVertexShaderCode, strlen(skinnedVertexShaderCode), "skinnedVertexShader", nullptr, nullptr, "main", "vs_5_0", 0, 0, &pBlob, nullptr);
+        if (FAILED(hr)) return hr;
+
+        Microsoft::WRL::ComPtr<ID3D11VertexShader> pShader;
+        hr = g_pd3dDevice->CreateVertexShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, pShader.GetAddressOf());
+        if (FAILED(hr)) return hr;
+
+        // Кости и веса — вторым потоком, раскладка как у SkinWeights
+        D3D11_INPUT_ELEMENT_DESC layout[] =
+        {
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "BLENDINDICES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 1, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "BLENDWEIGHT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 4, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        };
+        hr = g_pd3dDevice->CreateInputLayout(layout, ARRAYSIZE(layout), pBlob->GetBufferPointer(), pBlob->GetBufferSize(), g_pSkinnedVertexLayout.GetAddressOf());
+        if (FAILED(hr)) return hr;
+
+        Skeleton skeleton;
+        AnimationClip clip;
+        SkinnedMesh mesh;
+        CreateProceduralCharacter(16, 16, skeleton, clip, mesh);
+        g_Crowd.Init(skeleton, clip, mesh);
+
+        std::vector<SimpleVertex> vertices(mesh.VertexCount());
+        for (size_t i = 0; i < vertices.size(); ++i)
+            vertices[i] = { mesh.positions[i], mesh.colors[i] };
+        hr = g_Resources.CreateBuffer(BufferKind::Vertex, (UINT)(vertices.size() * sizeof(SimpleVertex)), vertices.data(), g_CharacterVertexBuffer);
+        if (FAILED(hr)) return hr;
+        hr = g_Resources.CreateBuffer(BufferKind::Vertex, (UINT)(mesh.skin.size() * sizeof(SkinWeights)), mesh.skin.data(), g_CharacterSkinBuffer);
+        if (FAILED(hr)) return hr;
+        hr = g_Resources.CreateBuffer(BufferKind::Index, (UINT)(mesh.indices.size() * sizeof(uint32_t)), mesh.indices.data(), g_CharacterIndexBuffer);
+        if (FAILED(hr)) return hr;
+
+        ConstantBufferSkinning cbSkinning = { { (uint32_t)g_Crowd.JointCount(), 0, 0, 0 } };
+        hr = g_Resources.CreateBuffer(BufferKind::Constant, sizeof(cbSkinning), &cbSkinning, g_ConstantBufferSkinning);
+        if (FAILED(hr)) return hr;
+
+        g_Characters.resize(g_Scene.characters.size());
+        for (size_t i = 0; i < g_Characters.size(); ++i)
+        {
+            const SceneCharacter& source = g_Scene.characters[i];
+            g_Characters[i].position = source.position;
+            g_Characters[i].heading = source.heading;
+            g_Characters[i].scale = source.scale;
+            g_Characters[i].phase = source.phase;
+            g_Characters[i].speed = source.speed;
+        }
+        g_AnimatedTime = -1.0f;
+        g_pSkinnedVertexShader = pShader;
+        return S_OK;
+    });
+}
+
 void CleanupDevice()
 {
+    StopCapture();
+
     if (g_pImmediateContext) g_pImmediateContext->ClearState();
 
-    g_pConstantBufferWorld.Reset();
-    g_pConstantBufferViewProjection.Reset();
-    g_pVertexBuffer.Reset();
-    g_pIndexBuffer.Reset();
+    StopMeshStreaming();
+    for (const Texture& texture : g_Textures)
+        g_Memory.Free(MemoryDomain::Gpu, MemoryCategory::Texture, texture.sizeBytes);
+    g_Memory.Free(MemoryDomain::Gpu, MemoryCategory::Texture, g_WhiteTexture.sizeBytes);
+    g_Textures.clear();
+    g_ObjectTextures.clear();
+    g_WhiteTexture = Texture();
+    g_pSamplerLinear.Reset();
+    g_pBlendAlpha.Reset();
+    g_pDepthReadOnly.Reset();
+    g_pRasterizerMultisample.Reset();
+    g_Fxaa.Release();
+    g_GpuTimer.Reset();
+    g_Upscale.Release();
+    g_Resources.Release(g_ConstantBufferWorld);
+    g_Resources.Release(g_ConstantBufferViewProjection);
+    g_Resources.Release(g_ConstantBufferLighting);
+    for (StructuredBuffer* pBuffer : { &g_LightBuffer, &g_ClusterRangeBuffer, &g_LightIndexBuffer })
+    {
+        g_Memory.Free(MemoryDomain::Gpu, MemoryCategory::Constant, pBuffer->sizeBytes);
+        *pBuffer = StructuredBuffer();
+    }
+    g_Resources.Release(g_VertexBuffer);
+    g_Resources.Release(g_IndexBuffer);
+    for (GpuBuffer* pBuffer : { &g_CharacterVertexBuffer, &g_CharacterSkinBuffer, &g_CharacterIndexBuffer, &g_SkinnedVertexBuffer, &g_ConstantBufferSkinning })
+        g_Resources.Release(*pBuffer);
+    g_Memory.Free(MemoryDomain::Gpu, MemoryCategory::Constant, g_BoneBuffer.sizeBytes);
+    g_BoneBuffer = StructuredBuffer();
+    g_pSkinnedVertexLayout.Reset();
+    g_pSkinnedVertexShader.Reset();
+    g_AnimatedTime = -1.0f;
+    g_Resources.Shutdown();
     g_pVertexLayout.Reset();
     g_pVertexShader.Reset();
     g_pPixelShader.Reset();
 
-    if (g_pRenderTargetView)
-    {
-        g_pRenderTargetView.Reset();
-    }
-
-    if (g_pSwapChain)
-    {
-        g_pSwapChain.Reset();
-    }
+    for (const std::unique_ptr<OutputWindow>& window : g_Windows)
+        window->surface.Release();
+    for (LatencyProbe& probe : g_LatencyProbes)
+        probe = LatencyProbe();
 
+    g_GraphTargets.clear();
+    g_FrameGraph.Reset();
+    g_pImmediateContext1.Reset();
     if (g_pImmediateContext)
     {
         g_pImmediateContext.Reset();
@@ -362,144 +1079,2241 @@ void CleanupDevice()
 
 void Render()
 {
-    // Привязываем Render Target View к контексту устройства
-    g_pImmediateContext->OMSetRenderTargets(1, g_pRenderTargetView.GetAddressOf(), nullptr);
-
     // Управляем временем для плавного вращения
     static ULONGLONG timeStart = 0;
     ULONGLONG timeCur = GetTickCount64();
     if (timeStart == 0) timeStart = timeCur;
     float t = (timeCur - timeStart) / 1000.0f; // Time in seconds
 
-    // Обновление мировой матрицы
-    XMMATRIX world = XMMatrixRotationY(t);
+    // Отложенное изменение размера применяется здесь, не чаще раза за кадр.
+    // Рисуются только видимые окна; свёрнутое главное остальным не мешает
+    std::vector<OutputWindow*> windows;
+    for (const std::unique_ptr<OutputWindow>& window : g_Windows)
+    {
+        if (window->hWnd && SUCCEEDED(window->surface.Update(g_pImmediateContext.Get())) && window->surface.IsVisible())
+            windows.push_back(window.get());
+    }
+    if (windows.empty()) return;
+
+    g_Resources.BeginFrame(g_pImmediateContext.Get());
+
+    // Регулятору — новый замер GPU (он опаздывает на пару кадров) или CPU-время
+    // прошлого кадра, смотря что дольше
+    static double cpuFrameMs = 0.0;
+    const bool gpuMeasured = g_GpuTimer.Poll(g_pImmediateContext.Get(), false) > 0;
+    if (g_DynamicResolution && gpuMeasured)
+        g_Resolution.Update(std::max(g_GpuTimer.LastMs(), cpuFrameMs));
+
+    // Ввод — как можно позже, когда всё, что от камеры не зависит, уже сделано
+    const InputFrame& input = SampleInput();
+    const int64_t inputTime = input.events > 0 ? input.firstEventTime : 0;
+    g_Camera.Update(input);
+
+    // Камера на орбите: поворот исходных позиции и направления взгляда
+    const Matrix rotationMatrix = MatrixRotationRollPitchYaw(g_Camera.Pitch(), g_Camera.Yaw(), 0.0f);
+    const Vector eye = Vector3TransformCoord(VectorSet(0.0f, 1.0f, -5.0f, 0.0f), rotationMatrix);
+    const Vector at = Vector3TransformCoord(VectorSet(0.0f, 1.0f, 0.0f, 0.0f), rotationMatrix);
+    const Vector up = Vector3TransformNormal(VectorSet(0.0f, 1.0f, 0.0f, 0.0f), rotationMatrix);
+    const Matrix view = MatrixLookAtLH(eye, at, up);
+    UpdateMeshStreaming(view);
+
+    const std::chrono::steady_clock::time_point cpuStart = std::chrono::steady_clock::now();
+    g_GpuTimer.Begin(g_pImmediateContext.Get());
+
+    UpdateViewObjects(t);
+    if (g_PickRequested)
+    {
+        // Камера окна — общая, повёрнутая вокруг сцены: луч строится из её положения в мире
+        g_PickRequested = false;
+        const OutputWindow* pWindow = g_pPickWindow ? g_pPickWindow : windows[0];
+        const Matrix toWorld = MatrixRotationY(-pWindow->yawOffset);
+        PickAt(CameraRay(Vector3TransformCoord(eye, toWorld), Vector3TransformCoord(at, toWorld), Vector3TransformNormal(up, toWorld), (float)g_PickX, (float)g_PickY,
+            pWindow->surface.BufferWidth(), pWindow->surface.BufferHeight(), pWindow->surface.AspectRatio()), t);
+    }
 
-    // Позиция камеры
-    static XMVECTOR eye = XMVectorSet(0.0f, 1.0f, -5.0f, 0.0f);
-    static XMVECTOR at = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-    static XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+    // Отсечение и очереди всех окон — сразу, параллельно; дальше на окно остаётся только отправка
+    std::vector<SceneView*> sceneViews;
+    for (OutputWindow* pWindow : windows)
+    {
+        pWindow->sceneView.view = MatrixRotationY(pWindow->yawOffset) * view;
+        pWindow->sceneView.projection = SceneProjection(pWindow->surface.AspectRatio());
+        sceneViews.push_back(&pWindow->sceneView);
+    }
+    g_ViewCullingStats = CullViews(g_ViewObjects, sceneViews.data(), sceneViews.size(), Jobs().ThreadCount());
 
-    // Обновляем матрицу вида, если камера была изменена
-    if (g_CameraUpdated)
+    for (OutputWindow* pWindow : windows)
     {
-        // Создаем матрицу вращения камеры
-        XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(g_CameraPitch, g_CameraYaw, 0.0f);
+        const UINT width = pWindow->surface.BufferWidth();
+        const UINT height = pWindow->surface.BufferHeight();
+        UINT renderWidth = width, renderHeight = height;
+        if (g_DynamicResolution)
+            g_Resolution.ScaledSize(width, height, renderWidth, renderHeight);
+
+        GraphTarget backBuffer;
+        backBuffer.pTexture = pWindow->surface.BackBuffer();
+        backBuffer.pRenderTargetView = pWindow->surface.RenderTargetView();
+        backBuffer.pDepthStencilView = pWindow->surface.DepthStencilView();
+        RenderView(backBuffer, width, height, renderWidth, renderHeight, pWindow->sceneView, t);
+        pWindow->graphStats = g_FrameGraph.Stats();
+        pWindow->renderStats = g_RenderStats;
+    }
 
-        // Применяем вращение к позиции камеры и направлению взгляда
-        eye = XMVector3TransformCoord(XMVectorSet(0.0f, 1.0f, -5.0f, 0.0f), rotationMatrix);
-        at = XMVector3TransformCoord(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), rotationMatrix);
-        up = XMVector3TransformNormal(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), rotationMatrix);
+    g_GpuTimer.End(g_pImmediateContext.Get());
+    cpuFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+    ReportRenderStats();
 
-        g_CameraUpdated = false; // Сбрасываем флаг
+    // Тот же кадр во внеэкранную цель захвата и в кольцо чтения
+    if (g_CaptureEnabled)
+    {
+        PumpCapture(false);
+        RenderTarget* pTarget = g_CaptureReadback.CanEnqueue() ?
+            g_Resources.AcquireTransientTarget(g_CaptureWidth, g_CaptureHeight, DXGI_FORMAT_R8G8B8A8_UNORM) : nullptr;
+        if (pTarget)
+        {
+            RenderFrame(pTarget->pTexture.Get(), pTarget->pRenderTargetView.Get(), pTarget->pDepthStencilView.Get(), pTarget->width, pTarget->height,
+                pTarget->width / (float)pTarget->height, view, t);
+            g_CaptureReadback.Enqueue(g_pImmediateContext.Get(), pTarget->pTexture.Get(), g_CaptureFrameIndex++);
+        }
     }
 
-    // Создаем видовую матрицу
-    XMMATRIX view = XMMatrixLookAtLH(eye, at, up);
+    // Презентация кадра во всех окнах
+    for (OutputWindow* pWindow : windows)
+        pWindow->surface.Present(0);
+    if (windows[0] == g_Windows[0].get())
+        TrackInputLatency(windows[0]->surface, inputTime);
+    g_Resources.EndFrame(g_pImmediateContext.Get());
+    TrackFrameMemory(g_FrameWriter);
+    g_Memory.EndFrame();
 
-    // Обновление проекционной матрицы
-    RECT rc;
-    GetClientRect(g_hWnd, &rc);
-    UINT width = rc.right - rc.left;
-    UINT height = rc.bottom - rc.top;
-    XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, width / (FLOAT)height, 0.01f, 100.0f);
+    if (!g_FirstFramePresented)
+    {
+        g_FirstFramePresented = true;
+        g_Startup.MarkFirstFrame();
+        OutputDebugStringA(g_Startup.Report().c_str());
+    }
+}
 
-    // Обновление константных буферов с использованием UpdateSubresource
-    ConstantBufferWorld cbWorld;
-    cbWorld.mWorld = XMMatrixTranspose(world);
-    g_pImmediateContext->UpdateSubresource(g_pConstantBufferWorld.Get(), 0, nullptr, &cbWorld, 0, 0);
+// Описание цели графа: цвет R8G8B8A8 и глубина D24S8 в одной цели пула
+GraphTextureDesc GraphTargetDesc(UINT width, UINT height, UINT sampleCount)
+{
+    GraphTextureDesc desc;
+    desc.width = width;
+    desc.height = height;
+    desc.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.sampleCount = sampleCount;
+    desc.bytesPerSample = FormatBytesPerPixel(DXGI_FORMAT_R8G8B8A8_UNORM) + FormatBytesPerPixel(DXGI_FORMAT_D24_UNORM_S8_UINT);
+    desc.clearColor = g_Scene.clearColor;
+    return desc;
+}
 
-    ConstantBufferViewProjection cbViewProjection;
-    cbViewProjection.mView = XMMatrixTranspose(view);
-    cbViewProjection.mProjection = XMMatrixTranspose(projection);
-    g_pImmediateContext->UpdateSubresource(g_pConstantBufferViewProjection.Get(), 0, nullptr, &cbViewProjection, 0, 0);
+// Проходы одного вида: сцена в renderWidth x renderHeight, затем сглаживание и
+// растяжение до width x height в output. MSAA рисует в многовыборочную цель и
+// разрешает её, FXAA фильтрует обычную; промежуточные цели — временные цели графа
+void AddViewPasses(RenderGraph& graph, GraphResource output, UINT width, UINT height, UINT renderWidth, UINT renderHeight, const SceneView& sceneView, float t)
+{
+    const bool scaled = (renderWidth != width || renderHeight != height) && EnsureUpscale();
+    if (!scaled)
+    {
+        renderWidth = width;
+        renderHeight = height;
+    }
+    const UINT samples = g_SupportedSamples[(int)g_AntiAliasing];
+    const bool msaa = samples > 1 && EnsureMultisampleRasterizer();
+    const bool fxaa = !msaa && g_AntiAliasing == AntiAliasingMode::Fxaa && EnsureFxaa();
+
+    GraphResource scene = output;
+    if (msaa)
+        scene = graph.CreateTexture("scene MSAA", GraphTargetDesc(renderWidth, renderHeight, samples));
+    else if (fxaa || scaled)
+        scene = graph.CreateTexture("scene", GraphTargetDesc(renderWidth, renderHeight, 1));
+
+    const SceneView* pSceneView = &sceneView;
+    graph.AddPass("scene", [=]()
+    {
+        const GraphTarget& target = g_GraphTargets[scene];
+        if (msaa) g_pImmediateContext->RSSetState(g_pRasterizerMultisample.Get());
+        RenderScene(target.pRenderTargetView, target.pDepthStencilView, renderWidth, renderHeight, *pSceneView, t);
+        if (msaa) g_pImmediateContext->RSSetState(nullptr);
+    }).Write(scene);
+
+    GraphResource color = scene;
+    if (msaa)
+    {
+        const GraphResource resolved = scaled ? graph.CreateTexture("resolved", GraphTargetDesc(renderWidth, renderHeight, 1)) : output;
+        RenderGraph::PassBuilder pass = graph.AddPass("MSAA resolve", [=]()
+        {
+            g_pImmediateContext->ResolveSubresource(g_GraphTargets[resolved].pTexture, 0, g_GraphTargets[scene].pTexture, 0, DXGI_FORMAT_R8G8B8A8_UNORM);
+        });
+        pass.Read(scene);
+        pass.Write(resolved, WriteMode::Overwrite);
+        color = resolved;
+    }
+    else if (fxaa)
+    {
+        const GraphResource filtered = scaled ? graph.CreateTexture("FXAA", GraphTargetDesc(renderWidth, renderHeight, 1)) : output;
+        RenderGraph::PassBuilder pass = graph.AddPass("FXAA", [=]()
+        {
+            g_Fxaa.Apply(g_pImmediateContext.Get(), g_GraphTargets[scene].pShaderResourceView, g_GraphTargets[filtered].pRenderTargetView, renderWidth, renderHeight);
+        });
+        pass.Read(scene);
+        pass.Write(filtered, WriteMode::Overwrite);
+        color = filtered;
+    }
 
-    // Очистка экрана
-    float clearColor[4] = { 0.0f, 0.2f, 0.4f, 1.0f };
-    g_pImmediateContext->ClearRenderTargetView(g_pRenderTargetView.Get(), clearColor);
+    if (scaled)
+    {
+        RenderGraph::PassBuilder pass = graph.AddPass("upscale", [=]()
+        {
+            g_Upscale.Apply(g_pImmediateContext.Get(), g_GraphTargets[color].pShaderResourceView, renderWidth, renderHeight,
+                g_GraphTargets[output].pRenderTargetView, width, height);
+        });
+        pass.Read(color);
+        pass.Write(output, WriteMode::Overwrite);
+    }
+}
 
-    // Установка шейдеров и константных буферов
-    g_pImmediateContext->VSSetShader(g_pVertexShader.Get(), nullptr, 0);
-    g_pImmediateContext->VSSetConstantBuffers(0, 1, g_pConstantBufferWorld.GetAddressOf());
-    g_pImmediateContext->VSSetConstantBuffers(1, 1, g_pConstantBufferViewProjection.GetAddressOf());
-    g_pImmediateContext->PSSetShader(g_pPixelShader.Get(), nullptr, 0);
+void DiscardGraphTarget(const GraphTarget& target)
+{
+    if (!g_pImmediateContext1) return;
+    if (target.pRenderTargetView)
+        g_pImmediateContext1->DiscardView(target.pRenderTargetView);
+    if (target.pDepthStencilView)
+        g_pImmediateContext1->DiscardView(target.pDepthStencilView);
+}
 
-    // Установка вершинного буфера и индексов
-    UINT stride = sizeof(SimpleVertex);
-    UINT offset = 0;
-    g_pImmediateContext->IASetVertexBuffers(0, 1, g_pVertexBuffer.GetAddressOf(), &stride, &offset);
-    g_pImmediateContext->IASetIndexBuffer(g_pIndexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0);
-    g_pImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+// Компилирует граф, берёт его физические цели из пула временных целей и
+// исполняет проходы, очищая и выбрасывая цели так, как решил Compile. false —
+// граф не скомпилировался или пул не создал цель; тогда не исполнено ничего
+bool ExecuteGraph(RenderGraph& graph)
+{
+    if (!graph.Compile()) return false;
 
-    // Отрисовка кубика
-    g_pImmediateContext->DrawIndexed(36, 0, 0);
+    std::vector<RenderTarget*> physical(graph.PhysicalCount(), nullptr);
+    for (size_t i = 0; i < physical.size(); ++i)
+    {
+        const GraphTextureDesc& desc = graph.PhysicalDesc((uint32_t)i);
+        physical[i] = g_Resources.AcquireTransientTarget(desc.width, desc.height, (DXGI_FORMAT)desc.format, desc.sampleCount);
+        if (!physical[i])
+        {
+            for (size_t acquired = 0; acquired < i; ++acquired)
+                g_Resources.ReleaseTransientTarget(physical[acquired]);
+            return false;
+        }
+    }
 
-    // Презентация кадра
-    g_pSwapChain->Present(0, 0);
-}
+    g_GraphTargets.resize(graph.ResourceCount());
+    for (GraphResource resource = 0; resource < graph.ResourceCount(); ++resource)
+    {
+        const uint32_t index = graph.Physical(resource);
+        if (index == ~0u) continue;
+        GraphTarget& target = g_GraphTargets[resource];
+        target.pTexture = physical[index]->pTexture.Get();
+        target.pRenderTargetView = physical[index]->pRenderTargetView.Get();
+        target.pShaderResourceView = physical[index]->pShaderResourceView.Get();
+        target.pDepthStencilView = physical[index]->pDepthStencilView.Get();
+    }
 
-LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
-{
-    switch (message)
+    for (const CompiledPass& pass : graph.Passes())
     {
-    case WM_SIZE:
-        if (g_pSwapChain && wParam != SIZE_MINIMIZED)
+        for (const GraphAttachment& attachment : pass.attachments)
         {
-            // Освобождаем существующий Render Target View
-            if (g_pRenderTargetView)
+            const GraphTarget& target = g_GraphTargets[attachment.resource];
+            if (attachment.load == LoadAction::Clear)
             {
-                g_pRenderTargetView.Reset();
+                const Float4& color = graph.Desc(attachment.resource).clearColor;
+                const float clearColor[4] = { color.x, color.y, color.z, color.w };
+                g_pImmediateContext->ClearRenderTargetView(target.pRenderTargetView, clearColor);
+                if (target.pDepthStencilView)
+                    g_pImmediateContext->ClearDepthStencilView(target.pDepthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
             }
-
-            // Изменяем размер буферов SwapChain
-            HRESULT hr = g_pSwapChain->ResizeBuffers(0, LOWORD(lParam), HIWORD(lParam), DXGI_FORMAT_UNKNOWN, 0);
-            if (FAILED(hr)) return DefWindowProc(hWnd, message, wParam, lParam);
-
-            // Получаем новый back buffer и создаем Render Target View
-            Microsoft::WRL::ComPtr<ID3D11Texture2D> pBackBuffer;
-            hr = g_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(pBackBuffer.GetAddressOf()));
-            if (SUCCEEDED(hr))
+            else if (attachment.load == LoadAction::DontCare)
             {
-                hr = g_pd3dDevice->CreateRenderTargetView(pBackBuffer.Get(), nullptr, g_pRenderTargetView.GetAddressOf());
-                pBackBuffer.Reset();
+                DiscardGraphTarget(target);
             }
-
-            if (FAILED(hr)) return DefWindowProc(hWnd, message, wParam, lParam);
-
-            // Привязываем Render Target View к контексту устройства
-            g_pImmediateContext->OMSetRenderTargets(1, g_pRenderTargetView.GetAddressOf(), nullptr);
-
-            // Обновляем Viewport
-            D3D11_VIEWPORT vp = {};
-            vp.Width = (FLOAT)LOWORD(lParam);
-            vp.Height = (FLOAT)HIWORD(lParam);
-            vp.MinDepth = 0.0f;
-            vp.MaxDepth = 1.0f;
-            vp.TopLeftX = 0;
-            vp.TopLeftY = 0;
-            g_pImmediateContext->RSSetViewports(1, &vp);
         }
-        break;
 
-    case WM_KEYDOWN:
-        switch (wParam)
+        graph.Run(pass);
+
+        for (const GraphAttachment& attachment : pass.attachments)
         {
-        case VK_UP:
-            g_CameraPitch += 0.01f;
-            g_CameraUpdated = true; // Камера обновлена
-            break;
-        case VK_DOWN:
-            g_CameraPitch -= 0.01f;
-            g_CameraUpdated = true; // Камера обновлена
-            break;
+            if (attachment.store == StoreAction::Discard)
+                DiscardGraphTarget(g_GraphTargets[attachment.resource]);
         }
-        break;
+    }
 
-    case WM_DESTROY:
-        PostQuitMessage(0);
-        break;
+    // Цели возвращаются в пул сразу: следующий граф кадра (захват) может взять их же
+    for (RenderTarget* pTarget : physical)
+        g_Resources.ReleaseTransientTarget(pTarget);
+    return true;
+}
 
-    default:
-        return DefWindowProc(hWnd, message, wParam, lParam);
-    }
-    return 0;
-}
\ No newline at end of file
+// Кадр одного вида через граф кадра в output (back buffer или цель захвата).
+// Если граф не исполнился, кадр рисуется прямо в выход без сглаживания и растяжения
+void RenderView(const GraphTarget& output, UINT width, UINT height, UINT renderWidth, UINT renderHeight, const SceneView& sceneView, float t)
+{
+    if (width == 0 || height == 0) return;
+
+    g_FrameGraph.Reset();
+    g_GraphTargets.clear();
+    const GraphResource resource = g_FrameGraph.ImportTexture("output", GraphTargetDesc(width, height, 1));
+    g_GraphTargets.push_back(output);
+    AddViewPasses(g_FrameGraph, resource, width, height, renderWidth, renderHeight, sceneView, t);
+    if (ExecuteGraph(g_FrameGraph)) return;
+
+    const float clearColor[4] = { g_Scene.clearColor.x, g_Scene.clearColor.y, g_Scene.clearColor.z, g_Scene.clearColor.w };
+    g_pImmediateContext->ClearRenderTargetView(output.pRenderTargetView, clearColor);
+    if (output.pDepthStencilView)
+        g_pImmediateContext->ClearDepthStencilView(output.pDepthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
+    RenderScene(output.pRenderTargetView, output.pDepthStencilView, width, height, sceneView, t);
+}
+
+// Кадр с текущим сглаживанием в выходную цель в её полном разрешении; вид свой,
+// отдельно от окон, поэтому объекты и отсечение считаются здесь же
+void RenderFrame(ID3D11Texture2D* pOutput, ID3D11RenderTargetView* pOutputView, ID3D11DepthStencilView* pOutputDepth, UINT width, UINT height, float aspectRatio, const Matrix& view, float t)
+{
+    if (width == 0 || height == 0) return;
+
+    UpdateViewObjects(t);
+    g_OffscreenView.view = view;
+    g_OffscreenView.projection = SceneProjection(aspectRatio);
+    SceneView* pSceneView = &g_OffscreenView;
+    CullViews(g_ViewObjects, &pSceneView, 1, 1);
+
+    GraphTarget output;
+    output.pTexture = pOutput;
+    output.pRenderTargetView = pOutputView;
+    output.pDepthStencilView = pOutputDepth;
+    RenderView(output, width, height, width, height, g_OffscreenView, t);
+}
+
+Matrix ObjectWorld(const SceneObject& object, float t)
+{
+    return MatrixScaling(object.scale, object.scale, object.scale) *
+           MatrixRotationY(object.spin * t) *
+           MatrixTranslation(object.position.x, object.position.y, object.position.z);
+}
+
+Matrix SceneProjection(float aspectRatio)
+{
+    return MatrixPerspectiveFovLH(PiDiv2, aspectRatio, 0.01f, 100.0f);
+}
+
+// Данные объектов, общие для всех видов кадра: мировые матрицы, объёмы (их же
+// берёт BVH выбора) и ключ состояния — шейдер один на всех, материал — текстура
+// (0 — белая), меш — 0 для кубика-заглушки, иначе номер меша в стримере + 1
+void UpdateViewObjects(float t)
+{
+    const size_t count = g_Scene.objects.size();
+    g_ObjectWorlds.resize(count);
+    g_ObjectBounds.resize(count);
+    g_ViewObjects.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Matrix world = ObjectWorld(g_Scene.objects[i], t);
+        StoreFloat4x4(&g_ObjectWorlds[i], MatrixTranspose(world));
+        g_ObjectBounds[i] = TransformAabb(ObjectLocalBounds(i), world);
+
+        ViewObject& object = g_ViewObjects[i];
+        object.bounds = g_ObjectBounds[i];
+        object.center = g_Scene.objects[i].position;
+        object.mesh = 0;
+        if (i < g_ObjectMeshes.size() && g_ObjectMeshes[i] < g_Meshes.size() && g_Meshes[g_ObjectMeshes[i]].indexCount > 0)
+            object.mesh = g_ObjectMeshes[i] + 1;
+        object.material = 0;
+        if (i < g_ObjectTextures.size() && g_ObjectTextures[i] < g_Textures.size())
+            object.material = g_ObjectTextures[i] + 1;
+        object.transparent = object.material > 0 && g_Textures[object.material - 1].hasAlpha;
+    }
+}
+
+void RenderScene(ID3D11RenderTargetView* pRenderTargetView, ID3D11DepthStencilView* pDepthStencilView, UINT width, UINT height, const SceneView& sceneView, float t)
+{
+    if (width == 0 || height == 0) return;
+
+    // Привязываем Render Target View к контексту устройства
+    g_pImmediateContext->OMSetRenderTargets(1, &pRenderTargetView, pDepthStencilView);
+
+    D3D11_VIEWPORT vp = {};
+    vp.Width = (FLOAT)width;
+    vp.Height = (FLOAT)height;
+    vp.MinDepth = 0.0f;
+    vp.MaxDepth = 1.0f;
+    vp.TopLeftX = 0;
+    vp.TopLeftY = 0;
+    g_pImmediateContext->RSSetViewports(1, &vp);
+
+    // Обновление константных буферов с использованием UpdateSubresource
+    ConstantBufferViewProjection cbViewProjection;
+    StoreFloat4x4(&cbViewProjection.mView, MatrixTranspose(sceneView.view));
+    StoreFloat4x4(&cbViewProjection.mProjection, MatrixTranspose(sceneView.projection));
+    g_Resources.UpdateBuffer(g_pImmediateContext.Get(), g_ConstantBufferViewProjection, &cbViewProjection, sizeof(cbViewProjection));
+
+    UpdateLighting(sceneView.view, sceneView.projection, width, height, t);
+
+    // Цель уже очищена: это делает граф кадра перед первой записью
+    // Установка шейдеров и константных буферов
+    g_pImmediateContext->VSSetShader(g_pVertexShader.Get(), nullptr, 0);
+    g_pImmediateContext->VSSetConstantBuffers(0, 1, g_ConstantBufferWorld.pBuffer.GetAddressOf());
+    g_pImmediateContext->VSSetConstantBuffers(1, 1, g_ConstantBufferViewProjection.pBuffer.GetAddressOf());
+    g_pImmediateContext->PSSetShader(g_pPixelShader.Get(), nullptr, 0);
+    g_pImmediateContext->PSSetSamplers(0, 1, g_pSamplerLinear.GetAddressOf());
+    g_pImmediateContext->PSSetConstantBuffers(2, 1, g_ConstantBufferLighting.pBuffer.GetAddressOf());
+    ID3D11ShaderResourceView* lightViews[3] = { g_LightBuffer.pShaderResourceView.Get(), g_ClusterRangeBuffer.pShaderResourceView.Get(), g_LightIndexBuffer.pShaderResourceView.Get() };
+    g_pImmediateContext->PSSetShaderResources(1, 3, lightViews);
+
+    g_pImmediateContext->IASetInputLayout(g_pVertexLayout.Get());
+    g_pImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    // Персонажи непрозрачны и рисуются до очереди; очередь сама перепривяжет меш и текстуру
+    RenderCharacters(t);
+
+    // Очередь вида уже отсечена и отсортирована (CullViews); здесь только отправка
+    const RenderQueue& queue = sceneView.queue;
+    RenderQueueStats stats;
+    stats.sortMs = sceneView.sortMs;
+    stats.draws = queue.Size();
+    stats.shaderChanges = stats.draws > 0 ? 1 : 0; // шейдер пока один и ставится выше
+
+    // Отправка в порядке ключей; состояние перепривязывается только при смене
+    const ResidentMesh* pBoundMesh = nullptr;
+    const Texture* pBoundTexture = nullptr;
+    RenderPass boundPass = RenderPass::Opaque;
+    g_pImmediateContext->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+    g_pImmediateContext->OMSetDepthStencilState(nullptr, 0);
+    for (size_t n = 0; n < queue.Size(); ++n)
+    {
+        const DrawItem& item = queue.Items()[n];
+        const size_t i = item.payload;
+
+        RenderPass pass = SortKey::Pass(item.key);
+        if (pass != boundPass)
+        {
+            bool transparent = pass == RenderPass::Transparent;
+            g_pImmediateContext->OMSetBlendState(transparent ? g_pBlendAlpha.Get() : nullptr, nullptr, 0xffffffff);
+            g_pImmediateContext->OMSetDepthStencilState(transparent ? g_pDepthReadOnly.Get() : nullptr, 0);
+            boundPass = pass;
+            ++stats.passChanges;
+        }
+
+        const ResidentMesh* pMesh = nullptr;
+        if (i < g_ObjectMeshes.size() && g_ObjectMeshes[i] < g_Meshes.size() && g_Meshes[g_ObjectMeshes[i]].indexCount > 0)
+            pMesh = &g_Meshes[g_ObjectMeshes[i]];
+
+        if (n == 0 || pMesh != pBoundMesh)
+        {
+            // Установка вершинного буфера и индексов; без меша — кубик-заглушка
+            const GpuBuffer& vertexBuffer = pMesh ? pMesh->vertexBuffer : g_VertexBuffer;
+            const GpuBuffer& indexBuffer = pMesh ? pMesh->indexBuffer : g_IndexBuffer;
+            UINT stride = sizeof(SimpleVertex);
+            UINT offset = vertexBuffer.offset;
+            g_pImmediateContext->IASetVertexBuffers(0, 1, vertexBuffer.pBuffer.GetAddressOf(), &stride, &offset);
+            g_pImmediateContext->IASetIndexBuffer(indexBuffer.pBuffer.Get(), pMesh ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, indexBuffer.offset);
+            pBoundMesh = pMesh;
+            ++stats.meshChanges;
+        }
+
+        const Texture* pTexture = &g_WhiteTexture;
+        if (i < g_ObjectTextures.size() && g_ObjectTextures[i] < g_Textures.size())
+            pTexture = &g_Textures[g_ObjectTextures[i]];
+        if (pTexture != pBoundTexture)
+        {
+            g_pImmediateContext->PSSetShaderResources(0, 1, pTexture->pShaderResourceView.GetAddressOf());
+            pBoundTexture = pTexture;
+            ++stats.materialChanges;
+        }
+
+        ConstantBufferWorld cbWorld;
+        cbWorld.mWorld = g_ObjectWorlds[i];
+        g_Resources.UpdateBuffer(g_pImmediateContext.Get(), g_ConstantBufferWorld, &cbWorld, sizeof(cbWorld));
+
+        g_pImmediateContext->DrawIndexed(pMesh ? pMesh->indexCount : 36, 0, 0);
+    }
+
+    if (boundPass != RenderPass::Opaque)
+    {
+        g_pImmediateContext->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+        g_pImmediateContext->OMSetDepthStencilState(nullptr, 0);
+    }
+    g_RenderStats = stats;
+}
+
+// Раз в секунду — число отрисовок, смены состояния и время сортировки очереди
+void ReportRenderStats()
+{
+    static ULONGLONG lastReport = 0;
+    ULONGLONG now = GetTickCount64();
+    if (now - lastReport < 1000) return;
+
+    ReportMemory();
+
+    // Очередь и граф — главного окна; отсечение — всех окон вместе
+    const OutputWindow& mainWindow = *g_Windows[0];
+    const RenderQueueStats& renderStats = mainWindow.renderStats;
+    char line[256];
+    snprintf(line, sizeof(line), "Render queue: %zu draws, sort %.3f ms, state changes %zu (pass %zu, shader %zu, material %zu, mesh %zu)\n",
+        renderStats.draws, renderStats.sortMs, renderStats.StateChanges(), renderStats.passChanges,
+        renderStats.shaderChanges, renderStats.materialChanges, renderStats.meshChanges);
+    OutputDebugStringA(line);
+
+    snprintf(line, sizeof(line), "Views: %zu of %zu objects, %zu visible in all views, cull and sort %.3f ms on %u threads\n",
+        g_ViewCullingStats.views, g_ViewCullingStats.objects, g_ViewCullingStats.visible, g_ViewCullingStats.ms, g_ViewCullingStats.threads);
+    OutputDebugStringA(line);
+
+    if (!g_Scene.lights.empty())
+    {
+        const LightCullingStats& lights = g_LightClusterer.Stats();
+        snprintf(line, sizeof(line), "Clustered lights: %zu lights, %zu visible, %zu indices in %zu clusters (max %u), assign %.3f ms\n",
+            lights.lights, lights.visibleLights, lights.indexCount, lights.occupiedClusters, lights.maxClusterLights, lights.assignMs);
+        OutputDebugStringA(line);
+    }
+
+    // Цена сглаживания: среднее время кадра на GPU в текущем режиме и последние замеры остальных
+    const int mode = (int)g_AntiAliasing;
+    if (g_GpuTimer.Samples() > 0)
+        g_AntiAliasingGpuMs[mode] = g_GpuTimer.AverageMs();
+    g_GpuTimer.ResetAverage();
+
+    int length = snprintf(line, sizeof(line), "Anti-aliasing: %s, GPU frame %.3f ms", AntiAliasingName(g_AntiAliasing), g_AntiAliasingGpuMs[mode]);
+    for (int other = 0; other < (int)AntiAliasingMode::Count && length < (int)sizeof(line); ++other)
+    {
+        if (other != mode && g_AntiAliasingGpuMs[other] > 0.0)
+            length += snprintf(line + length, sizeof(line) - length, ", %s %.3f ms", AntiAliasingName((AntiAliasingMode)other), g_AntiAliasingGpuMs[other]);
+    }
+    if (length < (int)sizeof(line) - 1)
+        snprintf(line + length, sizeof(line) - length, "\n");
+    OutputDebugStringA(line);
+
+    if (!g_Scene.characters.empty())
+    {
+        const AnimationStats& animation = g_Crowd.Stats();
+        snprintf(line, sizeof(line), "Animation: %zu characters (%zu joints, %zu vertices each), %s skinning, poses %.3f ms, CPU skinning %.3f ms on %u threads\n",
+            animation.characters, animation.joints, animation.vertices, g_SkinningMode == SkinningMode::Gpu ? "GPU" : "CPU",
+            animation.poseMs, g_SkinningMode == SkinningMode::Cpu ? animation.skinMs : 0.0, animation.threads);
+        OutputDebugStringA(line);
+    }
+
+    const RenderGraphStats& graphStats = mainWindow.graphStats;
+    snprintf(line, sizeof(line), "Render graph: %zu passes (%zu culled), %zu transient targets in %zu physical, %.1f MB (%.1f MB saved by aliasing), %zu clears, %zu discards%s, compile %.3f ms\n",
+        graphStats.passes, graphStats.culledPasses, graphStats.transientResources, graphStats.physicalResources,
+        graphStats.physicalBytes / (1024.0 * 1024.0), graphStats.SavedBytes() / (1024.0 * 1024.0),
+        graphStats.clears, graphStats.discards, g_pImmediateContext1 ? "" : " (skipped: no D3D11.1)", graphStats.compileMs);
+    OutputDebugStringA(line);
+
+    const JobStats jobs = Jobs().Stats();
+    if (jobs.jobs > 0)
+    {
+        snprintf(line, sizeof(line), "Jobs: %u threads, %llu jobs, %.1f%% stolen, %llu splits, %llu failed steals, %.2f%% contended locks, %llu sleeps\n",
+            jobs.threads, (unsigned long long)jobs.jobs, jobs.StealRate() * 100.0, (unsigned long long)jobs.splits,
+            (unsigned long long)jobs.failedSteals, jobs.ContentionRate() * 100.0, (unsigned long long)jobs.sleeps);
+        OutputDebugStringA(line);
+        Jobs().ResetStats();
+    }
+
+    const LatencyStats& latency = g_InputLatency.Stats();
+    if (latency.frames > 0 || g_Input.Dropped() > 0)
+    {
+        snprintf(line, sizeof(line), "Input: %zu frames with input, input-to-%s latency %.2f ms (%.2f-%.2f), last %.2f ms, %zu events dropped\n",
+            latency.frames, g_LatencySource == LatencySource::Scanout ? "photon" : "GPU-done", latency.averageMs, latency.minMs, latency.maxMs,
+            latency.lastMs, g_Input.Dropped());
+        OutputDebugStringA(line);
+        g_InputLatency.ResetStats();
+    }
+
+    if (g_DynamicResolution)
+    {
+        UINT renderWidth = 0, renderHeight = 0;
+        g_Resolution.ScaledSize(mainWindow.surface.BufferWidth(), mainWindow.surface.BufferHeight(), renderWidth, renderHeight);
+        const ResolutionStats resolution = g_Resolution.Stats();
+        snprintf(line, sizeof(line), "Dynamic resolution: scale %.3f (%ux%u); last %zu frames: scale %.3f-%.3f avg %.3f, frame %.2f ms of %.2f ms budget, %zu over, %zu scale changes\n",
+            resolution.scale, renderWidth, renderHeight, resolution.frames, resolution.minScale, resolution.maxScale, resolution.averageScale,
+            resolution.averageFrameMs, g_Resolution.Settings().targetMs, resolution.overBudgetFrames, resolution.scaleChanges);
+        OutputDebugStringA(line);
+    }
+    lastReport = now;
+}
+
+void SetAntiAliasing(AntiAliasingMode mode)
+{
+    // Замеры прошлого режима не должны смешаться с новым
+    g_GpuTimer.Poll(g_pImmediateContext.Get(), true);
+    if (g_GpuTimer.Samples() > 0)
+        g_AntiAliasingGpuMs[(int)g_AntiAliasing] = g_GpuTimer.AverageMs();
+    g_GpuTimer.ResetAverage();
+    g_AntiAliasing = mode;
+
+    char line[128];
+    snprintf(line, sizeof(line), "Anti-aliasing: %s (%u samples)\n", AntiAliasingName(mode), g_SupportedSamples[(int)mode]);
+    OutputDebugStringA(line);
+}
+
+HRESULT UploadStructured(StructuredBuffer& buffer, const void* pData, UINT elementSize, UINT count)
+{
+    // Пустой буфер не создать, а SRV нужен всегда — минимум один элемент
+    if (count > buffer.capacity || !buffer.pBuffer)
+    {
+        UINT capacity = 1;
+        while (capacity < count) capacity *= 2;
+
+        D3D11_BUFFER_DESC bd = {};
+        bd.Usage = D3D11_USAGE_DYNAMIC;
+        bd.ByteWidth = capacity * elementSize;
+        bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        bd.StructureByteStride = elementSize;
+
+        StructuredBuffer created;
+        HRESULT hr = g_pd3dDevice->CreateBuffer(&bd, nullptr, created.pBuffer.GetAddressOf());
+        if (FAILED(hr)) return hr;
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvd = {};
+        srvd.Format = DXGI_FORMAT_UNKNOWN;
+        srvd.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        srvd.Buffer.FirstElement = 0;
+        srvd.Buffer.NumElements = capacity;
+        hr = g_pd3dDevice->CreateShaderResourceView(created.pBuffer.Get(), &srvd, created.pShaderResourceView.GetAddressOf());
+        if (FAILED(hr)) return hr;
+
+        created.capacity = capacity;
+        created.sizeBytes = bd.ByteWidth;
+        g_Memory.Free(MemoryDomain::Gpu, MemoryCategory::Constant, buffer.sizeBytes);
+        g_Memory.Allocate(MemoryDomain::Gpu, MemoryCategory::Constant, created.sizeBytes);
+        buffer = created;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    HRESULT hr = g_pImmediateContext->Map(buffer.pBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+    if (FAILED(hr)) return hr;
+    if (count > 0) memcpy(mapped.pData, pData, (size_t)count * elementSize);
+    g_pImmediateContext->Unmap(buffer.pBuffer.Get(), 0);
+    return S_OK;
+}
+
+// Источники сцены в момент t раскладываются по кластерам текущей проекции
+// и загружаются в структурные буферы пиксельного шейдера
+void UpdateLighting(const Matrix& view, const Matrix& projection, UINT width, UINT height, float t)
+{
+    ConstantBufferLighting cbLighting = {};
+    const ClusterGrid& grid = g_LightClusterer.Grid();
+
+    if (!g_Scene.lights.empty())
+    {
+        g_FrameLights.resize(g_Scene.lights.size());
+        for (size_t i = 0; i < g_Scene.lights.size(); ++i)
+        {
+            const SceneLight& source = g_Scene.lights[i];
+            PointLight& light = g_FrameLights[i];
+            light.position = source.position;
+            light.position.y += source.bob * sinf(t + source.phase);
+            light.radius = source.radius;
+            light.color = source.color;
+            light.intensity = source.intensity;
+        }
+
+        g_LightClusterer.SetGrid(ClusterGrid::FromProjection(projection, 16, 9, 24));
+        g_LightClusterer.Assign(g_FrameLights, view, Jobs().ThreadCount());
+
+        const std::vector<PointLight>& lights = g_LightClusterer.ViewLights();
+        const std::vector<ClusterRange>& ranges = g_LightClusterer.Ranges();
+        const std::vector<uint32_t>& indices = g_LightClusterer.LightIndices();
+        if (FAILED(UploadStructured(g_LightBuffer, lights.data(), sizeof(PointLight), (UINT)lights.size())) ||
+            FAILED(UploadStructured(g_ClusterRangeBuffer, ranges.data(), sizeof(ClusterRange), (UINT)ranges.size())) ||
+            FAILED(UploadStructured(g_LightIndexBuffer, indices.data(), sizeof(uint32_t), (UINT)indices.size())))
+        {
+            g_LightBuffer = StructuredBuffer(); // без буферов шейдер рисует без освещения
+        }
+    }
+
+    if (g_LightBuffer.pShaderResourceView.Get() != nullptr && !g_Scene.lights.empty())
+    {
+        cbLighting.clusterDims[0] = grid.tilesX;
+        cbLighting.clusterDims[1] = grid.tilesY;
+        cbLighting.clusterDims[2] = grid.slices;
+        cbLighting.clusterDims[3] = (uint32_t)g_FrameLights.size();
+        cbLighting.screenSlices = Float4((float)width, (float)height, grid.SliceScale(), grid.SliceBias());
+        cbLighting.ambient = Float4(g_AmbientLight, g_AmbientLight, g_AmbientLight, 1.0f);
+    }
+    g_Resources.UpdateBuffer(g_pImmediateContext.Get(), g_ConstantBufferLighting, &cbLighting, sizeof(cbLighting));
+}
+
+// Позы толпы в момент t и их загрузка: палитры — в буфер костей или, при
+// скиннинге на CPU, готовые вершины. Кадр может рисоваться несколько раз
+// (захват), поэтому для того же t и режима ничего не пересчитывается
+bool AnimateCharacters(float t)
+{
+    if (t == g_AnimatedTime && g_SkinningMode == g_AnimatedMode) return true;
+
+    const unsigned threads = Jobs().ThreadCount();
+    g_Crowd.EvaluatePoses(g_Characters, t, threads);
+    g_AnimatedTime = -1.0f;
+
+    if (g_SkinningMode == SkinningMode::Gpu)
+    {
+        const std::vector<Float4x4>& palette = g_Crowd.Palette();
+        if (FAILED(UploadStructured(g_BoneBuffer, palette.data(), sizeof(Float4), (UINT)(palette.size() * 4)))) return false;
+    }
+    else
+    {
+        g_Crowd.SkinOnCpu(threads);
+        const std::vector<float>& vertices = g_Crowd.SkinnedVertices();
+        const UINT size = (UINT)(vertices.size() * sizeof(float));
+        if (!g_SkinnedVertexBuffer.IsValid() && FAILED(g_Resources.CreateBuffer(BufferKind::Vertex, size, nullptr, g_SkinnedVertexBuffer))) return false;
+        g_Resources.UpdateBuffer(g_pImmediateContext.Get(), g_SkinnedVertexBuffer, vertices.data(), size);
+    }
+
+    g_AnimatedTime = t;
+    g_AnimatedMode = g_SkinningMode;
+    return true;
+}
+
+void RenderCharacters(float t)
+{
+    if (g_Scene.characters.empty() || !EnsureCharacters() || !AnimateCharacters(t)) return;
+
+    const UINT characterCount = (UINT)g_Crowd.CharacterCount();
+    const UINT vertexCount = (UINT)g_Crowd.Mesh().VertexCount();
+    const UINT indexCount = (UINT)g_Crowd.Mesh().indices.size();
+    g_pImmediateContext->PSSetShaderResources(0, 1, g_WhiteTexture.pShaderResourceView.GetAddressOf());
+    g_pImmediateContext->IASetIndexBuffer(g_CharacterIndexBuffer.pBuffer.Get(), DXGI_FORMAT_R32_UINT, g_CharacterIndexBuffer.offset);
+
+    if (g_SkinningMode == SkinningMode::Gpu)
+    {
+        ID3D11Buffer* buffers[2] = { g_CharacterVertexBuffer.pBuffer.Get(), g_CharacterSkinBuffer.pBuffer.Get() };
+        UINT strides[2] = { sizeof(SimpleVertex), sizeof(SkinWeights) };
+        UINT offsets[2] = { g_CharacterVertexBuffer.offset, g_CharacterSkinBuffer.offset };
+        g_pImmediateContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+        g_pImmediateContext->IASetInputLayout(g_pSkinnedVertexLayout.Get());
+        g_pImmediateContext->VSSetShader(g_pSkinnedVertexShader.Get(), nullptr, 0);
+        g_pImmediateContext->VSSetConstantBuffers(3, 1, g_ConstantBufferSkinning.pBuffer.GetAddressOf());
+        g_pImmediateContext->VSSetShaderResources(0, 1, g_BoneBuffer.pShaderResourceView.GetAddressOf());
+
+        g_pImmediateContext->DrawIndexedInstanced(indexCount, characterCount, 0, 0, 0);
+
+        ID3D11Buffer* nullBuffer = nullptr;
+        UINT zero = 0;
+        g_pImmediateContext->IASetVertexBuffers(1, 1, &nullBuffer, &zero, &zero);
+        g_pImmediateContext->IASetInputLayout(g_pVertexLayout.Get());
+        g_pImmediateContext->VSSetShader(g_pVertexShader.Get(), nullptr, 0);
+    }
+    else
+    {
+        // Вершины уже в мировых координатах; у каждого персонажа своя база вершин
+        ConstantBufferWorld cbWorld;
+        StoreFloat4x4(&cbWorld.mWorld, MatrixIdentity());
+        g_Resources.UpdateBuffer(g_pImmediateContext.Get(), g_ConstantBufferWorld, &cbWorld, sizeof(cbWorld));
+
+        UINT stride = sizeof(SimpleVertex);
+        UINT offset = g_SkinnedVertexBuffer.offset;
+        g_pImmediateContext->IASetVertexBuffers(0, 1, g_SkinnedVertexBuffer.pBuffer.GetAddressOf(), &stride, &offset);
+        for (UINT i = 0; i < characterCount; ++i)
+            g_pImmediateContext->DrawIndexed(indexCount, 0, (INT)(i * vertexCount));
+    }
+}
+
+// Всё, что для сцены можно сделать без устройства; thread — поток для фаз запуска
+bool PrepareScene(const std::string& scenePath, unsigned thread)
+{
+    StartupTimeline::Clock::time_point phase = StartupTimeline::Clock::now();
+    if (!scenePath.empty())
+    {
+        const bool loaded = LoadScene(scenePath, g_Scene);
+        phase = g_Startup.Mark("scene file", thread, phase, loaded);
+        if (!loaded) return false;
+    }
+
+    StartMeshStreaming();
+    phase = g_Startup.Mark("start mesh streaming", thread, phase);
+    PrepareSceneTextures();
+    g_Startup.Mark("texture decode and compress", thread, phase);
+    return true;
+}
+
+void PrepareSceneTextures()
+{
+    g_PreparedTextures.clear();
+
+    // Каждое изображение читается и сжимается один раз
+    std::unordered_map<std::string, bool> seen;
+    for (const SceneObject& object : g_Scene.objects)
+    {
+        if (object.texture.empty() || !seen.emplace(object.texture, true).second) continue;
+
+        PreparedTexture prepared;
+        prepared.path = object.texture;
+        Image image;
+        prepared.prepared = SUCCEEDED(LoadImageFile(prepared.path, image)) &&
+                            SUCCEEDED(PrepareTexture(image, ChooseTextureFormat(image), prepared.data));
+        g_Memory.Allocate(MemoryDomain::Cpu, MemoryCategory::Texture, prepared.data.SizeBytes());
+        g_PreparedTextures.push_back(std::move(prepared));
+    }
+}
+
+void LoadSceneTextures()
+{
+    g_Textures.clear();
+    g_ObjectTextures.assign(g_Scene.objects.size(), ~0u);
+
+    // Каждая текстура создаётся один раз; не загрузившаяся заменяется белой
+    std::unordered_map<std::string, uint32_t> loaded;
+    for (const PreparedTexture& prepared : g_PreparedTextures)
+    {
+        Texture texture;
+        char line[512];
+        if (!prepared.prepared || FAILED(CreateTexture(g_pd3dDevice.Get(), prepared.data, texture)))
+        {
+            snprintf(line, sizeof(line), "Texture: failed to load %s\n", prepared.path.c_str());
+            OutputDebugStringA(line);
+            loaded[prepared.path] = ~0u;
+            continue;
+        }
+
+        snprintf(line, sizeof(line), "Texture: %s %ux%u, %u mips, %s %.2f MB (RGBA8 %.2f MB, %.1fx smaller)\n",
+            prepared.path.c_str(), texture.width, texture.height, texture.mipLevels, TextureFormatName(texture.format),
+            texture.sizeBytes / 1048576.0, texture.rgba8SizeBytes / 1048576.0, (double)texture.rgba8SizeBytes / texture.sizeBytes);
+        OutputDebugStringA(line);
+
+        g_Memory.Allocate(MemoryDomain::Gpu, MemoryCategory::Texture, texture.sizeBytes);
+        g_Textures.push_back(texture);
+        loaded[prepared.path] = (uint32_t)g_Textures.size() - 1;
+    }
+
+    for (const PreparedTexture& prepared : g_PreparedTextures)
+        g_Memory.Free(MemoryDomain::Cpu, MemoryCategory::Texture, prepared.data.SizeBytes());
+    g_PreparedTextures.clear();
+
+    for (size_t i = 0; i < g_Scene.objects.size(); ++i)
+    {
+        auto it = loaded.find(g_Scene.objects[i].texture);
+        if (it != loaded.end()) g_ObjectTextures[i] = it->second;
+    }
+}
+
+void StartMeshStreaming()
+{
+    g_ObjectMeshes.assign(g_Scene.objects.size(), MeshStreamer::InvalidMesh);
+    for (size_t i = 0; i < g_Scene.objects.size(); ++i)
+    {
+        if (!g_Scene.objects[i].mesh.empty())
+            g_ObjectMeshes[i] = g_MeshStreamer.Request(g_Scene.objects[i].mesh, 0.0f);
+    }
+
+    uint32_t meshCount = 0;
+    for (uint32_t meshId : g_ObjectMeshes)
+    {
+        if (meshId != MeshStreamer::InvalidMesh && meshId + 1 > meshCount) meshCount = meshId + 1;
+    }
+    g_Meshes.resize(meshCount);
+    g_PickMeshes.resize(meshCount);
+    if (meshCount == 0) return;
+
+    // Один поток на чтение, разбор — не больше чем на половине потоков планировщика
+    const unsigned threads = Jobs().ThreadCount();
+    g_MeshStreamer.Start(threads > 2 ? threads / 2 : 1);
+}
+
+// В основном потоке: дожидается задачи построения, если BVH строился в фоне (Wait
+// возвращается, только когда задача отпустила счётчик), и освобождает копию геометрии
+void AcceptPickBvh(uint32_t meshId, PickableMesh& mesh)
+{
+    if (mesh.pBuild) Jobs().Wait(*mesh.pBuild);
+    g_Memory.Free(MemoryDomain::Cpu, MemoryCategory::Mesh, mesh.SizeBytes());
+    mesh.pBuild.reset();
+    mesh.bvhReady = true;
+    std::vector<Float3>().swap(mesh.positions);
+    std::vector<uint32_t>().swap(mesh.indices);
+    g_Memory.Allocate(MemoryDomain::Cpu, MemoryCategory::Mesh, mesh.SizeBytes());
+
+    const BvhStats& stats = mesh.bvh.Stats();
+    char line[256];
+    snprintf(line, sizeof(line), "Pick: mesh %u BVH, %zu triangles, %zu nodes, depth %u, SAH cost %.1f, built in %.2f ms in the background\n",
+        meshId, stats.primitives, stats.nodes, stats.depth, stats.sahCost, stats.buildMs);
+    OutputDebugStringA(line);
+}
+
+bool UploadMesh(uint32_t meshId, const MeshData& mesh)
+{
+    static_assert(sizeof(SimpleVertex) == MeshData::VertexFloats * sizeof(float), "MeshData vertex layout must match SimpleVertex");
+    if (meshId >= g_Meshes.size()) return false;
+
+    ResidentMesh resident;
+    HRESULT hr = g_Resources.CreateBuffer(BufferKind::Vertex, (UINT)(mesh.vertices.size() * sizeof(float)), mesh.vertices.data(), resident.vertexBuffer);
+    if (SUCCEEDED(hr))
+        hr = g_Resources.CreateBuffer(BufferKind::Index, (UINT)(mesh.indices.size() * sizeof(uint32_t)), mesh.indices.data(), resident.indexBuffer);
+    if (FAILED(hr))
+    {
+        g_Resources.Release(resident.vertexBuffer);
+        g_Resources.Release(resident.indexBuffer);
+        return false;
+    }
+
+    resident.indexCount = (UINT)mesh.indices.size();
+    g_Meshes[meshId] = resident;
+
+    // Позиции и индексы остаются на CPU, пока фоновая задача строит по ним BVH
+    PickableMesh& pickable = g_PickMeshes[meshId];
+    pickable.positions.resize(mesh.VertexCount());
+    for (size_t i = 0; i < pickable.positions.size(); ++i)
+    {
+        const float* pVertex = &mesh.vertices[i * MeshData::VertexFloats];
+        pickable.positions[i] = Float3(pVertex[0], pVertex[1], pVertex[2]);
+        pickable.bounds.Grow(pickable.positions[i]);
+    }
+    pickable.indices = mesh.indices;
+    g_Memory.Allocate(MemoryDomain::Cpu, MemoryCategory::Mesh, pickable.SizeBytes());
+
+    // Рабочих потоков нет (-jobs 1): фоновая задача ждала бы Jobs().Wait, поэтому строим сразу
+    if (Jobs().ThreadCount() == 1)
+    {
+        pickable.bvh.Build(pickable.positions.data(), pickable.indices.data(), pickable.indices.size(), 1);
+        AcceptPickBvh(meshId, pickable);
+        return true;
+    }
+
+    // Одним потоком: построение не должно отнимать у кадра рабочие потоки
+    PickableMesh* pPickable = &pickable;
+    pickable.pBuild.reset(new JobCounter());
+    Jobs().Run([pPickable] { pPickable->bvh.Build(pPickable->positions.data(), pPickable->indices.data(), pPickable->indices.size(), 1); },
+        pickable.pBuild.get(), nullptr, JobPriority::Background);
+    return true;
+}
+
+void AcceptFinishedPickBvhs()
+{
+    for (uint32_t meshId = 0; meshId < g_PickMeshes.size(); ++meshId)
+    {
+        PickableMesh& mesh = g_PickMeshes[meshId];
+        if (mesh.pBuild && mesh.pBuild->Done()) AcceptPickBvh(meshId, mesh);
+    }
+}
+
+void UpdateMeshStreaming(const Matrix& view)
+{
+    if (g_Meshes.empty()) return;
+
+    // Приоритет — радиус кубика-заглушки на экране (при FOV 90° это r / z);
+    // объекты позади камеры тоже грузятся, но после видимых
+    std::vector<float> priorities(g_Meshes.size(), 0.0f);
+    for (size_t i = 0; i < g_Scene.objects.size() && i < g_ObjectMeshes.size(); ++i)
+    {
+        const uint32_t meshId = g_ObjectMeshes[i];
+        if (meshId == MeshStreamer::InvalidMesh || g_Meshes[meshId].indexCount > 0) continue;
+
+        const SceneObject& object = g_Scene.objects[i];
+        Vector center = Vector3TransformCoord(LoadFloat3(&object.position), view);
+        float depth = VectorGetZ(center);
+        float radius = object.scale * 1.7320508f;
+        float priority = 1.0f; // камера внутри или вплотную
+        if (depth > radius) priority = radius / depth;
+        else if (depth < -radius) priority = 0.1f * radius / -depth;
+
+        if (priority > priorities[meshId]) priorities[meshId] = priority;
+    }
+    for (uint32_t meshId = 0; meshId < priorities.size(); ++meshId)
+    {
+        if (g_Meshes[meshId].indexCount == 0) g_MeshStreamer.SetPriority(meshId, priorities[meshId]);
+    }
+
+    g_MeshStreamer.Pump(g_UploadBudgetBytes, g_UploadBudgetMs, UploadMesh);
+    AcceptFinishedPickBvhs();
+
+    // Раз в секунду, пока идёт загрузка, — состояние очереди и пропускная способность
+    static ULONGLONG lastReport = 0;
+    static bool reportedIdle = true;
+    ULONGLONG now = GetTickCount64();
+    if (now - lastReport < 1000) return;
+
+    StreamingStats stats = g_MeshStreamer.Stats();
+    bool idle = stats.queued + stats.loading + stats.ready + stats.uploading == 0;
+    if (idle && reportedIdle) return;
+
+    char line[256];
+    snprintf(line, sizeof(line), "Streaming: queued %zu, loading %zu, ready %zu (%.1f MB), resident %zu, failed %zu, upload %.1f MB/s, last frame %.1f KB in %.2f ms\n",
+        stats.queued, stats.loading, stats.ready, stats.readyBytes / 1048576.0, stats.resident, stats.failed,
+        stats.uploadBytesPerSecond / 1048576.0, stats.lastPumpBytes / 1024.0, stats.lastPumpMs);
+    OutputDebugStringA(line);
+    lastReport = now;
+    reportedIdle = idle;
+}
+
+void FlushMeshStreaming()
+{
+    if (g_Meshes.empty()) return;
+
+    g_MeshStreamer.WaitUntilDecoded();
+    g_MeshStreamer.Pump(~0ull, 1e9, UploadMesh);
+}
+
+void StopMeshStreaming()
+{
+    g_MeshStreamer.Stop();
+    for (ResidentMesh& mesh : g_Meshes)
+    {
+        g_Resources.Release(mesh.vertexBuffer);
+        g_Resources.Release(mesh.indexBuffer);
+    }
+    g_Meshes.clear();
+    for (PickableMesh& mesh : g_PickMeshes)
+    {
+        // Задача построения держит указатель на меш — дождаться её до удаления
+        if (mesh.pBuild) Jobs().Wait(*mesh.pBuild);
+        g_Memory.Free(MemoryDomain::Cpu, MemoryCategory::Mesh, mesh.SizeBytes());
+    }
+    g_PickMeshes.clear();
+    g_ObjectMeshes.clear();
+}
+
+// Луч из камеры через пиксель окна. Проекция — как в RenderScene: FOV 90°, то есть
+// tan(45°) = 1, и у направления единичная составляющая вдоль взгляда — t равно глубине
+Ray CameraRay(Vector eye, Vector at, Vector up, float x, float y, UINT width, UINT height, float aspectRatio)
+{
+    const float ndcX = (x + 0.5f) / width * 2.0f - 1.0f;
+    const float ndcY = 1.0f - (y + 0.5f) / height * 2.0f;
+    const Vector forward = Vector3Normalize(VectorSubtract(at, eye));
+    const Vector right = Vector3Normalize(Vector3Cross(up, forward));
+    const Vector cameraUp = Vector3Cross(forward, right);
+
+    Ray ray;
+    StoreFloat3(&ray.origin, eye);
+    StoreFloat3(&ray.direction, VectorAdd(forward, VectorAdd(VectorMultiply(right, VectorReplicate(ndcX * aspectRatio)), VectorMultiply(cameraUp, VectorReplicate(ndcY)))));
+    ray.tMax = 100.0f; // дальняя плоскость
+    return ray;
+}
+
+// BVH треугольников объекта; пока меш не на GPU, объект рисуется и выбирается как кубик
+const MeshBvh& ObjectMeshBvh(size_t object)
+{
+    const uint32_t meshId = object < g_ObjectMeshes.size() ? g_ObjectMeshes[object] : MeshStreamer::InvalidMesh;
+    if (meshId >= g_Meshes.size() || g_Meshes[meshId].indexCount == 0) return g_CubeBvh;
+
+    // Выбор пришёл раньше, чем фоновое построение закончилось, — дождаться его
+    PickableMesh& mesh = g_PickMeshes[meshId];
+    if (mesh.pBuild) AcceptPickBvh(meshId, mesh);
+    return mesh.bvhReady ? mesh.bvh : g_CubeBvh;
+}
+
+Aabb ObjectLocalBounds(size_t object)
+{
+    const uint32_t meshId = object < g_ObjectMeshes.size() ? g_ObjectMeshes[object] : MeshStreamer::InvalidMesh;
+    if (meshId >= g_Meshes.size() || g_Meshes[meshId].indexCount == 0) return g_CubeBvh.Bounds();
+    const PickableMesh& mesh = g_PickMeshes[meshId];
+    return mesh.bvhReady ? mesh.bvh.Bounds() : mesh.bounds;
+}
+
+// Объёмы объектов в момент t. Число объектов то же — дерево только подгоняется
+// (Refit), иначе строится заново. Возвращает true, если строилось
+bool UpdateObjectBvh(float t)
+{
+    UpdateViewObjects(t);
+    if (!g_ObjectBvh.Empty() && g_ObjectBvh.Stats().primitives == g_ObjectBounds.size())
+    {
+        g_ObjectBvh.Refit(g_ObjectBounds);
+        return false;
+    }
+    g_ObjectBvh.Build(g_ObjectBounds, Jobs().ThreadCount());
+    return true;
+}
+
+// Ближайший объект под лучом — по треугольникам, а не по объёмам. Луч переводится
+// в пространство объекта без нормализации, поэтому t у всех объектов общее
+uint32_t PickObject(const Ray& ray, float t, RayHit& hit)
+{
+    uint32_t picked = ~0u;
+    g_ObjectBvh.Traverse(ray, hit, [&](uint32_t index, const Ray& worldRay, RayHit& closest)
+    {
+        const uint32_t object = g_ObjectBvh.Primitives()[index];
+        const SceneObject& sceneObject = g_Scene.objects[object];
+        const float inverseScale = 1.0f / sceneObject.scale;
+        const Matrix toObject = MatrixTranslation(-sceneObject.position.x, -sceneObject.position.y, -sceneObject.position.z) *
+                                MatrixRotationY(-sceneObject.spin * t) *
+                                MatrixScaling(inverseScale, inverseScale, inverseScale);
+
+        Ray local;
+        StoreFloat3(&local.origin, Vector3TransformCoord(LoadFloat3(&worldRay.origin), toObject));
+        StoreFloat3(&local.direction, Vector3TransformNormal(LoadFloat3(&worldRay.direction), toObject));
+        local.tMax = closest.t;
+        RayHit localHit;
+        if (ObjectMeshBvh(object).Intersect(local, localHit))
+        {
+            closest = localHit;
+            picked = object;
+        }
+    });
+    return picked;
+}
+
+void PickAt(const Ray& ray, float t)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const bool rebuilt = UpdateObjectBvh(t);
+    RayHit hit;
+    const uint32_t object = PickObject(ray, t, hit);
+    const double pickMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const BvhStats& stats = g_ObjectBvh.Stats();
+    char line[512];
+    if (object == ~0u)
+    {
+        snprintf(line, sizeof(line), "Pick: nothing, %.3f ms (object BVH %s %.3f ms)\n", pickMs, rebuilt ? "build" : "refit", rebuilt ? stats.buildMs : stats.refitMs);
+    }
+    else
+    {
+        const std::string& mesh = g_Scene.objects[object].mesh;
+        snprintf(line, sizeof(line), "Pick: object %u (%s), depth %.3f, triangle %u, %.3f ms (object BVH %s %.3f ms)\n",
+            object, mesh.empty() ? "cube" : mesh.c_str(), hit.t, hit.primitive, pickMs, rebuilt ? "build" : "refit", rebuilt ? stats.buildMs : stats.refitMs);
+    }
+    OutputDebugStringA(line);
+}
+
+HRESULT StartCapture()
+{
+    HRESULT hr = g_CaptureReadback.Init(g_pd3dDevice.Get(), g_CaptureWidth, g_CaptureHeight, DXGI_FORMAT_R8G8B8A8_UNORM, g_CaptureReadbackSlots);
+    if (SUCCEEDED(hr) && !g_FrameWriter.Start("capture", FrameFormat::Png))
+        hr = E_FAIL;
+
+    if (FAILED(hr))
+    {
+        g_CaptureReadback.Reset();
+        return hr;
+    }
+
+    g_Memory.Allocate(MemoryDomain::Gpu, MemoryCategory::Staging, g_CaptureReadback.SizeBytes());
+    g_CaptureFrameIndex = 0;
+    g_CaptureEnabled = true;
+    return S_OK;
+}
+
+void StopCapture()
+{
+    if (!g_CaptureEnabled) return;
+
+    // Дочитываем кадры, которые ещё в полёте, и дописываем очередь
+    PumpCapture(true);
+    g_FrameWriter.Stop();
+
+    g_Memory.Free(MemoryDomain::Gpu, MemoryCategory::Staging, g_CaptureReadback.SizeBytes());
+    g_CaptureReadback.Reset();
+    g_CaptureEnabled = false;
+}
+
+void TrackFrameMemory(const FrameWriter& writer)
+{
+    uint64_t frameData = g_OffscreenView.CapacityBytes() + g_LightClusterer.CapacityBytes() +
+        g_FrameLights.capacity() * sizeof(PointLight) + g_Crowd.CapacityBytes() +
+        g_ObjectWorlds.capacity() * sizeof(Float4x4) + g_ViewObjects.capacity() * sizeof(ViewObject);
+    uint64_t surfaces = 0;
+    for (const std::unique_ptr<OutputWindow>& window : g_Windows)
+    {
+        frameData += window->sceneView.CapacityBytes();
+        surfaces += window->surface.SizeBytes();
+    }
+
+    g_Memory.Track(MemoryDomain::Gpu, MemoryCategory::Target, g_TrackedMemory.surface, surfaces);
+    g_Memory.Track(MemoryDomain::Cpu, MemoryCategory::Mesh, g_TrackedMemory.streamingMeshes, g_MeshStreamer.Stats().readyBytes);
+    g_Memory.Track(MemoryDomain::Cpu, MemoryCategory::Transient, g_TrackedMemory.frameData, frameData);
+    g_Memory.Track(MemoryDomain::Cpu, MemoryCategory::Staging, g_TrackedMemory.frameWriter, writer.BufferedBytes());
+}
+
+void ReportMemory()
+{
+    char line[256];
+    for (int domain = 0; domain < (int)MemoryDomain::Count; ++domain)
+    {
+        const MemoryDomain d = (MemoryDomain)domain;
+        const MemoryCounters total = g_Memory.Counters(d, MemoryCategory::Count);
+        int length = snprintf(line, sizeof(line), "Memory %s: %.1f MB (peak %.1f MB), %.1f allocations %.1f KB per frame",
+            MemoryDomainName(d), total.currentBytes / 1048576.0, total.peakBytes / 1048576.0,
+            total.averageFrameAllocations, total.averageFrameAllocatedBytes / 1024.0);
+        for (int category = 0; category < (int)MemoryCategory::Count && length < (int)sizeof(line); ++category)
+        {
+            const MemoryCounters counters = g_Memory.Counters(d, (MemoryCategory)category);
+            if (counters.peakBytes == 0) continue;
+            length += snprintf(line + length, sizeof(line) - length, ", %s %.1f MB", MemoryCategoryName((MemoryCategory)category), counters.currentBytes / 1048576.0);
+        }
+        if (length < (int)sizeof(line) - 1)
+            snprintf(line + length, sizeof(line) - length, "\n");
+        OutputDebugStringA(line);
+    }
+}
+
+// Бюджеты из командной строки и вытеснение: временные цели и свободные
+// константные буферы пулов можно отпустить сразу, остальное только предупреждает
+void ConfigureMemoryTracking(const BatchOptions& options)
+{
+    for (const BatchOptions::MemoryBudget& budget : options.memoryBudgets)
+        g_Memory.SetBudget(budget.domain, budget.category, budget.bytes);
+
+    g_Memory.SetEvictionCallback(MemoryDomain::Gpu, MemoryCategory::Transient, [](uint64_t) { return g_Resources.TrimTransientTargets(); });
+    g_Memory.SetEvictionCallback(MemoryDomain::Gpu, MemoryCategory::Constant, [](uint64_t) { return g_Resources.TrimConstantBuffers(); });
+    g_Memory.SetWarningCallback([](const MemoryBudgetEvent& event)
+    {
+        char line[256];
+        snprintf(line, sizeof(line), "Memory: %s %s over budget, %.1f MB of %.1f MB (evicted %.1f MB)\n",
+            MemoryDomainName(event.domain), MemoryCategoryName(event.category), event.currentBytes / 1048576.0,
+            event.budgetBytes / 1048576.0, event.evictedBytes / 1048576.0);
+        OutputDebugStringA(line);
+    });
+}
+
+void PumpCapture(bool wait)
+{
+    auto onReady = [](UINT frameIndex, const D3D11_MAPPED_SUBRESOURCE& mapped)
+    {
+        Frame frame;
+        frame.index = frameIndex;
+        frame.width = g_CaptureReadback.Width();
+        frame.height = g_CaptureReadback.Height();
+
+        const UINT rowSize = frame.width * 4;
+        frame.pixels = g_FrameWriter.AcquireBuffer((size_t)rowSize * frame.height);
+        const BYTE* src = static_cast<const BYTE*>(mapped.pData);
+        for (UINT y = 0; y < frame.height; ++y)
+            memcpy(frame.pixels.data() + (size_t)y * rowSize, src + (size_t)y * mapped.RowPitch, rowSize);
+
+        g_FrameWriter.Submit(std::move(frame));
+    };
+
+    const UINT failures = g_CaptureReadback.Failures();
+    if (wait)
+        g_CaptureReadback.Drain(g_pImmediateContext.Get(), onReady);
+    else
+        g_CaptureReadback.Poll(g_pImmediateContext.Get(), false, onReady);
+
+    if (g_CaptureReadback.Failures() != failures)
+    {
+        char line[128];
+        snprintf(line, sizeof(line), "Capture: %u frame(s) lost, Map failed with 0x%08X\n",
+            g_CaptureReadback.Failures() - failures, (unsigned)g_CaptureReadback.LastError());
+        OutputDebugStringA(line);
+    }
+}
+
+std::string NarrowArgument(const wchar_t* argument)
+{
+    int size = WideCharToMultiByte(CP_ACP, 0, argument, -1, nullptr, 0, nullptr, nullptr);
+    if (size <= 1) return std::string();
+    std::string result(size - 1, '\0');
+    WideCharToMultiByte(CP_ACP, 0, argument, -1, &result[0], size, nullptr, nullptr);
+    return result;
+}
+
+// Lab3.exe -batch <сцена> <путь камеры> <префикс вывода> [-format png|raw|y4m] [-size WxH] [-threads N] [-aa режим]
+//   фазы запуска и время до первого кадра пишутся в <префикс вывода>_startup.csv
+// Lab3.exe -scene <сцена> — интерактивный режим с заданной сценой
+// Lab3.exe -texbench <изображение> — сжатие BC1/BC7 и скорость выборки на CPU
+// Lab3.exe -sortbench [число отрисовок] — сортировка очереди отрисовки (по умолчанию 1M)
+// Lab3.exe -mathbench [число элементов] — VectorMath против DirectXMath: биты и скорость (по умолчанию 64K)
+// Lab3.exe -lightbench — кластерное освещение: распределение и освещение от 16 до 16K источников
+// Lab3.exe -bvhbench [число треугольников] — BVH: построение, Refit и лучей в секунду (по умолчанию 2M)
+// Lab3.exe -aabench [-scene <сцена>] — цена каждого режима сглаживания на GPU и MSAA программного растеризатора
+// Lab3.exe -animbench [число персонажей] — позы и скиннинг толпы: персонажей в миллисекунду (по умолчанию 1000)
+// Lab3.exe -inputbench — ввод: поворот камеры при разной частоте кадров и автоповтора, цена выборки событий
+// Lab3.exe -viewbench [число объектов] — отсечение и очереди нескольких видов: один поток против вида на поток (по умолчанию 100K)
+// Lab3.exe -jobbench [потоков] — планировщик задач: масштабирование от 1 до N потоков, доля краж и ожиданий (по умолчанию 64)
+// Lab3.exe -graphbench — граф кадра: отбрасывание проходов, совмещение целей и время компиляции на типичном отложенном кадре
+// -aa none|msaa2|msaa4|msaa8|fxaa — сглаживание в интерактивном и пакетном режимах (F9 переключает)
+// -skinning gpu|cpu — где считается скиннинг персонажей сцены, по умолчанию gpu (F6 переключает)
+// -jobs N — потоков в планировщике задач вместе с основным (по умолчанию по числу ядер); -pinjobs — привязать их к ядрам
+// -views N — N окон (до 8) с одной сценой на общем устройстве, камеры расставлены вокруг сцены
+// -dynres <бюджет кадра, мс>|off — динамическое разрешение окна, по умолчанию 16.7 мс (F8 переключает)
+// -membudget cpu|gpu[.mesh|texture|constant|staging|transient|target]=<МБ> — бюджет памяти, можно несколько раз
+// -memdump <файл> — JSON-снимок памяти при выходе (F7 — снимок в memory.json в любой момент);
+//   пакетный режим всегда пишет <префикс вывода>_memory.json
+bool ParseBatchOptions(BatchOptions& options)
+{
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if (!argv) return false;
+
+    bool batch = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::wstring argument = argv[i];
+        if (argument == L"-batch" && i + 3 < argc)
+        {
+            options.scenePath = NarrowArgument(argv[i + 1]);
+            options.cameraPath = NarrowArgument(argv[i + 2]);
+            options.outputPrefix = NarrowArgument(argv[i + 3]);
+            batch = true;
+            i += 3;
+        }
+        else if (argument == L"-format" && i + 1 < argc)
+        {
+            std::wstring format = argv[++i];
+            if (format == L"raw") options.format = FrameFormat::Raw;
+            else if (format == L"y4m") options.format = FrameFormat::Y4m;
+            else options.format = FrameFormat::Png;
+        }
+        else if (argument == L"-size" && i + 1 < argc)
+        {
+            UINT width = 0, height = 0;
+            if (swscanf_s(argv[++i], L"%ux%u", &width, &height) == 2 && width > 0 && height > 0)
+            {
+                options.width = width;
+                options.height = height;
+            }
+        }
+        else if (argument == L"-texbench" && i + 1 < argc)
+        {
+            options.textureBenchmarkPath = NarrowArgument(argv[++i]);
+        }
+        else if (argument == L"-sortbench")
+        {
+            options.sortBenchmarkDraws = 1000000;
+            if (i + 1 < argc && argv[i + 1][0] != L'-')
+                options.sortBenchmarkDraws = (size_t)_wtoi64(argv[++i]);
+        }
+        else if (argument == L"-mathbench")
+        {
+            options.mathBenchmarkCount = 65536;
+            if (i + 1 < argc && argv[i + 1][0] != L'-')
+                options.mathBenchmarkCount = (size_t)_wtoi64(argv[++i]);
+        }
+        else if (argument == L"-lightbench")
+        {
+            options.lightBenchmark = true;
+        }
+        else if (argument == L"-bvhbench")
+        {
+            options.bvhBenchmarkTriangles = 2000000;
+            if (i + 1 < argc && argv[i + 1][0] != L'-')
+                options.bvhBenchmarkTriangles = (size_t)_wtoi64(argv[++i]);
+        }
+        else if (argument == L"-aabench")
+        {
+            options.antiAliasingBenchmark = true;
+        }
+        else if (argument == L"-animbench")
+        {
+            options.animationBenchmarkCharacters = 1000;
+            if (i + 1 < argc && argv[i + 1][0] != L'-')
+                options.animationBenchmarkCharacters = (size_t)_wtoi64(argv[++i]);
+        }
+        else if (argument == L"-graphbench")
+        {
+            options.renderGraphBenchmark = true;
+        }
+        else if (argument == L"-inputbench")
+        {
+            options.inputBenchmark = true;
+        }
+        else if (argument == L"-jobbench")
+        {
+            options.jobBenchmarkThreads = 64;
+            if (i + 1 < argc && argv[i + 1][0] != L'-')
+                options.jobBenchmarkThreads = (unsigned)std::max(1, _wtoi(argv[++i]));
+        }
+        else if (argument == L"-jobs" && i + 1 < argc)
+        {
+            options.jobThreads = (unsigned)std::max(1, _wtoi(argv[++i]));
+        }
+        else if (argument == L"-pinjobs")
+        {
+            options.pinJobThreads = true;
+        }
+        else if (argument == L"-viewbench")
+        {
+            options.viewBenchmarkObjects = 100000;
+            if (i + 1 < argc && argv[i + 1][0] != L'-')
+                options.viewBenchmarkObjects = (size_t)_wtoi64(argv[++i]);
+        }
+        else if (argument == L"-views" && i + 1 < argc)
+        {
+            options.viewCount = (UINT)std::min(8, std::max(1, _wtoi(argv[++i])));
+        }
+        else if (argument == L"-skinning" && i + 1 < argc)
+        {
+            options.skinning = std::wstring(argv[++i]) == L"cpu" ? SkinningMode::Cpu : SkinningMode::Gpu;
+        }
+        else if (argument == L"-dynres" && i + 1 < argc)
+        {
+            std::wstring budget = argv[++i];
+            options.frameBudgetMs = budget == L"off" ? 0.0 : _wtof(budget.c_str());
+        }
+        else if (argument == L"-aa" && i + 1 < argc)
+        {
+            ParseAntiAliasing(NarrowArgument(argv[++i]), options.antiAliasing);
+        }
+        else if (argument == L"-membudget" && i + 1 < argc)
+        {
+            BatchOptions::MemoryBudget budget;
+            if (ParseMemoryBudget(NarrowArgument(argv[++i]), budget.domain, budget.category, budget.bytes))
+                options.memoryBudgets.push_back(budget);
+        }
+        else if (argument == L"-memdump" && i + 1 < argc)
+        {
+            options.memoryDumpPath = NarrowArgument(argv[++i]);
+        }
+        else if (argument == L"-scene" && i + 1 < argc)
+        {
+            options.scenePath = NarrowArgument(argv[++i]);
+        }
+        else if (argument == L"-threads" && i + 1 < argc)
+        {
+            options.encodeThreads = (unsigned)_wtoi(argv[++i]);
+        }
+    }
+
+    LocalFree(argv);
+    return batch;
+}
+
+int RunBatch(const BatchOptions& options)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    // Сцена готовится параллельно с устройством, как в интерактивном режиме
+    StartupTask sceneTask;
+    sceneTask.Start(g_Startup, "scene", [&options](unsigned thread) { return PrepareScene(options.scenePath, thread); });
+
+    CameraPath cameraPath;
+    if (!LoadCameraPath(options.cameraPath, cameraPath))
+    {
+        sceneTask.Wait();
+        StopMeshStreaming();
+        OutputDebugStringA("Batch: failed to load camera path\n");
+        return -1;
+    }
+
+    const bool deviceCreated = SUCCEEDED(InitDevice(nullptr));
+    const bool sceneLoaded = sceneTask.Wait();
+    if (!deviceCreated || !sceneLoaded)
+    {
+        if (!sceneLoaded) OutputDebugStringA("Batch: failed to load scene\n");
+        CleanupDevice();
+        return -1;
+    }
+
+    // Кадры должны показывать сцену целиком — меши грузятся до первого кадра
+    StartupTimeline::Clock::time_point phase = StartupTimeline::Clock::now();
+    LoadSceneTextures();
+    phase = g_Startup.Mark("texture upload", 0, phase);
+    FlushMeshStreaming();
+    g_Startup.Mark("mesh flush", 0, phase);
+
+    RenderTarget target;
+    ReadbackRing readback;
+    HRESULT hr = CreateRenderTarget(g_pd3dDevice.Get(), options.width, options.height, DXGI_FORMAT_R8G8B8A8_UNORM, target);
+    if (SUCCEEDED(hr))
+        hr = readback.Init(g_pd3dDevice.Get(), options.width, options.height, DXGI_FORMAT_R8G8B8A8_UNORM, g_BatchReadbackSlots);
+    if (FAILED(hr))
+    {
+        CleanupDevice();
+        return -1;
+    }
+    g_Memory.Allocate(MemoryDomain::Gpu, MemoryCategory::Target, target.sizeBytes);
+    g_Memory.Allocate(MemoryDomain::Gpu, MemoryCategory::Staging, readback.SizeBytes());
+
+    // GPU рисует кадры по одному; параллелятся кодирование и запись на диск
+    unsigned encodeThreads = options.encodeThreads;
+    if (encodeThreads == 0)
+    {
+        unsigned cores = std::thread::hardware_concurrency();
+        encodeThreads = cores > 1 ? cores - 1 : 1;
+    }
+
+    FrameWriter writer;
+    writer.SetFrameRate((unsigned)(cameraPath.fps + 0.5f));
+    if (!writer.Start(options.outputPrefix, options.format, encodeThreads * 2, encodeThreads))
+    {
+        CleanupDevice();
+        return -1;
+    }
+
+    // Докат после прерывания: уже записанные кадры пропускаются, журнал дописывается
+    const bool resume = options.format != FrameFormat::Y4m;
+    writer.OpenTimingLog(options.outputPrefix + "_timing.csv", resume);
+
+    struct PendingFrame
+    {
+        double renderMs;
+        Clock::time_point submitted;
+    };
+    std::unordered_map<UINT, PendingFrame> pending;
+
+    // Первый кадр в пакетном режиме — первый прочитанный с GPU
+    auto onReady = [&](UINT frameIndex, const D3D11_MAPPED_SUBRESOURCE& mapped)
+    {
+        g_Startup.MarkFirstFrame();
+
+        Frame frame;
+        frame.index = frameIndex;
+        frame.width = readback.Width();
+        frame.height = readback.Height();
+
+        const UINT rowSize = frame.width * 4;
+        frame.pixels = writer.AcquireBuffer((size_t)rowSize * frame.height);
+        const BYTE* src = static_cast<const BYTE*>(mapped.pData);
+        for (UINT y = 0; y < frame.height; ++y)
+            memcpy(frame.pixels.data() + (size_t)y * rowSize, src + (size_t)y * mapped.RowPitch, rowSize);
+
+        auto it = pending.find(frameIndex);
+        if (it != pending.end())
+        {
+            frame.renderMs = it->second.renderMs;
+            frame.readbackMs = std::chrono::duration<double, std::milli>(Clock::now() - it->second.submitted).count();
+            pending.erase(it);
+        }
+
+        writer.Submit(std::move(frame));
+    };
+
+    const Vector up = VectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+    const UINT frameCount = cameraPath.FrameCount();
+    UINT skipped = 0;
+    Clock::time_point batchStart = Clock::now();
+
+    for (UINT frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+    {
+        if (resume && writer.FrameExists(frameIndex))
+        {
+            ++skipped;
+            continue;
+        }
+
+        if (!readback.CanEnqueue())
+            readback.Poll(g_pImmediateContext.Get(), true, onReady);
+
+        float t = frameIndex / cameraPath.fps;
+        Float3 eye, at;
+        SampleCameraPath(cameraPath, t, eye, at);
+        Matrix view = MatrixLookAtLH(LoadFloat3(&eye), LoadFloat3(&at), up);
+
+        Clock::time_point renderStart = Clock::now();
+        g_Resources.BeginFrame(g_pImmediateContext.Get());
+        RenderFrame(target.pTexture.Get(), target.pRenderTargetView.Get(), target.pDepthStencilView.Get(), target.width, target.height, target.width / (float)target.height, view, t);
+        readback.Enqueue(g_pImmediateContext.Get(), target.pTexture.Get(), frameIndex);
+        g_Resources.EndFrame(g_pImmediateContext.Get());
+        TrackFrameMemory(writer);
+        g_Memory.EndFrame();
+
+        Clock::time_point submitted = Clock::now();
+        PendingFrame frame = { std::chrono::duration<double, std::milli>(submitted - renderStart).count(), submitted };
+        pending[frameIndex] = frame;
+
+        readback.Poll(g_pImmediateContext.Get(), false, onReady);
+    }
+
+    readback.Drain(g_pImmediateContext.Get(), onReady);
+    writer.Stop();
+
+    double seconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+    UINT rendered = frameCount - skipped;
+    char summary[256];
+    snprintf(summary, sizeof(summary), "Batch: %u frames rendered, %u skipped, %.2f s, %.1f fps\n",
+        rendered, skipped, seconds, seconds > 0.0 ? rendered / seconds : 0.0);
+    OutputDebugStringA(summary);
+    if (readback.Failures() > 0)
+    {
+        snprintf(summary, sizeof(summary), "Batch: %u frames lost to readback errors, last 0x%08X\n", readback.Failures(), (unsigned)readback.LastError());
+        OutputDebugStringA(summary);
+    }
+    OutputDebugStringA(g_Startup.Report().c_str());
+    g_Startup.WriteCsv(options.outputPrefix + "_startup.csv");
+    ReportMemory();
+    g_Memory.WriteSnapshot(options.outputPrefix + "_memory.json");
+
+    g_Memory.Free(MemoryDomain::Gpu, MemoryCategory::Target, target.sizeBytes);
+    g_Memory.Free(MemoryDomain::Gpu, MemoryCategory::Staging, readback.SizeBytes());
+
+    readback.Reset();
+    target = RenderTarget();
+    CleanupDevice();
+    return writer.FramesWritten() == rendered ? 0 : -1;
+}
+
+int64_t QpcToMicroseconds(LONGLONG counter)
+{
+    static LARGE_INTEGER frequency = {};
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    return counter / frequency.QuadPart * 1000000 + counter % frequency.QuadPart * 1000000 / frequency.QuadPart;
+}
+
+// Время ввода и показа кадров — на одной шкале с SyncQPCTime статистики DXGI
+int64_t NowMicroseconds()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return QpcToMicroseconds(counter.QuadPart);
+}
+
+// Время, когда сообщение встало в очередь (GetMessageTime), на шкале NowMicroseconds:
+// в замер задержки ввода попадает и ожидание в очереди. Тики идут шагами системного
+// таймера (обычно 15,6 мс) — с такой точностью и известен возраст сообщения
+int64_t MessageTimeMicroseconds()
+{
+    const int64_t now = NowMicroseconds();
+    // Разность по модулю 2^32: счётчик тиков переполняется раз в 49,7 суток
+    const LONG ageMs = (LONG)(GetTickCount() - (DWORD)GetMessageTime());
+    return ageMs > 0 ? now - (int64_t)ageMs * 1000 : now;
+}
+
+void ReadRawInput(HRAWINPUT hInput)
+{
+    RAWINPUT input;
+    UINT size = sizeof(input);
+    if (GetRawInputData(hInput, RID_INPUT, &input, &size, sizeof(RAWINPUTHEADER)) == (UINT)-1) return;
+
+    InputEvent event;
+    event.time = MessageTimeMicroseconds();
+    if (input.header.dwType == RIM_TYPEKEYBOARD)
+    {
+        // 255 — служебные коды без клавиши (части последовательностей E0/E1)
+        const RAWKEYBOARD& keyboard = input.data.keyboard;
+        if (keyboard.VKey >= 255) return;
+        event.type = (keyboard.Flags & RI_KEY_BREAK) ? InputEventType::KeyUp : InputEventType::KeyDown;
+        event.key = (uint8_t)keyboard.VKey;
+        g_Input.Push(event);
+    }
+    else if (input.header.dwType == RIM_TYPEMOUSE)
+    {
+        const RAWMOUSE& mouse = input.data.mouse;
+        event.key = InputKey::RightButton;
+        if (mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_DOWN)
+        {
+            event.type = InputEventType::KeyDown;
+            g_Input.Push(event);
+        }
+        if (mouse.usButtonFlags & RI_MOUSE_RIGHT_BUTTON_UP)
+        {
+            event.type = InputEventType::KeyUp;
+            g_Input.Push(event);
+        }
+        if (!(mouse.usFlags & MOUSE_MOVE_ABSOLUTE) && (mouse.lLastX != 0 || mouse.lLastY != 0))
+        {
+            event.type = InputEventType::MouseMove;
+            event.dx = mouse.lLastX;
+            event.dy = mouse.lLastY;
+            g_Input.Push(event);
+        }
+    }
+}
+
+// Дочитывает сырой ввод, пришедший, пока готовился кадр, и закрывает интервал ввода кадра
+const InputFrame& SampleInput()
+{
+    MSG msg;
+    while (PeekMessage(&msg, nullptr, WM_INPUT, WM_INPUT, PM_REMOVE))
+        DispatchMessage(&msg);
+    return g_Input.Sample(NowMicroseconds());
+}
+
+// После Present главного окна: кадр с вводом отмечается, а показанные кадры
+// закрываются по статистике DXGI (время обратного хода луча, когда кадр вышел
+// на экран) или, без неё, по запросам-событиям, которые GPU проходит в конце кадра
+void TrackInputLatency(Surface& surface, int64_t inputTime)
+{
+    if (g_LatencySource == LatencySource::Scanout)
+    {
+        UINT presentCount = 0;
+        DXGI_FRAME_STATISTICS statistics = {};
+        HRESULT hr = surface.SwapChain()->GetLastPresentCount(&presentCount);
+        if (SUCCEEDED(hr)) hr = surface.SwapChain()->GetFrameStatistics(&statistics);
+        if (SUCCEEDED(hr))
+        {
+            if (inputTime != 0)
+                g_InputLatency.Submit(presentCount, inputTime);
+            g_InputLatency.Complete(statistics.PresentCount, QpcToMicroseconds(statistics.SyncQPCTime.QuadPart));
+            return;
+        }
+        // Разрыв статистики (смена режима, перекрытие окна) — временно; прочее — статистики нет совсем
+        if (hr == DXGI_ERROR_FRAME_STATISTICS_DISJOINT) return;
+        g_LatencySource = LatencySource::GpuDone;
+        g_InputLatency = LatencyTracker();
+        OutputDebugStringA("Input: no DXGI frame statistics, latency is measured to GPU completion\n");
+    }
+
+    ++g_LatencyFrame;
+    for (LatencyProbe& probe : g_LatencyProbes)
+    {
+        if (probe.pending && g_pImmediateContext->GetData(probe.pQuery.Get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
+        {
+            g_InputLatency.Complete(probe.frameId, NowMicroseconds());
+            probe.pending = false;
+        }
+    }
+    if (inputTime == 0) return;
+
+    // Все запросы заняты — кадр без замера: GPU отстаёт больше чем на их число кадров
+    for (LatencyProbe& probe : g_LatencyProbes)
+    {
+        if (probe.pending) continue;
+        if (!probe.pQuery)
+        {
+            D3D11_QUERY_DESC desc = {};
+            desc.Query = D3D11_QUERY_EVENT;
+            if (FAILED(g_pd3dDevice->CreateQuery(&desc, probe.pQuery.GetAddressOf()))) return;
+        }
+        g_pImmediateContext->End(probe.pQuery.Get());
+        g_InputLatency.Submit(g_LatencyFrame, inputTime);
+        probe.frameId = g_LatencyFrame;
+        probe.pending = true;
+        return;
+    }
+}
+
+// Окно вывода по HWND; nullptr — ещё не создано (сообщения из CreateWindow) или уже закрыто
+OutputWindow* WindowFromHandle(HWND hWnd)
+{
+    for (const std::unique_ptr<OutputWindow>& window : g_Windows)
+    {
+        if (window->hWnd == hWnd) return window.get();
+    }
+    return nullptr;
+}
+
+LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    OutputWindow* pWindow = WindowFromHandle(hWnd);
+    switch (message)
+    {
+    case WM_SIZE:
+        // Буферы пересоздаются не здесь, а в Surface::Update перед следующим кадром.
+        // Размер окна, пришедший до создания цепочки обмена, Surface::Create возьмёт сам
+        if (pWindow)
+            pWindow->surface.OnSize(LOWORD(lParam), HIWORD(lParam), wParam == SIZE_MINIMIZED);
+        break;
+
+    case WM_ENTERSIZEMOVE:
+        // Пока тянут рамку, основной цикл стоит в модальном цикле окна — кадры рисуем по таймеру
+        if (pWindow)
+            pWindow->surface.OnEnterSizeMove();
+        SetTimer(hWnd, g_SizeMoveTimerId, USER_TIMER_MINIMUM, nullptr);
+        break;
+
+    case WM_EXITSIZEMOVE:
+        KillTimer(hWnd, g_SizeMoveTimerId);
+        if (pWindow)
+            pWindow->surface.OnExitSizeMove();
+        break;
+
+    case WM_TIMER:
+        if (wParam == g_SizeMoveTimerId) Render();
+        break;
+
+    case WM_LBUTTONDOWN:
+        // Сам выбор — в Render, где известны камера и время кадра
+        g_PickX = GET_X_LPARAM(lParam);
+        g_PickY = GET_Y_LPARAM(lParam);
+        g_pPickWindow = pWindow;
+        g_PickRequested = pWindow != nullptr;
+        break;
+
+    case WM_INPUT:
+        // Система освобождает данные сырого ввода в DefWindowProc
+        ReadRawInput((HRAWINPUT)lParam);
+        return DefWindowProc(hWnd, message, wParam, lParam);
+
+    case WM_KILLFOCUS:
+    {
+        // Отпускания клавиш уйдут другому окну — камера не должна крутиться дальше.
+        // Сообщение не из очереди: у GetMessageTime здесь время чужого сообщения
+        InputEvent event;
+        event.time = NowMicroseconds();
+        event.type = InputEventType::ReleaseAll;
+        g_Input.Push(event);
+        break;
+    }
+
+    case WM_KEYUP:
+        if (!g_RawInput && wParam < InputFrame::KeyCount)
+        {
+            InputEvent event;
+            event.time = MessageTimeMicroseconds();
+            event.type = InputEventType::KeyUp;
+            event.key = (uint8_t)wParam;
+            g_Input.Push(event);
+        }
+        break;
+
+    case WM_KEYDOWN:
+        if (!g_RawInput && wParam < InputFrame::KeyCount)
+        {
+            InputEvent event;
+            event.time = MessageTimeMicroseconds();
+            event.type = InputEventType::KeyDown;
+            event.key = (uint8_t)wParam;
+            g_Input.Push(event);
+        }
+        switch (wParam)
+        {
+        case VK_F6:
+            g_SkinningMode = g_SkinningMode == SkinningMode::Gpu ? SkinningMode::Cpu : SkinningMode::Gpu;
+            OutputDebugStringA(g_SkinningMode == SkinningMode::Gpu ? "Animation: GPU skinning\n" : "Animation: CPU skinning\n");
+            break;
+        case VK_F7:
+            if (g_Memory.WriteSnapshot("memory.json"))
+                OutputDebugStringA("Memory: snapshot written to memory.json\n");
+            break;
+        case VK_F8:
+            g_DynamicResolution = !g_DynamicResolution;
+            g_Resolution.Reset();
+            break;
+        case VK_F9:
+            SetAntiAliasing((AntiAliasingMode)(((int)g_AntiAliasing + 1) % (int)AntiAliasingMode::Count));
+            break;
+        case VK_F12:
+            if (g_CaptureEnabled) StopCapture();
+            else StartCapture();
+            break;
+        }
+        break;
+
+    case WM_DESTROY:
+        // Закрыто побочное окно — оно просто перестаёт рисоваться; главное — выход
+        if (pWindow && pWindow != g_Windows[0].get())
+        {
+            if (g_pPickWindow == pWindow) g_PickRequested = false;
+            pWindow->surface.Release();
+            pWindow->hWnd = nullptr;
+            break;
+        }
+        PostQuitMessage(0);
+        break;
+
+    default:
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+    return 0;
+}
+
+int RunTextureBenchmark(const std::string& imagePath)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    Image image;
+    if (FAILED(LoadImageFile(imagePath, image)))
+    {
+        OutputDebugStringA("Texture benchmark: failed to load image\n");
+        return -1;
+    }
+
+    char line[256];
+    std::vector<Image> mips = GenerateMips(image);
+    uint64_t rgba8Bytes = 0;
+    for (const Image& mip : mips)
+        rgba8Bytes += mip.rgba.size();
+    snprintf(line, sizeof(line), "Texture benchmark: %ux%u, %zu mips, RGBA8 %.2f MB\n", image.width, image.height, mips.size(), rgba8Bytes / 1048576.0);
+    OutputDebugStringA(line);
+
+    // Размер и время сжатия всей цепочки
+    const unsigned threads = Jobs().ThreadCount();
+    const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC7 };
+    for (BlockFormat format : formats)
+    {
+        Clock::time_point start = Clock::now();
+        uint64_t bytes = 0;
+        std::vector<uint8_t> blocks;
+        for (const Image& mip : mips)
+        {
+            CompressImage(mip, format, blocks, threads);
+            bytes += blocks.size();
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        snprintf(line, sizeof(line), "  %s: %.2f MB (%.1fx smaller), compressed in %.1f ms\n",
+            format == BlockFormat::BC1 ? "BC1" : "BC7", bytes / 1048576.0, (double)rgba8Bytes / bytes, ms);
+        OutputDebugStringA(line);
+    }
+
+    TiledTexture tiled;
+    tiled.Build(mips);
+    SamplerBenchmark result = BenchmarkSampler(tiled, 1u << 24);
+    snprintf(line, sizeof(line), "  CPU sampler: bilinear %.1f Mtexels/s, trilinear %.1f Mtexels/s\n",
+        result.BilinearTexelsPerSecond() / 1e6, result.TrilinearTexelsPerSecond() / 1e6);
+    OutputDebugStringA(line);
+    return 0;
+}
+
+int RunSortBenchmark(size_t drawCount)
+{
+    // 8 шейдеров, 256 материалов, 1024 меша — порядок величин для большой сцены
+    SortBenchmark result = BenchmarkRenderQueue(drawCount, 8, 256, 1024);
+
+    char line[256];
+    snprintf(line, sizeof(line), "Sort benchmark: %zu draws, radix %.2f ms, std::sort %.2f ms\n",
+        result.draws, result.radixSortMs, result.stdSortMs);
+    OutputDebugStringA(line);
+    snprintf(line, sizeof(line), "  state changes: unsorted %zu, sorted %zu (%.1fx fewer)\n",
+        result.unsortedStateChanges, result.sortedStateChanges,
+        result.sortedStateChanges > 0 ? (double)result.unsortedStateChanges / result.sortedStateChanges : 0.0);
+    OutputDebugStringA(line);
+    return 0;
+}
+
+int RunMathBenchmark(size_t count)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    MathBenchmark result = BenchmarkVectorMath(count);
+    char line[256];
+    snprintf(line, sizeof(line), "Math benchmark (%s): %zu elements\n", BackendName(), result.count);
+    OutputDebugStringA(line);
+    snprintf(line, sizeof(line), "  TransformCoord: %.2f ns single, %.2f ns stream\n", result.transformCoordNs, result.transformCoordStreamNs);
+    OutputDebugStringA(line);
+    snprintf(line, sizeof(line), "  MatrixMultiply: %.2f ns single, %.2f ns stream\n", result.matrixMultiplyNs, result.matrixMultiplyStreamNs);
+    OutputDebugStringA(line);
+    snprintf(line, sizeof(line), "  stream vs single bit mismatches: %zu of %zu\n", result.mismatches, result.count * 4);
+    OutputDebugStringA(line);
+
+    // Сверка с DirectXMath на тех же входах: мировая, видовая и проекционная
+    // матрицы и преобразование точки должны совпасть до бита
+    std::mt19937 random(54321);
+    std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+    size_t mismatches = 0;
+    auto compare = [&mismatches](const Matrix& ours, DirectX::FXMMATRIX theirs)
+    {
+        Float4x4 a;
+        DirectX::XMFLOAT4X4 b;
+        StoreFloat4x4(&a, ours);
+        DirectX::XMStoreFloat4x4(&b, theirs);
+        if (memcmp(&a, &b, sizeof(a)) != 0) ++mismatches;
+    };
+
+    std::vector<Float3> points(count);
+    Matrix viewProjection = MatrixIdentity();
+    DirectX::XMMATRIX xmViewProjection = DirectX::XMMatrixIdentity();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float scale = 0.1f + std::abs(distribution(random));
+        const float angle = distribution(random) * 10.0f;
+        const Float3 position(distribution(random), distribution(random), distribution(random));
+        const Float3 eye(distribution(random), distribution(random), distribution(random));
+        const Float3 at(distribution(random), distribution(random), distribution(random));
+        const float aspectRatio = 0.5f + std::abs(distribution(random));
+        points[i] = Float3(distribution(random), distribution(random), distribution(random));
+
+        Matrix world = MatrixScaling(scale, scale, scale) * MatrixRotationY(angle) * MatrixTranslation(position.x, position.y, position.z);
+        DirectX::XMMATRIX xmWorld = DirectX::XMMatrixScaling(scale, scale, scale) * DirectX::XMMatrixRotationY(angle) *
+                                    DirectX::XMMatrixTranslation(position.x, position.y, position.z);
+        compare(world, xmWorld);
+
+        Matrix view = MatrixLookAtLH(LoadFloat3(&eye), LoadFloat3(&at), VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        DirectX::XMMATRIX xmView = DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(eye.x, eye.y, eye.z, 0.0f),
+            DirectX::XMVectorSet(at.x, at.y, at.z, 0.0f), DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        compare(view, xmView);
+
+        Matrix projection = MatrixPerspectiveFovLH(PiDiv2, aspectRatio, 0.01f, 100.0f);
+        DirectX::XMMATRIX xmProjection = DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, aspectRatio, 0.01f, 100.0f);
+        compare(projection, xmProjection);
+        compare(MatrixTranspose(world * view * projection), DirectX::XMMatrixTranspose(xmWorld * xmView * xmProjection));
+
+        Float3 ours, theirs;
+        StoreFloat3(&ours, Vector3TransformCoord(LoadFloat3(&points[i]), world * view));
+        DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&theirs),
+            DirectX::XMVector3TransformCoord(DirectX::XMVectorSet(points[i].x, points[i].y, points[i].z, 0.0f), xmWorld * xmView));
+        if (memcmp(&ours, &theirs, sizeof(ours)) != 0) ++mismatches;
+
+        if (i == 0)
+        {
+            viewProjection = view * projection;
+            xmViewProjection = xmView * xmProjection;
+        }
+    }
+    snprintf(line, sizeof(line), "  DirectXMath bit mismatches: %zu of %zu checks\n", mismatches, count * 5);
+    OutputDebugStringA(line);
+
+    // Те же циклы по одному элементу на DirectXMath — для сравнения скорости
+    std::vector<Float3> transformed(count);
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        DirectX::XMVECTOR point = DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(&points[i]));
+        DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&transformed[i]), DirectX::XMVector3TransformCoord(point, xmViewProjection));
+    }
+    const double xmTransformNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+
+    std::vector<DirectX::XMFLOAT4X4> products(count);
+    for (size_t i = 0; i < count; ++i)
+        DirectX::XMStoreFloat4x4(&products[i], DirectX::XMMatrixRotationY(i * 0.001f));
+    start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+        DirectX::XMStoreFloat4x4(&products[i], DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&products[i]), xmViewProjection));
+    const double xmMultiplyNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+
+    snprintf(line, sizeof(line), "  DirectXMath: TransformCoord %.2f ns, MatrixMultiply %.2f ns\n", xmTransformNs, xmMultiplyNs);
+    OutputDebugStringA(line);
+    return mismatches == 0 && result.mismatches == 0 ? 0 : 1;
+}
+
+int RunLightBenchmark()
+{
+    const unsigned threads = Jobs().ThreadCount();
+    std::vector<LightCullingBenchmark> results = BenchmarkLightCulling({ 16, 64, 256, 1024, 4096, 16384 }, 1 << 15, threads);
+
+    char line[256];
+    snprintf(line, sizeof(line), "Light culling benchmark: 16x9x24 clusters, %u threads, 32768 shaded points\n", threads);
+    OutputDebugStringA(line);
+    double maxError = 0.0;
+    for (const LightCullingBenchmark& result : results)
+    {
+        snprintf(line, sizeof(line), "  %5zu lights: assign %.3f ms, %.1f lights per cluster (max %u), shade %.2f ms clustered vs %.2f ms all lights\n",
+            result.lights, result.assignMs, result.averageClusterLights, result.maxClusterLights, result.clusteredShadeMs, result.naiveShadeMs);
+        OutputDebugStringA(line);
+        maxError = std::max(maxError, result.maxShadeError);
+    }
+    snprintf(line, sizeof(line), "  max difference from all-lights shading: %g\n", maxError);
+    OutputDebugStringA(line);
+    return maxError < 1e-4 ? 0 : 1;
+}
+
+int RunBvhBenchmark(size_t triangleCount)
+{
+    const unsigned threads = Jobs().ThreadCount();
+    const BvhBenchmark result = BenchmarkBvh(triangleCount, 1 << 20, threads);
+
+    char line[256];
+    snprintf(line, sizeof(line), "BVH benchmark: %zu triangles, %zu nodes, depth %u, SAH cost %.1f\n", result.triangles, result.nodes, result.depth, result.sahCost);
+    OutputDebugStringA(line);
+    snprintf(line, sizeof(line), "  build %.1f ms on %u threads, %.1f ms on one; refit %.2f ms\n", result.buildMs, result.threads, result.singleThreadBuildMs, result.refitMs);
+    OutputDebugStringA(line);
+    snprintf(line, sizeof(line), "  %zu camera rays (%.0f%% hit): %.2f Mrays/s single, %.2f Mrays/s in packets of %zu; random rays %.2f Mrays/s\n",
+        result.rays, result.hitRate * 100.0, result.coherentRaysPerSecond / 1e6, result.packetRaysPerSecond / 1e6, RayPacketSize, result.incoherentRaysPerSecond / 1e6);
+    OutputDebugStringA(line);
+    snprintf(line, sizeof(line), "  mismatches against single rays and brute force: %zu\n", result.mismatches);
+    OutputDebugStringA(line);
+    return result.mismatches == 0 ? 0 : 1;
+}
+
+int RunAntiAliasingBenchmark(const std::string& scenePath)
+{
+    if (!PrepareScene(scenePath, 0))
+    {
+        OutputDebugStringA("Anti-aliasing benchmark: failed to load scene\n");
+        return -1;
+    }
+
+    if (FAILED(InitDevice(nullptr)))
+    {
+        CleanupDevice();
+        return -1;
+    }
+
+    LoadSceneTextures();
+    FlushMeshStreaming();
+
+    RenderTarget output;
+    if (FAILED(CreateRenderTarget(g_pd3dDevice.Get(), g_CaptureWidth, g_CaptureHeight, DXGI_FORMAT_R8G8B8A8_UNORM, output)))
+    {
+        CleanupDevice();
+        return -1;
+    }
+
+    const Matrix view = MatrixLookAtLH(VectorSet(0.0f, 1.0f, -5.0f, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const UINT warmupFrames = 10;
+    const UINT measuredFrames = 200;
+
+    char line[256];
+    snprintf(line, sizeof(line), "Anti-aliasing benchmark: %ux%u, %u frames per mode\n", output.width, output.height, measuredFrames);
+    OutputDebugStringA(line);
+
+    double baselineMs = 0.0;
+    for (int mode = 0; mode < (int)AntiAliasingMode::Count; ++mode)
+    {
+        g_AntiAliasing = (AntiAliasingMode)mode;
+
+        // Прогрев: временные цели режима создаются в первых кадрах
+        for (UINT frame = 0; frame < warmupFrames + measuredFrames; ++frame)
+        {
+            if (frame == warmupFrames)
+            {
+                g_GpuTimer.Poll(g_pImmediateContext.Get(), true);
+                g_GpuTimer.ResetAverage();
+            }
+
+            g_Resources.BeginFrame(g_pImmediateContext.Get());
+            g_GpuTimer.Begin(g_pImmediateContext.Get());
+            RenderFrame(output.pTexture.Get(), output.pRenderTargetView.Get(), output.pDepthStencilView.Get(), output.width, output.height,
+                output.width / (float)output.height, view, frame / 60.0f);
+            g_GpuTimer.End(g_pImmediateContext.Get());
+            g_Resources.EndFrame(g_pImmediateContext.Get());
+            g_GpuTimer.Poll(g_pImmediateContext.Get(), false);
+        }
+        g_GpuTimer.Poll(g_pImmediateContext.Get(), true);
+
+        const double gpuMs = g_GpuTimer.AverageMs();
+        if (mode == (int)AntiAliasingMode::None) baselineMs = gpuMs;
+        snprintf(line, sizeof(line), "  %-8s (%u samples): GPU %.3f ms per frame, +%.3f ms over none (%zu frames timed)\n",
+            AntiAliasingName((AntiAliasingMode)mode), g_SupportedSamples[mode], gpuMs, gpuMs - baselineMs, g_GpuTimer.Samples());
+        OutputDebugStringA(line);
+    }
+
+    // Тот же выбор в программном растеризаторе: покрытие по выборкам, цвет — раз на пиксель
+    const uint32_t rasterWidth = 1280, rasterHeight = 720;
+    const size_t triangles = 20000;
+    std::vector<RasterBenchmark> raster = BenchmarkCoverageRaster(rasterWidth, rasterHeight, triangles);
+    snprintf(line, sizeof(line), "Software MSAA: %ux%u, %zu triangles\n", rasterWidth, rasterHeight, triangles);
+    OutputDebugStringA(line);
+    for (const RasterBenchmark& result : raster)
+    {
+        snprintf(line, sizeof(line), "  %ux: draw %.2f ms, resolve %.2f ms, %zu shaded pixels, %zu samples written, %zu edge pixels\n",
+            result.sampleCount, result.drawMs, result.resolveMs, result.stats.shadedPixels, result.stats.coveredSamples, result.stats.partialPixels);
+        OutputDebugStringA(line);
+    }
+
+    output = RenderTarget();
+    CleanupDevice();
+    return 0;
+}
+
+int RunAnimationBenchmark(size_t characterCount)
+{
+    const unsigned threads = Jobs().ThreadCount();
+    const AnimationBenchmark single = BenchmarkAnimation(characterCount, 1);
+    const AnimationBenchmark result = threads > 1 ? BenchmarkAnimation(characterCount, threads) : single;
+
+    char line[256];
+    snprintf(line, sizeof(line), "Animation benchmark: %zu characters, %zu joints and %zu vertices each, %u threads\n",
+        result.characters, result.joints, result.vertices, result.threads);
+    OutputDebugStringA(line);
+    snprintf(line, sizeof(line), "  poses: %.3f ms on %u threads, %.3f ms on one; %.1f characters per ms (GPU skinning)\n",
+        result.poseMs, result.threads, single.poseMs, result.posesPerMs);
+    OutputDebugStringA(line);
+    snprintf(line, sizeof(line), "  CPU skinning (%s): %.3f ms on %u threads; on one %.3f ms batched vs %.3f ms scalar\n",
+        BackendName(), result.skinMs, result.threads, result.simdSkinMs, result.scalarSkinMs);
+    OutputDebugStringA(line);
+    snprintf(line, sizeof(line), "  poses and CPU skinning: %.1f characters per ms; max difference from scalar %g\n",
+        result.charactersPerMs, std::max(result.maxError, single.maxError));
+    OutputDebugStringA(line);
+
+    // Вершины CPU-скиннинга идут и в программный растеризатор: толпа квадратом, камера сверху-сзади
+    const size_t rasterCharacters = std::min<size_t>(characterCount, 1024);
+    const size_t side = (size_t)std::ceil(std::sqrt((double)rasterCharacters));
+    Skeleton skeleton;
+    AnimationClip clip;
+    SkinnedMesh mesh;
+    CreateProceduralCharacter(16, 16, skeleton, clip, mesh);
+    CrowdAnimator crowd;
+    crowd.Init(skeleton, clip, mesh);
+
+    std::vector<CharacterInstance> characters(rasterCharacters);
+    for (size_t i = 0; i < rasterCharacters; ++i)
+    {
+        characters[i].position = Float3(1.5f * ((float)(i % side) - 0.5f * side), 0.0f, 1.5f * (float)(i / side));
+        characters[i].phase = 0.113f * i;
+    }
+    crowd.EvaluatePoses(characters, 0.5f, threads);
+    crowd.SkinOnCpu(threads);
+
+    const uint32_t rasterWidth = 1280, rasterHeight = 720;
+    const Matrix view = MatrixLookAtLH(VectorSet(0.0f, 4.0f, -6.0f, 0.0f), VectorSet(0.0f, 0.0f, 0.75f * side, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const Matrix projection = MatrixPerspectiveFovLH(PiDiv2, rasterWidth / (float)rasterHeight, 0.01f, 100.0f);
+
+    // В пространство вида (отсечь то, что за камерой), затем в пиксели
+    const std::vector<float>& skinned = crowd.SkinnedVertices();
+    const size_t vertexCount = skinned.size() / SkinnedMesh::VertexFloats;
+    std::vector<Float3> viewPositions(vertexCount), clipPositions(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+        viewPositions[v] = Float3(skinned[v * SkinnedMesh::VertexFloats], skinned[v * SkinnedMesh::VertexFloats + 1], skinned[v * SkinnedMesh::VertexFloats + 2]);
+    Vector3TransformCoordStream(viewPositions.data(), viewPositions.data(), vertexCount, view);
+    Vector3TransformCoordStream(clipPositions.data(), viewPositions.data(), vertexCount, projection);
+
+    CoverageRasterizer rasterizer;
+    rasterizer.Resize(rasterWidth, rasterHeight, 4);
+    rasterizer.Clear(Float4(0.0f, 0.2f, 0.4f, 1.0f));
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::vector<uint32_t>& indices = mesh.indices;
+    for (size_t character = 0; character < rasterCharacters; ++character)
+    {
+        const size_t base = character * mesh.VertexCount();
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            RasterVertex corners[3];
+            bool visible = true;
+            for (int k = 0; k < 3 && visible; ++k)
+            {
+                const size_t v = base + indices[i + k];
+                visible = viewPositions[v].z > 0.01f;
+                corners[k].x = (clipPositions[v].x * 0.5f + 0.5f) * rasterWidth;
+                corners[k].y = (0.5f - clipPositions[v].y * 0.5f) * rasterHeight;
+                corners[k].z = clipPositions[v].z;
+                const float* color = &skinned[v * SkinnedMesh::VertexFloats + 3];
+                corners[k].color = Float4(color[0], color[1], color[2], color[3]);
+            }
+            if (visible) rasterizer.DrawTriangle(corners[0], corners[1], corners[2]);
+        }
+    }
+    const double drawMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const RasterStats& raster = rasterizer.Stats();
+    snprintf(line, sizeof(line), "  software raster of %zu CPU-skinned characters: %ux%u 4x, %zu triangles in %.2f ms, %zu shaded pixels\n",
+        rasterCharacters, rasterWidth, rasterHeight, raster.triangles, drawMs, raster.shadedPixels);
+    OutputDebugStringA(line);
+    return result.maxError < 1e-3 && single.maxError < 1e-3 ? 0 : 1;
+}
+
+int RunRenderGraphBenchmark()
+{
+    const uint32_t sizes[][2] = { { 1280, 720 }, { 1920, 1080 }, { 3840, 2160 } };
+    size_t violations = 0;
+    char line[512];
+    for (const auto& size : sizes)
+    {
+        const RenderGraphBenchmark result = BenchmarkRenderGraph(size[0], size[1], 1000);
+        violations += result.violations;
+        snprintf(line, sizeof(line), "Render graph %ux%u: %zu passes (%zu culled), %zu transient targets in %zu physical, %.1f MB -> %.1f MB, %zu clears, %zu discards, build and compile %.1f us, %zu violations\n",
+            size[0], size[1], result.passes, result.culledPasses, result.transientResources, result.physicalResources,
+            result.transientBytes / (1024.0 * 1024.0), result.physicalBytes / (1024.0 * 1024.0),
+            result.clears, result.discards, result.compileUs, result.violations);
+        OutputDebugStringA(line);
+
+        if (&size == &sizes[0])
+        {
+            std::string order = "  order:";
+            for (const std::string& name : result.order)
+                order += " " + name + ",";
+            order.back() = '\n';
+            OutputDebugStringA(order.c_str());
+            std::string culled = "  culled:";
+            for (const std::string& name : result.culled)
+                culled += " " + name + ",";
+            culled.back() = '\n';
+            OutputDebugStringA(culled.c_str());
+        }
+    }
+    return violations == 0 ? 0 : 1;
+}
+
+int RunViewCullingBenchmark(size_t objectCount)
+{
+    const unsigned threads = Jobs().ThreadCount();
+    size_t mismatches = 0;
+    char line[256];
+    for (size_t viewCount : { 1, 2, 4, 8 })
+    {
+        const ViewCullingBenchmark result = BenchmarkViewCulling(objectCount, viewCount, threads);
+        mismatches += result.mismatches;
+        snprintf(line, sizeof(line), "View culling: %zu objects, %zu views (%.1f%% visible each): one view %.3f ms, all views %.3f ms on one thread, %.3f ms on %u threads, %zu mismatches\n",
+            result.objects, result.views, 100.0 * result.visibleFraction, result.singleViewMs, result.serialMs, result.parallelMs, result.threads, result.mismatches);
+        OutputDebugStringA(line);
+    }
+    return mismatches == 0 ? 0 : 1;
+}
+
+int RunInputBenchmark()
+{
+    const InputBenchmark result = BenchmarkInput();
+    char line[256];
+    snprintf(line, sizeof(line), "Input: %zu frame rate / auto-repeat combinations, camera angle error %.6f rad (fixed step per message: spread %.3f rad), sample of 1000 events %.2f us\n",
+        result.combinations, result.maxAngleError, result.legacyAngleSpread, result.sampleUs);
+    OutputDebugStringA(line);
+    return result.maxAngleError < 1e-3 ? 0 : 1;
+}
+
+int RunJobBenchmark(unsigned maxThreads)
+{
+    const JobBenchmark result = BenchmarkJobs(maxThreads);
+    char line[256];
+    snprintf(line, sizeof(line), "Job system benchmark: parallel for over %zu uneven elements, %zu jobs in dependent layers, %u cores\n",
+        result.elements, result.graphJobs, std::thread::hardware_concurrency());
+    OutputDebugStringA(line);
+    for (const JobScalingPoint& point : result.points)
+    {
+        snprintf(line, sizeof(line), "  %2u threads: for %.2f ms (%.2fx), layers %.2f ms, %.1f%% stolen, %.2f%% contended, %llu splits\n",
+            point.threads, point.forMs, point.speedup, point.graphMs, point.stealRate * 100.0, point.contentionRate * 100.0,
+            (unsigned long long)point.splits);
+        OutputDebugStringA(line);
+    }
+    snprintf(line, sizeof(line), "  mismatches: %zu\n", result.mismatches);
+    OutputDebugStringA(line);
+    return result.mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,38 @@
+﻿#include "Animation.h"
+#include "JobSystem.h"
+
+#include "Check.h"
+
+#include <algorithm>
+
+namespace
+{
+    // std::min берёт MaxJoints по ссылке: без определения вне класса это не слинкуется при -O0
+    void TestMaxJointsOdrUse()
+    {
+        const size_t requested = 1000;
+        CHECK(std::min(requested, Skeleton::MaxJoints) == 256);
+    }
+
+    // Пакетный скиннинг против построчного, на одном потоке и на пуле (критерий Lab3.exe -animbench)
+    void TestBatchedSkinningMatchesScalar()
+    {
+        const AnimationBenchmark single = BenchmarkAnimation(64, 1);
+        const AnimationBenchmark result = BenchmarkAnimation(64, Jobs().ThreadCount());
+        CHECK(single.maxError < 1e-3);
+        CHECK(result.maxError < 1e-3);
+        CHECK(result.characters == 64 && result.joints > 0 && result.joints <= Skeleton::MaxJoints);
+    }
+}
+
+int main()
+{
+    // Позы и скиннинг по потокам проверяются и на одноядерной машине
+    JobSystemSettings settings;
+    settings.threads = 3;
+    ConfigureJobs(settings);
+
+    TestMaxJointsOdrUse();
+    TestBatchedSkinningMatchesScalar();
+    return Check::Result();
+}
@@ -0,0 +1,213 @@
+﻿#include "BufferAllocator.h"
+
+#include "Check.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Живые куски одного блока не пересекаются и лежат внутри него
+    size_t CountOverlaps(std::vector<Suballocation> live, const BlockSuballocator& allocator, uint64_t blockCapacity)
+    {
+        std::sort(live.begin(), live.end(), [](const Suballocation& a, const Suballocation& b)
+        {
+            return a.block != b.block ? a.block < b.block : a.offset < b.offset;
+        });
+        size_t overlaps = 0;
+        for (size_t i = 0; i < live.size(); ++i)
+        {
+            if (live[i].block >= allocator.BlockCount() || live[i].offset + live[i].size > blockCapacity) ++overlaps;
+            if (i > 0 && live[i].block == live[i - 1].block && live[i - 1].offset + live[i - 1].size > live[i].offset) ++overlaps;
+        }
+        return overlaps;
+    }
+
+    void TestSizeClasses()
+    {
+        CHECK(BlockSuballocator::RoundedSize(1) == BlockSuballocator::MinClassSize);
+        CHECK(BlockSuballocator::RoundedSize(256) == 256);
+        CHECK(BlockSuballocator::RoundedSize(257) == 512);
+        CHECK(BlockSuballocator::RoundedSize(BlockSuballocator::MaxClassSize) == BlockSuballocator::MaxClassSize);
+        CHECK(BlockSuballocator::RoundedSize(BlockSuballocator::MaxClassSize + 1) == 2 * BlockSuballocator::MaxClassSize);
+        CHECK(BlockSuballocator::SizeClassOf(1000) == 2);
+    }
+
+    // Освобождённый кусок берётся следующим запросом того же класса, а не новый диапазон
+    void TestReuseWithinClass()
+    {
+        BlockSuballocator allocator;
+        allocator.AddBlock(1 << 20);
+
+        const Suballocation first = allocator.Allocate(300, 16);
+        const Suballocation second = allocator.Allocate(400, 16);
+        CHECK(first.IsValid() && second.IsValid());
+        CHECK(first.size == 512 && second.size == 512);
+        CHECK(allocator.UsedBytes() == 1024);
+
+        allocator.Free(first);
+        CHECK(allocator.UsedBytes() == 512);
+        const Suballocation reused = allocator.Allocate(500, 16); // тот же класс 512
+        CHECK(reused.block == first.block && reused.offset == first.offset);
+
+        // Другой класс кусок не забирает
+        allocator.Free(reused);
+        const Suballocation other = allocator.Allocate(1000, 16);
+        CHECK(other.offset != first.offset);
+        allocator.Free(other);
+
+        // Выравнивание проверяется и у готовых кусков
+        const Suballocation aligned = allocator.Allocate(512, 4096);
+        CHECK(aligned.IsValid() && aligned.offset % 4096 == 0);
+
+        // Trim возвращает куски в блок: свободное место снова одним диапазоном
+        allocator.Free(aligned);
+        allocator.Free(second);
+        allocator.Trim();
+        CHECK(allocator.UsedBytes() == 0);
+        const Suballocation whole = allocator.Allocate(1 << 20, 1);
+        CHECK(whole.IsValid() && whole.offset == 0);
+    }
+
+    // Случайные выделения и освобождения нескольких классов и крупных кусков:
+    // живые диапазоны никогда не пересекаются, учёт байт сходится
+    void TestNoOverlaps()
+    {
+        const uint64_t blockCapacity = 4 << 20;
+        BlockSuballocator allocator;
+        allocator.AddBlock(blockCapacity);
+
+        std::mt19937 random(2024);
+        std::vector<Suballocation> live;
+        size_t overlaps = 0, failed = 0;
+        for (int step = 0; step < 20000; ++step)
+        {
+            if (!live.empty() && random() % 3 == 0)
+            {
+                const size_t index = random() % live.size();
+                allocator.Free(live[index]);
+                live[index] = live.back();
+                live.pop_back();
+            }
+            else
+            {
+                const uint64_t size = random() % 8 == 0 ? 64 * 1024 + random() % (256 * 1024) : 1 + random() % 8192;
+                const uint64_t alignment = 1ull << (random() % 9);
+                Suballocation allocation = allocator.Allocate(size, alignment);
+                if (!allocation.IsValid())
+                {
+                    // Как ResourceManager: места нет — новый блок и повтор
+                    allocator.AddBlock(blockCapacity);
+                    allocation = allocator.Allocate(size, alignment);
+                }
+                if (!allocation.IsValid() || allocation.offset % alignment != 0 || allocation.size < size)
+                {
+                    ++failed;
+                    continue;
+                }
+                live.push_back(allocation);
+            }
+            if (step % 500 == 0)
+            {
+                overlaps += CountOverlaps(live, allocator, blockCapacity);
+                if (step % 5000 == 0) allocator.Trim();
+            }
+        }
+        overlaps += CountOverlaps(live, allocator, blockCapacity);
+        CHECK(overlaps == 0);
+        CHECK(failed == 0);
+
+        uint64_t used = 0;
+        for (const Suballocation& allocation : live)
+            used += allocation.size;
+        CHECK(allocator.UsedBytes() == used);
+        CHECK(allocator.CapacityBytes() == allocator.BlockCount() * blockCapacity);
+    }
+
+    void TestRangeAllocator()
+    {
+        RangeAllocator ranges(1024);
+        const uint64_t a = ranges.Allocate(100, 64);
+        const uint64_t b = ranges.Allocate(100, 64);
+        const uint64_t c = ranges.Allocate(100, 64);
+        CHECK(a == 0 && b % 64 == 0 && c % 64 == 0 && b >= a + 100 && c >= b + 100);
+        CHECK(ranges.Allocate(2048, 1) == RangeAllocator::InvalidOffset);
+
+        // Отступы выравнивания остаются свободными, освобождение в любом порядке
+        // сливает соседей обратно в один диапазон
+        ranges.Free(b, 100);
+        ranges.Free(a, 100);
+        CHECK(ranges.FreeRangeCount() == 2);
+        ranges.Free(c, 100);
+        CHECK(ranges.FreeBytes() == 1024);
+        CHECK(ranges.FreeRangeCount() == 1);
+        CHECK(ranges.LargestFreeRange() == 1024);
+    }
+
+    // Ресурс, отпущенный в кадре N, не освобождается, пока кадр N не завершён
+    void TestDeferredRelease()
+    {
+        DeferredReleaseQueue<std::string> queue;
+        std::vector<std::string> released;
+        auto release = [&released](std::string& item) { released.push_back(item); };
+
+        queue.Push(1, "a1");
+        queue.Push(1, "b1");
+        queue.Push(2, "c2");
+        queue.Push(4, "d4");
+
+        CHECK(queue.Retire(0, release) == 0);
+        CHECK(released.empty());
+
+        CHECK(queue.Retire(1, release) == 2);
+        CHECK(released.size() == 2 && released[0] == "a1" && released[1] == "b1");
+
+        // Кадр 3 завершён, но 4 — нет
+        CHECK(queue.Retire(3, release) == 1);
+        CHECK(released.size() == 3 && released[2] == "c2");
+        CHECK(queue.Size() == 1);
+
+        // Ограда может и не двигаться: повторный опрос ничего не освобождает
+        CHECK(queue.Retire(3, release) == 0);
+
+        queue.Push(5, "e5");
+        queue.RetireAll(release);
+        CHECK(released.size() == 5 && released[3] == "d4" && released[4] == "e5");
+        CHECK(queue.Size() == 0);
+    }
+
+    void TestTransientPool()
+    {
+        TransientPool<int, int> pool(2);
+        CHECK(pool.Acquire(1, 1) == nullptr);
+        int* first = pool.Add(1, 100, 1);
+        CHECK(pool.Acquire(1, 1) == nullptr); // занят в этом кадре
+        pool.Release(first);
+        CHECK(pool.Acquire(1, 1) == first);
+
+        pool.EndFrame(1);
+        CHECK(pool.Acquire(1, 2) != nullptr);
+        pool.EndFrame(2);
+
+        // Не нужен больше двух кадров — удаляется
+        size_t evicted = 0;
+        pool.EndFrame(4, [&evicted](const int&) { ++evicted; });
+        CHECK(evicted == 0);
+        pool.EndFrame(5, [&evicted](const int&) { ++evicted; });
+        CHECK(evicted == 1);
+        CHECK(pool.Size() == 0);
+    }
+}
+
+int main()
+{
+    TestSizeClasses();
+    TestReuseWithinClass();
+    TestNoOverlaps();
+    TestRangeAllocator();
+    TestDeferredRelease();
+    TestTransientPool();
+    return Check::Result();
+}
@@ -0,0 +1,86 @@
+﻿#include "Bvh.h"
+#include "JobSystem.h"
+
+#include "Check.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace Math;
+
+namespace
+{
+    // Два квадрата друг за другом: луч вдоль +z попадает в ближний, после Refit — в сдвинутый
+    void TestMeshIntersect()
+    {
+        std::vector<Float3> positions = {
+            Float3(-1, -1, 1), Float3(1, -1, 1), Float3(1, 1, 1), Float3(-1, 1, 1),
+            Float3(-1, -1, 3), Float3(1, -1, 3), Float3(1, 1, 3), Float3(-1, 1, 3),
+        };
+        const std::vector<uint32_t> indices = { 4, 5, 6, 4, 6, 7, 0, 1, 2, 0, 2, 3 };
+
+        MeshBvh bvh;
+        bvh.Build(positions.data(), indices.data(), indices.size(), 2);
+        CHECK(bvh.TriangleCount() == 4);
+        CHECK(bvh.Bounds().min.z == 1.0f && bvh.Bounds().max.z == 3.0f);
+
+        Ray ray;
+        ray.origin = Float3(0.25f, -0.5f, 0.0f);
+        ray.direction = Float3(0.0f, 0.0f, 1.0f);
+        RayHit hit;
+        CHECK(bvh.Intersect(ray, hit));
+        CHECK(std::fabs(hit.t - 1.0f) < 1e-6f && (hit.primitive == 2 || hit.primitive == 3));
+
+        // Мимо и дальше tMax
+        RayHit miss;
+        Ray aside = ray;
+        aside.origin.x = 5.0f;
+        CHECK(!bvh.Intersect(aside, miss) && !miss.Hit());
+        Ray shortRay = ray;
+        shortRay.tMax = 0.5f;
+        CHECK(!bvh.Intersect(shortRay, miss));
+
+        // Ближний квадрат уехал за дальний
+        for (size_t i = 0; i < 4; ++i)
+            positions[i].z = 5.0f;
+        bvh.Refit(positions.data());
+        RayHit moved;
+        CHECK(bvh.Intersect(ray, moved));
+        CHECK(std::fabs(moved.t - 3.0f) < 1e-6f && moved.primitive < 2);
+
+        // Пакет совпадает с одиночными лучами
+        RayPacket packet;
+        RayHit single[RayPacketSize];
+        for (size_t lane = 0; lane < RayPacketSize; ++lane)
+        {
+            Ray laneRay = ray;
+            laneRay.origin.x = -1.5f + lane;
+            packet.Set(lane, laneRay);
+            bvh.Intersect(laneRay, single[lane]);
+        }
+        RayHit packed[RayPacketSize];
+        bvh.Intersect(packet, packed);
+        for (size_t lane = 0; lane < RayPacketSize; ++lane)
+            CHECK(packed[lane].primitive == single[lane].primitive && packed[lane].t == single[lane].t);
+    }
+
+    // Пакеты и дерево против одиночных лучей и перебора (критерий Lab3.exe -bvhbench)
+    void TestBenchmarkSelfCheck()
+    {
+        const BvhBenchmark result = BenchmarkBvh(20000, 1 << 14, Jobs().ThreadCount());
+        CHECK(result.mismatches == 0);
+        CHECK(result.nodes > 0 && result.hitRate > 0.0);
+    }
+}
+
+int main()
+{
+    // Поддеревья строятся параллельно и на одноядерной машине
+    JobSystemSettings settings;
+    settings.threads = 3;
+    ConfigureJobs(settings);
+
+    TestMeshIntersect();
+    TestBenchmarkSelfCheck();
+    return Check::Result();
+}
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+// Проверки для headless-тестов без сторонних фреймворков: CHECK печатает
+// место и условие и считает провалы, main возвращает Check::Result().
+
+#include <cstdio>
+
+namespace Check
+{
+    inline int& Failures()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    inline int Result()
+    {
+        if (Failures() == 0)
+        {
+            std::printf("OK\n");
+            return 0;
+        }
+        std::printf("%d check(s) failed\n", Failures());
+        return 1;
+    }
+}
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            ++Check::Failures(); \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        } \
+    } while (0)
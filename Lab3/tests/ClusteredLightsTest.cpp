@@ -0,0 +1,33 @@
+﻿#include "ClusteredLights.h"
+#include "JobSystem.h"
+
+#include "Check.h"
+
+#include <vector>
+
+namespace
+{
+    // Освещение по спискам кластеров совпадает с перебором всех источников
+    // (критерий тот же, что у Lab3.exe -lightbench, размеры меньше)
+    void TestClusteredMatchesAllLights()
+    {
+        const std::vector<LightCullingBenchmark> results = BenchmarkLightCulling({ 16, 256, 2048 }, 1 << 12, Jobs().ThreadCount());
+        CHECK(results.size() == 3);
+        for (const LightCullingBenchmark& result : results)
+        {
+            CHECK(result.maxShadeError < 1e-4);
+            CHECK(result.maxClusterLights <= result.lights);
+        }
+    }
+}
+
+int main()
+{
+    // Параллельное распределение проверяется и на одноядерной машине
+    JobSystemSettings settings;
+    settings.threads = 3;
+    ConfigureJobs(settings);
+
+    TestClusteredMatchesAllLights();
+    return Check::Result();
+}
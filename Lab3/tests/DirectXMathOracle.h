@@ -0,0 +1,475 @@
+﻿#pragma once
+
+// Эталон для VectorMathTest: ветка _XM_SSE_INTRINSICS_ функций DirectXMath,
+// которые заменяет VectorMath, переписанная как есть, а интринсики SSE —
+// по полосам на обычных float (каждая полоса mm_*_ps — одна операция IEEE
+// одинарной точности, как и у процессора). Так эталон собирается на любой
+// платформе и с любым бэкендом VectorMath и даёт биты настоящего DirectXMath
+// без заголовков Windows. Сборка без слияния в FMA (-std=c++14, см. CMakeLists.txt).
+// Имена интринсиков без ведущего подчёркивания: в xmmintrin.h часть из них макросы.
+//
+// Не входят MatrixRotationRollPitchYaw и MatrixInverse: они с DirectXMath
+// побитово не совпадают и проверяются по эталону в double.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace DirectXMathOracle
+{
+    struct XMVECTOR
+    {
+        float f[4];
+    };
+
+    struct XMMATRIX
+    {
+        XMVECTOR r[4];
+    };
+
+    struct XMVECTORU32
+    {
+        uint32_t u[4];
+        operator XMVECTOR() const
+        {
+            XMVECTOR v;
+            memcpy(v.f, u, sizeof(v.f));
+            return v;
+        }
+    };
+
+    // -------------------------------------------------------------------------
+    // Интринсики SSE по полосам
+
+    constexpr int MM_SHUFFLE(int z, int y, int x, int w) { return (z << 6) | (y << 4) | (x << 2) | w; }
+
+    inline XMVECTOR mm_setzero_ps() { return XMVECTOR{ { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+    inline XMVECTOR mm_set_ps(float w, float z, float y, float x) { return XMVECTOR{ { x, y, z, w } }; }
+    inline XMVECTOR mm_set_ss(float x) { return XMVECTOR{ { x, 0.0f, 0.0f, 0.0f } }; }
+
+    inline XMVECTOR mm_add_ps(XMVECTOR a, XMVECTOR b) { return XMVECTOR{ { a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3] } }; }
+    inline XMVECTOR mm_sub_ps(XMVECTOR a, XMVECTOR b) { return XMVECTOR{ { a.f[0] - b.f[0], a.f[1] - b.f[1], a.f[2] - b.f[2], a.f[3] - b.f[3] } }; }
+    inline XMVECTOR mm_mul_ps(XMVECTOR a, XMVECTOR b) { return XMVECTOR{ { a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3] } }; }
+    inline XMVECTOR mm_div_ps(XMVECTOR a, XMVECTOR b) { return XMVECTOR{ { a.f[0] / b.f[0], a.f[1] / b.f[1], a.f[2] / b.f[2], a.f[3] / b.f[3] } }; }
+    inline XMVECTOR mm_sqrt_ps(XMVECTOR a) { return XMVECTOR{ { std::sqrt(a.f[0]), std::sqrt(a.f[1]), std::sqrt(a.f[2]), std::sqrt(a.f[3]) } }; }
+
+    inline XMVECTOR mm_add_ss(XMVECTOR a, XMVECTOR b) { a.f[0] = a.f[0] + b.f[0]; return a; }
+    inline XMVECTOR mm_move_ss(XMVECTOR a, XMVECTOR b) { a.f[0] = b.f[0]; return a; }
+
+    inline XMVECTOR mm_shuffle_ps(XMVECTOR a, XMVECTOR b, int imm)
+    {
+        return XMVECTOR{ { a.f[imm & 3], a.f[(imm >> 2) & 3], b.f[(imm >> 4) & 3], b.f[(imm >> 6) & 3] } };
+    }
+    inline XMVECTOR mm_unpacklo_ps(XMVECTOR a, XMVECTOR b) { return XMVECTOR{ { a.f[0], b.f[0], a.f[1], b.f[1] } }; }
+    inline XMVECTOR XM_PERMUTE_PS(XMVECTOR v, int imm) { return mm_shuffle_ps(v, v, imm); }
+
+    template <class Op>
+    XMVECTOR Bitwise(XMVECTOR a, XMVECTOR b, Op op)
+    {
+        uint32_t x[4], y[4];
+        memcpy(x, a.f, sizeof(x));
+        memcpy(y, b.f, sizeof(y));
+        for (int i = 0; i < 4; ++i)
+            x[i] = op(x[i], y[i]);
+        memcpy(a.f, x, sizeof(x));
+        return a;
+    }
+    inline XMVECTOR mm_and_ps(XMVECTOR a, XMVECTOR b) { return Bitwise(a, b, [](uint32_t x, uint32_t y) { return x & y; }); }
+    inline XMVECTOR mm_andnot_ps(XMVECTOR a, XMVECTOR b) { return Bitwise(a, b, [](uint32_t x, uint32_t y) { return ~x & y; }); }
+    inline XMVECTOR mm_or_ps(XMVECTOR a, XMVECTOR b) { return Bitwise(a, b, [](uint32_t x, uint32_t y) { return x | y; }); }
+
+    // Неупорядоченные (NaN) — «не равны», как cmpneqps
+    inline XMVECTOR mm_cmpneq_ps(XMVECTOR a, XMVECTOR b)
+    {
+        XMVECTORU32 mask;
+        for (int i = 0; i < 4; ++i)
+            mask.u[i] = !(a.f[i] == b.f[i]) ? 0xFFFFFFFFu : 0u;
+        return mask;
+    }
+
+    // Без _XM_FMA3_INTRINSICS_ — умножение и сложение
+    inline XMVECTOR XM_FMADD_PS(XMVECTOR a, XMVECTOR b, XMVECTOR c) { return mm_add_ps(mm_mul_ps(a, b), c); }
+    inline XMVECTOR XM_FNMADD_PS(XMVECTOR a, XMVECTOR b, XMVECTOR c) { return mm_sub_ps(c, mm_mul_ps(a, b)); }
+
+    // -------------------------------------------------------------------------
+    // Константы DirectXMath
+
+    const float XM_PI = 3.141592654f;
+    const float XM_2PI = 6.283185307f;
+    const float XM_1DIV2PI = 0.159154943f;
+    const float XM_PIDIV2 = 1.570796327f;
+
+    const XMVECTOR g_XMIdentityR0 = { { 1.0f, 0.0f, 0.0f, 0.0f } };
+    const XMVECTOR g_XMIdentityR1 = { { 0.0f, 1.0f, 0.0f, 0.0f } };
+    const XMVECTOR g_XMIdentityR2 = { { 0.0f, 0.0f, 1.0f, 0.0f } };
+    const XMVECTOR g_XMIdentityR3 = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+    const XMVECTOR g_XMNegateX = { { -1.0f, 1.0f, 1.0f, 1.0f } };
+    const XMVECTOR g_XMNegateY = { { 1.0f, -1.0f, 1.0f, 1.0f } };
+    const XMVECTOR g_XMNegateZ = { { 1.0f, 1.0f, -1.0f, 1.0f } };
+    const XMVECTORU32 g_XMMaskY = { { 0x00000000, 0xFFFFFFFF, 0x00000000, 0x00000000 } };
+    const XMVECTORU32 g_XMMask3 = { { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000 } };
+    const XMVECTORU32 g_XMSelect1110 = { { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000 } };
+    const XMVECTORU32 g_XMInfinity = { { 0x7F800000, 0x7F800000, 0x7F800000, 0x7F800000 } };
+    const XMVECTORU32 g_XMQNaN = { { 0x7FC00000, 0x7FC00000, 0x7FC00000, 0x7FC00000 } };
+
+    // -------------------------------------------------------------------------
+    // Функции DirectXMath
+
+    inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return mm_set_ps(w, z, y, x); }
+
+    inline XMVECTOR XMLoadFloat3(const float* p) { return XMVectorSet(p[0], p[1], p[2], 0.0f); }
+
+    inline void XMScalarSinCos(float* pSin, float* pCos, float Value)
+    {
+        // Map Value to y in [-pi,pi], x = 2*pi*quotient + remainder.
+        float quotient = XM_1DIV2PI * Value;
+        if (Value >= 0.0f)
+            quotient = static_cast<float>(static_cast<int>(quotient + 0.5f));
+        else
+            quotient = static_cast<float>(static_cast<int>(quotient - 0.5f));
+        float y = Value - XM_2PI * quotient;
+
+        // Map y to [-pi/2,pi/2] with sin(y) = sin(Value).
+        float sign;
+        if (y > XM_PIDIV2)
+        {
+            y = XM_PI - y;
+            sign = -1.0f;
+        }
+        else if (y < -XM_PIDIV2)
+        {
+            y = -XM_PI - y;
+            sign = -1.0f;
+        }
+        else
+        {
+            sign = +1.0f;
+        }
+
+        float y2 = y * y;
+
+        // 11-degree minimax approximation
+        *pSin = (((((-2.3889859e-08f * y2 + 2.7525562e-06f) * y2 - 0.00019840874f) * y2 + 0.0083333310f) * y2 - 0.16666667f) * y2 + 1.0f) * y;
+
+        // 10-degree minimax approximation
+        float p = ((((-2.6051615e-07f * y2 + 2.4760495e-05f) * y2 - 0.0013888378f) * y2 + 0.041666638f) * y2 - 0.5f) * y2 + 1.0f;
+        *pCos = sign * p;
+    }
+
+    inline XMVECTOR XMVectorNegate(XMVECTOR V)
+    {
+        XMVECTOR Z;
+        Z = mm_setzero_ps();
+        return mm_sub_ps(Z, V);
+    }
+
+    inline XMVECTOR XMVectorSelect(XMVECTOR V1, XMVECTOR V2, XMVECTOR Control)
+    {
+        XMVECTOR vTemp1 = mm_andnot_ps(Control, V1);
+        XMVECTOR vTemp2 = mm_and_ps(V2, Control);
+        return mm_or_ps(vTemp1, vTemp2);
+    }
+
+    inline XMVECTOR XMVector3Dot(XMVECTOR V1, XMVECTOR V2)
+    {
+        // Perform the dot product
+        XMVECTOR vDot = mm_mul_ps(V1, V2);
+        // x=Dot.vector4_f32[1], y=Dot.vector4_f32[2]
+        XMVECTOR vTemp = XM_PERMUTE_PS(vDot, MM_SHUFFLE(2, 1, 2, 1));
+        // Result.vector4_f32[0] = x+y
+        vDot = mm_add_ss(vDot, vTemp);
+        // x=Dot.vector4_f32[2]
+        vTemp = XM_PERMUTE_PS(vTemp, MM_SHUFFLE(1, 1, 1, 1));
+        // Result.vector4_f32[0] = (x+y)+z
+        vDot = mm_add_ss(vDot, vTemp);
+        // Splat x
+        return XM_PERMUTE_PS(vDot, MM_SHUFFLE(0, 0, 0, 0));
+    }
+
+    inline XMVECTOR XMVector3Cross(XMVECTOR V1, XMVECTOR V2)
+    {
+        // y1,z1,x1,w1
+        XMVECTOR vTemp1 = XM_PERMUTE_PS(V1, MM_SHUFFLE(3, 0, 2, 1));
+        // z2,x2,y2,w2
+        XMVECTOR vTemp2 = XM_PERMUTE_PS(V2, MM_SHUFFLE(3, 1, 0, 2));
+        // Perform the left operation
+        XMVECTOR vResult = mm_mul_ps(vTemp1, vTemp2);
+        // z1,x1,y1,w1
+        vTemp1 = XM_PERMUTE_PS(vTemp1, MM_SHUFFLE(3, 0, 2, 1));
+        // y2,z2,x2,w2
+        vTemp2 = XM_PERMUTE_PS(vTemp2, MM_SHUFFLE(3, 1, 0, 2));
+        // Perform the right operation
+        vResult = XM_FNMADD_PS(vTemp1, vTemp2, vResult);
+        // Set w to zero
+        return mm_and_ps(vResult, g_XMMask3);
+    }
+
+    inline XMVECTOR XMVector3Normalize(XMVECTOR V)
+    {
+        // Perform the dot product on x,y and z only
+        XMVECTOR vLengthSq = mm_mul_ps(V, V);
+        XMVECTOR vTemp = XM_PERMUTE_PS(vLengthSq, MM_SHUFFLE(2, 1, 2, 1));
+        vLengthSq = mm_add_ss(vLengthSq, vTemp);
+        vTemp = XM_PERMUTE_PS(vTemp, MM_SHUFFLE(1, 1, 1, 1));
+        vLengthSq = mm_add_ss(vLengthSq, vTemp);
+        vLengthSq = XM_PERMUTE_PS(vLengthSq, MM_SHUFFLE(0, 0, 0, 0));
+        // Prepare for the division
+        XMVECTOR vResult = mm_sqrt_ps(vLengthSq);
+        // Create zero with a single instruction
+        XMVECTOR vZeroMask = mm_setzero_ps();
+        // Test for a divide by zero (Must be FP to detect -0.0)
+        vZeroMask = mm_cmpneq_ps(vZeroMask, vResult);
+        // Failsafe on zero (Or epsilon) length planes
+        // If the length is infinity, set the elements to zero
+        vLengthSq = mm_cmpneq_ps(vLengthSq, g_XMInfinity);
+        // Divide to perform the normalization
+        vResult = mm_div_ps(V, vResult);
+        // Any that are infinity, set to zero
+        vResult = mm_and_ps(vResult, vZeroMask);
+        // Select qnan or result based on infinite length
+        XMVECTOR vTemp1 = mm_andnot_ps(vLengthSq, g_XMQNaN);
+        XMVECTOR vTemp2 = mm_and_ps(vResult, vLengthSq);
+        vResult = mm_or_ps(vTemp1, vTemp2);
+        return vResult;
+    }
+
+    inline XMVECTOR XMVector3TransformCoord(XMVECTOR V, const XMMATRIX& M)
+    {
+        XMVECTOR vResult = XM_PERMUTE_PS(V, MM_SHUFFLE(2, 2, 2, 2)); // Z
+        vResult = XM_FMADD_PS(vResult, M.r[2], M.r[3]);
+        XMVECTOR vTemp = XM_PERMUTE_PS(V, MM_SHUFFLE(1, 1, 1, 1)); // Y
+        vResult = XM_FMADD_PS(vTemp, M.r[1], vResult);
+        vTemp = XM_PERMUTE_PS(V, MM_SHUFFLE(0, 0, 0, 0)); // X
+        vResult = XM_FMADD_PS(vTemp, M.r[0], vResult);
+        XMVECTOR W = XM_PERMUTE_PS(vResult, MM_SHUFFLE(3, 3, 3, 3));
+        vResult = mm_div_ps(vResult, W);
+        return vResult;
+    }
+
+    inline XMVECTOR XMVector3TransformNormal(XMVECTOR V, const XMMATRIX& M)
+    {
+        XMVECTOR vResult = XM_PERMUTE_PS(V, MM_SHUFFLE(2, 2, 2, 2)); // Z
+        vResult = mm_mul_ps(vResult, M.r[2]);
+        XMVECTOR vTemp = XM_PERMUTE_PS(V, MM_SHUFFLE(1, 1, 1, 1)); // Y
+        vResult = XM_FMADD_PS(vTemp, M.r[1], vResult);
+        vTemp = XM_PERMUTE_PS(V, MM_SHUFFLE(0, 0, 0, 0)); // X
+        vResult = XM_FMADD_PS(vTemp, M.r[0], vResult);
+        return vResult;
+    }
+
+    inline XMMATRIX XMMatrixIdentity()
+    {
+        XMMATRIX M;
+        M.r[0] = g_XMIdentityR0;
+        M.r[1] = g_XMIdentityR1;
+        M.r[2] = g_XMIdentityR2;
+        M.r[3] = g_XMIdentityR3;
+        return M;
+    }
+
+    inline XMMATRIX XMMatrixMultiply(const XMMATRIX& M1, const XMMATRIX& M2)
+    {
+        XMMATRIX mResult;
+        for (int row = 0; row < 4; ++row)
+        {
+            // Splat the component X,Y,Z then W
+            XMVECTOR vW = M1.r[row];
+            XMVECTOR vX = XM_PERMUTE_PS(vW, MM_SHUFFLE(0, 0, 0, 0));
+            XMVECTOR vY = XM_PERMUTE_PS(vW, MM_SHUFFLE(1, 1, 1, 1));
+            XMVECTOR vZ = XM_PERMUTE_PS(vW, MM_SHUFFLE(2, 2, 2, 2));
+            vW = XM_PERMUTE_PS(vW, MM_SHUFFLE(3, 3, 3, 3));
+            // Perform the operation on the first row
+            vX = mm_mul_ps(vX, M2.r[0]);
+            vY = mm_mul_ps(vY, M2.r[1]);
+            vZ = mm_mul_ps(vZ, M2.r[2]);
+            vW = mm_mul_ps(vW, M2.r[3]);
+            // Perform a binary add to reduce cumulative errors
+            vX = mm_add_ps(vX, vZ);
+            vY = mm_add_ps(vY, vW);
+            vX = mm_add_ps(vX, vY);
+            mResult.r[row] = vX;
+        }
+        return mResult;
+    }
+
+    inline XMMATRIX XMMatrixTranspose(const XMMATRIX& M)
+    {
+        // x.x,x.y,y.x,y.y
+        XMVECTOR vTemp1 = mm_shuffle_ps(M.r[0], M.r[1], MM_SHUFFLE(1, 0, 1, 0));
+        // x.z,x.w,y.z,y.w
+        XMVECTOR vTemp3 = mm_shuffle_ps(M.r[0], M.r[1], MM_SHUFFLE(3, 2, 3, 2));
+        // z.x,z.y,w.x,w.y
+        XMVECTOR vTemp2 = mm_shuffle_ps(M.r[2], M.r[3], MM_SHUFFLE(1, 0, 1, 0));
+        // z.z,z.w,w.z,w.w
+        XMVECTOR vTemp4 = mm_shuffle_ps(M.r[2], M.r[3], MM_SHUFFLE(3, 2, 3, 2));
+        XMMATRIX mResult;
+        // x.x,y.x,z.x,w.x
+        mResult.r[0] = mm_shuffle_ps(vTemp1, vTemp2, MM_SHUFFLE(2, 0, 2, 0));
+        // x.y,y.y,z.y,w.y
+        mResult.r[1] = mm_shuffle_ps(vTemp1, vTemp2, MM_SHUFFLE(3, 1, 3, 1));
+        // x.z,y.z,z.z,w.z
+        mResult.r[2] = mm_shuffle_ps(vTemp3, vTemp4, MM_SHUFFLE(2, 0, 2, 0));
+        // x.w,y.w,z.w,w.w
+        mResult.r[3] = mm_shuffle_ps(vTemp3, vTemp4, MM_SHUFFLE(3, 1, 3, 1));
+        return mResult;
+    }
+
+    inline XMMATRIX XMMatrixScaling(float ScaleX, float ScaleY, float ScaleZ)
+    {
+        XMMATRIX M;
+        M.r[0] = mm_set_ps(0, 0, 0, ScaleX);
+        M.r[1] = mm_set_ps(0, 0, ScaleY, 0);
+        M.r[2] = mm_set_ps(0, ScaleZ, 0, 0);
+        M.r[3] = g_XMIdentityR3;
+        return M;
+    }
+
+    inline XMMATRIX XMMatrixTranslation(float OffsetX, float OffsetY, float OffsetZ)
+    {
+        XMMATRIX M;
+        M.r[0] = g_XMIdentityR0;
+        M.r[1] = g_XMIdentityR1;
+        M.r[2] = g_XMIdentityR2;
+        M.r[3] = XMVectorSet(OffsetX, OffsetY, OffsetZ, 1.f);
+        return M;
+    }
+
+    inline XMMATRIX XMMatrixRotationX(float Angle)
+    {
+        float SinAngle;
+        float CosAngle;
+        XMScalarSinCos(&SinAngle, &CosAngle, Angle);
+
+        XMVECTOR vSin = mm_set_ss(SinAngle);
+        XMVECTOR vCos = mm_set_ss(CosAngle);
+        // x = 0,y = cos,z = sin, w = 0
+        vCos = mm_shuffle_ps(vCos, vSin, MM_SHUFFLE(3, 0, 0, 3));
+        XMMATRIX M;
+        M.r[0] = g_XMIdentityR0;
+        M.r[1] = vCos;
+        // x = 0,y = sin,z = cos, w = 0
+        vCos = XM_PERMUTE_PS(vCos, MM_SHUFFLE(3, 1, 2, 0));
+        // x = 0,y = -sin,z = cos, w = 0
+        vCos = mm_mul_ps(vCos, g_XMNegateY);
+        M.r[2] = vCos;
+        M.r[3] = g_XMIdentityR3;
+        return M;
+    }
+
+    inline XMMATRIX XMMatrixRotationY(float Angle)
+    {
+        float SinAngle;
+        float CosAngle;
+        XMScalarSinCos(&SinAngle, &CosAngle, Angle);
+
+        XMVECTOR vSin = mm_set_ss(SinAngle);
+        XMVECTOR vCos = mm_set_ss(CosAngle);
+        // x = sin,y = 0,z = cos, w = 0
+        vSin = mm_shuffle_ps(vSin, vCos, MM_SHUFFLE(3, 0, 3, 0));
+        XMMATRIX M;
+        M.r[2] = vSin;
+        M.r[1] = g_XMIdentityR1;
+        // x = cos,y = 0,z = sin, w = 0
+        vSin = XM_PERMUTE_PS(vSin, MM_SHUFFLE(3, 0, 1, 2));
+        // x = cos,y = 0,z = -sin, w = 0
+        vSin = mm_mul_ps(vSin, g_XMNegateZ);
+        M.r[0] = vSin;
+        M.r[3] = g_XMIdentityR3;
+        return M;
+    }
+
+    inline XMMATRIX XMMatrixRotationZ(float Angle)
+    {
+        float SinAngle;
+        float CosAngle;
+        XMScalarSinCos(&SinAngle, &CosAngle, Angle);
+
+        XMVECTOR vSin = mm_set_ss(SinAngle);
+        XMVECTOR vCos = mm_set_ss(CosAngle);
+        // x = cos,y = sin,z = 0, w = 0
+        vCos = mm_unpacklo_ps(vCos, vSin);
+        XMMATRIX M;
+        M.r[0] = vCos;
+        // x = sin,y = cos,z = 0, w = 0
+        vCos = XM_PERMUTE_PS(vCos, MM_SHUFFLE(3, 2, 0, 1));
+        // x = cos,y = -sin,z = 0, w = 0
+        vCos = mm_mul_ps(vCos, g_XMNegateX);
+        M.r[1] = vCos;
+        M.r[2] = g_XMIdentityR2;
+        M.r[3] = g_XMIdentityR3;
+        return M;
+    }
+
+    inline XMMATRIX XMMatrixPerspectiveFovLH(float FovAngleY, float AspectRatio, float NearZ, float FarZ)
+    {
+        float SinFov;
+        float CosFov;
+        XMScalarSinCos(&SinFov, &CosFov, 0.5f * FovAngleY);
+
+        float fRange = FarZ / (FarZ - NearZ);
+        // Note: This is recorded on the stack
+        float Height = CosFov / SinFov;
+        XMVECTOR rMem = {
+            { Height / AspectRatio,
+              Height,
+              fRange,
+              -fRange * NearZ }
+        };
+        // Copy from memory to SSE register
+        XMVECTOR vValues = rMem;
+        XMVECTOR vTemp = mm_setzero_ps();
+        // Copy x only
+        vTemp = mm_move_ss(vTemp, vValues);
+        // CosFov / SinFov,0,0,0
+        XMMATRIX M;
+        M.r[0] = vTemp;
+        // 0,Height / AspectRatio,0,0
+        vTemp = vValues;
+        vTemp = mm_and_ps(vTemp, g_XMMaskY);
+        M.r[1] = vTemp;
+        // x=fRange,y=-fRange * NearZ,0,1.0f
+        vTemp = mm_setzero_ps();
+        vValues = mm_shuffle_ps(vValues, g_XMIdentityR3, MM_SHUFFLE(3, 2, 3, 2));
+        // 0,0,fRange,1.0f
+        vTemp = mm_shuffle_ps(vTemp, vValues, MM_SHUFFLE(3, 0, 0, 0));
+        M.r[2] = vTemp;
+        // 0,0,-fRange * NearZ,0.0f
+        vTemp = mm_shuffle_ps(vTemp, vValues, MM_SHUFFLE(2, 1, 0, 0));
+        M.r[3] = vTemp;
+        return M;
+    }
+
+    inline XMMATRIX XMMatrixLookToLH(XMVECTOR EyePosition, XMVECTOR EyeDirection, XMVECTOR UpDirection)
+    {
+        XMVECTOR R2 = XMVector3Normalize(EyeDirection);
+
+        XMVECTOR R0 = XMVector3Cross(UpDirection, R2);
+        R0 = XMVector3Normalize(R0);
+
+        XMVECTOR R1 = XMVector3Cross(R2, R0);
+
+        XMVECTOR NegEyePosition = XMVectorNegate(EyePosition);
+
+        XMVECTOR D0 = XMVector3Dot(R0, NegEyePosition);
+        XMVECTOR D1 = XMVector3Dot(R1, NegEyePosition);
+        XMVECTOR D2 = XMVector3Dot(R2, NegEyePosition);
+
+        XMMATRIX M;
+        M.r[0] = XMVectorSelect(D0, R0, g_XMSelect1110);
+        M.r[1] = XMVectorSelect(D1, R1, g_XMSelect1110);
+        M.r[2] = XMVectorSelect(D2, R2, g_XMSelect1110);
+        M.r[3] = g_XMIdentityR3;
+
+        M = XMMatrixTranspose(M);
+
+        return M;
+    }
+
+    inline XMMATRIX XMMatrixLookAtLH(XMVECTOR EyePosition, XMVECTOR FocusPosition, XMVECTOR UpDirection)
+    {
+        XMVECTOR EyeDirection = mm_sub_ps(FocusPosition, EyePosition);
+        return XMMatrixLookToLH(EyePosition, EyeDirection, UpDirection);
+    }
+
+    inline XMMATRIX operator*(const XMMATRIX& M1, const XMMATRIX& M2) { return XMMatrixMultiply(M1, M2); }
+}
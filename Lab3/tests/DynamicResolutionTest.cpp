@@ -0,0 +1,213 @@
+﻿#include "DynamicResolution.h"
+
+#include "Check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace
+{
+    const double TargetMs = 1000.0 / 60.0;
+    const double FixedMs = 2.0;  // часть кадра, не зависящая от разрешения
+    const size_t LatencyFrames = 2; // замер GPU приходит через два кадра
+
+    // Модель GPU: кадр стоит FixedMs + pixelMs(кадр) * масштаб², время кадра
+    // узнаём с задержкой. Возвращает масштаб и время каждого кадра
+    struct Trace
+    {
+        std::vector<float> scales;
+        std::vector<double> frameMs;
+    };
+
+    Trace Simulate(ResolutionController& controller, size_t frames, const std::function<double(size_t)>& pixelMs)
+    {
+        Trace trace;
+        std::deque<double> inFlight;
+        float scale = controller.Scale();
+        for (size_t frame = 0; frame < frames; ++frame)
+        {
+            const double ms = FixedMs + pixelMs(frame) * scale * scale;
+            trace.scales.push_back(scale);
+            trace.frameMs.push_back(ms);
+
+            inFlight.push_back(ms);
+            if (inFlight.size() > LatencyFrames)
+            {
+                scale = controller.Update(inFlight.front());
+                inFlight.pop_front();
+            }
+        }
+        return trace;
+    }
+
+    bool Quantized(float scale, const ResolutionSettings& settings)
+    {
+        const float steps = scale / settings.scaleStep;
+        return std::fabs(steps - std::floor(steps + 0.5f)) < 1e-4f && scale >= settings.minScale && scale <= settings.maxScale;
+    }
+
+    void CheckQuantized(const Trace& trace, const ResolutionSettings& settings)
+    {
+        size_t bad = 0;
+        for (float scale : trace.scales)
+            if (!Quantized(scale, settings)) ++bad;
+        CHECK(bad == 0);
+    }
+
+    // Смены масштаба в [begin, end) и возвраты к масштабу, с которого только что ушли (A -> B -> A)
+    void CountChanges(const Trace& trace, size_t begin, size_t end, size_t& changes, size_t& flipFlops)
+    {
+        changes = flipFlops = 0;
+        float previous = -1.0f;
+        for (size_t frame = begin + 1; frame < end; ++frame)
+        {
+            if (trace.scales[frame] == trace.scales[frame - 1]) continue;
+            ++changes;
+            if (trace.scales[frame] == previous) ++flipFlops;
+            previous = trace.scales[frame - 1];
+        }
+    }
+
+    double Average(const std::vector<double>& values, size_t begin, size_t end)
+    {
+        double sum = 0.0;
+        for (size_t i = begin; i < end; ++i)
+            sum += values[i];
+        return sum / (end - begin);
+    }
+
+    // Нагрузка выросла вдвое: масштаб опускается до бюджета и там остаётся
+    void TestStep()
+    {
+        ResolutionController controller;
+        const ResolutionSettings& settings = controller.Settings();
+        const Trace trace = Simulate(controller, 600, [](size_t frame) { return frame < 100 ? 10.0 : 20.0; });
+        CheckQuantized(trace, settings);
+
+        // До скачка запас есть — полный масштаб без изменений
+        size_t changes = 0, flipFlops = 0;
+        CountChanges(trace, 0, 100, changes, flipFlops);
+        CHECK(changes == 0);
+        CHECK(trace.scales[99] == settings.maxScale);
+
+        // Через 200 кадров после скачка — у бюджета: ниже него с запасом на шаг
+        // квантования и мёртвую зону, и без лишнего понижения
+        const double average = Average(trace.frameMs, 300, 600);
+        CHECK(average <= TargetMs * (1.0 + settings.deadband) + 0.5);
+        CHECK(average >= TargetMs * 0.85);
+        const double ideal = std::sqrt((TargetMs - FixedMs) / 20.0);
+        CHECK(std::fabs(trace.scales.back() - ideal) <= 2.0 * settings.scaleStep);
+
+        CountChanges(trace, 300, 600, changes, flipFlops);
+        CHECK(changes <= 1);
+        CHECK(flipFlops == 0);
+    }
+
+    // Нагрузка растёт плавно: масштаб только опускается, время кадра следует за бюджетом
+    void TestRamp()
+    {
+        ResolutionController controller;
+        const ResolutionSettings& settings = controller.Settings();
+        const Trace trace = Simulate(controller, 900, [](size_t frame) { return 12.0 + 12.0 * std::min<size_t>(frame, 600) / 600.0; });
+        CheckQuantized(trace, settings);
+
+        size_t raises = 0;
+        for (size_t frame = 1; frame < trace.scales.size(); ++frame)
+            if (trace.scales[frame] > trace.scales[frame - 1]) ++raises;
+        CHECK(raises == 0);
+
+        double worst = 0.0;
+        for (size_t frame = 0; frame < trace.frameMs.size(); ++frame)
+            worst = std::max(worst, trace.frameMs[frame]);
+        CHECK(worst <= TargetMs * 1.15);
+
+        const double average = Average(trace.frameMs, 700, 900);
+        CHECK(average <= TargetMs * (1.0 + settings.deadband) + 0.5);
+        CHECK(average >= TargetMs * 0.85);
+
+        size_t changes = 0, flipFlops = 0;
+        CountChanges(trace, 0, trace.scales.size(), changes, flipFlops);
+        CHECK(flipFlops == 0);
+    }
+
+    // Одиночные провальные кадры (загрузка, сборка мусора) не обрушивают масштаб,
+    // и после них он возвращается к полному
+    void TestSpikes()
+    {
+        ResolutionController controller;
+        const ResolutionSettings& settings = controller.Settings();
+        const Trace trace = Simulate(controller, 600, [](size_t frame) { return frame % 150 == 75 ? 60.0 : 11.0; });
+        CheckQuantized(trace, settings);
+
+        float lowest = settings.maxScale;
+        for (float scale : trace.scales)
+            lowest = std::min(lowest, scale);
+        CHECK(lowest >= settings.maxScale - 4.0f * settings.scaleStep);
+
+        // Через 60 кадров после каждого всплеска масштаб снова полный
+        for (size_t spike = 75; spike < trace.scales.size(); spike += 150)
+            if (spike + 60 < trace.scales.size())
+                CHECK(trace.scales[spike + 60] == settings.maxScale);
+    }
+
+    // Шум у самого бюджета: мёртвая зона и гистерезис держат масштаб на месте
+    void TestNoiseAtBudget()
+    {
+        ResolutionController controller;
+        const ResolutionSettings& settings = controller.Settings();
+        const double pixelMs = (TargetMs - FixedMs) / (0.75 * 0.75);
+        const Trace trace = Simulate(controller, 1200, [pixelMs](size_t frame)
+        {
+            // Детерминированный шум ±4%
+            const double noise = 0.04 * std::sin(frame * 1.7) * std::cos(frame * 0.31);
+            return pixelMs * (1.0 + noise);
+        });
+        CheckQuantized(trace, settings);
+
+        size_t changes = 0, flipFlops = 0;
+        CountChanges(trace, 400, 1200, changes, flipFlops);
+        CHECK(changes <= 2);
+        CHECK(flipFlops == 0);
+        CHECK(std::fabs(trace.scales.back() - 0.75f) <= 2.0f * settings.scaleStep);
+    }
+
+    // Масштаб квантуется и с другим шагом и границами, ScaledSize не даёт нулевых размеров
+    void TestSettings()
+    {
+        ResolutionSettings settings;
+        settings.minScale = 0.25f;
+        settings.scaleStep = 1.0f / 8.0f;
+        ResolutionController controller(settings);
+        const Trace trace = Simulate(controller, 400, [](size_t) { return 400.0; });
+        CheckQuantized(trace, controller.Settings());
+        CHECK(trace.scales.back() == 0.25f);
+
+        unsigned width = 0, height = 0;
+        controller.ScaledSize(1, 1, width, height);
+        CHECK(width == 1 && height == 1);
+        controller.ScaledSize(1920, 1080, width, height);
+        CHECK(width == 480 && height == 270);
+
+        const ResolutionStats stats = controller.Stats();
+        CHECK(stats.frames == ResolutionController::HistorySize);
+        CHECK(stats.scale == 0.25f);
+        CHECK(stats.overBudgetFrames == stats.frames);
+
+        controller.Reset();
+        CHECK(controller.Scale() == 1.0f);
+        CHECK(controller.History().empty());
+    }
+}
+
+int main()
+{
+    TestStep();
+    TestRamp();
+    TestSpikes();
+    TestNoiseAtBudget();
+    TestSettings();
+    return Check::Result();
+}
@@ -0,0 +1,228 @@
+﻿#include "FrameWriter.h"
+
+#include "Check.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::vector<uint8_t> ReadAll(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    bool Exists(const std::string& path)
+    {
+        std::ifstream file(path);
+        return file.good();
+    }
+
+    uint32_t BE32(const uint8_t* p)
+    {
+        return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    }
+
+    // Эталоны без таблиц и без отложенного остатка — не те же, что в FrameWriter.cpp
+    uint32_t ReferenceCrc32(const uint8_t* data, size_t size)
+    {
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc ^= data[i];
+            for (int k = 0; k < 8; ++k)
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+        return ~crc;
+    }
+
+    uint32_t ReferenceAdler32(const std::vector<uint8_t>& data)
+    {
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : data)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        return b << 16 | a;
+    }
+
+    Frame MakeFrame(uint32_t index, uint32_t width, uint32_t height)
+    {
+        Frame frame;
+        frame.index = index;
+        frame.width = width;
+        frame.height = height;
+        frame.pixels.resize((size_t)width * height * 4);
+        for (size_t i = 0; i < frame.pixels.size(); ++i)
+            frame.pixels[i] = (uint8_t)(i * 7 + index);
+        return frame;
+    }
+
+    // Чанки с верными CRC, zlib из stored-блоков с верными LEN/NLEN и Adler-32;
+    // распакованное — строки кадра с байтом фильтра 0
+    void TestPngRoundTrip()
+    {
+        // Строка 1201 байт, 300 строк — больше 65535: несколько stored-блоков
+        const Frame frame = MakeFrame(3, 300, 300);
+        FrameWriter writer;
+        CHECK(writer.Start("FrameWriterTest_png", FrameFormat::Png));
+        writer.Submit(MakeFrame(3, 300, 300));
+        writer.Stop();
+        CHECK(writer.FramesWritten() == 1);
+
+        const std::vector<uint8_t> png = ReadAll(writer.FramePath(3));
+        CHECK(png.size() == writer.BytesWritten());
+        CHECK(png.size() > 8 && png[0] == 0x89 && png[1] == 'P' && png[2] == 'N' && png[3] == 'G');
+        if (png.size() <= 8) return;
+
+        std::vector<std::string> chunks;
+        std::vector<uint8_t> idat;
+        size_t offset = 8;
+        while (offset + 12 <= png.size())
+        {
+            const uint32_t length = BE32(&png[offset]);
+            if (offset + 12 + length > png.size()) break;
+            const std::string type(png.begin() + offset + 4, png.begin() + offset + 8);
+            CHECK(BE32(&png[offset + 8 + length]) == ReferenceCrc32(&png[offset + 4], length + 4));
+            if (type == "IHDR")
+            {
+                CHECK(length == 13 && BE32(&png[offset + 8]) == 300 && BE32(&png[offset + 12]) == 300);
+                CHECK(png[offset + 16] == 8 && png[offset + 17] == 6);
+            }
+            if (type == "IDAT") idat.assign(png.begin() + offset + 8, png.begin() + offset + 8 + length);
+            chunks.push_back(type);
+            offset += 12 + length;
+        }
+        CHECK(offset == png.size());
+        CHECK(chunks.size() == 3 && chunks[0] == "IHDR" && chunks[1] == "IDAT" && chunks[2] == "IEND");
+
+        CHECK(idat.size() > 6 && idat[0] == 0x78 && idat[1] == 0x01 && (idat[0] * 256 + idat[1]) % 31 == 0);
+        if (idat.size() <= 6) return;
+        std::vector<uint8_t> raw;
+        size_t blocks = 0;
+        bool final = false;
+        size_t at = 2;
+        while (!final && at + 5 <= idat.size() - 4)
+        {
+            final = (idat[at] & 1) != 0;
+            CHECK((idat[at] & 6) == 0); // stored
+            const uint32_t len = idat[at + 1] | idat[at + 2] << 8;
+            const uint32_t nlen = idat[at + 3] | idat[at + 4] << 8;
+            CHECK((len ^ 0xFFFFu) == nlen);
+            at += 5;
+            if (at + len > idat.size() - 4) break;
+            raw.insert(raw.end(), idat.begin() + at, idat.begin() + at + len);
+            at += len;
+            ++blocks;
+        }
+        CHECK(final && blocks > 1 && at == idat.size() - 4);
+        CHECK(BE32(&idat[idat.size() - 4]) == ReferenceAdler32(raw));
+
+        std::vector<uint8_t> expected;
+        for (uint32_t y = 0; y < frame.height; ++y)
+        {
+            expected.push_back(0);
+            expected.insert(expected.end(), frame.pixels.begin() + y * 1200, frame.pixels.begin() + (y + 1) * 1200);
+        }
+        CHECK(raw == expected);
+    }
+
+    // Кадр пишется во временный файл и переименовывается: старый кадр заменяется
+    // целиком, от .part ничего не остаётся; FrameExists видит только готовые кадры
+    void TestPartRename()
+    {
+        FrameWriter writer;
+        CHECK(writer.Start("FrameWriterTest_raw", FrameFormat::Raw, 2, 2));
+        const std::string path = writer.FramePath(7);
+        CHECK(path == "FrameWriterTest_raw_000007.rgba");
+
+        std::remove(writer.FramePath(8).c_str());
+        {
+            std::ofstream stale(path, std::ios::binary | std::ios::trunc);
+            stale << "a longer stale frame from an interrupted run, to be replaced";
+        }
+        {
+            std::ofstream stalePart(writer.FramePath(8) + ".part", std::ios::binary | std::ios::trunc);
+            stalePart << "partial";
+        }
+        CHECK(writer.FrameExists(7));
+        CHECK(!writer.FrameExists(8)); // недописанный .part кадром не считается
+
+        const Frame seven = MakeFrame(7, 4, 3);
+        const Frame eight = MakeFrame(8, 4, 3);
+        writer.Submit(MakeFrame(7, 4, 3));
+        writer.Submit(MakeFrame(8, 4, 3));
+        writer.Stop();
+
+        CHECK(writer.FramesWritten() == 2 && writer.BytesWritten() == 2 * 4 * 3 * 4);
+        CHECK(ReadAll(path) == seven.pixels);
+        CHECK(ReadAll(writer.FramePath(8)) == eight.pixels);
+        CHECK(writer.FrameExists(8));
+        CHECK(!Exists(path + ".part") && !Exists(writer.FramePath(8) + ".part"));
+    }
+
+    // Заголовок один на поток, перед каждым кадром FRAME и три плоскости W*H
+    void TestY4m()
+    {
+        FrameWriter writer;
+        writer.SetFrameRate(24);
+        CHECK(writer.Start("FrameWriterTest", FrameFormat::Y4m, 4, 4));
+        CHECK(writer.FramePath(5) == "FrameWriterTest.y4m");
+        CHECK(!writer.FrameExists(0));
+
+        Frame white;
+        white.width = 5;
+        white.height = 3;
+        white.pixels.assign(5 * 3 * 4, 255);
+        writer.Submit(std::move(white));
+        writer.Submit(MakeFrame(1, 5, 3));
+        writer.Stop();
+
+        const std::string header = "YUV4MPEG2 W5 H3 F24:1 Ip A1:1 C444\n";
+        const size_t frameBytes = 6 + 5 * 3 * 3;
+        const std::vector<uint8_t> file = ReadAll("FrameWriterTest.y4m");
+        CHECK(file.size() == header.size() + 2 * frameBytes);
+        CHECK(writer.BytesWritten() == 2 * 5 * 3 * 3);
+        if (file.size() != header.size() + 2 * frameBytes) return;
+        CHECK(std::string(file.begin(), file.begin() + header.size()) == header);
+        CHECK(std::string(file.begin() + header.size(), file.begin() + header.size() + 6) == "FRAME\n");
+        CHECK(std::string(file.begin() + header.size() + frameBytes, file.begin() + header.size() + frameBytes + 6) == "FRAME\n");
+
+        // Белый в BT.601 ограниченного диапазона: Y 235, U и V 128
+        const uint8_t* planes = &file[header.size() + 6];
+        CHECK(planes[0] == 235 && planes[14] == 235 && planes[15] == 128 && planes[30] == 128 && planes[44] == 128);
+    }
+
+    void TestTimingLog()
+    {
+        FrameWriter writer;
+        CHECK(writer.Start("FrameWriterTest_log", FrameFormat::Raw));
+        CHECK(writer.OpenTimingLog("FrameWriterTest_log.csv", false));
+        Frame frame = MakeFrame(0, 2, 2);
+        frame.renderMs = 1.5;
+        writer.Submit(std::move(frame));
+        writer.Stop();
+
+        std::ifstream log("FrameWriterTest_log.csv");
+        std::string header, row, extra;
+        std::getline(log, header);
+        std::getline(log, row);
+        CHECK(header == "frame,render_ms,readback_ms,write_ms");
+        CHECK(row.compare(0, 8, "0,1.5,0,") == 0);
+        CHECK(!std::getline(log, extra));
+    }
+}
+
+int main()
+{
+    TestPngRoundTrip();
+    TestPartRename();
+    TestY4m();
+    TestTimingLog();
+    return Check::Result();
+}
@@ -0,0 +1,98 @@
+﻿#include "Input.h"
+
+#include "Check.h"
+
+#include <cmath>
+
+namespace
+{
+    InputEvent Event(int64_t time, InputEventType type, uint8_t key = 0)
+    {
+        InputEvent event;
+        event.time = time;
+        event.type = type;
+        event.key = key;
+        return event;
+    }
+
+    // Клавиша держится свою долю кадра; автоповтор ничего не добавляет
+    void TestHeldTime()
+    {
+        InputBuffer buffer;
+        buffer.Sample(1000000);
+
+        buffer.Push(Event(1005000, InputEventType::KeyDown, InputKey::Left));
+        buffer.Push(Event(1008000, InputEventType::KeyDown, InputKey::Left));
+        buffer.Push(Event(1012000, InputEventType::KeyUp, InputKey::Left));
+        buffer.Push(Event(1010000, InputEventType::KeyDown, InputKey::Up)); // не по порядку
+        const InputFrame& frame = buffer.Sample(1016000);
+        CHECK(frame.events == 4 && frame.firstEventTime == 1005000);
+        CHECK(std::fabs(frame.heldSeconds[InputKey::Left] - 0.007f) < 1e-6f);
+        CHECK(std::fabs(frame.heldSeconds[InputKey::Up] - 0.006f) < 1e-6f);
+        CHECK(!frame.down[InputKey::Left] && frame.down[InputKey::Up]);
+
+        // Нажатая с прошлого кадра держится весь интервал; опоздавшее отпускание — в его начале
+        buffer.Push(Event(1000000, InputEventType::KeyUp, InputKey::Up));
+        const InputFrame& next = buffer.Sample(1032000);
+        CHECK(next.heldSeconds[InputKey::Up] == 0.0f && !next.down[InputKey::Up]);
+        CHECK(buffer.Pending() == 0);
+
+        // Потеря фокуса отпускает всё
+        buffer.Push(Event(1033000, InputEventType::KeyDown, InputKey::Right));
+        buffer.Push(Event(1035000, InputEventType::ReleaseAll));
+        const InputFrame& released = buffer.Sample(1048000);
+        CHECK(std::fabs(released.heldSeconds[InputKey::Right] - 0.002f) < 1e-6f && !released.down[InputKey::Right]);
+    }
+
+    void TestCamera()
+    {
+        InputBuffer buffer;
+        buffer.Sample(1000000);
+        buffer.Push(Event(1000000, InputEventType::KeyDown, InputKey::RightButton));
+        InputEvent move = Event(1001000, InputEventType::MouseMove);
+        move.dx = 100;
+        buffer.Push(move);
+        buffer.Push(Event(1000000, InputEventType::KeyDown, InputKey::Up));
+
+        CameraController camera;
+        CHECK(camera.Update(buffer.Sample(1500000)));
+        CHECK(std::fabs(camera.Yaw() - 0.3f) < 1e-5f);
+        CHECK(std::fabs(camera.Pitch() - 0.5f) < 1e-5f);
+
+        // Наклон упирается в maxPitch
+        camera.Update(buffer.Sample(3500000));
+        CHECK(camera.Pitch() == camera.Settings().maxPitch);
+    }
+
+    // Задержка считается до показа своего кадра; перекрытые кадры пропускаются
+    void TestLatency()
+    {
+        LatencyTracker tracker;
+        tracker.Submit(1, 1000);
+        tracker.Submit(2, 2000);
+        tracker.Submit(3, 3000);
+        tracker.Complete(2, 12000);
+        CHECK(tracker.Stats().frames == 1 && tracker.Stats().lastMs == 10.0);
+        tracker.Complete(3, 8000);
+        CHECK(tracker.Stats().frames == 2 && tracker.Stats().minMs == 5.0 && tracker.Stats().averageMs == 7.5);
+        tracker.Complete(1, 20000); // уже не ждёт
+        CHECK(tracker.Stats().frames == 2);
+    }
+
+    // Поворот не зависит от частоты кадров и автоповтора (критерий Lab3.exe -inputbench)
+    void TestBenchmarkSelfCheck()
+    {
+        const InputBenchmark result = BenchmarkInput();
+        CHECK(result.combinations > 0);
+        CHECK(result.maxAngleError < 1e-3);
+    }
+}
+
+int main()
+{
+    TestHeldTime();
+    TestCamera();
+    TestLatency();
+    TestBenchmarkSelfCheck();
+    return Check::Result();
+}
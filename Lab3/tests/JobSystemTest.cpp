@@ -0,0 +1,77 @@
+﻿#include "JobSystem.h"
+
+#include "Check.h"
+
+#include <atomic>
+#include <vector>
+
+namespace
+{
+    JobSystemSettings Threads(unsigned threads)
+    {
+        JobSystemSettings settings;
+        settings.threads = threads;
+        return settings;
+    }
+
+    void TestParallelFor()
+    {
+        JobSystem jobs(Threads(4));
+        std::vector<std::atomic<int>> visits(10000);
+        jobs.ParallelFor(visits.size(), 16, [&visits](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                ++visits[i];
+        });
+        size_t wrong = 0;
+        for (const std::atomic<int>& visit : visits)
+            wrong += visit.load() != 1;
+        CHECK(wrong == 0);
+    }
+
+    // Задача «после» счётчика не начнётся, пока не выполнены все его задачи
+    void TestDependencies()
+    {
+        JobSystem jobs(Threads(4));
+        std::atomic<int> first{ 0 };
+        std::atomic<int> early{ 0 };
+        JobCounter layer, next;
+        for (int i = 0; i < 64; ++i)
+            jobs.Run([&first] { ++first; }, &layer);
+        for (int i = 0; i < 16; ++i)
+            jobs.Run([&first, &early] { if (first.load() != 64) ++early; }, &next, &layer);
+        jobs.Wait(next);
+        CHECK(layer.Done() && next.Done());
+        CHECK(first.load() == 64 && early.load() == 0);
+    }
+
+    // В пуле из одного потока рабочих нет: фоновая задача выполняется в Wait
+    void TestBackgroundWithoutWorkers()
+    {
+        JobSystem jobs(Threads(1));
+        CHECK(jobs.ThreadCount() == 1);
+        bool ran = false;
+        JobCounter counter;
+        jobs.Run([&ran] { ran = true; }, &counter, nullptr, JobPriority::Background);
+        CHECK(!ran);
+        jobs.Wait(counter);
+        CHECK(ran);
+    }
+
+    // Суммы ParallelFor и порядок слоёв при 1, 2 и 4 потоках (критерий Lab3.exe -jobbench)
+    void TestBenchmarkSelfCheck()
+    {
+        const JobBenchmark result = BenchmarkJobs(4);
+        CHECK(result.mismatches == 0);
+        CHECK(result.points.size() == 3 && result.points.back().threads == 4);
+    }
+}
+
+int main()
+{
+    TestParallelFor();
+    TestDependencies();
+    TestBackgroundWithoutWorkers();
+    TestBenchmarkSelfCheck();
+    return Check::Result();
+}
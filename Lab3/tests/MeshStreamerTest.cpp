@@ -0,0 +1,175 @@
+﻿#include "MeshStreamer.h"
+
+#include "Check.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // OBJ-полоса из triangles треугольников в текущем каталоге (ctest запускает тест в каталоге сборки)
+    std::string WriteObj(const char* name, size_t triangles)
+    {
+        const std::string path = std::string("MeshStreamerTest_") + name + ".obj";
+        std::ofstream stream(path, std::ios::binary);
+        for (size_t i = 0; i < triangles + 2; ++i)
+            stream << "v " << (float)(i / 2) << ' ' << (float)(i % 2) << " 0\n";
+        for (size_t i = 0; i < triangles; ++i)
+            stream << "f " << i + 1 << ' ' << i + 2 << ' ' << i + 3 << '\n';
+        return path;
+    }
+
+    size_t MeshBytes(size_t triangles)
+    {
+        return (triangles + 2) * MeshData::VertexFloats * sizeof(float) + triangles * 3 * sizeof(uint32_t);
+    }
+
+    struct Recorder
+    {
+        std::vector<uint32_t> order;
+        std::vector<size_t> sizes;
+
+        MeshStreamer::UploadFn Fn()
+        {
+            return [this](uint32_t meshId, const MeshData& mesh)
+            {
+                order.push_back(meshId);
+                sizes.push_back(mesh.SizeBytes());
+                return true;
+            };
+        }
+    };
+
+    void TestParseObj()
+    {
+        const char text[] = "# comment\nv 0 0 0\nv 1 0 0 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2/5 3//7 -1\n";
+        MeshData mesh;
+        CHECK(ParseObj(text, sizeof(text) - 1, mesh));
+        CHECK(mesh.VertexCount() == 4);
+        CHECK(mesh.indices.size() == 6); // четырёхугольник — веером в два треугольника
+        CHECK(mesh.indices[3] == 0 && mesh.indices[4] == 2 && mesh.indices[5] == 3);
+
+        const char broken[] = "v 0 0 0\nf 1 2 3\n";
+        CHECK(!ParseObj(broken, sizeof(broken) - 1, mesh));
+    }
+
+    // Выше приоритет — раньше на GPU; SetPriority переставляет ещё не загруженные
+    void TestPriorityOrder()
+    {
+        MeshStreamer streamer;
+        const uint32_t low = streamer.Request(WriteObj("low", 10), 1.0f);
+        const uint32_t middle = streamer.Request(WriteObj("middle", 10), 2.0f);
+        const uint32_t high = streamer.Request(WriteObj("high", 10), 3.0f);
+        const uint32_t promoted = streamer.Request(WriteObj("promoted", 10), 0.5f);
+        CHECK(streamer.Request(WriteObj("middle", 10), 2.0f) == middle); // тот же путь — тот же меш
+        CHECK(streamer.State(low) == MeshState::Queued);
+
+        // Ещё в очереди на чтение
+        streamer.SetPriority(promoted, 10.0f);
+        streamer.Start(1);
+        streamer.WaitUntilDecoded();
+        CHECK(streamer.State(low) == MeshState::Ready && streamer.State(promoted) == MeshState::Ready);
+
+        // Уже разобран и ждёт загрузки
+        streamer.SetPriority(low, 5.0f);
+
+        Recorder recorder;
+        CHECK(streamer.Pump(~0ull, 1e9, recorder.Fn()) == 4);
+        const std::vector<uint32_t> expected = { promoted, low, high, middle };
+        CHECK(recorder.order == expected);
+        CHECK(streamer.State(promoted) == MeshState::Resident);
+        CHECK(streamer.IsIdle());
+        streamer.Stop();
+    }
+
+    // Pump останавливается на бюджете байт и времени, но первый меш загружает всегда
+    void TestBudget()
+    {
+        MeshStreamer streamer;
+        streamer.Start(2);
+        std::vector<uint32_t> ids;
+        for (int i = 0; i < 6; ++i)
+        {
+            const std::string name = "budget" + std::to_string(i);
+            ids.push_back(streamer.Request(WriteObj(name.c_str(), 100), (float)(6 - i)));
+        }
+        streamer.WaitUntilDecoded();
+
+        const uint64_t size = MeshBytes(100);
+        CHECK(streamer.Stats().ready == 6);
+        CHECK(streamer.Stats().readyBytes == 6 * size);
+
+        Recorder recorder;
+        CHECK(streamer.Pump(2 * size + size / 2, 1e9, recorder.Fn()) == 2);
+        CHECK(recorder.order.size() == 2 && recorder.order[0] == ids[0] && recorder.order[1] == ids[1]);
+        CHECK(streamer.Stats().lastPumpBytes == 2 * size);
+        CHECK(streamer.Stats().readyBytes == 4 * size);
+
+        // Меш больше бюджета всё равно проходит — по одному за Pump
+        CHECK(streamer.Pump(1, 1e9, recorder.Fn()) == 1);
+        CHECK(recorder.order.back() == ids[2]);
+
+        // Бюджет времени исчерпан сразу после первого
+        CHECK(streamer.Pump(~0ull, 0.0, recorder.Fn()) == 1);
+        CHECK(streamer.Pump(~0ull, 1e9, recorder.Fn()) == 2);
+        CHECK(streamer.Pump(~0ull, 1e9, recorder.Fn()) == 0);
+
+        const StreamingStats stats = streamer.Stats();
+        CHECK(stats.resident == 6 && stats.ready == 0 && stats.readyBytes == 0);
+        CHECK(stats.bytesUploaded == 6 * size);
+        streamer.Stop();
+    }
+
+    // Пока функция загрузки держит меш, он не готов и не считается в readyBytes
+    void TestUploadingState()
+    {
+        MeshStreamer streamer;
+        streamer.Start(1);
+        const uint32_t first = streamer.Request(WriteObj("uploading0", 20), 2.0f);
+        const uint32_t second = streamer.Request(WriteObj("uploading1", 20), 1.0f);
+        streamer.WaitUntilDecoded();
+
+        size_t checks = 0;
+        const bool pumped = streamer.Pump(~0ull, 1e9, [&](uint32_t meshId, const MeshData& mesh)
+        {
+            const StreamingStats stats = streamer.Stats();
+            CHECK(streamer.State(meshId) == MeshState::Uploading);
+            CHECK(stats.uploading == 1);
+            CHECK(mesh.SizeBytes() == MeshBytes(20));
+            if (meshId == first) CHECK(stats.ready == 1 && stats.readyBytes == MeshBytes(20));
+            if (meshId == second) CHECK(stats.ready == 0 && stats.readyBytes == 0);
+            ++checks;
+            return meshId == first; // вторая загрузка не удалась
+        }) == 2;
+        CHECK(pumped && checks == 2);
+        CHECK(streamer.State(first) == MeshState::Resident);
+        CHECK(streamer.State(second) == MeshState::Failed);
+
+        const uint32_t missing = streamer.Request("MeshStreamerTest_missing.obj", 1.0f);
+        streamer.WaitUntilDecoded();
+        CHECK(streamer.State(missing) == MeshState::Failed);
+        CHECK(streamer.Stats().failed == 2);
+        streamer.Stop();
+    }
+}
+
+// Аргумент — число потоков планировщика: ctest запускает тест и с одним,
+// когда рабочих потоков нет и фоновые задачи сами не выполняются
+int main(int argc, char* argv[])
+{
+    if (argc > 1)
+    {
+        JobSystemSettings settings;
+        settings.threads = (unsigned)std::atoi(argv[1]);
+        ConfigureJobs(settings);
+    }
+
+    TestParseObj();
+    TestPriorityOrder();
+    TestBudget();
+    TestUploadingState();
+    return Check::Result();
+}
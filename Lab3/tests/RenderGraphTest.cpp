@@ -0,0 +1,310 @@
+﻿#include "RenderGraph.h"
+
+#include "Check.h"
+
+#include <cstring>
+
+namespace
+{
+    GraphTextureDesc Desc(uint32_t width, uint32_t height, uint32_t format = 28)
+    {
+        GraphTextureDesc desc;
+        desc.width = width;
+        desc.height = height;
+        desc.format = format;
+        return desc;
+    }
+
+    // Позиция прохода в порядке исполнения; ~0u — отброшен
+    uint32_t Position(const RenderGraph& graph, const char* name)
+    {
+        const std::vector<CompiledPass>& passes = graph.Passes();
+        for (uint32_t position = 0; position < passes.size(); ++position)
+            if (graph.PassName(passes[position].pass) == name) return position;
+        return ~0u;
+    }
+
+    const GraphAttachment* Attachment(const RenderGraph& graph, const char* pass, GraphResource resource)
+    {
+        const uint32_t position = Position(graph, pass);
+        if (position == ~0u) return nullptr;
+        for (const GraphAttachment& attachment : graph.Passes()[position].attachments)
+            if (attachment.resource == resource) return &attachment;
+        return nullptr;
+    }
+
+    // Проход, чей результат никто не читает, отбрасывается вместе со всем, что нужно
+    // только ему; побочный эффект и запись во внешнюю цель держат проход живым
+    void TestCulling()
+    {
+        RenderGraph graph;
+        const GraphResource backBuffer = graph.ImportTexture("BackBuffer", Desc(64, 64));
+        const GraphResource scene = graph.CreateTexture("Scene", Desc(64, 64));
+        const GraphResource debug = graph.CreateTexture("Debug", Desc(64, 64));
+        const GraphResource debugBlur = graph.CreateTexture("DebugBlur", Desc(64, 64));
+        const GraphResource readback = graph.CreateTexture("Readback", Desc(1, 1));
+
+        graph.AddPass("Scene", nullptr).Write(scene);
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Debug", nullptr);
+            pass.Read(scene);
+            pass.Write(debug);
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("DebugBlur", nullptr);
+            pass.Read(debug);
+            pass.Write(debugBlur, WriteMode::Overwrite);
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Readback", nullptr);
+            pass.Read(scene);
+            pass.Write(readback);
+            pass.SideEffect();
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Present", nullptr);
+            pass.Read(scene);
+            pass.Write(backBuffer, WriteMode::Overwrite);
+        }
+        graph.AddPass("Unused", nullptr).Write(graph.CreateTexture("Nothing", Desc(8, 8)));
+
+        CHECK(graph.Compile());
+        CHECK(graph.Passes().size() == 3);
+        CHECK(Position(graph, "Scene") != ~0u);
+        CHECK(Position(graph, "Readback") != ~0u);
+        CHECK(Position(graph, "Present") != ~0u);
+        CHECK(graph.Culled(1) && graph.Culled(2) && graph.Culled(5));
+        CHECK(graph.Stats().culledPasses == 3);
+        CHECK(graph.Physical(debug) == ~0u && graph.Physical(debugBlur) == ~0u);
+        CHECK(graph.Validate() == 0);
+
+        // Пометка выхода оживляет цепочку
+        graph.MarkOutput(debugBlur);
+        CHECK(graph.Compile());
+        CHECK(graph.Passes().size() == 5);
+        CHECK(Position(graph, "Debug") < Position(graph, "DebugBlur"));
+    }
+
+    // Проходы объявлены не по порядку: писатель идёт раньше читателя, перезапись —
+    // после всех читателей прежнего содержимого, при равенстве — порядок объявления
+    void TestOrdering()
+    {
+        RenderGraph graph;
+        const GraphResource backBuffer = graph.ImportTexture("BackBuffer", Desc(64, 64));
+        const GraphResource gbuffer = graph.CreateTexture("GBuffer", Desc(64, 64));
+        const GraphResource lit = graph.CreateTexture("Lit", Desc(64, 64));
+        const GraphResource shadow = graph.CreateTexture("Shadow", Desc(32, 32));
+
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Lighting", nullptr);
+            pass.Read(gbuffer);
+            pass.Read(shadow);
+            pass.Write(lit, WriteMode::Overwrite);
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Tonemap", nullptr);
+            pass.Read(lit);
+            pass.Write(backBuffer, WriteMode::Overwrite);
+        }
+        graph.AddPass("GBuffer", nullptr).Write(gbuffer);
+        graph.AddPass("Shadow", nullptr).Write(shadow);
+        {
+            // Дорисовка поверх освещения — после тонмаппинга, который читал прежнее содержимое
+            RenderGraph::PassBuilder pass = graph.AddPass("Overlay", nullptr);
+            pass.Write(lit);
+            pass.Write(backBuffer);
+        }
+
+        CHECK(graph.Compile());
+        CHECK(graph.Passes().size() == 5);
+        CHECK(Position(graph, "GBuffer") < Position(graph, "Lighting"));
+        CHECK(Position(graph, "Shadow") < Position(graph, "Lighting"));
+        CHECK(Position(graph, "Lighting") < Position(graph, "Tonemap"));
+        CHECK(Position(graph, "Tonemap") < Position(graph, "Overlay"));
+        CHECK(Position(graph, "GBuffer") < Position(graph, "Shadow")); // оба готовы сразу — по объявлению
+        CHECK(graph.Validate() == 0);
+
+        // Ссылка на несуществующую цель — ошибка компиляции
+        graph.AddPass("Broken", nullptr).Read(1000);
+        CHECK(!graph.Compile());
+    }
+
+    // Цели с одним описанием и непересекающимся временем жизни делят физическую,
+    // пересекающиеся и несовместимые — нет
+    void TestAliasing()
+    {
+        RenderGraph graph;
+        const GraphResource backBuffer = graph.ImportTexture("BackBuffer", Desc(64, 64));
+        const GraphResource a = graph.CreateTexture("A", Desc(64, 64));
+        const GraphResource b = graph.CreateTexture("B", Desc(64, 64));
+        const GraphResource c = graph.CreateTexture("C", Desc(64, 64));
+        const GraphResource half = graph.CreateTexture("Half", Desc(32, 32));
+        const GraphResource otherFormat = graph.CreateTexture("OtherFormat", Desc(64, 64, 10));
+
+        graph.AddPass("WriteA", nullptr).Write(a);                 // 0: A
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("AtoB", nullptr); // 1: A, B
+            pass.Read(a);
+            pass.Write(b, WriteMode::Overwrite);
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("BtoHalf", nullptr); // 2: B, Half
+            pass.Read(b);
+            pass.Write(half, WriteMode::Overwrite);
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("HalfToC", nullptr); // 3: Half, C — A уже свободна
+            pass.Read(half);
+            pass.Write(c, WriteMode::Overwrite);
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("CtoOther", nullptr); // 4: C, OtherFormat — B свободна
+            pass.Read(c);
+            pass.Write(otherFormat, WriteMode::Overwrite);
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Present", nullptr); // 5
+            pass.Read(otherFormat);
+            pass.Write(backBuffer, WriteMode::Overwrite);
+        }
+
+        CHECK(graph.Compile());
+        CHECK(graph.Passes().size() == 6);
+        CHECK(graph.Physical(a) != ~0u);
+        CHECK(graph.Physical(a) != graph.Physical(b)); // A и B живы в AtoB
+        CHECK(graph.Physical(c) == graph.Physical(a) || graph.Physical(c) == graph.Physical(b));
+        CHECK(graph.Physical(half) != graph.Physical(a) && graph.Physical(half) != graph.Physical(b));
+        CHECK(graph.Physical(otherFormat) != graph.Physical(a) && graph.Physical(otherFormat) != graph.Physical(b));
+        CHECK(graph.Physical(backBuffer) == ~0u);
+        CHECK(graph.PhysicalCount() == 4);
+        CHECK(graph.Stats().transientResources == 5);
+        CHECK(graph.Stats().SavedBytes() == Desc(64, 64).SizeBytes());
+        CHECK(graph.Validate() == 0);
+    }
+
+    // Первая частичная запись очищает, полная — не трогает прежнее; последнее
+    // использование временной цели выбрасывает её, внешняя сохраняется
+    void TestLoadStore()
+    {
+        RenderGraph graph;
+        const GraphResource backBuffer = graph.ImportTexture("BackBuffer", Desc(64, 64));
+        const GraphResource history = graph.ImportTexture("History", Desc(64, 64)); // прошлый кадр, в графе не пишется
+        const GraphResource overlay = graph.ImportTexture("Overlay", Desc(64, 64), true);
+        const GraphResource scene = graph.CreateTexture("Scene", Desc(64, 64));
+        const GraphResource depth = graph.CreateTexture("Depth", Desc(64, 64, 40));
+        const GraphResource post = graph.CreateTexture("Post", Desc(64, 64));
+
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Opaque", nullptr);
+            pass.Write(scene);
+            pass.Write(depth);
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Transparent", nullptr);
+            pass.Read(depth);
+            pass.Write(scene);
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Post", nullptr);
+            pass.Read(scene);
+            pass.Read(history);
+            pass.Write(post, WriteMode::Overwrite);
+        }
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Resolve", nullptr);
+            pass.Read(post);
+            pass.Write(overlay);
+            pass.Write(backBuffer);
+        }
+
+        CHECK(graph.Compile());
+        CHECK(graph.Passes().size() == 4);
+
+        const GraphAttachment* p = Attachment(graph, "Opaque", scene);
+        CHECK(p && p->write && p->load == LoadAction::Clear && p->store == StoreAction::Store);
+        p = Attachment(graph, "Opaque", depth);
+        CHECK(p && p->load == LoadAction::Clear && p->store == StoreAction::Store);
+
+        // И чтение, и запись глубины — одно вложение с загрузкой
+        p = Attachment(graph, "Transparent", scene);
+        CHECK(p && p->write && p->load == LoadAction::Load && p->store == StoreAction::Store);
+        p = Attachment(graph, "Transparent", depth);
+        CHECK(p && !p->write && p->load == LoadAction::Load && p->store == StoreAction::Discard);
+
+        p = Attachment(graph, "Post", scene);
+        CHECK(p && p->load == LoadAction::Load && p->store == StoreAction::Discard);
+        p = Attachment(graph, "Post", post);
+        CHECK(p && p->load == LoadAction::DontCare && p->store == StoreAction::Store);
+        p = Attachment(graph, "Post", history);
+        CHECK(p && p->load == LoadAction::Load && p->store == StoreAction::Store);
+
+        p = Attachment(graph, "Resolve", post);
+        CHECK(p && p->store == StoreAction::Discard);
+        p = Attachment(graph, "Resolve", backBuffer);
+        CHECK(p && p->load == LoadAction::Clear && p->store == StoreAction::Store);
+        p = Attachment(graph, "Resolve", overlay); // внешняя с сохранением содержимого — загружается
+        CHECK(p && p->write && p->load == LoadAction::Load && p->store == StoreAction::Store);
+
+        // В списке вложений прохода сначала чтения, затем записи
+        const uint32_t resolve = Position(graph, "Resolve");
+        CHECK(resolve != ~0u);
+        if (resolve != ~0u)
+        {
+            const std::vector<GraphAttachment>& attachments = graph.Passes()[resolve].attachments;
+            CHECK(attachments.size() == 3 && !attachments[0].write && attachments[1].write && attachments[2].write);
+        }
+
+        CHECK(graph.Stats().clears == 3);
+        CHECK(graph.Stats().discards == 3);
+        CHECK(graph.Validate() == 0);
+    }
+
+    // Исполнение идёт в порядке компиляции, отброшенные не вызываются
+    void TestRun()
+    {
+        RenderGraph graph;
+        const GraphResource backBuffer = graph.ImportTexture("BackBuffer", Desc(64, 64));
+        const GraphResource scene = graph.CreateTexture("Scene", Desc(64, 64));
+        std::string trace;
+
+        {
+            RenderGraph::PassBuilder pass = graph.AddPass("Present", [&trace] { trace += "P"; });
+            pass.Read(scene);
+            pass.Write(backBuffer, WriteMode::Overwrite);
+        }
+        graph.AddPass("Scene", [&trace] { trace += "S"; }).Write(scene);
+        graph.AddPass("Unused", [&trace] { trace += "U"; }).Write(graph.CreateTexture("Nothing", Desc(8, 8)));
+
+        CHECK(graph.Compile());
+        for (const CompiledPass& pass : graph.Passes())
+            graph.Run(pass);
+        CHECK(trace == "SP");
+
+        graph.Reset();
+        CHECK(graph.Passes().empty() && graph.ResourceCount() == 0);
+    }
+
+    // Типичный отложенный кадр без нарушений (критерий Lab3.exe -graphbench)
+    void TestBenchmarkFrame()
+    {
+        const uint32_t sizes[][2] = { { 1280, 720 }, { 3840, 2160 } };
+        for (const auto& size : sizes)
+        {
+            const RenderGraphBenchmark result = BenchmarkRenderGraph(size[0], size[1], 10);
+            CHECK(result.violations == 0);
+            CHECK(result.passes > result.culledPasses && !result.order.empty());
+            CHECK(result.physicalBytes <= result.transientBytes);
+        }
+    }
+}
+
+int main()
+{
+    TestCulling();
+    TestOrdering();
+    TestAliasing();
+    TestLoadStore();
+    TestRun();
+    TestBenchmarkFrame();
+    return Check::Result();
+}
@@ -0,0 +1,176 @@
+﻿#include "Startup.h"
+
+#include "Check.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef StartupTimeline::Clock Clock;
+
+    std::vector<std::string> Split(const std::string& line, char separator)
+    {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, separator))
+            fields.push_back(field);
+        return fields;
+    }
+
+    // Два шага запуска идут одновременно: каждый ждёт, пока начнётся другой
+    void TestParallelPhasesOverlap()
+    {
+        StartupTimeline timeline;
+        std::atomic<int> started{ 0 };
+        auto step = [&started](unsigned)
+        {
+            ++started;
+            const Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+            while (started.load() < 2 && Clock::now() < deadline)
+                std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return started.load() == 2;
+        };
+
+        StartupTask shaders, scene;
+        shaders.Start(timeline, "shaders", step);
+        scene.Start(timeline, "scene", [&step](unsigned thread) { return step(thread) && false; });
+        timeline.Mark("window", 0, Clock::now()); // основной поток тем временем делает своё
+        CHECK(shaders.Wait());
+        CHECK(!scene.Wait()); // результат шага доходит до Wait
+        CHECK(shaders.Started() && scene.Started());
+
+        const std::vector<StartupPhase> phases = timeline.Phases();
+        CHECK(phases.size() == 3);
+        const StartupPhase* pShaders = nullptr;
+        const StartupPhase* pScene = nullptr;
+        for (const StartupPhase& p : phases)
+        {
+            if (p.name == "shaders") pShaders = &p;
+            if (p.name == "scene") pScene = &p;
+        }
+        CHECK(pShaders && pScene);
+        if (pShaders && pScene)
+        {
+            CHECK(pShaders->thread != pScene->thread && pShaders->thread != 0 && pScene->thread != 0);
+            CHECK(pShaders->succeeded && !pScene->succeeded);
+            CHECK(pShaders->startMs < pScene->startMs + pScene->durationMs);
+            CHECK(pScene->startMs < pShaders->startMs + pShaders->durationMs);
+            CHECK(pShaders->durationMs >= 20.0 && pScene->durationMs >= 20.0);
+        }
+    }
+
+    // Фазы записаны не по порядку — Phases отдаёт их по началу
+    void TestPhasesOrdered()
+    {
+        StartupTimeline timeline;
+        const Clock::time_point origin = Clock::now();
+        timeline.Restart();
+        timeline.Record("third", 2, origin + std::chrono::milliseconds(300), origin + std::chrono::milliseconds(310), true);
+        timeline.Record("first", 0, origin + std::chrono::milliseconds(100), origin + std::chrono::milliseconds(400), true);
+        timeline.Record("second", 1, origin + std::chrono::milliseconds(200), origin + std::chrono::milliseconds(205), false);
+
+        const std::vector<StartupPhase> phases = timeline.Phases();
+        CHECK(phases.size() == 3);
+        CHECK(phases[0].name == "first" && phases[1].name == "second" && phases[2].name == "third");
+        for (size_t i = 1; i < phases.size(); ++i)
+            CHECK(phases[i - 1].startMs <= phases[i].startMs);
+        CHECK(std::abs(phases[0].durationMs - 300.0) < 1.0);
+        CHECK(!phases[1].succeeded);
+
+        // Mark возвращает начало следующей фазы: фазы идут встык
+        Clock::time_point phase = Clock::now();
+        phase = timeline.Mark("a", 0, phase);
+        timeline.Mark("b", 0, phase, false);
+        // (они начались раньше записанных выше и встают в начало)
+        const std::vector<StartupPhase> marked = timeline.Phases();
+        CHECK(marked.size() == 5);
+        CHECK(marked[0].name == "a" && marked[1].name == "b" && marked[2].name == "first");
+        CHECK(std::abs(marked[0].startMs + marked[0].durationMs - marked[1].startMs) < 1e-6);
+        CHECK(marked[0].succeeded && !marked[1].succeeded);
+    }
+
+    // Первый кадр записывается один раз; Restart его забывает
+    void TestFirstFrame()
+    {
+        StartupTimeline timeline;
+        CHECK(timeline.FirstFrameMs() == 0.0);
+        CHECK(timeline.Report().find("no frame yet") != std::string::npos);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        timeline.MarkFirstFrame();
+        const double first = timeline.FirstFrameMs();
+        CHECK(first > 0.0);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        timeline.MarkFirstFrame();
+        CHECK(timeline.FirstFrameMs() == first);
+        CHECK(timeline.ElapsedMs() >= first + 5.0);
+        CHECK(timeline.Report().find("time to first frame") != std::string::npos);
+
+        timeline.Restart();
+        CHECK(timeline.FirstFrameMs() == 0.0 && timeline.Phases().empty());
+        CHECK(timeline.NewThread() == 1);
+    }
+
+    void TestCsv()
+    {
+        StartupTimeline timeline;
+        timeline.Measure("device", 0, [] { return true; });
+        timeline.Measure("scene, textures", 1, [] { return false; });
+        timeline.MarkFirstFrame();
+
+        const std::string path = "StartupTest.csv";
+        CHECK(timeline.WriteCsv(path));
+
+        std::ifstream file(path);
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(file, line))
+            lines.push_back(line);
+
+        CHECK(lines.size() == 4);
+        if (lines.size() != 4) return;
+        CHECK(lines[0] == "phase,thread,start_ms,duration_ms,succeeded");
+
+        const std::vector<std::string> device = Split(lines[1], ',');
+        CHECK(device.size() == 5 && device[0] == "device" && device[1] == "0" && device[4] == "1");
+        if (device.size() == 5) CHECK(std::atof(device[2].c_str()) >= 0.0 && std::atof(device[3].c_str()) >= 0.0);
+
+        const std::vector<std::string> scene = Split(lines[2], ',');
+        CHECK(scene.back() == "0" && scene[scene.size() - 4] == "1");
+
+        const std::vector<std::string> firstFrame = Split(lines[3], ',');
+        CHECK(firstFrame.size() == 5 && firstFrame[0] == "first_frame" && firstFrame[1] == "0" && firstFrame[3] == "0" && firstFrame[4] == "1");
+        if (firstFrame.size() == 5) CHECK(std::atof(firstFrame[2].c_str()) > 0.0);
+
+        // Без кадра — нулевое время и 0 в последней колонке
+        timeline.Restart();
+        CHECK(timeline.WriteCsv(path));
+        std::ifstream empty(path);
+        std::getline(empty, line);
+        std::getline(empty, line);
+        CHECK(line == "first_frame,0,0,0,0");
+    }
+}
+
+int main()
+{
+    // Один рабочий поток, как на двух ядрах: второй фоновый шаг берёт Wait основного
+    JobSystemSettings settings;
+    settings.threads = 2;
+    ConfigureJobs(settings);
+
+    TestParallelPhasesOverlap();
+    TestPhasesOrdered();
+    TestFirstFrame();
+    TestCsv();
+    return Check::Result();
+}
@@ -0,0 +1,444 @@
+﻿#include "VectorMath.h"
+
+#include "Check.h"
+#include "DirectXMathOracle.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Собирается для каждого бэкенда (см. CMakeLists.txt): результат сверяется
+// побитово с DirectXMath (DirectXMathOracle.h) и с эталоном в double,
+// пакетные функции — ещё и побитово с поэлементными.
+
+using namespace Math;
+
+namespace
+{
+    typedef double Reference[4][4];
+
+    const double Tolerance = 2e-5; // относительная, с поправкой на порядок величин
+
+    std::mt19937 g_Random(777);
+
+    float RandomFloat(float low, float high)
+    {
+        return std::uniform_real_distribution<float>(low, high)(g_Random);
+    }
+
+    void ToReference(const Matrix& m, Reference& r)
+    {
+        Float4x4 stored;
+        StoreFloat4x4(&stored, m);
+        for (int row = 0; row < 4; ++row)
+            for (int column = 0; column < 4; ++column)
+                r[row][column] = stored.m[row][column];
+    }
+
+    bool Near(double value, double expected, double scale = 1.0)
+    {
+        return std::fabs(value - expected) <= Tolerance * std::max(scale, std::fabs(expected));
+    }
+
+    // Сравнение с эталоном; scale — порядок величин элементов, от него считается допуск нулей
+    bool NearMatrix(const Matrix& m, const Reference& expected, double scale = 1.0)
+    {
+        Reference actual;
+        ToReference(m, actual);
+        for (int row = 0; row < 4; ++row)
+            for (int column = 0; column < 4; ++column)
+                if (!Near(actual[row][column], expected[row][column], scale)) return false;
+        return true;
+    }
+
+    double MaxAbs(const Reference& r)
+    {
+        double result = 0.0;
+        for (int row = 0; row < 4; ++row)
+            for (int column = 0; column < 4; ++column)
+                result = std::max(result, std::fabs(r[row][column]));
+        return result;
+    }
+
+    void Multiply(const Reference& a, const Reference& b, Reference& result)
+    {
+        for (int row = 0; row < 4; ++row)
+            for (int column = 0; column < 4; ++column)
+            {
+                result[row][column] = 0.0;
+                for (int k = 0; k < 4; ++k)
+                    result[row][column] += a[row][k] * b[k][column];
+            }
+    }
+
+    // Гаусс-Жордан с выбором ведущего элемента
+    bool Invert(const Reference& m, Reference& result)
+    {
+        double a[4][8];
+        for (int row = 0; row < 4; ++row)
+            for (int column = 0; column < 4; ++column)
+            {
+                a[row][column] = m[row][column];
+                a[row][column + 4] = row == column ? 1.0 : 0.0;
+            }
+        for (int column = 0; column < 4; ++column)
+        {
+            int pivot = column;
+            for (int row = column + 1; row < 4; ++row)
+                if (std::fabs(a[row][column]) > std::fabs(a[pivot][column])) pivot = row;
+            if (a[pivot][column] == 0.0) return false;
+            for (int k = 0; k < 8; ++k)
+                std::swap(a[column][k], a[pivot][k]);
+            const double inverse = 1.0 / a[column][column];
+            for (int k = 0; k < 8; ++k)
+                a[column][k] *= inverse;
+            for (int row = 0; row < 4; ++row)
+            {
+                if (row == column) continue;
+                const double factor = a[row][column];
+                for (int k = 0; k < 8; ++k)
+                    a[row][k] -= factor * a[column][k];
+            }
+        }
+        for (int row = 0; row < 4; ++row)
+            for (int column = 0; column < 4; ++column)
+                result[row][column] = a[row][column + 4];
+        return true;
+    }
+
+    void TransformReference(const double point[3], const Reference& m, bool coord, double result[3])
+    {
+        for (int column = 0; column < 3; ++column)
+            result[column] = point[0] * m[0][column] + point[1] * m[1][column] + point[2] * m[2][column] + (coord ? m[3][column] : 0.0);
+        if (!coord) return;
+        const double w = point[0] * m[0][3] + point[1] * m[1][3] + point[2] * m[2][3] + m[3][3];
+        for (int column = 0; column < 3; ++column)
+            result[column] /= w;
+    }
+
+    Matrix RandomMatrix()
+    {
+        Float4x4 stored;
+        for (int row = 0; row < 4; ++row)
+            for (int column = 0; column < 4; ++column)
+                stored.m[row][column] = RandomFloat(-4.0f, 4.0f);
+        return LoadFloat4x4(&stored);
+    }
+
+    Matrix RandomWorld()
+    {
+        const float scale = RandomFloat(0.2f, 3.0f);
+        return MatrixScaling(scale, scale, scale) * MatrixRotationRollPitchYaw(RandomFloat(-3.0f, 3.0f), RandomFloat(-3.0f, 3.0f), RandomFloat(-3.0f, 3.0f)) *
+            MatrixTranslation(RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f));
+    }
+
+    namespace DX = DirectXMathOracle;
+
+    bool SameBits(const Matrix& m, const DX::XMMATRIX& expected)
+    {
+        Float4x4 stored;
+        StoreFloat4x4(&stored, m);
+        return memcmp(&stored, &expected, sizeof(stored)) == 0;
+    }
+
+    bool SameBits(Vector v, DX::XMVECTOR expected)
+    {
+        Float4 stored;
+        StoreFloat4(&stored, v);
+        return memcmp(&stored, expected.f, sizeof(stored)) == 0;
+    }
+
+    DX::XMMATRIX ToOracle(const Matrix& m)
+    {
+        DX::XMMATRIX result;
+        StoreFloat4x4(reinterpret_cast<Float4x4*>(&result), m);
+        return result;
+    }
+
+    DX::XMVECTOR ToOracle(Vector v)
+    {
+        DX::XMVECTOR result;
+        StoreFloat4(reinterpret_cast<Float4*>(result.f), v);
+        return result;
+    }
+
+    // Всё, что обещано побитово равным DirectXMath, — с теми же входами через эталон
+    void TestDirectXMathBits()
+    {
+        size_t mismatches = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            const float angle = RandomFloat(-20.0f, 20.0f);
+            float s, c, expectedSin, expectedCos;
+            ScalarSinCos(&s, &c, angle);
+            DX::XMScalarSinCos(&expectedSin, &expectedCos, angle);
+            if (memcmp(&s, &expectedSin, sizeof(s)) != 0 || memcmp(&c, &expectedCos, sizeof(c)) != 0) ++mismatches;
+            if (!SameBits(MatrixRotationX(angle), DX::XMMatrixRotationX(angle))) ++mismatches;
+            if (!SameBits(MatrixRotationY(angle), DX::XMMatrixRotationY(angle))) ++mismatches;
+            if (!SameBits(MatrixRotationZ(angle), DX::XMMatrixRotationZ(angle))) ++mismatches;
+
+            const float x = RandomFloat(-10.0f, 10.0f), y = RandomFloat(-10.0f, 10.0f), z = RandomFloat(-10.0f, 10.0f);
+            if (!SameBits(MatrixScaling(x, y, z), DX::XMMatrixScaling(x, y, z))) ++mismatches;
+            if (!SameBits(MatrixTranslation(x, y, z), DX::XMMatrixTranslation(x, y, z))) ++mismatches;
+
+            const float fov = RandomFloat(0.3f, 2.5f), aspect = RandomFloat(0.5f, 3.0f);
+            const float nearZ = RandomFloat(0.01f, 1.0f), farZ = nearZ + RandomFloat(1.0f, 1000.0f);
+            const Matrix projection = MatrixPerspectiveFovLH(fov, aspect, nearZ, farZ);
+            const DX::XMMATRIX dxProjection = DX::XMMatrixPerspectiveFovLH(fov, aspect, nearZ, farZ);
+            if (!SameBits(projection, dxProjection)) ++mismatches;
+
+            const Matrix a = RandomMatrix(), b = RandomMatrix();
+            const DX::XMMATRIX dxA = ToOracle(a), dxB = ToOracle(b);
+            if (!SameBits(a * b, dxA * dxB)) ++mismatches;
+            if (!SameBits(MatrixTranspose(a), DX::XMMatrixTranspose(dxA))) ++mismatches;
+
+            const Vector u = VectorSet(x, y, z, RandomFloat(-1.0f, 1.0f));
+            const Vector v = VectorSet(RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), 0.0f);
+            const DX::XMVECTOR dxU = ToOracle(u), dxV = ToOracle(v);
+            if (!SameBits(VectorNegate(u), DX::XMVectorNegate(dxU))) ++mismatches;
+            if (!SameBits(Vector3Dot(u, v), DX::XMVector3Dot(dxU, dxV))) ++mismatches;
+            if (!SameBits(Vector3Cross(u, v), DX::XMVector3Cross(dxU, dxV))) ++mismatches;
+            if (!SameBits(Vector3Normalize(u), DX::XMVector3Normalize(dxU))) ++mismatches;
+            if (!SameBits(Vector3TransformCoord(u, a), DX::XMVector3TransformCoord(dxU, dxA))) ++mismatches;
+            if (!SameBits(Vector3TransformNormal(u, a), DX::XMVector3TransformNormal(dxU, dxA))) ++mismatches;
+
+            // Камера и полная цепочка кадра, как в main.cpp
+            const Vector up = VectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+            const DX::XMVECTOR dxUp = ToOracle(up);
+            const Matrix view = MatrixLookAtLH(u, v, up);
+            const DX::XMMATRIX dxView = DX::XMMatrixLookAtLH(dxU, dxV, dxUp);
+            if (!SameBits(view, dxView)) ++mismatches;
+            if (!SameBits(MatrixLookToLH(u, v, up), DX::XMMatrixLookToLH(dxU, dxV, dxUp))) ++mismatches;
+
+            const Matrix world = MatrixScaling(x, x, x) * MatrixRotationY(angle) * MatrixTranslation(x, y, z);
+            const DX::XMMATRIX dxWorld = DX::XMMatrixScaling(x, x, x) * DX::XMMatrixRotationY(angle) * DX::XMMatrixTranslation(x, y, z);
+            if (!SameBits(MatrixTranspose(world * view * projection), DX::XMMatrixTranspose(dxWorld * dxView * dxProjection))) ++mismatches;
+
+            Float3 point(x, y, z);
+            const float dxPoint[3] = { x, y, z };
+            if (!SameBits(Vector3TransformCoord(LoadFloat3(&point), world * view * projection),
+                    DX::XMVector3TransformCoord(DX::XMLoadFloat3(dxPoint), dxWorld * dxView * dxProjection))) ++mismatches;
+        }
+        CHECK(mismatches == 0);
+
+        // Нулевая длина даёт ноль, бесконечная — QNaN, как у DirectXMath
+        const Vector zero = VectorZero();
+        const Vector infinite = VectorSet(INFINITY, 1.0f, 0.0f, 0.0f);
+        CHECK(SameBits(Vector3Normalize(zero), DX::XMVector3Normalize(ToOracle(zero))));
+        CHECK(SameBits(Vector3Normalize(infinite), DX::XMVector3Normalize(ToOracle(infinite))));
+        CHECK(SameBits(MatrixIdentity(), DX::XMMatrixIdentity()));
+    }
+
+    void TestMultiplyTranspose()
+    {
+        size_t multiplyErrors = 0, transposeErrors = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            const Matrix a = RandomMatrix(), b = RandomMatrix();
+            Reference ra, rb, expected;
+            ToReference(a, ra);
+            ToReference(b, rb);
+            Multiply(ra, rb, expected);
+            if (!NearMatrix(a * b, expected, 16.0)) ++multiplyErrors;
+
+            Reference transposed, actual;
+            ToReference(MatrixTranspose(a), actual);
+            for (int row = 0; row < 4; ++row)
+                for (int column = 0; column < 4; ++column)
+                    transposed[row][column] = ra[column][row];
+            if (memcmp(actual, transposed, sizeof(actual)) != 0) ++transposeErrors;
+        }
+        CHECK(multiplyErrors == 0);
+        CHECK(transposeErrors == 0);
+
+        Reference identity;
+        ToReference(MatrixIdentity(), identity);
+        for (int row = 0; row < 4; ++row)
+            for (int column = 0; column < 4; ++column)
+                CHECK(identity[row][column] == (row == column ? 1.0 : 0.0));
+    }
+
+    void TestInverse()
+    {
+        size_t errors = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            // Мировые матрицы и случайные, у которых определитель не слишком мал
+            const Matrix m = i % 2 ? RandomWorld() : RandomMatrix();
+            Reference rm, expected;
+            ToReference(m, rm);
+            if (!Invert(rm, expected)) continue;
+            Vector determinant = VectorZero();
+            const Matrix inverse = MatrixInverse(&determinant, m);
+            if (std::fabs(VectorGetX(determinant)) < 1e-2f) continue;
+
+            // Для плохо обусловленных допуск растёт с нормой обратной
+            const double scale = MaxAbs(expected) * MaxAbs(rm);
+            if (!NearMatrix(inverse, expected, scale)) ++errors;
+
+            Reference identity;
+            ToReference(m * inverse, identity);
+            for (int row = 0; row < 4; ++row)
+                for (int column = 0; column < 4; ++column)
+                    if (!Near(identity[row][column], row == column ? 1.0 : 0.0, scale)) ++errors;
+        }
+        CHECK(errors == 0);
+
+        // Вырожденная: определитель 0, элементы не конечны
+        Vector determinant = VectorReplicate(1.0f);
+        const Matrix singular = MatrixInverse(&determinant, MatrixScaling(1.0f, 0.0f, 1.0f));
+        CHECK(VectorGetX(determinant) == 0.0f);
+        CHECK(!std::isfinite(VectorGetX(singular.r[0])));
+    }
+
+    void TestRotationsAndProjection()
+    {
+        size_t errors = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            const float angle = RandomFloat(-20.0f, 20.0f);
+            const double s = std::sin((double)angle), c = std::cos((double)angle);
+            const Reference x = { { 1, 0, 0, 0 }, { 0, c, s, 0 }, { 0, -s, c, 0 }, { 0, 0, 0, 1 } };
+            const Reference y = { { c, 0, -s, 0 }, { 0, 1, 0, 0 }, { s, 0, c, 0 }, { 0, 0, 0, 1 } };
+            const Reference z = { { c, s, 0, 0 }, { -s, c, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
+            if (!NearMatrix(MatrixRotationX(angle), x)) ++errors;
+            if (!NearMatrix(MatrixRotationY(angle), y)) ++errors;
+            if (!NearMatrix(MatrixRotationZ(angle), z)) ++errors;
+
+            const float fov = RandomFloat(0.3f, 2.5f), aspect = RandomFloat(0.5f, 3.0f);
+            const float nearZ = RandomFloat(0.01f, 1.0f), farZ = nearZ + RandomFloat(1.0f, 1000.0f);
+            const double height = 1.0 / std::tan(0.5 * fov), range = farZ / ((double)farZ - nearZ);
+            const Reference projection = { { height / aspect, 0, 0, 0 }, { 0, height, 0, 0 }, { 0, 0, range, 1 }, { 0, 0, -range * nearZ, 0 } };
+            if (!NearMatrix(MatrixPerspectiveFovLH(fov, aspect, nearZ, farZ), projection)) ++errors;
+        }
+        CHECK(errors == 0);
+    }
+
+    void TestLookAt()
+    {
+        size_t errors = 0;
+        for (int i = 0; i < 1000; ++i)
+        {
+            const double eye[3] = { RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f) };
+            const double at[3] = { RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f) };
+            double forward[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+            const double distance = std::sqrt(forward[0] * forward[0] + forward[1] * forward[1] + forward[2] * forward[2]);
+            // Взгляд почти вдоль «вверх» или в упор — базис неустойчив и в эталоне
+            if (distance < 1.0 || std::fabs(forward[1]) / distance > 0.95) continue;
+            for (double& component : forward)
+                component /= distance;
+
+            // Правая тройка LH: right = up x forward, up' = forward x right
+            double right[3] = { forward[2], 0.0, -forward[0] };
+            const double rightLength = std::sqrt(right[0] * right[0] + right[2] * right[2]);
+            right[0] /= rightLength;
+            right[2] /= rightLength;
+            const double up[3] = { forward[1] * right[2] - forward[2] * right[1], forward[2] * right[0] - forward[0] * right[2],
+                                   forward[0] * right[1] - forward[1] * right[0] };
+            auto dot = [&eye](const double axis[3]) { return -(axis[0] * eye[0] + axis[1] * eye[1] + axis[2] * eye[2]); };
+            const Reference expected = { { right[0], up[0], forward[0], 0 }, { right[1], up[1], forward[1], 0 },
+                                         { right[2], up[2], forward[2], 0 }, { dot(right), dot(up), dot(forward), 1 } };
+
+            const Matrix view = MatrixLookAtLH(VectorSet((float)eye[0], (float)eye[1], (float)eye[2], 0.0f),
+                VectorSet((float)at[0], (float)at[1], (float)at[2], 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+            if (!NearMatrix(view, expected, 10.0)) ++errors;
+        }
+        CHECK(errors == 0);
+    }
+
+    void TestTransforms()
+    {
+        // Не кратно восьми — пакетный путь проходит и хвост
+        const size_t count = 1003;
+        std::vector<Float3> points(count), coords(count), normals(count);
+        for (Float3& point : points)
+            point = Float3(RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f));
+
+        const Matrix world = RandomWorld();
+        const Matrix viewProjection = world * MatrixLookAtLH(VectorSet(0.0f, 1.0f, -30.0f, 0.0f), VectorSet(0.0f, 0.0f, 0.0f, 0.0f), VectorSet(0.0f, 1.0f, 0.0f, 0.0f)) *
+                                      MatrixPerspectiveFovLH(PiDiv2, 16.0f / 9.0f, 0.1f, 100.0f);
+        Vector3TransformCoordStream(coords.data(), points.data(), count, viewProjection);
+        Vector3TransformNormalStream(normals.data(), points.data(), count, world);
+
+        Reference rViewProjection, rWorld;
+        ToReference(viewProjection, rViewProjection);
+        ToReference(world, rWorld);
+
+        size_t errors = 0, streamMismatches = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double point[3] = { points[i].x, points[i].y, points[i].z };
+            double coord[3], normal[3];
+            TransformReference(point, rViewProjection, true, coord);
+            TransformReference(point, rWorld, false, normal);
+
+            Float3 single;
+            StoreFloat3(&single, Vector3TransformCoord(LoadFloat3(&points[i]), viewProjection));
+            if (memcmp(&single, &coords[i], sizeof(single)) != 0) ++streamMismatches;
+            // Точки у плоскости камеры делятся на малое w: сравниваем относительно величины результата
+            const double coordScale = 100.0 * std::max({ 1.0, std::fabs(coord[0]), std::fabs(coord[1]), std::fabs(coord[2]) });
+            if (!Near(single.x, coord[0], coordScale) || !Near(single.y, coord[1], coordScale) || !Near(single.z, coord[2], coordScale)) ++errors;
+
+            StoreFloat3(&single, Vector3TransformNormal(LoadFloat3(&points[i]), world));
+            if (memcmp(&single, &normals[i], sizeof(single)) != 0) ++streamMismatches;
+            if (!Near(single.x, normal[0], 30.0) || !Near(single.y, normal[1], 30.0) || !Near(single.z, normal[2], 30.0)) ++errors;
+        }
+        CHECK(errors == 0);
+        CHECK(streamMismatches == 0);
+
+        // Вход и выход могут совпадать
+        std::vector<Float3> inPlace = points;
+        Vector3TransformCoordStream(inPlace.data(), inPlace.data(), count, viewProjection);
+        CHECK(memcmp(inPlace.data(), coords.data(), count * sizeof(Float3)) == 0);
+    }
+
+    void TestMatrixStreams()
+    {
+        const size_t count = 257;
+        std::vector<Float4x4> input(count), products(count), transposed(count);
+        for (Float4x4& matrix : input)
+            StoreFloat4x4(&matrix, RandomWorld());
+        const Matrix m = RandomMatrix();
+        MatrixMultiplyStream(products.data(), input.data(), count, m);
+        MatrixMultiplyTransposeStream(transposed.data(), input.data(), count, m);
+
+        size_t errors = 0, streamMismatches = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Matrix product = LoadFloat4x4(&input[i]) * m;
+            Float4x4 single;
+            StoreFloat4x4(&single, product);
+            if (memcmp(&single, &products[i], sizeof(single)) != 0) ++streamMismatches;
+            StoreFloat4x4(&single, MatrixTranspose(product));
+            if (memcmp(&single, &transposed[i], sizeof(single)) != 0) ++streamMismatches;
+
+            Reference a, b, expected;
+            ToReference(LoadFloat4x4(&input[i]), a);
+            ToReference(m, b);
+            Multiply(a, b, expected);
+            if (!NearMatrix(LoadFloat4x4(&products[i]), expected, 100.0)) ++errors;
+        }
+        CHECK(errors == 0);
+        CHECK(streamMismatches == 0);
+    }
+}
+
+int main()
+{
+    std::printf("VectorMath backend: %s\n", BackendName());
+
+    TestDirectXMathBits();
+    TestMultiplyTranspose();
+    TestInverse();
+    TestRotationsAndProjection();
+    TestLookAt();
+    TestTransforms();
+    TestMatrixStreams();
+
+    const MathBenchmark benchmark = BenchmarkVectorMath(1000);
+    CHECK(benchmark.mismatches == 0);
+    return Check::Result();
+}
@@ -0,0 +1,54 @@
+﻿#include "JobSystem.h"
+#include "ViewCulling.h"
+
+#include "Check.h"
+
+#include <vector>
+
+using namespace Math;
+
+namespace
+{
+    Aabb Box(float x, float y, float z, float halfSize)
+    {
+        Aabb box;
+        box.Grow(Float3(x - halfSize, y - halfSize, z - halfSize));
+        box.Grow(Float3(x + halfSize, y + halfSize, z + halfSize));
+        return box;
+    }
+
+    // Камера в начале координат смотрит по +z, FOV 90°, глубина 1..100
+    void TestFrustum()
+    {
+        const Frustum frustum = FrustumFromMatrix(MatrixPerspectiveFovLH(1.5707964f, 1.0f, 1.0f, 100.0f));
+        CHECK(FrustumIntersectsAabb(frustum, Box(0, 0, 10, 1)));
+        CHECK(!FrustumIntersectsAabb(frustum, Box(0, 0, -10, 1)));  // позади
+        CHECK(!FrustumIntersectsAabb(frustum, Box(0, 0, 200, 1)));  // за дальней плоскостью
+        CHECK(!FrustumIntersectsAabb(frustum, Box(30, 0, 10, 1)));  // сбоку
+        CHECK(FrustumIntersectsAabb(frustum, Box(10.5f, 0, 10, 1))); // задевает край
+    }
+
+    // Виды, считаемые параллельно, получают те же очереди, что и по одному
+    // (критерий Lab3.exe -viewbench, размеры меньше)
+    void TestBenchmarkSelfCheck()
+    {
+        for (size_t viewCount : { 1, 2, 8 })
+        {
+            const ViewCullingBenchmark result = BenchmarkViewCulling(4096, viewCount, Jobs().ThreadCount());
+            CHECK(result.mismatches == 0);
+            CHECK(result.views == viewCount && result.visibleFraction > 0.0);
+        }
+    }
+}
+
+int main()
+{
+    // Вид на поток проверяется и на одноядерной машине
+    JobSystemSettings settings;
+    settings.threads = 3;
+    ConfigureJobs(settings);
+
+    TestFrustum();
+    TestBenchmarkSelfCheck();
+    return Check::Result();
+}